@@ -0,0 +1,191 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace KDGpuBenchmarks {
+
+namespace {
+
+volatile uint64_t g_sink = 0;
+
+std::string escapeJson(const std::string &str)
+{
+    std::string escaped;
+    escaped.reserve(str.size());
+    for (const char c : str) {
+        switch (c) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                escaped += buffer;
+            } else {
+                escaped += c;
+            }
+            break;
+        }
+    }
+    return escaped;
+}
+
+} // namespace
+
+State::State(uint64_t iterations)
+    : m_iterations(iterations)
+{
+}
+
+void State::pauseTiming()
+{
+    if (!m_running)
+        return;
+    m_elapsedNs += std::chrono::duration<double, std::nano>(Clock::now() - m_start).count();
+    m_running = false;
+}
+
+void State::resumeTiming()
+{
+    if (m_running)
+        return;
+    m_running = true;
+    m_start = Clock::now();
+}
+
+void State::consume(uint64_t value)
+{
+    g_sink = value;
+}
+
+Runner::Runner(const RunnerOptions &options)
+    : m_options(options)
+{
+}
+
+void Runner::add(const std::string &name, BenchmarkFunction function, uint64_t maxIterations)
+{
+    if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos)
+        return;
+    const uint64_t limit = maxIterations > 0 ? std::min(maxIterations, m_options.maxIterations) : m_options.maxIterations;
+    m_benchmarks.push_back({ name, std::move(function), limit });
+}
+
+void Runner::setContext(const std::string &key, const std::string &value)
+{
+    m_context.emplace_back(key, value);
+}
+
+double Runner::measure(const Benchmark &benchmark, uint64_t iterations, uint64_t &itemsPerIteration) const
+{
+    State state(iterations);
+    state.resumeTiming();
+    benchmark.function(state);
+    state.pauseTiming();
+    itemsPerIteration = state.itemsPerIteration();
+    return state.elapsedNs();
+}
+
+const std::vector<Result> &Runner::run()
+{
+    const double minTimeNs = m_options.minTimeMs * 1.0e6;
+
+    m_results.clear();
+    m_results.reserve(m_benchmarks.size());
+    for (const auto &benchmark : m_benchmarks) {
+        std::fprintf(stderr, "Running %s...\n", benchmark.name.c_str());
+
+        // Find an iteration count which runs for at least minTime
+        uint64_t iterations = 1;
+        uint64_t itemsPerIteration = 1;
+        for (;;) {
+            const double elapsedNs = measure(benchmark, iterations, itemsPerIteration);
+            if (elapsedNs >= minTimeNs || iterations >= benchmark.maxIterations)
+                break;
+            const double predicted = elapsedNs > 0.0 ? double(iterations) * minTimeNs * 1.2 / elapsedNs : double(iterations) * 100.0;
+            const double next = std::clamp(predicted, double(iterations) * 2.0, double(iterations) * 100.0);
+            iterations = std::min<uint64_t>(static_cast<uint64_t>(next), benchmark.maxIterations);
+        }
+
+        std::vector<double> samples;
+        samples.reserve(m_options.repetitions);
+        for (uint32_t i = 0; i < std::max(1U, m_options.repetitions); ++i)
+            samples.push_back(measure(benchmark, iterations, itemsPerIteration) / double(iterations));
+        std::sort(samples.begin(), samples.end());
+
+        Result result;
+        result.name = benchmark.name;
+        result.iterations = iterations;
+        result.itemsPerIteration = itemsPerIteration;
+        result.nsPerIteration = samples[samples.size() / 2];
+        result.minNsPerIteration = samples.front();
+        result.maxNsPerIteration = samples.back();
+        result.itemsPerSecond = result.nsPerIteration > 0.0 ? double(itemsPerIteration) * 1.0e9 / result.nsPerIteration : 0.0;
+        m_results.push_back(result);
+    }
+    return m_results;
+}
+
+void Runner::printTable(std::FILE *stream) const
+{
+    std::fprintf(stream, "%-52s %12s %14s %16s\n", "benchmark", "iterations", "ns/iteration", "items/s");
+    for (const auto &result : m_results) {
+        std::fprintf(stream, "%-52s %12llu %14.1f %16.0f\n",
+                     result.name.c_str(),
+                     static_cast<unsigned long long>(result.iterations),
+                     result.nsPerIteration,
+                     result.itemsPerSecond);
+    }
+}
+
+std::string Runner::toJson() const
+{
+    std::ostringstream json;
+    json.precision(12);
+
+    json << "{\n  \"context\": {";
+    for (size_t i = 0; i < m_context.size(); ++i) {
+        json << (i == 0 ? "\n" : ",\n")
+             << "    \"" << escapeJson(m_context[i].first) << "\": \"" << escapeJson(m_context[i].second) << "\"";
+    }
+    json << "\n  },\n  \"benchmarks\": [";
+
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const Result &result = m_results[i];
+        json << (i == 0 ? "\n" : ",\n")
+             << "    {\n"
+             << "      \"name\": \"" << escapeJson(result.name) << "\",\n"
+             << "      \"iterations\": " << result.iterations << ",\n"
+             << "      \"repetitions\": " << std::max(1U, m_options.repetitions) << ",\n"
+             << "      \"items_per_iteration\": " << result.itemsPerIteration << ",\n"
+             << "      \"ns_per_iteration\": " << result.nsPerIteration << ",\n"
+             << "      \"min_ns_per_iteration\": " << result.minNsPerIteration << ",\n"
+             << "      \"max_ns_per_iteration\": " << result.maxNsPerIteration << ",\n"
+             << "      \"items_per_second\": " << result.itemsPerSecond << "\n"
+             << "    }";
+    }
+    json << "\n  ]\n}\n";
+
+    return json.str();
+}
+
+} // namespace KDGpuBenchmarks
@@ -0,0 +1,114 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace KDGpuBenchmarks {
+
+/**
+ * Handed to every benchmark function. The function must run its operation
+ * iterations() times. Setup and teardown which should not be measured can be
+ * excluded with pauseTiming() / resumeTiming().
+ */
+class State
+{
+public:
+    explicit State(uint64_t iterations);
+
+    uint64_t iterations() const noexcept { return m_iterations; }
+
+    // Number of items (draws, lookups...) processed by one iteration, used for the throughput
+    void setItemsPerIteration(uint64_t items) noexcept { m_itemsPerIteration = items; }
+    uint64_t itemsPerIteration() const noexcept { return m_itemsPerIteration; }
+
+    void pauseTiming();
+    void resumeTiming();
+
+    double elapsedNs() const noexcept { return m_elapsedNs; }
+
+    // Prevents the compiler from optimizing away the computation of value
+    static void consume(uint64_t value);
+
+private:
+    friend class Runner;
+
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t m_iterations;
+    uint64_t m_itemsPerIteration{ 1 };
+    double m_elapsedNs{ 0.0 };
+    Clock::time_point m_start;
+    bool m_running{ false };
+};
+
+using BenchmarkFunction = std::function<void(State &)>;
+
+struct Result {
+    std::string name; // <suite>/<benchmark>
+    uint64_t iterations{ 0 };
+    uint64_t itemsPerIteration{ 1 };
+    double nsPerIteration{ 0.0 }; // Median of the repetitions
+    double minNsPerIteration{ 0.0 };
+    double maxNsPerIteration{ 0.0 };
+    double itemsPerSecond{ 0.0 };
+};
+
+struct RunnerOptions {
+    std::string filter; // Only run benchmarks whose name contains this string
+    double minTimeMs{ 100.0 }; // Minimum measured time of each repetition
+    uint32_t repetitions{ 3 };
+    uint64_t maxIterations{ 10000000 };
+};
+
+class Runner
+{
+public:
+    explicit Runner(const RunnerOptions &options);
+
+    // maxIterations caps the iteration count of benchmarks with a bounded amount of resources (0 = default)
+    void add(const std::string &name, BenchmarkFunction function, uint64_t maxIterations = 0);
+
+    const std::vector<Result> &run();
+    const std::vector<Result> &results() const noexcept { return m_results; }
+
+    void setContext(const std::string &key, const std::string &value);
+    void printTable(std::FILE *stream = stdout) const;
+    std::string toJson() const;
+
+private:
+    struct Benchmark {
+        std::string name;
+        BenchmarkFunction function;
+        uint64_t maxIterations;
+    };
+
+    double measure(const Benchmark &benchmark, uint64_t iterations, uint64_t &itemsPerIteration) const;
+
+    RunnerOptions m_options;
+    std::vector<Benchmark> m_benchmarks;
+    std::vector<std::pair<std::string, std::string>> m_context;
+    std::vector<Result> m_results;
+};
+
+struct GpuContext;
+
+// Each suite registers its benchmarks with the runner
+void registerPoolBenchmarks(Runner &runner);
+void registerResourceBenchmarks(Runner &runner, GpuContext &context);
+void registerRecordingBenchmarks(Runner &runner, GpuContext &context);
+
+} // namespace KDGpuBenchmarks
@@ -0,0 +1,57 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "gpu_context.h"
+
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#include <cstdio>
+
+using namespace KDGpu;
+
+namespace KDGpuBenchmarks {
+
+bool GpuContext::initialize(const std::string &adapterName)
+{
+    api = std::make_unique<VulkanGraphicsApi>();
+    instance = api->createInstance(InstanceOptions{
+            .applicationName = "kdgpu_benchmarks",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    if (!instance.isValid()) {
+        std::fprintf(stderr, "Failed to create a Vulkan instance\n");
+        return false;
+    }
+
+    if (adapterName.empty()) {
+        adapter = instance.selectAdapter(AdapterDeviceType::Default);
+    } else {
+        for (Adapter *candidate : instance.adapters()) {
+            if (candidate->properties().deviceName.find(adapterName) != std::string::npos) {
+                adapter = candidate;
+                break;
+            }
+        }
+    }
+    if (!adapter) {
+        std::fprintf(stderr, "No adapter matching \"%s\" found\n", adapterName.c_str());
+        return false;
+    }
+
+    device = adapter->createDevice();
+    if (!device.isValid() || device.queues().empty()) {
+        std::fprintf(stderr, "Failed to create a device on %s\n", adapter->properties().deviceName.c_str());
+        return false;
+    }
+    queue = &device.queues()[0];
+
+    return true;
+}
+
+} // namespace KDGpuBenchmarks
@@ -0,0 +1,37 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/adapter.h>
+#include <KDGpu/device.h>
+#include <KDGpu/graphics_api.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/queue.h>
+
+#include <memory>
+#include <string>
+
+namespace KDGpuBenchmarks {
+
+// The device shared by all the benchmarks which need one. No surface is ever
+// created so the benchmarks can run headless, e.g. on lavapipe.
+struct GpuContext {
+    std::unique_ptr<KDGpu::GraphicsApi> api;
+    KDGpu::Instance instance;
+    KDGpu::Adapter *adapter{ nullptr };
+    KDGpu::Device device;
+    KDGpu::Queue *queue{ nullptr };
+
+    // Picks the first adapter whose name contains adapterName, or the default adapter if empty
+    bool initialize(const std::string &adapterName);
+};
+
+} // namespace KDGpuBenchmarks
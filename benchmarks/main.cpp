@@ -0,0 +1,145 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "benchmark.h"
+#include "gpu_context.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Runs the CPU side benchmarks of KDGpu and reports them as a table and, on
+// request, as JSON so results can be compared between releases.
+//
+// No window or surface is created, so the benchmarks can run headless. To run
+// them on a software implementation, point the Vulkan loader at it, e.g.:
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json kdgpu_benchmarks --json results.json
+
+namespace {
+
+void printUsage(const char *program)
+{
+    std::printf("Usage: %s [options]\n"
+                "  --json <file>         Write the results as JSON to file, - for stdout\n"
+                "                        (the table then goes to stderr)\n"
+                "  --filter <substring>  Only run the benchmarks whose name contains substring\n"
+                "  --adapter <substring> Use the first adapter whose name contains substring\n"
+                "  --min-time <ms>       Minimum duration of each repetition (default 100)\n"
+                "  --repetitions <n>     Number of repetitions, the median is reported (default 3)\n"
+                "  --no-gpu              Only run the benchmarks which do not need a device\n"
+                "  --help                Show this help\n",
+                program);
+}
+
+std::string currentDate()
+{
+    const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return buffer;
+}
+
+std::string versionToString(uint32_t version)
+{
+    // Same layout as VK_MAKE_API_VERSION
+    return std::to_string((version >> 22U) & 0x7FU) + "." +
+            std::to_string((version >> 12U) & 0x3FFU) + "." +
+            std::to_string(version & 0xFFFU);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    using namespace KDGpuBenchmarks;
+
+    RunnerOptions options;
+    std::string jsonPath;
+    std::string adapterName;
+    bool useGpu = true;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--json") == 0 && hasValue) {
+            jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--adapter") == 0 && hasValue) {
+            adapterName = argv[++i];
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            options.minTimeMs = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            options.repetitions = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--no-gpu") == 0) {
+            useGpu = false;
+        } else if (std::strcmp(argv[i], "--help") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::fprintf(stderr, "Unknown or incomplete option %s\n", argv[i]);
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Declared before the runner so that the resources captured by the benchmarks are released first
+    GpuContext context;
+    if (useGpu && !context.initialize(adapterName))
+        return 1;
+
+    Runner runner(options);
+    runner.setContext("date", currentDate());
+#if defined(NDEBUG)
+    runner.setContext("build_type", "release");
+#else
+    runner.setContext("build_type", "debug");
+#endif
+    if (useGpu) {
+        const auto &properties = context.adapter->properties();
+        runner.setContext("adapter", properties.deviceName);
+        runner.setContext("adapter_type", KDGpu::adapterDeviceTypeToString(properties.deviceType));
+        runner.setContext("api_version", versionToString(properties.apiVersion));
+        runner.setContext("driver_version", std::to_string(properties.driverVersion));
+    }
+
+    registerPoolBenchmarks(runner);
+    if (useGpu) {
+        registerResourceBenchmarks(runner, context);
+        registerRecordingBenchmarks(runner, context);
+    }
+
+    runner.run();
+    // Keep stdout parseable when the JSON is written to it
+    runner.printTable(jsonPath == "-" ? stderr : stdout);
+
+    if (!jsonPath.empty()) {
+        const std::string json = runner.toJson();
+        if (jsonPath == "-") {
+            std::cout << json;
+        } else {
+            std::ofstream file(jsonPath);
+            if (!file) {
+                std::fprintf(stderr, "Failed to open %s for writing\n", jsonPath.c_str());
+                return 1;
+            }
+            file << json;
+        }
+    }
+
+    if (useGpu)
+        context.device.waitUntilIdle();
+
+    return 0;
+}
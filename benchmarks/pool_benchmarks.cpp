@@ -0,0 +1,417 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "benchmark.h"
+
+#include <KDGpu/concurrent_pool.h>
+#include <KDGpu/pool.h>
+#include <KDGpu/transient_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Benchmarks of the containers backing the ResourceManager. They do not need a device.
+
+namespace KDGpuBenchmarks {
+
+namespace {
+
+// Roughly the size of the smaller Vulkan resource structs
+struct Payload {
+    uint64_t a{ 0 };
+    uint64_t b{ 0 };
+    uint64_t c{ 0 };
+    uint64_t d{ 0 };
+};
+
+struct payload_tag;
+using PayloadHandle = KDGpu::Handle<payload_tag>;
+
+// The Pool before it became a slot map: data and generations in two separate vectors, reused
+// slots move assigned from a temporary and every index probed to find the alive entries.
+// Kept as the baseline of the Pool benchmarks.
+class LegacyPool
+{
+public:
+    // KDGpu::Handle can't be constructed outside of KDGpu
+    struct Handle {
+        uint32_t index{ 0 };
+        uint32_t generation{ 0 };
+    };
+
+    explicit LegacyPool(uint32_t size = 64)
+        : m_capacity(size)
+    {
+        m_data.reserve(size);
+        m_generations.reserve(size);
+        m_freeIndices.reserve(size);
+    }
+
+    uint32_t size() const noexcept { return m_data.size() - m_freeIndices.size(); }
+
+    Payload *get(const Handle &handle) noexcept
+    {
+        if (!canUseHandle(handle))
+            return nullptr;
+        return &m_data[handle.index];
+    }
+
+    Handle emplace(const Payload &payload)
+    {
+        if (size() >= m_capacity)
+            growCapacity();
+
+        if (m_freeIndices.size() > 0) {
+            Handle handle;
+            handle.index = m_freeIndices.back();
+            m_freeIndices.pop_back();
+            handle.generation = m_generations[handle.index].generation;
+            m_generations[handle.index].isAlive = true;
+            m_data[handle.index] = Payload(payload);
+            return handle;
+        }
+
+        m_data.emplace_back(payload);
+        m_generations.emplace_back(GenerationEntry{ 1, true });
+        return Handle{ static_cast<uint32_t>(m_data.size() - 1), 1 };
+    }
+
+    void remove(const Handle &handle)
+    {
+        if (!canUseHandle(handle))
+            return;
+        auto &generation = m_generations[handle.index];
+        ++generation.generation;
+        generation.isAlive = false;
+        m_freeIndices.push_back(handle.index);
+    }
+
+    Handle handleForIndex(uint32_t entryIndex) const
+    {
+        if (entryIndex >= m_generations.size() || m_generations[entryIndex].isAlive == false)
+            return {};
+        return Handle{ entryIndex, m_generations[entryIndex].generation };
+    }
+
+    uint32_t slotCount() const noexcept { return static_cast<uint32_t>(m_data.size()); }
+
+private:
+    bool canUseHandle(const Handle &handle) const noexcept
+    {
+        return handle.index < m_data.size() && handle.generation == m_generations[handle.index].generation && m_generations[handle.index].isAlive;
+    }
+
+    void growCapacity()
+    {
+        m_capacity *= 2;
+        if (m_capacity == 0)
+            m_capacity = 1;
+        m_data.reserve(m_capacity);
+        m_generations.reserve(m_capacity);
+        m_freeIndices.reserve(m_capacity);
+    }
+
+    struct GenerationEntry {
+        uint32_t generation{ 0 };
+        bool isAlive{ false };
+    };
+
+    std::vector<Payload> m_data;
+    std::vector<GenerationEntry> m_generations;
+    std::vector<uint32_t> m_freeIndices;
+    uint32_t m_capacity;
+};
+
+template<typename PoolType>
+using HandleOf = decltype(std::declval<PoolType &>().emplace(Payload{}));
+
+constexpr uint32_t EntryCount = 1U << 16;
+constexpr uint64_t MaxInsertions = 1U << 20;
+
+uint32_t nextRandom(uint32_t &state)
+{
+    state = state * 1664525 + 1013904223;
+    return state;
+}
+
+template<typename PoolType>
+void populate(PoolType &pool, std::vector<HandleOf<PoolType>> &handles, uint32_t count)
+{
+    handles.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+        handles.push_back(pool.emplace(Payload{ i, 0, 0, 0 }));
+}
+
+template<typename PoolType>
+void registerCommonBenchmarks(Runner &runner, const std::string &prefix)
+{
+    runner.add(
+            prefix + "/emplace", [](State &state) {
+                state.pauseTiming();
+                auto pool = std::make_unique<PoolType>();
+                state.resumeTiming();
+                for (uint64_t i = 0; i < state.iterations(); ++i)
+                    pool->emplace(Payload{ i, 0, 0, 0 });
+                state.pauseTiming();
+                pool.reset();
+            },
+            MaxInsertions);
+
+    runner.add(prefix + "/get", [](State &state) {
+        state.pauseTiming();
+        auto pool = std::make_unique<PoolType>(EntryCount);
+        std::vector<HandleOf<PoolType>> handles;
+        populate(*pool, handles, EntryCount);
+        state.resumeTiming();
+
+        uint32_t random = 1;
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < state.iterations(); ++i)
+            sum += pool->get(handles[nextRandom(random) % EntryCount])->a;
+        State::consume(sum);
+
+        state.pauseTiming();
+        pool.reset();
+    });
+}
+
+template<typename PoolType>
+void registerChurnBenchmark(Runner &runner, const std::string &prefix)
+{
+    runner.add(prefix + "/remove+emplace", [](State &state) {
+        state.pauseTiming();
+        auto pool = std::make_unique<PoolType>(EntryCount);
+        std::vector<HandleOf<PoolType>> handles;
+        populate(*pool, handles, EntryCount);
+        state.resumeTiming();
+
+        uint32_t random = 7;
+        for (uint64_t i = 0; i < state.iterations(); ++i) {
+            const uint32_t slot = nextRandom(random) % EntryCount;
+            pool->remove(handles[slot]);
+            handles[slot] = pool->emplace(Payload{ i, 0, 0, 0 });
+        }
+
+        state.pauseTiming();
+        pool.reset();
+    });
+}
+
+// Mostly lookups with some creation and destruction from every thread at once.
+// The baseline is Pool guarded by a single mutex.
+template<typename Access>
+void runContendedWorkload(State &state, uint32_t threadCount)
+{
+    constexpr uint32_t PrePopulatedCount = 1024;
+    constexpr uint32_t LookupsPerMutation = 16;
+
+    state.pauseTiming();
+    Access access(PrePopulatedCount * 2);
+    std::vector<PayloadHandle> shared;
+    shared.reserve(PrePopulatedCount);
+    for (uint32_t i = 0; i < PrePopulatedCount; ++i)
+        shared.push_back(access.insert(Payload{ i, 0, 0, 0 }));
+
+    const uint64_t operationsPerThread = std::max<uint64_t>(1, state.iterations() / threadCount);
+    std::atomic<bool> start{ false };
+    std::atomic<uint64_t> sink{ 0 };
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+
+    for (uint32_t t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            while (!start.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            uint64_t localSum = 0;
+            std::vector<PayloadHandle> owned;
+            owned.reserve(64);
+            uint32_t cursor = t * 7919;
+
+            for (uint64_t i = 0; i < operationsPerThread; ++i) {
+                if (i % LookupsPerMutation == 0) {
+                    if (owned.size() < 64) {
+                        owned.push_back(access.insert(Payload{ i, t, 0, 0 }));
+                    } else {
+                        access.remove(owned.back());
+                        owned.pop_back();
+                    }
+                } else {
+                    localSum += access.read(shared[nextRandom(cursor) % PrePopulatedCount]);
+                }
+            }
+
+            for (const auto &handle : owned)
+                access.remove(handle);
+            sink.fetch_add(localSum, std::memory_order_relaxed);
+        });
+    }
+
+    state.resumeTiming();
+    start.store(true, std::memory_order_release);
+    for (auto &thread : threads)
+        thread.join();
+    state.pauseTiming();
+
+    State::consume(sink.load());
+}
+
+class LockedPoolAccess
+{
+public:
+    explicit LockedPoolAccess(uint32_t size)
+        : m_pool(size)
+    {
+    }
+
+    PayloadHandle insert(const Payload &payload)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pool.insert(payload);
+    }
+
+    void remove(const PayloadHandle &handle)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pool.remove(handle);
+    }
+
+    uint64_t read(const PayloadHandle &handle)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Payload *payload = m_pool.get(handle);
+        return payload ? payload->a : 0;
+    }
+
+private:
+    std::mutex m_mutex;
+    KDGpu::Pool<Payload, payload_tag> m_pool;
+};
+
+class ConcurrentPoolAccess
+{
+public:
+    explicit ConcurrentPoolAccess(uint32_t size)
+        : m_pool(size)
+    {
+    }
+
+    PayloadHandle insert(const Payload &payload) { return m_pool.insert(payload); }
+    void remove(const PayloadHandle &handle) { m_pool.remove(handle); }
+    uint64_t read(const PayloadHandle &handle)
+    {
+        const Payload *payload = m_pool.get(handle);
+        return payload ? payload->a : 0;
+    }
+
+private:
+    KDGpu::ConcurrentPool<Payload, payload_tag> m_pool;
+};
+
+} // namespace
+
+void registerPoolBenchmarks(Runner &runner)
+{
+    using Pool = KDGpu::Pool<Payload, payload_tag>;
+    using ConcurrentPool = KDGpu::ConcurrentPool<Payload, payload_tag>;
+    using TransientPool = KDGpu::TransientPool<Payload, payload_tag>;
+
+    registerCommonBenchmarks<LegacyPool>(runner, "pool/LegacyPool");
+    registerChurnBenchmark<LegacyPool>(runner, "pool/LegacyPool");
+    runner.add("pool/LegacyPool/forEach(1/16 occupancy)", [](State &state) {
+        state.pauseTiming();
+        auto pool = std::make_unique<LegacyPool>(EntryCount);
+        std::vector<LegacyPool::Handle> handles;
+        populate(*pool, handles, EntryCount);
+        for (uint32_t i = 0; i < EntryCount; ++i) {
+            if (i % 16 != 0)
+                pool->remove(handles[i]);
+        }
+        state.setItemsPerIteration(pool->size());
+        state.resumeTiming();
+
+        // It has no forEach(), every slot has to be probed
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < state.iterations(); ++i) {
+            const uint32_t slotCount = pool->slotCount();
+            for (uint32_t slot = 0; slot < slotCount; ++slot) {
+                const LegacyPool::Handle handle = pool->handleForIndex(slot);
+                if (handle.generation != 0)
+                    sum += pool->get(handle)->a;
+            }
+        }
+        State::consume(sum);
+
+        state.pauseTiming();
+        pool.reset();
+    });
+
+    registerCommonBenchmarks<Pool>(runner, "pool/Pool");
+    registerChurnBenchmark<Pool>(runner, "pool/Pool");
+    runner.add("pool/Pool/forEach(1/16 occupancy)", [](State &state) {
+        state.pauseTiming();
+        auto pool = std::make_unique<Pool>(EntryCount);
+        std::vector<PayloadHandle> handles;
+        populate(*pool, handles, EntryCount);
+        for (uint32_t i = 0; i < EntryCount; ++i) {
+            if (i % 16 != 0)
+                pool->remove(handles[i]);
+        }
+        state.setItemsPerIteration(pool->size());
+        state.resumeTiming();
+
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < state.iterations(); ++i)
+            pool->forEach([&](const PayloadHandle &, Payload &payload) { sum += payload.a; });
+        State::consume(sum);
+
+        state.pauseTiming();
+        pool.reset();
+    });
+
+    registerCommonBenchmarks<ConcurrentPool>(runner, "pool/ConcurrentPool");
+    registerChurnBenchmark<ConcurrentPool>(runner, "pool/ConcurrentPool");
+
+    const uint32_t threadCount = std::max(2U, std::thread::hardware_concurrency());
+    const std::string threadSuffix = "/threads:" + std::to_string(threadCount);
+    runner.add("pool/Pool+mutex/contended" + threadSuffix, [threadCount](State &state) {
+        runContendedWorkload<LockedPoolAccess>(state, threadCount);
+    });
+    runner.add("pool/ConcurrentPool/contended" + threadSuffix, [threadCount](State &state) {
+        runContendedWorkload<ConcurrentPoolAccess>(state, threadCount);
+    });
+
+    registerCommonBenchmarks<TransientPool>(runner, "pool/TransientPool");
+    runner.add("pool/TransientPool/frame(8 entries)", [](State &state) {
+        // The typical frame: a command recorder and a few pass recorders which are all released at the end
+        constexpr uint32_t EntriesPerFrame = 8;
+        state.pauseTiming();
+        auto pool = std::make_unique<TransientPool>(EntriesPerFrame);
+        state.setItemsPerIteration(EntriesPerFrame);
+        state.resumeTiming();
+
+        PayloadHandle handles[EntriesPerFrame];
+        for (uint64_t i = 0; i < state.iterations(); ++i) {
+            for (uint32_t e = 0; e < EntriesPerFrame; ++e)
+                handles[e] = pool->emplace(Payload{ i, e, 0, 0 });
+            for (uint32_t e = 0; e < EntriesPerFrame; ++e)
+                pool->remove(handles[e]);
+        }
+
+        state.pauseTiming();
+        pool.reset();
+    });
+}
+
+} // namespace KDGpuBenchmarks
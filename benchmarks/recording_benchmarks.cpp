@@ -0,0 +1,291 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "benchmark.h"
+#include "gpu_context.h"
+
+#include <KDGpu/bind_group.h>
+#include <KDGpu/bind_group_layout.h>
+#include <KDGpu/bind_group_layout_options.h>
+#include <KDGpu/bind_group_options.h>
+#include <KDGpu/buffer.h>
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/command_buffer.h>
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/graphics_pipeline.h>
+#include <KDGpu/graphics_pipeline_options.h>
+#include <KDGpu/pipeline_layout.h>
+#include <KDGpu/pipeline_layout_options.h>
+#include <KDGpu/render_pass_command_recorder.h>
+#include <KDGpu/shader_module.h>
+#include <KDGpu/texture.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/texture_view.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Cost of recording and submitting commands. These only measure the CPU side:
+// the recorded command buffers are never submitted, except by the submit
+// benchmarks which keep the GPU work empty.
+
+using namespace KDGpu;
+
+namespace KDGpuBenchmarks {
+
+namespace {
+
+inline std::string assetPath()
+{
+#if defined(KDGPU_ASSET_PATH)
+    return KDGPU_ASSET_PATH;
+#else
+    return "";
+#endif
+}
+
+// Commands recorded into one render pass before starting over with a new command buffer
+constexpr uint64_t CommandsPerPass = 4096;
+// Render passes recorded into one command buffer before starting over
+constexpr uint64_t PassesPerCommandBuffer = 1024;
+// Command buffers submitted before waiting for the queue to drain
+constexpr uint32_t SubmissionsInFlight = 64;
+
+struct RecordingScene {
+    Texture colorTexture;
+    TextureView colorTextureView;
+    ShaderModule vertexShader;
+    ShaderModule fragmentShader;
+    Buffer vertexBuffer;
+    Buffer uniformBuffer;
+    BindGroupLayout bindGroupLayout;
+    BindGroup bindGroup;
+    PipelineLayout pipelineLayout;
+    GraphicsPipeline pipeline;
+    RenderPassCommandRecorderOptions renderPassOptions;
+};
+
+// Calls func(pass, i) state.iterations() times, spread over as many render passes as needed
+template<typename Func>
+void recordInRenderPasses(State &state, Device &device, const RecordingScene &scene, Func &&func)
+{
+    uint64_t recorded = 0;
+    while (recorded < state.iterations()) {
+        state.pauseTiming();
+        CommandRecorder recorder = device.createCommandRecorder();
+        RenderPassCommandRecorder pass = recorder.beginRenderPass(scene.renderPassOptions);
+        pass.setPipeline(scene.pipeline);
+        pass.setVertexBuffer(0, scene.vertexBuffer);
+        pass.setBindGroup(0, scene.bindGroup);
+        const uint64_t count = std::min(CommandsPerPass, state.iterations() - recorded);
+        state.resumeTiming();
+
+        for (uint64_t i = 0; i < count; ++i)
+            func(pass, recorded + i);
+
+        state.pauseTiming();
+        pass.end();
+        CommandBuffer commandBuffer = recorder.finish();
+        recorded += count;
+        state.resumeTiming();
+    }
+}
+
+} // namespace
+
+void registerRecordingBenchmarks(Runner &runner, GpuContext &context)
+{
+    Device *device = &context.device;
+    Queue *queue = context.queue;
+    auto scene = std::make_shared<RecordingScene>();
+
+    scene->colorTexture = device->createTexture(TextureOptions{
+            .type = TextureType::TextureType2D,
+            .format = Format::R8G8B8A8_UNORM,
+            .extent = { 256, 256, 1 },
+            .mipLevels = 1,
+            .usage = TextureUsageFlagBits::ColorAttachmentBit,
+            .memoryUsage = MemoryUsage::GpuOnly,
+    });
+    scene->colorTextureView = scene->colorTexture.createView();
+
+    scene->vertexShader = device->createShaderModule(readShaderFile(assetPath() + "/shaders/tests/render_pass_command_recorder/triangle.vert.spv"));
+    scene->fragmentShader = device->createShaderModule(readShaderFile(assetPath() + "/shaders/tests/render_pass_command_recorder/triangle.frag.spv"));
+
+    const float vertexData[] = {
+        1.0f, -1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+        -1.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+        0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f
+    };
+    scene->vertexBuffer = device->createBuffer(BufferOptions{
+                                                       .size = sizeof(vertexData),
+                                                       .usage = BufferUsageFlagBits::VertexBufferBit,
+                                                       .memoryUsage = MemoryUsage::CpuToGpu,
+                                               },
+                                               vertexData);
+    scene->uniformBuffer = device->createBuffer(BufferOptions{
+            .size = 256,
+            .usage = BufferUsageFlagBits::UniformBufferBit,
+            .memoryUsage = MemoryUsage::CpuToGpu,
+    });
+
+    scene->bindGroupLayout = device->createBindGroupLayout(BindGroupLayoutOptions{
+            .bindings = {
+                    { .binding = 0, .resourceType = ResourceBindingType::UniformBuffer, .shaderStages = ShaderStageFlagBits::VertexBit },
+            },
+    });
+    scene->bindGroup = device->createBindGroup(BindGroupOptions{
+            .layout = scene->bindGroupLayout,
+            .resources = {
+                    { .binding = 0, .resource = UniformBufferBinding{ .buffer = scene->uniformBuffer } },
+            },
+    });
+    scene->pipelineLayout = device->createPipelineLayout({ .bindGroupLayouts = { scene->bindGroupLayout } });
+    scene->pipeline = device->createGraphicsPipeline(GraphicsPipelineOptions{
+            .shaderStages = {
+                    { .shaderModule = scene->vertexShader.handle(), .stage = ShaderStageFlagBits::VertexBit },
+                    { .shaderModule = scene->fragmentShader.handle(), .stage = ShaderStageFlagBits::FragmentBit },
+            },
+            .layout = scene->pipelineLayout,
+            .vertex = {
+                    .buffers = {
+                            { .binding = 0, .stride = 2 * 4 * sizeof(float) },
+                    },
+                    .attributes = {
+                            { .location = 0, .binding = 0, .format = Format::R32G32B32A32_SFLOAT },
+                            { .location = 1, .binding = 0, .format = Format::R32G32B32A32_SFLOAT, .offset = 4 * sizeof(float) },
+                    },
+            },
+            .renderTargets = {
+                    { .format = Format::R8G8B8A8_UNORM },
+            },
+    });
+
+    scene->renderPassOptions = RenderPassCommandRecorderOptions{
+        .colorAttachments = {
+                { .view = scene->colorTextureView,
+                  .clearValue = { 0.0f, 0.0f, 0.0f, 1.0f } },
+        },
+    };
+
+    runner.add("recording/draw", [device, scene](State &state) {
+        const DrawCommand drawCommand{ .vertexCount = 3 };
+        recordInRenderPasses(state, *device, *scene, [&](RenderPassCommandRecorder &pass, uint64_t) {
+            pass.draw(drawCommand);
+        });
+    });
+
+    runner.add("recording/setVertexBuffer+draw", [device, scene](State &state) {
+        const DrawCommand drawCommand{ .vertexCount = 3 };
+        recordInRenderPasses(state, *device, *scene, [&](RenderPassCommandRecorder &pass, uint64_t) {
+            pass.setVertexBuffer(0, scene->vertexBuffer);
+            pass.draw(drawCommand);
+        });
+    });
+
+    runner.add("recording/setBindGroup", [device, scene](State &state) {
+        recordInRenderPasses(state, *device, *scene, [&](RenderPassCommandRecorder &pass, uint64_t) {
+            pass.setBindGroup(0, scene->bindGroup);
+        });
+    });
+
+    runner.add("recording/setPipeline", [device, scene](State &state) {
+        recordInRenderPasses(state, *device, *scene, [&](RenderPassCommandRecorder &pass, uint64_t) {
+            pass.setPipeline(scene->pipeline);
+        });
+    });
+
+    // Every pass after the first hits the render pass and framebuffer caches of the device
+    runner.add("recording/beginRenderPass+end(cached)", [device, scene](State &state) {
+        uint64_t recorded = 0;
+        while (recorded < state.iterations()) {
+            state.pauseTiming();
+            CommandRecorder recorder = device->createCommandRecorder();
+            const uint64_t count = std::min(PassesPerCommandBuffer, state.iterations() - recorded);
+            state.resumeTiming();
+
+            for (uint64_t i = 0; i < count; ++i) {
+                RenderPassCommandRecorder pass = recorder.beginRenderPass(scene->renderPassOptions);
+                pass.end();
+            }
+
+            state.pauseTiming();
+            CommandBuffer commandBuffer = recorder.finish();
+            recorded += count;
+            state.resumeTiming();
+        }
+    });
+
+    // A whole frame: recorder, one render pass with 100 draws, finish
+    runner.add("recording/frame(100 draws)", [device, scene](State &state) {
+        constexpr uint32_t DrawsPerFrame = 100;
+        const DrawCommand drawCommand{ .vertexCount = 3 };
+        state.setItemsPerIteration(DrawsPerFrame);
+        for (uint64_t i = 0; i < state.iterations(); ++i) {
+            CommandRecorder recorder = device->createCommandRecorder();
+            RenderPassCommandRecorder pass = recorder.beginRenderPass(scene->renderPassOptions);
+            pass.setPipeline(scene->pipeline);
+            pass.setVertexBuffer(0, scene->vertexBuffer);
+            pass.setBindGroup(0, scene->bindGroup);
+            for (uint32_t d = 0; d < DrawsPerFrame; ++d)
+                pass.draw(drawCommand);
+            pass.end();
+            CommandBuffer commandBuffer = recorder.finish();
+        }
+    });
+
+    // A command buffer must not be resubmitted while it may still be executing, so
+    // cycle through a set of empty ones and drain the queue once all are in flight.
+    auto submitBenchmark = [device, queue](State &state, bool withFence) {
+        state.pauseTiming();
+        std::vector<CommandBuffer> commandBuffers;
+        commandBuffers.reserve(SubmissionsInFlight);
+        for (uint32_t i = 0; i < SubmissionsInFlight; ++i) {
+            CommandRecorder recorder = device->createCommandRecorder();
+            commandBuffers.push_back(recorder.finish());
+        }
+        Fence fence = device->createFence({ .createSignalled = false });
+        queue->waitUntilIdle();
+        state.resumeTiming();
+
+        for (uint64_t i = 0; i < state.iterations(); ++i) {
+            const uint32_t index = i % SubmissionsInFlight;
+            if (withFence)
+                queue->submit({ .commandBuffers = { commandBuffers[index] }, .signalFence = fence });
+            else
+                queue->submit({ .commandBuffers = { commandBuffers[index] } });
+
+            if (index == SubmissionsInFlight - 1 || withFence) {
+                state.pauseTiming();
+                if (withFence) {
+                    fence.wait();
+                    fence.reset();
+                }
+                queue->waitUntilIdle();
+                state.resumeTiming();
+            }
+        }
+
+        state.pauseTiming();
+        queue->waitUntilIdle();
+        commandBuffers.clear();
+    };
+
+    runner.add("submit/empty", [submitBenchmark](State &state) {
+        submitBenchmark(state, false);
+    });
+
+    runner.add("submit/empty+fence", [submitBenchmark](State &state) {
+        submitBenchmark(state, true);
+    });
+}
+
+} // namespace KDGpuBenchmarks
@@ -0,0 +1,226 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "benchmark.h"
+#include "gpu_context.h"
+
+#include <KDGpu/bind_group.h>
+#include <KDGpu/bind_group_layout.h>
+#include <KDGpu/bind_group_layout_options.h>
+#include <KDGpu/bind_group_options.h>
+#include <KDGpu/buffer.h>
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/compute_pipeline.h>
+#include <KDGpu/compute_pipeline_options.h>
+#include <KDGpu/fence.h>
+#include <KDGpu/gpu_semaphore.h>
+#include <KDGpu/graphics_pipeline.h>
+#include <KDGpu/graphics_pipeline_options.h>
+#include <KDGpu/pipeline_layout.h>
+#include <KDGpu/pipeline_layout_options.h>
+#include <KDGpu/sampler.h>
+#include <KDGpu/sampler_options.h>
+#include <KDGpu/shader_module.h>
+#include <KDGpu/texture.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/texture_view.h>
+
+#include <memory>
+#include <vector>
+
+// Cost of the Device::create* functions. Every benchmark only measures the
+// creation, the objects are destroyed outside of the timed region in batches.
+// Swapchains are not covered as they need a surface, which would prevent the
+// benchmarks from running headless.
+
+using namespace KDGpu;
+
+namespace KDGpuBenchmarks {
+
+namespace {
+
+inline std::string assetPath()
+{
+#if defined(KDGPU_ASSET_PATH)
+    return KDGPU_ASSET_PATH;
+#else
+    return "";
+#endif
+}
+
+// Upper bound on the number of objects alive at once
+constexpr size_t BatchSize = 256;
+
+// Creating pipelines is orders of magnitude slower than anything else
+constexpr uint64_t MaxPipelineIterations = 2000;
+constexpr uint64_t MaxResourceIterations = 200000;
+
+template<typename T, typename CreateFunction>
+void addCreateBenchmark(Runner &runner, const std::string &name, CreateFunction create, uint64_t maxIterations = MaxResourceIterations)
+{
+    runner.add(
+            "create/" + name, [create](State &state) {
+                state.pauseTiming();
+                std::vector<T> objects;
+                objects.reserve(BatchSize);
+                state.resumeTiming();
+
+                for (uint64_t i = 0; i < state.iterations(); ++i) {
+                    objects.push_back(create());
+                    if (objects.size() == BatchSize) {
+                        state.pauseTiming();
+                        objects.clear();
+                        state.resumeTiming();
+                    }
+                }
+
+                state.pauseTiming();
+                objects.clear();
+            },
+            maxIterations);
+}
+
+struct ResourceScene {
+    std::vector<uint32_t> vertexShaderCode;
+    std::vector<uint32_t> fragmentShaderCode;
+    std::vector<uint32_t> computeShaderCode;
+    ShaderModule vertexShader;
+    ShaderModule fragmentShader;
+    ShaderModule computeShader;
+    Texture texture;
+    Buffer uniformBuffer;
+    BindGroupLayout bindGroupLayout;
+    PipelineLayout pipelineLayout;
+};
+
+} // namespace
+
+void registerResourceBenchmarks(Runner &runner, GpuContext &context)
+{
+    Device *device = &context.device;
+    auto scene = std::make_shared<ResourceScene>();
+
+    scene->vertexShaderCode = readShaderFile(assetPath() + "/shaders/tests/render_pass_command_recorder/triangle.vert.spv");
+    scene->fragmentShaderCode = readShaderFile(assetPath() + "/shaders/tests/render_pass_command_recorder/triangle.frag.spv");
+    scene->computeShaderCode = readShaderFile(assetPath() + "/shaders/tests/compute_pipeline/empty_compute.comp.spv");
+    scene->vertexShader = device->createShaderModule(scene->vertexShaderCode);
+    scene->fragmentShader = device->createShaderModule(scene->fragmentShaderCode);
+    scene->computeShader = device->createShaderModule(scene->computeShaderCode);
+
+    const TextureOptions textureOptions = {
+        .type = TextureType::TextureType2D,
+        .format = Format::R8G8B8A8_UNORM,
+        .extent = { 256, 256, 1 },
+        .mipLevels = 1,
+        .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+        .memoryUsage = MemoryUsage::GpuOnly
+    };
+    scene->texture = device->createTexture(textureOptions);
+
+    const BufferOptions bufferOptions = {
+        .size = 256,
+        .usage = BufferUsageFlagBits::UniformBufferBit,
+        .memoryUsage = MemoryUsage::CpuToGpu
+    };
+    scene->uniformBuffer = device->createBuffer(bufferOptions);
+
+    const BindGroupLayoutOptions bindGroupLayoutOptions = {
+        .bindings = {
+                { .binding = 0, .resourceType = ResourceBindingType::UniformBuffer, .shaderStages = ShaderStageFlagBits::VertexBit },
+        }
+    };
+    scene->bindGroupLayout = device->createBindGroupLayout(bindGroupLayoutOptions);
+    scene->pipelineLayout = device->createPipelineLayout({ .bindGroupLayouts = { scene->bindGroupLayout } });
+
+    addCreateBenchmark<Buffer>(runner, "Buffer", [device, bufferOptions] {
+        return device->createBuffer(bufferOptions);
+    });
+
+    addCreateBenchmark<Texture>(runner, "Texture", [device, textureOptions] {
+        return device->createTexture(textureOptions);
+    });
+
+    addCreateBenchmark<TextureView>(runner, "TextureView", [scene] {
+        return scene->texture.createView();
+    });
+
+    addCreateBenchmark<Sampler>(runner, "Sampler", [device] {
+        return device->createSampler();
+    });
+
+    addCreateBenchmark<ShaderModule>(runner, "ShaderModule", [device, scene] {
+        return device->createShaderModule(scene->vertexShaderCode);
+    });
+
+    addCreateBenchmark<BindGroupLayout>(runner, "BindGroupLayout", [device, bindGroupLayoutOptions] {
+        return device->createBindGroupLayout(bindGroupLayoutOptions);
+    });
+
+    addCreateBenchmark<PipelineLayout>(runner, "PipelineLayout", [device, scene] {
+        return device->createPipelineLayout({ .bindGroupLayouts = { scene->bindGroupLayout } });
+    });
+
+    addCreateBenchmark<BindGroup>(runner, "BindGroup", [device, scene] {
+        return device->createBindGroup(BindGroupOptions{
+                .layout = scene->bindGroupLayout,
+                .resources = {
+                        { .binding = 0, .resource = UniformBufferBinding{ .buffer = scene->uniformBuffer } },
+                },
+        });
+    });
+
+    addCreateBenchmark<GraphicsPipeline>(
+            runner, "GraphicsPipeline", [device, scene] {
+                return device->createGraphicsPipeline(GraphicsPipelineOptions{
+                        .shaderStages = {
+                                { .shaderModule = scene->vertexShader.handle(), .stage = ShaderStageFlagBits::VertexBit },
+                                { .shaderModule = scene->fragmentShader.handle(), .stage = ShaderStageFlagBits::FragmentBit },
+                        },
+                        .layout = scene->pipelineLayout,
+                        .vertex = {
+                                .buffers = {
+                                        { .binding = 0, .stride = 2 * 4 * sizeof(float) },
+                                },
+                                .attributes = {
+                                        { .location = 0, .binding = 0, .format = Format::R32G32B32A32_SFLOAT },
+                                        { .location = 1, .binding = 0, .format = Format::R32G32B32A32_SFLOAT, .offset = 4 * sizeof(float) },
+                                },
+                        },
+                        .renderTargets = {
+                                { .format = Format::R8G8B8A8_UNORM },
+                        },
+                });
+            },
+            MaxPipelineIterations);
+
+    addCreateBenchmark<ComputePipeline>(
+            runner, "ComputePipeline", [device, scene] {
+                return device->createComputePipeline(ComputePipelineOptions{
+                        .layout = scene->pipelineLayout,
+                        .shaderStage = { .shaderModule = scene->computeShader },
+                });
+            },
+            MaxPipelineIterations);
+
+    addCreateBenchmark<CommandRecorder>(runner, "CommandRecorder", [device] {
+        return device->createCommandRecorder();
+    });
+
+    addCreateBenchmark<GpuSemaphore>(runner, "GpuSemaphore", [device] {
+        return device->createGpuSemaphore();
+    });
+
+    addCreateBenchmark<Fence>(runner, "Fence", [device] {
+        return device->createFence();
+    });
+}
+
+} // namespace KDGpuBenchmarks
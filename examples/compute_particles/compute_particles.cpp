@@ -216,6 +216,8 @@ void ComputeParticles::initializeScene()
             },
             .depthStencilAttachment = {
                 .view = m_depthTextureView,
+                .depthStoreOperation = AttachmentStoreOperation::DontCare,
+                .stencilStoreOperation = AttachmentStoreOperation::DontCare,
             }
         };
         // clang-format on
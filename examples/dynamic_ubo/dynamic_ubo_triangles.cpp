@@ -88,7 +88,8 @@ void DynamicUBOTriangles::initializeScene()
         BufferOptions bufferOptions = {
             .size = entityCount * m_dynamicUBOByteStride,
             .usage = BufferUsageFlagBits::UniformBufferBit,
-            .memoryUsage = MemoryUsage::CpuToGpu // So we can map it to CPU address space
+            .memoryUsage = MemoryUsage::CpuToGpu, // So we can map it to CPU address space
+            .persistentlyMapped = true // Updated every frame, so keep it mapped
         };
         m_transformDynamicUBOBuffer = m_device.createBuffer(bufferOptions);
     }
@@ -175,6 +176,8 @@ void DynamicUBOTriangles::initializeScene()
         },
         .depthStencilAttachment = {
             .view = m_depthTextureView,
+            .depthStoreOperation = AttachmentStoreOperation::DontCare,
+            .stencilStoreOperation = AttachmentStoreOperation::DontCare,
         }
     };
     // clang-format on
@@ -211,9 +214,8 @@ void DynamicUBOTriangles::updateScene()
         std::memcpy(rawTransformData.data() + i * m_dynamicUBOByteStride, &transform, sizeof(glm::mat4));
     }
 
-    auto bufferData = m_transformDynamicUBOBuffer.map();
-    std::memcpy(bufferData, rawTransformData.data(), rawTransformData.size());
-    m_transformDynamicUBOBuffer.unmap();
+    std::memcpy(m_transformDynamicUBOBuffer.mappedData(), rawTransformData.data(), rawTransformData.size());
+    m_transformDynamicUBOBuffer.flush(0, rawTransformData.size());
 }
 
 void DynamicUBOTriangles::resize()
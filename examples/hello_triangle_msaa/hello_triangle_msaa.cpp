@@ -199,12 +199,15 @@ void HelloTriangleMSAA::initializeScene()
             {
                 .view = m_msaaTextureView,
                 .resolveView = {}, // Not setting the swapchain texture view just yet
+                .storeOperation = AttachmentStoreOperation::DontCare, // Only the resolved image is kept
                 .clearValue = { 0.3f, 0.3f, 0.3f, 1.0f },
                 .finalLayout = TextureLayout::PresentSrc
             }
         },
         .depthStencilAttachment = {
             .view = m_depthTextureView,
+            .depthStoreOperation = AttachmentStoreOperation::DontCare,
+            .stencilStoreOperation = AttachmentStoreOperation::DontCare,
         },
         .samples = m_samples
     };
@@ -260,8 +263,8 @@ void HelloTriangleMSAA::createRenderTarget()
         .extent = { .width = m_window->width(), .height = m_window->height(), .depth = 1 },
         .mipLevels = 1,
         .samples = m_samples,
-        .usage = TextureUsageFlagBits::ColorAttachmentBit,
-        .memoryUsage = MemoryUsage::GpuOnly,
+        .usage = TextureUsageFlagBits::ColorAttachmentBit | TextureUsageFlagBits::TransientAttachmentBit,
+        .memoryUsage = MemoryUsage::GpuLazilyAllocated, // Only resolved, never stored
         .initialLayout = TextureLayout::Undefined
     };
     m_msaaTexture = m_device.createTexture(options);
@@ -149,6 +149,8 @@ void HelloTriangle::initializeScene()
         },
         .depthStencilAttachment = {
             .view = m_depthTextureView,
+            .depthStoreOperation = AttachmentStoreOperation::DontCare,
+            .stencilStoreOperation = AttachmentStoreOperation::DontCare,
         }
     };
     // clang-format on
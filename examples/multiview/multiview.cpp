@@ -236,7 +236,11 @@ void MultiView::initializeFullScreenPass()
                 { .view = {}, // Not setting the swapchain texture view just yet
                   .clearValue = { 0.0f, 0.0f, 0.0f, 1.0f },
                   .finalLayout = TextureLayout::PresentSrc } },
-        .depthStencilAttachment = { .view = m_depthTextureView }
+        .depthStencilAttachment = {
+                .view = m_depthTextureView,
+                .depthStoreOperation = AttachmentStoreOperation::DontCare,
+                .stencilStoreOperation = AttachmentStoreOperation::DontCare,
+        }
     };
 
     // Create a sampler we can use to sample from the color texture in the final pass
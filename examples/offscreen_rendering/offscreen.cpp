@@ -99,6 +99,9 @@ Offscreen::Offscreen()
     m_device = adapter->createDevice(DeviceOptions{ .requestedFeatures = adapter->features() });
     m_queue = m_device.queues()[0];
 
+    // Copies the rendered images into host visible buffers without stalling the queue
+    m_readbackRing = m_device.createReadbackRing(m_queue);
+
     createRenderTargets();
 }
 
@@ -286,6 +289,7 @@ void Offscreen::cleanupScene()
     m_dataBuffer = {};
     m_commandBuffer = {};
     m_stagingBuffers.clear();
+    m_readbackRing = {};
 }
 
 void Offscreen::resize(uint32_t width, uint32_t height)
@@ -359,32 +363,22 @@ void Offscreen::render(const std::string &baseFilename)
     renderPass.draw(drawCmd);
     renderPass.end();
 
-    // Copy from the color render target to the CPU visible color texture. The barriers ensure
-    // that we correctly serialize the operations performed on the GPU and also act to transition
-    // the textures into the correct layout for each step. See the explanations in the
-    // createRenderTargets() function for more information.
-    commandRecorder.textureMemoryBarrier(m_barriers[uint8_t(TextureBarriers::CopySrcPre)]);
-    commandRecorder.textureMemoryBarrier(m_barriers[uint8_t(TextureBarriers::CopyDstPre)]);
-    commandRecorder.copyTextureToTexture(m_copyOptions);
-    commandRecorder.textureMemoryBarrier(m_barriers[uint8_t(TextureBarriers::CopyDstPost)]);
-    commandRecorder.textureMemoryBarrier(m_barriers[uint8_t(TextureBarriers::CopySrcPost)]);
-
     // Finish recording and submit
     m_commandBuffer = commandRecorder.finish();
     SubmitOptions submitOptions = {
         .commandBuffers = { m_commandBuffer }
     };
     m_queue.submit(submitOptions);
-    m_queue.waitUntilIdle();
-
-    SPDLOG_INFO("Render and copy completed in {} s", elapsed.nsecElapsed() / 1.0e9);
 
-    // Map the host texture to cpu address space so we can save it to disk
-    const auto subresourceLayout = m_cpuColorTexture.getSubresourceLayout();
-    const uint8_t *data = static_cast<uint8_t *>(m_cpuColorTexture.map());
-    data += subresourceLayout.offset;
+    // Copy the color render target into a host visible buffer once the rendering is done. Rather
+    // than waiting for the whole queue to become idle, we only wait for this copy to complete. An
+    // application rendering many frames would keep the Readback around and poll isReady() instead.
+    Readback readback = m_readbackRing.readTextureData(m_readbackOptions);
+    m_readbackRing.submit();
+    const uint8_t *data = static_cast<const uint8_t *>(readback.data());
+    const uint32_t rowPitch = m_width * 4;
 
-    SPDLOG_INFO("Mapping completed in {} s", elapsed.nsecElapsed() / 1.0e9);
+    SPDLOG_INFO("Render and copy completed in {} s", elapsed.nsecElapsed() / 1.0e9);
 
 // #define KDGPU_OFFSCREEN_SAVE_AS_PPM
 #if defined(KDGPU_OFFSCREEN_SAVE_AS_PPM)
@@ -402,7 +396,7 @@ void Offscreen::render(const std::string &baseFilename)
             file.write((char *)texel, 3); // Output RGB for current texel
             ++texel;
         }
-        data += subresourceLayout.rowPitch;
+        data += rowPitch;
     }
     file.close();
 #else
@@ -412,7 +406,7 @@ void Offscreen::render(const std::string &baseFilename)
         .width = m_width,
         .height = m_height,
         .pixelData = data,
-        .byteSize = subresourceLayout.size,
+        .byteSize = readback.byteSize(),
     };
     writeImage(filename, imageData);
 #endif
@@ -420,10 +414,8 @@ void Offscreen::render(const std::string &baseFilename)
     SPDLOG_INFO("Saving completed in {} s", elapsed.nsecElapsed() / 1.0e9);
     SPDLOG_INFO("Saved image to disk as {}", filename);
 
-    m_cpuColorTexture.unmap();
-
-    // See if we can release any staging buffers used for uploads. As we are waiting
-    // for the queue to become idle above, we should always be able to release here.
+    // See if we can release any staging buffers used for uploads. As the uploads were
+    // submitted before the rendering we waited for above, we should always be able to release here.
     releaseStagingBuffers();
 }
 
@@ -484,87 +476,17 @@ void Offscreen::createRenderTargets()
     };
     // clang-format on
 
-    // Create a color texture that is host visible and in linear layout. We will copy into this.
-    TextureOptions cpuColorTextureOptions = {
-        .type = TextureType::TextureType2D,
-        .format = m_colorFormat,
-        .extent = { m_width, m_height, 1 },
-        .mipLevels = 1,
-        .samples = SampleCountFlagBits::Samples1Bit,
-        .tiling = TextureTiling::Linear, // Linear so we can manipulate it on the host
-        .usage = TextureUsageFlagBits::TransferDstBit,
-        .memoryUsage = MemoryUsage::CpuOnly
-    };
-    m_cpuColorTexture = m_device.createTexture(cpuColorTextureOptions);
-
-    // Setup the options for the memory barriers that will be used to serialize the
-    // memory accesses and transition the textures into the correct layouts for each step.
-    // These will be the same for every call to render() unless we have to resize and
-    // hence recreate the textures we are rendering to and copying between.
-
-    // Insert a texture memory barrier to ensure the rendering to the color render target
-    // is completed and to transition it into a layout suitable for copying from
-    m_barriers[uint8_t(TextureBarriers::CopySrcPre)] = {
-        .srcStages = PipelineStageFlagBit::TransferBit,
-        .srcMask = AccessFlagBit::MemoryReadBit,
-        .dstStages = PipelineStageFlagBit::TransferBit,
-        .dstMask = AccessFlagBit::TransferReadBit,
-        .oldLayout = TextureLayout::ColorAttachmentOptimal,
-        .newLayout = TextureLayout::TransferSrcOptimal,
-        .texture = m_colorTexture,
-        .range = { .aspectMask = TextureAspectFlagBits::ColorBit }
+    // The readback of the color render target can be specified once here and reused in every
+    // call to render(). The resolve attachment is left in the color attachment optimal layout
+    // by the render pass, the readback transitions it for the copy and back again afterwards.
+    m_readbackOptions = {
+        .sourceTexture = m_colorTexture,
+        .srcStages = PipelineStageFlagBit::ColorAttachmentOutputBit,
+        .srcMask = AccessFlagBit::ColorAttachmentWriteBit,
+        .layout = TextureLayout::ColorAttachmentOptimal,
+        .byteSize = DeviceSize(m_width) * m_height * 4,
+        .regions = { {
+                .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
+                .textureExtent = { .width = m_width, .height = m_height, .depth = 1 } } }
     };
-
-    // Insert another texture memory barrier to transition the destination cpu visible
-    // texture into a suitable layout for copying into
-    m_barriers[uint8_t(TextureBarriers::CopyDstPre)] = {
-        .srcStages = PipelineStageFlagBit::TransferBit,
-        .srcMask = AccessFlagBit::None,
-        .dstStages = PipelineStageFlagBit::TransferBit,
-        .dstMask = AccessFlagBit::TransferWriteBit,
-        .oldLayout = TextureLayout::Undefined,
-        .newLayout = TextureLayout::TransferDstOptimal,
-        .texture = m_cpuColorTexture,
-        .range = { .aspectMask = TextureAspectFlagBits::ColorBit }
-    };
-
-    // Transition the destination texture to general layout so that we can map it to the cpu
-    // address space later.
-    m_barriers[uint8_t(TextureBarriers::CopyDstPost)] = {
-        .srcStages = PipelineStageFlagBit::TransferBit,
-        .srcMask = AccessFlagBit::TransferWriteBit,
-        .dstStages = PipelineStageFlagBit::TransferBit,
-        .dstMask = AccessFlagBit::MemoryReadBit,
-        .oldLayout = TextureLayout::TransferDstOptimal,
-        .newLayout = TextureLayout::General,
-        .texture = m_cpuColorTexture,
-        .range = { .aspectMask = TextureAspectFlagBits::ColorBit }
-    };
-
-    // Transition the color target back to the color attachment optimal layout, ready
-    // to render again later.
-    m_barriers[uint8_t(TextureBarriers::CopySrcPost)] = {
-        .srcStages = PipelineStageFlagBit::TransferBit,
-        .srcMask = AccessFlagBit::TransferReadBit,
-        .dstStages = PipelineStageFlagBit::TransferBit,
-        .dstMask = AccessFlagBit::MemoryReadBit,
-        .oldLayout = TextureLayout::TransferSrcOptimal,
-        .newLayout = TextureLayout::ColorAttachmentOptimal,
-        .texture = m_colorTexture,
-        .range = { .aspectMask = TextureAspectFlagBits::ColorBit }
-    };
-
-    // Likewise, we can specify the copy operation parameters once here and reuse them many
-    // times in calls to render().
-    // clang-format off
-    m_copyOptions = {
-        .srcTexture = m_colorTexture,
-        .srcLayout = TextureLayout::TransferSrcOptimal,
-        .dstTexture = m_cpuColorTexture,
-        .dstLayout = TextureLayout::TransferDstOptimal,
-        .regions = {{
-            .extent = { .width = m_width, .height = m_height, .depth = 1 }
-        }}
-    };
-    // clang-format on
 }
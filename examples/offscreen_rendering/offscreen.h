@@ -14,6 +14,7 @@
 #include <KDGpu/device.h>
 #include <KDGpu/instance.h>
 #include <KDGpu/queue.h>
+#include <KDGpu/readback_ring.h>
 #include <KDGpu/sampler.h>
 #include <KDGpu/texture.h>
 #include <KDGpu/texture_view.h>
@@ -54,6 +55,7 @@ private:
     Device m_device;
     Queue m_queue;
     std::vector<UploadStagingBuffer> m_stagingBuffers;
+    ReadbackRing m_readbackRing;
 
     uint32_t m_width{ 1920 };
     uint32_t m_height{ 1080 };
@@ -66,17 +68,7 @@ private:
     Texture m_depthTexture;
     TextureView m_depthTextureView;
 
-    Texture m_cpuColorTexture;
-
-    enum class TextureBarriers : uint8_t {
-        CopySrcPre = 0,
-        CopyDstPre,
-        CopyDstPost,
-        CopySrcPost,
-        Count
-    };
-    TextureMemoryBarrierOptions m_barriers[uint8_t(TextureBarriers::Count)];
-    TextureToTextureCopy m_copyOptions;
+    TextureReadbackOptions m_readbackOptions;
 
     const Format m_colorFormat{ Format::R8G8B8A8_UNORM };
 #if defined(KDGPU_PLATFORM_MACOS)
@@ -63,7 +63,9 @@ void RenderToTexture::initializeScene()
             }
         },
         .depthStencilAttachment = {
-            .view = m_depthTextureView
+            .view = m_depthTextureView,
+            .depthStoreOperation = AttachmentStoreOperation::DontCare,
+            .stencilStoreOperation = AttachmentStoreOperation::DontCare,
         }
     };
     // clang-format on
@@ -81,7 +83,9 @@ void RenderToTexture::initializeScene()
             }
         },
         .depthStencilAttachment = {
-            .view = m_depthTextureView
+            .view = m_depthTextureView,
+            .depthStoreOperation = AttachmentStoreOperation::DontCare,
+            .stencilStoreOperation = AttachmentStoreOperation::DontCare,
         }
     };
     // clang-format on
@@ -238,6 +238,8 @@ void TexturedQuad::initializeScene()
         },
         .depthStencilAttachment = {
             .view = m_depthTextureView,
+            .depthStoreOperation = AttachmentStoreOperation::DontCare,
+            .stencilStoreOperation = AttachmentStoreOperation::DontCare,
         }
     };
     // clang-format on
@@ -80,6 +80,16 @@ struct AdapterFeatures {
     bool multiView;
     bool multiViewGeometryShader;
     bool multiViewTessellationShader;
+    bool shaderSampledImageArrayNonUniformIndexing;
+    bool shaderStorageImageArrayNonUniformIndexing;
+    bool shaderStorageBufferArrayNonUniformIndexing;
+    bool descriptorBindingSampledImageUpdateAfterBind;
+    bool descriptorBindingStorageImageUpdateAfterBind;
+    bool descriptorBindingStorageBufferUpdateAfterBind;
+    bool descriptorBindingUpdateUnusedWhilePending;
+    bool descriptorBindingPartiallyBound;
+    bool descriptorBindingVariableDescriptorCount;
+    bool runtimeDescriptorArray;
 };
 
 /*! @} */
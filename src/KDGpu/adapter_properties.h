@@ -152,6 +152,21 @@ struct AdapterMultiViewProperties {
     uint32_t maxMultiviewInstanceIndex;
 };
 
+/**
+    @headerfile adapter_properties.h <KDGpu/adapter_properties.h>
+ */
+struct AdapterDescriptorIndexingProperties {
+    uint32_t maxUpdateAfterBindDescriptorsInAllPools;
+    uint32_t maxPerStageDescriptorUpdateAfterBindSamplers;
+    uint32_t maxPerStageDescriptorUpdateAfterBindSampledImages;
+    uint32_t maxPerStageDescriptorUpdateAfterBindStorageImages;
+    uint32_t maxPerStageDescriptorUpdateAfterBindStorageBuffers;
+    uint32_t maxDescriptorSetUpdateAfterBindSamplers;
+    uint32_t maxDescriptorSetUpdateAfterBindSampledImages;
+    uint32_t maxDescriptorSetUpdateAfterBindStorageImages;
+    uint32_t maxDescriptorSetUpdateAfterBindStorageBuffers;
+};
+
 /**
     @headerfile adapter_properties.h <KDGpu/adapter_properties.h>
  */
@@ -166,6 +181,7 @@ struct AdapterProperties {
     AdapterLimits limits;
     AdapterSparseProperties sparseProperties;
     AdapterMultiViewProperties multiViewProperties;
+    AdapterDescriptorIndexingProperties descriptorIndexingProperties;
 };
 
 /**
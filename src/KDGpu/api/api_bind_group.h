@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <vector>
+
 namespace KDGpu {
 
 struct BindGroupEntry;
@@ -21,6 +23,7 @@ struct BindGroupEntry;
  */
 struct ApiBindGroup {
     virtual void update(const BindGroupEntry &entry) = 0;
+    virtual void update(const std::vector<BindGroupEntry> &entries) = 0;
 };
 
 } // namespace KDGpu
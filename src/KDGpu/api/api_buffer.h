@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <KDGpu/gpu_core.h>
+
 namespace KDGpu {
 
 /**
@@ -20,6 +22,14 @@ namespace KDGpu {
 struct ApiBuffer {
     virtual void *map() = 0;
     virtual void unmap() = 0;
+    virtual void *mappedData() const = 0;
+    virtual void flush(DeviceSize offset, DeviceSize size) = 0;
+    virtual void invalidate(DeviceSize offset, DeviceSize size) = 0;
+
+    // Writes the data through a mapping, skipping the staging copy, when the buffer is GpuOnly
+    // but has landed in host visible memory and the GPU cannot be using it. Returns false if
+    // the data has to be staged instead.
+    virtual bool writeDirectly(const void *data, DeviceSize offset, DeviceSize size) = 0;
 };
 
 } // namespace KDGpu
@@ -11,8 +11,10 @@
 #pragma once
 
 #include <KDGpu/adapter_queue_type.h>
+#include <KDGpu/deletion_queue_statistics.h>
 #include <KDGpu/device_options.h>
 #include <KDGpu/handle.h>
+#include <KDGpu/memory_budget.h>
 #include <KDGpu/queue_description.h>
 
 #include <span>
@@ -22,6 +24,8 @@ namespace KDGpu {
 
 class ResourceManager;
 
+struct Device_t;
+
 /**
  * @brief ApiDevice
  * \ingroup api
@@ -29,10 +33,18 @@ class ResourceManager;
  */
 struct ApiDevice {
     virtual std::vector<QueueDescription> getQueues(ResourceManager *resourceManager,
+                                                    const Handle<Device_t> &deviceHandle,
                                                     const std::vector<QueueRequest> &queueRequests,
                                                     std::span<AdapterQueueType> queueTypes) = 0;
 
     virtual void waitUntilIdle() = 0;
+
+    virtual void collectGarbage() = 0;
+    virtual void resetTransientBindGroups() = 0;
+    virtual DeletionQueueStatistics deletionQueueStatistics() const = 0;
+
+    virtual MemoryBudget memoryBudget() const = 0;
+    virtual void setMemoryBudgetCallback(float usageThreshold, const MemoryBudgetCallback &callback) = 0;
 };
 
 } // namespace KDGpu
@@ -0,0 +1,26 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/memory_pool.h>
+
+namespace KDGpu {
+
+/**
+ * @brief ApiMemoryPool
+ * \ingroup api
+ *
+ */
+struct ApiMemoryPool {
+    virtual MemoryPoolStatistics statistics() const = 0;
+};
+
+} // namespace KDGpu
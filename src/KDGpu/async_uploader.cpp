@@ -0,0 +1,192 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "async_uploader.h"
+
+#include <KDGpu/command_recorder.h>
+
+namespace KDGpu {
+
+AsyncUploader::AsyncUploader() = default;
+
+AsyncUploader::AsyncUploader(GraphicsApi *api, const Handle<Device_t> &device, const Queue &transferQueue,
+                             const Queue &destinationQueue, const AsyncUploaderOptions &options)
+    : m_api(api)
+    , m_device(device)
+    , m_transferQueue(transferQueue)
+    , m_destinationQueue(destinationQueue)
+    , m_ring(std::make_unique<StagingRing>(api, device, transferQueue.handle(), options.stagingSize))
+{
+    if (usesTransferQueue())
+        m_ring->setQueueOwnershipTransfer(m_transferQueue.queueTypeIndex(), m_destinationQueue.queueTypeIndex());
+}
+
+AsyncUploader::AsyncUploader(AsyncUploader &&other)
+{
+    *this = std::move(other);
+}
+
+AsyncUploader &AsyncUploader::operator=(AsyncUploader &&other)
+{
+    if (this != &other) {
+        if (isValid())
+            waitUntilIdle();
+
+        m_api = std::exchange(other.m_api, nullptr);
+        m_device = std::exchange(other.m_device, {});
+        m_transferQueue = other.m_transferQueue;
+        m_destinationQueue = other.m_destinationQueue;
+        m_ring = std::move(other.m_ring);
+        m_pendingBufferAcquires = std::move(other.m_pendingBufferAcquires);
+        m_pendingTextureAcquires = std::move(other.m_pendingTextureAcquires);
+        m_acquireSubmissions = std::move(other.m_acquireSubmissions);
+        m_freeSemaphores = std::move(other.m_freeSemaphores);
+        m_flushCount = std::exchange(other.m_flushCount, 0);
+
+        other.m_pendingBufferAcquires.clear();
+        other.m_pendingTextureAcquires.clear();
+        other.m_acquireSubmissions.clear();
+        other.m_freeSemaphores.clear();
+    }
+    return *this;
+}
+
+AsyncUploader::~AsyncUploader()
+{
+    if (isValid())
+        waitUntilIdle();
+}
+
+void AsyncUploader::uploadBufferData(const BufferUploadOptions &options)
+{
+    if (!isValid())
+        return;
+
+    // Nothing to hand over if the data was written directly into the buffer
+    const bool copied = m_ring->uploadBufferData(options);
+
+    if (copied && usesTransferQueue()) {
+        m_pendingBufferAcquires.push_back(BufferMemoryBarrierOptions{
+                .srcStages = PipelineStageFlags(PipelineStageFlagBit::AllCommandsBit),
+                .dstStages = options.dstStages,
+                .dstMask = options.dstMask,
+                .srcQueueTypeIndex = m_transferQueue.queueTypeIndex(),
+                .dstQueueTypeIndex = m_destinationQueue.queueTypeIndex(),
+                .buffer = options.destinationBuffer });
+    }
+}
+
+void AsyncUploader::uploadTextureData(const TextureUploadOptions &options)
+{
+    if (!isValid())
+        return;
+
+    m_ring->uploadTextureData(options);
+
+    if (usesTransferQueue()) {
+        // Must match the release recorded by the StagingRing, layout transition included
+        m_pendingTextureAcquires.push_back(TextureMemoryBarrierOptions{
+                .srcStages = PipelineStageFlags(PipelineStageFlagBit::AllCommandsBit),
+                .dstStages = options.dstStages,
+                .dstMask = options.dstMask,
+                .oldLayout = TextureLayout::TransferDstOptimal,
+                .newLayout = options.newLayout,
+                .srcQueueTypeIndex = m_transferQueue.queueTypeIndex(),
+                .dstQueueTypeIndex = m_destinationQueue.queueTypeIndex(),
+                .texture = options.destinationTexture,
+                .range = textureUploadRange(options.regions) });
+    }
+}
+
+void AsyncUploader::flush()
+{
+    if (!isValid())
+        return;
+
+    reclaim();
+
+    if (!usesTransferQueue()) {
+        m_ring->submit();
+        ++m_flushCount;
+        return;
+    }
+
+    if (m_pendingBufferAcquires.empty() && m_pendingTextureAcquires.empty())
+        return;
+
+    GpuSemaphore semaphore;
+    if (!m_freeSemaphores.empty()) {
+        semaphore = std::move(m_freeSemaphores.back());
+        m_freeSemaphores.pop_back();
+    } else {
+        semaphore = GpuSemaphore(m_api, m_device, GpuSemaphoreOptions{});
+    }
+
+    m_ring->submit({ semaphore.handle() });
+
+    // The acquires are submitted on their own so that the destination queue only waits
+    // for the transfer queue right before the barriers rather than before the next frame
+    CommandRecorder recorder(m_api, m_device, CommandRecorderOptions{ .queue = m_destinationQueue.handle() });
+    for (const BufferMemoryBarrierOptions &barrier : m_pendingBufferAcquires)
+        recorder.bufferMemoryBarrier(barrier);
+    for (const TextureMemoryBarrierOptions &barrier : m_pendingTextureAcquires)
+        recorder.textureMemoryBarrier(barrier);
+    m_pendingBufferAcquires.clear();
+    m_pendingTextureAcquires.clear();
+    CommandBuffer commandBuffer = recorder.finish();
+
+    Fence fence(m_api, m_device, FenceOptions{ .createSignalled = false });
+    m_destinationQueue.submit(SubmitOptions{
+            .commandBuffers = { commandBuffer.handle() },
+            .waitSemaphores = { semaphore.handle() },
+            .signalFence = fence.handle(),
+            // The acquire barriers chain onto the semaphore wait through these stages
+            .waitStages = { PipelineStageFlags(PipelineStageFlagBit::AllCommandsBit) } });
+
+    m_acquireSubmissions.push_back(AcquireSubmission{
+            .fence = std::move(fence),
+            .commandBuffer = std::move(commandBuffer),
+            .semaphore = std::move(semaphore) });
+    ++m_flushCount;
+}
+
+void AsyncUploader::waitUntilIdle()
+{
+    flush();
+    for (AcquireSubmission &submission : m_acquireSubmissions)
+        submission.fence.wait();
+    reclaim();
+    m_ring->release();
+}
+
+AsyncUploaderStatistics AsyncUploader::statistics() const noexcept
+{
+    if (!isValid())
+        return {};
+
+    return AsyncUploaderStatistics{
+        .usesTransferQueue = usesTransferQueue(),
+        .flushCount = m_flushCount,
+        .acquiresInFlight = static_cast<uint32_t>(m_acquireSubmissions.size()),
+        .staging = m_ring->statistics()
+    };
+}
+
+void AsyncUploader::reclaim()
+{
+    m_ring->reclaim();
+    while (!m_acquireSubmissions.empty() && m_acquireSubmissions.front().fence.status() == FenceStatus::Signalled) {
+        // The wait on the semaphore has completed, it can be signalled again
+        m_freeSemaphores.push_back(std::move(m_acquireSubmissions.front().semaphore));
+        m_acquireSubmissions.pop_front();
+    }
+}
+
+} // namespace KDGpu
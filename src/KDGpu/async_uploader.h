@@ -0,0 +1,112 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/command_buffer.h>
+#include <KDGpu/fence.h>
+#include <KDGpu/gpu_semaphore.h>
+#include <KDGpu/memory_barrier.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/staging_ring.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace KDGpu {
+
+struct AsyncUploaderOptions {
+    DeviceSize stagingSize{ StagingRing::DefaultSize };
+};
+
+struct AsyncUploaderStatistics {
+    bool usesTransferQueue{ false };
+    uint64_t flushCount{ 0 };
+    uint32_t acquiresInFlight{ 0 };
+    StagingRingStatistics staging;
+};
+
+/**
+    @brief Uploads data on a dedicated transfer queue, overlapping with rendering
+    @ingroup public
+    @headerfile async_uploader.h <KDGpu/async_uploader.h>
+
+    Uses the first transfer only queue of the device, which has to be requested
+    when creating it, see Adapter::queueTypes(). The copies are recorded on that
+    queue and end with a queue family ownership release. flush() submits them,
+    signalling a semaphore which a submission on the destination queue waits on
+    before acquiring the ownership of the uploaded resources.
+
+    Without a transfer only queue, the uploads go through the destination queue.
+
+    The destination resources must not hold contents the upload has to preserve
+    on another queue family: buffers are fully owned by the transfer queue while
+    being written to and textures must be uploaded from TextureLayout::Undefined.
+ */
+class KDGPU_EXPORT AsyncUploader
+{
+public:
+    AsyncUploader();
+    ~AsyncUploader();
+
+    AsyncUploader(AsyncUploader &&);
+    AsyncUploader &operator=(AsyncUploader &&);
+
+    AsyncUploader(const AsyncUploader &) = delete;
+    AsyncUploader &operator=(const AsyncUploader &) = delete;
+
+    bool isValid() const noexcept { return m_ring != nullptr; }
+    bool usesTransferQueue() const noexcept { return m_transferQueue.handle() != m_destinationQueue.handle(); }
+
+    const Queue &transferQueue() const noexcept { return m_transferQueue; }
+    const Queue &destinationQueue() const noexcept { return m_destinationQueue; }
+
+    void uploadBufferData(const BufferUploadOptions &options);
+    void uploadTextureData(const TextureUploadOptions &options);
+
+    // Submits the uploads recorded since the last flush. Work submitted to the destination
+    // queue afterwards sees the uploaded data.
+    void flush();
+
+    // Flushes and blocks until all uploads have completed, then frees the staging memory
+    void waitUntilIdle();
+
+    AsyncUploaderStatistics statistics() const noexcept;
+
+private:
+    explicit AsyncUploader(GraphicsApi *api, const Handle<Device_t> &device, const Queue &transferQueue,
+                           const Queue &destinationQueue, const AsyncUploaderOptions &options);
+
+    struct AcquireSubmission {
+        Fence fence;
+        CommandBuffer commandBuffer;
+        GpuSemaphore semaphore;
+    };
+
+    void reclaim();
+
+    GraphicsApi *m_api{ nullptr };
+    Handle<Device_t> m_device;
+    Queue m_transferQueue;
+    Queue m_destinationQueue;
+    std::unique_ptr<StagingRing> m_ring;
+
+    std::vector<BufferMemoryBarrierOptions> m_pendingBufferAcquires;
+    std::vector<TextureMemoryBarrierOptions> m_pendingTextureAcquires;
+    std::deque<AcquireSubmission> m_acquireSubmissions;
+    std::vector<GpuSemaphore> m_freeSemaphores;
+    uint64_t m_flushCount{ 0 };
+
+    friend class Device;
+};
+
+} // namespace KDGpu
@@ -67,6 +67,12 @@ void BindGroup::update(const BindGroupEntry &entry)
     apiBindGroup->update(entry);
 }
 
+void BindGroup::update(const std::vector<BindGroupEntry> &entries)
+{
+    auto apiBindGroup = m_api->resourceManager()->getBindGroup(m_bindGroup);
+    apiBindGroup->update(entries);
+}
+
 bool operator==(const BindGroup &a, const BindGroup &b)
 {
     return a.m_api == b.m_api && a.m_device == b.m_device && a.m_bindGroup == b.m_bindGroup;
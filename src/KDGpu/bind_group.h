@@ -13,6 +13,8 @@
 #include <KDGpu/bind_group_description.h>
 #include <KDGpu/kdgpu_export.h>
 
+#include <vector>
+
 namespace KDGpu {
 
 struct BindGroupEntry;
@@ -47,6 +49,8 @@ public:
     operator Handle<BindGroup_t>() const noexcept { return m_bindGroup; }
 
     void update(const BindGroupEntry &entry);
+    // Prefer this over several single entry updates, the descriptors are written together
+    void update(const std::vector<BindGroupEntry> &entries);
 
 private:
     explicit BindGroup(GraphicsApi *api, const Handle<Device_t> &device, const BindGroupOptions &options);
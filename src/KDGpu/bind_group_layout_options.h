@@ -12,6 +12,9 @@
 
 #include <KDGpu/gpu_core.h>
 #include <KDGpu/bind_group_description.h>
+#include <KDGpu/handle.h>
+
+#include <vector>
 
 namespace KDGpu {
 
@@ -20,13 +23,21 @@ struct ResourceBindingLayout {
     uint32_t count{ 1 };
     ResourceBindingType resourceType;
     ShaderStageFlags shaderStages;
+    // For Sampler and CombinedImageSampler bindings, either one sampler per descriptor or a
+    // single one for all of them. Bind groups then need no sampler for this binding.
+    std::vector<Handle<Sampler_t>> immutableSamplers{};
+    ResourceBindingFlags flags{};
 
     bool isCompatible(const ResourceBindingLayout &other) const noexcept
     {
         return binding == other.binding &&
                 count == other.count &&
-                resourceType == other.resourceType;
+                resourceType == other.resourceType &&
+                immutableSamplers == other.immutableSamplers &&
+                flags == other.flags;
     }
+
+    friend bool operator==(const ResourceBindingLayout &, const ResourceBindingLayout &) = default;
 };
 
 // The following struct describes a bind group (descriptor set) layout and from this we
@@ -34,6 +45,8 @@ struct ResourceBindingLayout {
 // the bind group can be used we will need to populate it with the specified bindings.
 struct BindGroupLayoutOptions {
     std::vector<ResourceBindingLayout> bindings;
+
+    friend bool operator==(const BindGroupLayoutOptions &, const BindGroupLayoutOptions &) = default;
 };
 
 } // namespace KDGpu
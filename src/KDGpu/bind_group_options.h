@@ -18,11 +18,18 @@ namespace KDGpu {
 struct BindGroupEntry { // An entry into a BindGroup ( == a descriptor in a descriptor set)
     uint32_t binding;
     BindingResource resource;
+    uint32_t arrayElement{ 0 }; // For bindings holding an array of descriptors
 };
 
 struct BindGroupOptions {
     Handle<BindGroupLayout_t> layout;
     std::vector<BindGroupEntry> resources;
+    // Only valid until the next call to Device::resetTransientBindGroups(). Allocated from
+    // per frame descriptor pools which are reset as a whole rather than freed set by set.
+    bool transient{ false };
+    // Number of descriptors of the binding created with VariableBindGroupEntriesCountBit,
+    // if the layout has one. Capped to the count of that binding.
+    uint32_t maxVariableArrayLength{ 0 };
 };
 
 } // namespace KDGpu
@@ -0,0 +1,239 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "bindless_table.h"
+
+#include <KDGpu/adapter.h>
+#include <KDGpu/bind_group_layout_options.h>
+#include <KDGpu/bind_group_options.h>
+#include <KDGpu/device.h>
+#include <KDGpu/utils/logging.h>
+
+#include <algorithm>
+
+namespace KDGpu {
+
+namespace {
+
+// Whether the device can update descriptors of this type after binding, and how many a set can hold
+bool updateAfterBindLimit(const Device *device, ResourceBindingType type, uint32_t &limit)
+{
+    const AdapterFeatures &features = device->enabledFeatures();
+    const AdapterDescriptorIndexingProperties &properties = device->adapter()->properties().descriptorIndexingProperties;
+
+    switch (type) {
+    case ResourceBindingType::SampledImage:
+        limit = std::min(properties.maxDescriptorSetUpdateAfterBindSampledImages, properties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+        return features.descriptorBindingSampledImageUpdateAfterBind;
+    case ResourceBindingType::Sampler:
+        limit = std::min(properties.maxDescriptorSetUpdateAfterBindSamplers, properties.maxPerStageDescriptorUpdateAfterBindSamplers);
+        return features.descriptorBindingSampledImageUpdateAfterBind;
+    case ResourceBindingType::CombinedImageSampler:
+        // Counts against both the sampler and the sampled image limits
+        limit = std::min({ properties.maxDescriptorSetUpdateAfterBindSampledImages, properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                           properties.maxDescriptorSetUpdateAfterBindSamplers, properties.maxPerStageDescriptorUpdateAfterBindSamplers });
+        return features.descriptorBindingSampledImageUpdateAfterBind;
+    case ResourceBindingType::StorageImage:
+        limit = std::min(properties.maxDescriptorSetUpdateAfterBindStorageImages, properties.maxPerStageDescriptorUpdateAfterBindStorageImages);
+        return features.descriptorBindingStorageImageUpdateAfterBind;
+    case ResourceBindingType::StorageBuffer:
+        limit = std::min(properties.maxDescriptorSetUpdateAfterBindStorageBuffers, properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers);
+        return features.descriptorBindingStorageBufferUpdateAfterBind;
+    default:
+        limit = 0;
+        return false;
+    }
+}
+
+} // namespace
+
+BindlessTable::BindlessTable() = default;
+
+BindlessTable::BindlessTable(Device *device, const BindlessTableOptions &options)
+    : m_device(device)
+    , m_resourceType(options.resourceType)
+{
+    const AdapterFeatures &features = device->enabledFeatures();
+    uint32_t limit = 0;
+    if (!updateAfterBindLimit(device, m_resourceType, limit) || !features.descriptorBindingPartiallyBound ||
+        !features.descriptorBindingVariableDescriptorCount || !features.runtimeDescriptorArray ||
+        !features.descriptorBindingUpdateUnusedWhilePending) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "BindlessTable needs the descriptor indexing features of the device for its resource type");
+        return;
+    }
+
+    m_maxCount = std::min(options.maxCount, limit);
+    if (m_maxCount == 0) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "BindlessTable needs a non zero maxCount");
+        return;
+    }
+
+    m_bindGroupLayout = device->createBindGroupLayout(BindGroupLayoutOptions{
+            .bindings = { {
+                    .binding = 0,
+                    .count = m_maxCount,
+                    .resourceType = m_resourceType,
+                    .shaderStages = options.shaderStages,
+                    .flags = ResourceBindingFlags(ResourceBindingFlagBits::UpdateAfterBindBit) |
+                            ResourceBindingFlagBits::UpdateUnusedWhilePendingBit |
+                            ResourceBindingFlagBits::PartiallyBoundBit |
+                            ResourceBindingFlagBits::VariableBindGroupEntriesCountBit,
+            } },
+    });
+    if (!m_bindGroupLayout.isValid())
+        return;
+
+    m_bindGroup = device->createBindGroup(BindGroupOptions{
+            .layout = m_bindGroupLayout,
+            .maxVariableArrayLength = std::clamp(options.initialCapacity, 1u, m_maxCount),
+    });
+    if (!m_bindGroup.isValid())
+        return;
+
+    m_capacity = std::clamp(options.initialCapacity, 1u, m_maxCount);
+    m_resources.resize(m_capacity);
+}
+
+BindlessTable::BindlessTable(BindlessTable &&other)
+{
+    *this = std::move(other);
+}
+
+BindlessTable &BindlessTable::operator=(BindlessTable &&other)
+{
+    if (this != &other) {
+        m_device = other.m_device;
+        m_resourceType = other.m_resourceType;
+        m_bindGroup = std::move(other.m_bindGroup);
+        m_bindGroupLayout = std::move(other.m_bindGroupLayout);
+        m_capacity = other.m_capacity;
+        m_maxCount = other.m_maxCount;
+        m_resources = std::move(other.m_resources);
+        m_nextIndex = other.m_nextIndex;
+        m_freeIndices = std::move(other.m_freeIndices);
+        m_retiredIndices = std::move(other.m_retiredIndices);
+        m_residentCount = other.m_residentCount;
+        m_growCount = other.m_growCount;
+
+        other.m_device = nullptr;
+        other.m_capacity = 0;
+        other.m_maxCount = 0;
+        other.m_resources.clear();
+        other.m_nextIndex = 0;
+        other.m_freeIndices.clear();
+        other.m_retiredIndices.clear();
+        other.m_residentCount = 0;
+    }
+    return *this;
+}
+
+BindlessTable::~BindlessTable() = default;
+
+uint32_t BindlessTable::add(const BindingResource &resource)
+{
+    if (!isValid() || resource.type() != m_resourceType)
+        return InvalidIndex;
+
+    recycleRetiredIndices();
+
+    uint32_t index = InvalidIndex;
+    if (!m_freeIndices.empty()) {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    } else {
+        if (m_nextIndex == m_capacity && !grow())
+            return InvalidIndex;
+        index = m_nextIndex++;
+    }
+
+    m_resources[index] = resource;
+    ++m_residentCount;
+    m_bindGroup.update(BindGroupEntry{ .binding = 0, .resource = resource, .arrayElement = index });
+    return index;
+}
+
+bool BindlessTable::update(uint32_t index, const BindingResource &resource)
+{
+    if (index >= m_nextIndex || !m_resources[index].has_value() || resource.type() != m_resourceType)
+        return false;
+
+    m_resources[index] = resource;
+    m_bindGroup.update(BindGroupEntry{ .binding = 0, .resource = resource, .arrayElement = index });
+    return true;
+}
+
+void BindlessTable::remove(uint32_t index)
+{
+    if (index >= m_nextIndex || !m_resources[index].has_value())
+        return;
+
+    // The descriptor is left as is, the partially bound array doesn't need it to be valid
+    // as long as shaders don't read it. Submissions made so far still might.
+    m_resources[index].reset();
+    --m_residentCount;
+    m_retiredIndices.push_back(RetiredIndex{
+            .serial = m_device->deletionQueueStatistics().lastSubmittedSerial,
+            .index = index });
+}
+
+BindlessTableStatistics BindlessTable::statistics() const noexcept
+{
+    return BindlessTableStatistics{
+        .residentCount = m_residentCount,
+        .capacity = m_capacity,
+        .retiringCount = static_cast<uint32_t>(m_retiredIndices.size()),
+        .growCount = m_growCount,
+    };
+}
+
+bool BindlessTable::grow()
+{
+    if (m_capacity >= m_maxCount)
+        return false;
+
+    // The bind group keeps the number of descriptors it was allocated with, move
+    // everything over to a larger one with a single batched update
+    const uint32_t capacity = std::min(m_capacity * 2, m_maxCount);
+    std::vector<BindGroupEntry> entries;
+    entries.reserve(m_residentCount);
+    for (uint32_t index = 0; index < m_nextIndex; ++index) {
+        if (m_resources[index].has_value())
+            entries.push_back(BindGroupEntry{ .binding = 0, .resource = *m_resources[index], .arrayElement = index });
+    }
+
+    BindGroup bindGroup = m_device->createBindGroup(BindGroupOptions{
+            .layout = m_bindGroupLayout,
+            .resources = std::move(entries),
+            .maxVariableArrayLength = capacity,
+    });
+    if (!bindGroup.isValid())
+        return false;
+
+    // The previous descriptor set is only recycled once the submissions using it have retired
+    m_bindGroup = std::move(bindGroup);
+    m_capacity = capacity;
+    m_resources.resize(m_capacity);
+    ++m_growCount;
+    return true;
+}
+
+void BindlessTable::recycleRetiredIndices()
+{
+    if (m_retiredIndices.empty())
+        return;
+
+    const uint64_t completedSerial = m_device->deletionQueueStatistics().lastCompletedSerial;
+    while (!m_retiredIndices.empty() && m_retiredIndices.front().serial <= completedSerial) {
+        m_freeIndices.push_back(m_retiredIndices.front().index);
+        m_retiredIndices.pop_front();
+    }
+}
+
+} // namespace KDGpu
@@ -0,0 +1,135 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/bind_group.h>
+#include <KDGpu/bind_group_description.h>
+#include <KDGpu/bind_group_layout.h>
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <deque>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace KDGpu {
+
+class Device;
+
+struct BindlessTableOptions {
+    // SampledImage, StorageImage, Sampler, CombinedImageSampler or StorageBuffer
+    ResourceBindingType resourceType{ ResourceBindingType::SampledImage };
+    uint32_t maxCount{ 16384 }; // Clamped to the update after bind limits of the adapter
+    uint32_t initialCapacity{ 256 };
+    ShaderStageFlags shaderStages{ ShaderStageFlags(ShaderStageFlagBits::AllGraphics) | ShaderStageFlagBits::ComputeBit };
+};
+
+struct BindlessTableStatistics {
+    uint32_t residentCount{ 0 }; // Indices holding a resource
+    uint32_t capacity{ 0 };
+    uint32_t retiringCount{ 0 }; // Removed indices waiting for the GPU to be done with them
+    uint32_t growCount{ 0 };
+};
+
+/**
+    @brief Global array of resources of a single type, indexed from shaders
+    @ingroup public
+    @headerfile bindless_table.h <KDGpu/bindless_table.h>
+
+    The table is a bind group with a single binding 0 holding a runtime sized
+    array, created with descriptor indexing: descriptors are written after the
+    bind group is bound, need not all be written and the array only holds
+    capacity() descriptors. Every added resource gets an index which stays the
+    same until it is removed. Shaders read it from push constants or instance
+    data, so that drawing with another resource needs no new bind group.
+
+    @code{.glsl}
+    layout(set = 1, binding = 0) uniform texture2D textures[];
+    ...
+    texture(sampler2D(textures[nonuniformEXT(material.textureIndex)], linearSampler), uv);
+    @endcode
+
+    When all the indices are in use the array doubles, up to maxCount(). The
+    table then gets a new bind group which must be bound again, bindGroupLayout()
+    does not change so pipelines remain valid. Removed indices are handed out
+    again once the submissions made until then have retired, as noticed by
+    Device::collectGarbage() for instance.
+
+    The device must have been created with the descriptorBindingPartiallyBound,
+    descriptorBindingVariableDescriptorCount, runtimeDescriptorArray,
+    descriptorBindingUpdateUnusedWhilePending features and the update after bind
+    feature matching the resource type.
+
+    @sa Device::createBindlessTable
+ */
+class KDGPU_EXPORT BindlessTable
+{
+public:
+    static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    BindlessTable();
+    ~BindlessTable();
+
+    BindlessTable(BindlessTable &&);
+    BindlessTable &operator=(BindlessTable &&);
+
+    BindlessTable(const BindlessTable &) = delete;
+    BindlessTable &operator=(const BindlessTable &) = delete;
+
+    bool isValid() const noexcept { return m_bindGroup.isValid(); }
+
+    const BindGroupLayout &bindGroupLayout() const noexcept { return m_bindGroupLayout; }
+    const BindGroup &bindGroup() const noexcept { return m_bindGroup; } // Replaced when the table grows
+    ResourceBindingType resourceType() const noexcept { return m_resourceType; }
+    uint32_t capacity() const noexcept { return m_capacity; }
+    uint32_t maxCount() const noexcept { return m_maxCount; }
+
+    // Returns the index of the resource in the array, or InvalidIndex if the table is full
+    // or the resource is not of the type of the table
+    uint32_t add(const BindingResource &resource);
+
+    // Replaces the resource at index, which the GPU must not be reading anymore
+    bool update(uint32_t index, const BindingResource &resource);
+
+    void remove(uint32_t index);
+
+    BindlessTableStatistics statistics() const noexcept;
+
+private:
+    explicit BindlessTable(Device *device, const BindlessTableOptions &options);
+
+    struct RetiredIndex {
+        uint64_t serial;
+        uint32_t index;
+    };
+
+    bool grow();
+    void recycleRetiredIndices();
+
+    Device *m_device{ nullptr };
+    ResourceBindingType m_resourceType{ ResourceBindingType::SampledImage };
+    BindGroupLayout m_bindGroupLayout;
+    BindGroup m_bindGroup;
+    uint32_t m_capacity{ 0 };
+    uint32_t m_maxCount{ 0 };
+
+    std::vector<std::optional<BindingResource>> m_resources; // One per index below m_capacity
+    uint32_t m_nextIndex{ 0 }; // Indices from there on were never handed out
+    std::vector<uint32_t> m_freeIndices;
+    std::deque<RetiredIndex> m_retiredIndices; // Ordered by serial
+    uint32_t m_residentCount{ 0 };
+    uint32_t m_growCount{ 0 };
+
+    friend class Device;
+};
+
+} // namespace KDGpu
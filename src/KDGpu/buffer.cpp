@@ -24,6 +24,11 @@ Buffer::Buffer(GraphicsApi *api, const Handle<Device_t> &device, const BufferOpt
     , m_device(device)
     , m_buffer(m_api->resourceManager()->createBuffer(m_device, options, initialData))
 {
+    if (options.persistentlyMapped && isValid()) {
+        auto apiBuffer = m_api->resourceManager()->getBuffer(m_buffer);
+        m_mapped = apiBuffer->mappedData();
+        m_persistentlyMapped = m_mapped != nullptr;
+    }
 }
 
 Buffer::Buffer(Buffer &&other)
@@ -31,10 +36,14 @@ Buffer::Buffer(Buffer &&other)
     m_api = other.m_api;
     m_device = other.m_device;
     m_buffer = other.m_buffer;
+    m_mapped = other.m_mapped;
+    m_persistentlyMapped = other.m_persistentlyMapped;
 
     other.m_api = nullptr;
     other.m_device = {};
     other.m_buffer = {};
+    other.m_mapped = nullptr;
+    other.m_persistentlyMapped = false;
 }
 
 Buffer &Buffer::operator=(Buffer &&other)
@@ -46,10 +55,14 @@ Buffer &Buffer::operator=(Buffer &&other)
         m_api = other.m_api;
         m_device = other.m_device;
         m_buffer = other.m_buffer;
+        m_mapped = other.m_mapped;
+        m_persistentlyMapped = other.m_persistentlyMapped;
 
         other.m_api = nullptr;
         other.m_device = {};
         other.m_buffer = {};
+        other.m_mapped = nullptr;
+        other.m_persistentlyMapped = false;
     }
     return *this;
 }
@@ -71,13 +84,30 @@ void *Buffer::map()
 
 void Buffer::unmap()
 {
-    if (!m_mapped)
+    // A persistently mapped buffer stays mapped until it is destroyed
+    if (!m_mapped || m_persistentlyMapped)
         return;
     auto apiBuffer = m_api->resourceManager()->getBuffer(m_buffer);
     apiBuffer->unmap();
     m_mapped = nullptr;
 }
 
+void Buffer::flush(DeviceSize offset, DeviceSize size)
+{
+    if (!isValid())
+        return;
+    auto apiBuffer = m_api->resourceManager()->getBuffer(m_buffer);
+    apiBuffer->flush(offset, size);
+}
+
+void Buffer::invalidate(DeviceSize offset, DeviceSize size)
+{
+    if (!isValid())
+        return;
+    auto apiBuffer = m_api->resourceManager()->getBuffer(m_buffer);
+    apiBuffer->invalidate(offset, size);
+}
+
 bool operator==(const Buffer &a, const Buffer &b)
 {
     return a.m_api == b.m_api && a.m_device == b.m_device && a.m_buffer == b.m_buffer && a.m_mapped == b.m_mapped;
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <KDGpu/gpu_core.h>
 #include <KDGpu/handle.h>
 #include <KDGpu/kdgpu_export.h>
 
@@ -44,6 +45,16 @@ public:
     void *map();
     void unmap();
 
+    // Returns the mapping of a persistently mapped buffer (or of a buffer
+    // currently mapped with map()), nullptr otherwise. No API call is made.
+    void *mappedData() const noexcept { return m_mapped; }
+    bool isPersistentlyMapped() const noexcept { return m_persistentlyMapped; }
+
+    // Needed after writing to / before reading from memory which is not host coherent.
+    // Both are no-ops on host coherent memory.
+    void flush(DeviceSize offset = 0, DeviceSize size = WholeSize);
+    void invalidate(DeviceSize offset = 0, DeviceSize size = WholeSize);
+
 private:
     explicit Buffer(GraphicsApi *api, const Handle<Device_t> &device, const BufferOptions &options, const void *initialData);
 
@@ -52,9 +63,12 @@ private:
     Handle<Buffer_t> m_buffer;
 
     void *m_mapped{ nullptr };
+    bool m_persistentlyMapped{ false };
 
     friend class Device;
     friend class Queue;
+    friend class StagingRing;
+    friend class ReadbackRing;
     friend KDGPU_EXPORT bool operator==(const Buffer &, const Buffer &);
 };
 
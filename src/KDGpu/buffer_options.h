@@ -11,17 +11,24 @@
 #pragma once
 
 #include <KDGpu/gpu_core.h>
+#include <KDGpu/handle.h>
 
 #include <vector>
 
 namespace KDGpu {
 
+struct MemoryPool_t;
+
 struct BufferOptions {
     DeviceSize size;
     BufferUsageFlags usage;
     MemoryUsage memoryUsage;
     SharingMode sharingMode{ SharingMode::Exclusive };
     std::vector<uint32_t> queueTypeIndices{};
+    // Keeps the buffer mapped for its whole lifetime. Only honoured for host
+    // visible memory, Buffer::mappedData() then returns the mapping directly.
+    bool persistentlyMapped{ false };
+    Handle<MemoryPool_t> memoryPool{}; // Allocate from this pool rather than from the default ones
 };
 
 } // namespace KDGpu
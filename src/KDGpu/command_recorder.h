@@ -151,6 +151,9 @@ protected:
 
     friend class Device;
     friend class Queue;
+    friend class StagingRing;
+    friend class ReadbackRing;
+    friend class AsyncUploader;
 };
 
 } // namespace KDGpu
@@ -0,0 +1,360 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include "handle.h"
+#include "pool_statistics.h"
+
+#include <assert.h>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace KDGpu {
+
+/**
+ * @brief ConcurrentPool
+ * @internal
+ *
+ * A thread-safe variant of Pool that can be used for resource types which are
+ * created on worker threads while other threads look them up.
+ *
+ * Entries live in fixed size chunks which are never moved or reallocated once
+ * they have been published, which allows get() to be wait-free: it only performs
+ * two atomic loads (chunk pointer and slot generation). The alive state is
+ * packed into the lowest bit of the slot generation so that a single load tells
+ * us both whether the slot is alive and whether the handle is still current.
+ *
+ * Freed slots are stored in a set of sharded free lists. Each thread prefers its
+ * own shard which keeps contention low when several threads create and destroy
+ * resources at the same time.
+ *
+ * As with Pool, removing an entry does not call its destructor. The destructor of
+ * a stale entry is called when its slot gets reused or when the pool is destroyed.
+ */
+template<typename T, typename H>
+class ConcurrentPool
+{
+public:
+    static constexpr uint32_t ChunkSizeLog2 = 8;
+    static constexpr uint32_t ChunkSize = 1U << ChunkSizeLog2;
+    static constexpr uint32_t MaxChunkCount = 4096;
+    static constexpr uint32_t MaxSize = ChunkSize * MaxChunkCount;
+    static constexpr uint32_t ShardCount = 8;
+
+    // The chunk table and free lists are allocated up front, so that threads sharing a pool
+    // never race to create them. Only the chunks themselves are allocated on demand.
+    ConcurrentPool()
+        : m_chunks(std::make_unique<std::atomic<Slot *>[]>(MaxChunkCount))
+        , m_shards(std::make_unique<Shard[]>(ShardCount))
+        , m_capacity(0)
+        , m_nextIndex(0)
+        , m_size(0)
+        , m_highWaterMark(0)
+        , m_insertCount(0)
+        , m_reuseCount(0)
+    {
+        for (uint32_t i = 0; i < MaxChunkCount; ++i)
+            m_chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    explicit ConcurrentPool(uint32_t size)
+        : ConcurrentPool()
+    {
+        assert(size <= MaxSize);
+        const uint32_t chunkCount = (size + ChunkSize - 1) >> ChunkSizeLog2;
+        for (uint32_t i = 0; i < chunkCount; ++i)
+            chunkAt(i << ChunkSizeLog2);
+    }
+
+    ~ConcurrentPool()
+    {
+        destroyAll();
+    }
+
+    ConcurrentPool(ConcurrentPool const &other) = delete;
+    ConcurrentPool &operator=(ConcurrentPool const &other) = delete;
+
+    // Moving is not thread-safe and must not race with any other operation on either pool.
+    // A moved-from pool is empty and may only be looked up in, destroyed or assigned to.
+    ConcurrentPool(ConcurrentPool &&other) noexcept
+        : m_chunks(std::move(other.m_chunks))
+        , m_shards(std::move(other.m_shards))
+        , m_capacity(other.m_capacity.load(std::memory_order_relaxed))
+        , m_nextIndex(other.m_nextIndex.load(std::memory_order_relaxed))
+        , m_size(other.m_size.load(std::memory_order_relaxed))
+        , m_highWaterMark(other.m_highWaterMark.load(std::memory_order_relaxed))
+        , m_insertCount(other.m_insertCount.load(std::memory_order_relaxed))
+        , m_reuseCount(other.m_reuseCount.load(std::memory_order_relaxed))
+    {
+        other.m_capacity.store(0, std::memory_order_relaxed);
+        other.m_nextIndex.store(0, std::memory_order_relaxed);
+        other.m_size.store(0, std::memory_order_relaxed);
+        other.resetStatistics();
+    }
+
+    ConcurrentPool &operator=(ConcurrentPool &&other) noexcept
+    {
+        if (this != &other) {
+            destroyAll();
+
+            m_chunks = std::move(other.m_chunks);
+            m_shards = std::move(other.m_shards);
+            m_capacity.store(other.m_capacity.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m_nextIndex.store(other.m_nextIndex.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m_size.store(other.m_size.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m_highWaterMark.store(other.m_highWaterMark.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m_insertCount.store(other.m_insertCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m_reuseCount.store(other.m_reuseCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            other.m_capacity.store(0, std::memory_order_relaxed);
+            other.m_nextIndex.store(0, std::memory_order_relaxed);
+            other.m_size.store(0, std::memory_order_relaxed);
+            other.resetStatistics();
+        }
+        return *this;
+    }
+
+    uint32_t capacity() const noexcept { return m_capacity.load(std::memory_order_relaxed); }
+    uint32_t size() const noexcept { return m_size.load(std::memory_order_relaxed); }
+
+    // Relaxed loads only. The counters are read independently so the snapshot may
+    // be slightly inconsistent while other threads are inserting or removing entries.
+    PoolStatistics statistics() const noexcept
+    {
+        return PoolStatistics{
+            .liveCount = size(),
+            .highWaterMark = m_highWaterMark.load(std::memory_order_relaxed),
+            .capacity = capacity(),
+            .insertCount = m_insertCount.load(std::memory_order_relaxed),
+            .reuseCount = m_reuseCount.load(std::memory_order_relaxed)
+        };
+    }
+
+    void resetStatistics() noexcept
+    {
+        m_highWaterMark.store(size(), std::memory_order_relaxed);
+        m_insertCount.store(0, std::memory_order_relaxed);
+        m_reuseCount.store(0, std::memory_order_relaxed);
+    }
+
+    // Wait-free. Safe to call concurrently with emplace() and remove().
+    T *get(const Handle<H> &handle) const noexcept
+    {
+        Slot *slot = slotAt(handle.m_index);
+        if (!slot)
+            return nullptr;
+        const uint32_t generation = slot->generation.load(std::memory_order_acquire);
+        if (generation != handle.m_generation || !isAlive(generation))
+            return nullptr;
+        return slot->data();
+    }
+
+    template<typename... Args>
+    Handle<H> emplace(Args &&...args)
+    {
+        assert(m_chunks && "emplace() on a moved-from ConcurrentPool");
+
+        uint32_t index = 0;
+        if (popFreeIndex(index)) {
+            m_reuseCount.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            index = m_nextIndex.fetch_add(1, std::memory_order_relaxed);
+            assert(index < MaxSize);
+        }
+
+        Slot *slot = chunkAt(index) + (index & (ChunkSize - 1));
+        const uint32_t oldGeneration = slot->generation.load(std::memory_order_relaxed);
+
+        // A slot that has been used before still holds its previous (removed) value
+        if (oldGeneration != 0)
+            slot->data()->~T();
+        new (slot->storage) T(std::forward<Args>(args)...);
+
+        // Removed slots have an even generation, bumping it makes it odd (alive)
+        const uint32_t generation = oldGeneration + 1;
+        slot->generation.store(generation, std::memory_order_release);
+        const uint32_t newSize = m_size.fetch_add(1, std::memory_order_relaxed) + 1;
+        m_insertCount.fetch_add(1, std::memory_order_relaxed);
+        uint32_t highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+        while (newSize > highWaterMark && !m_highWaterMark.compare_exchange_weak(highWaterMark, newSize, std::memory_order_relaxed)) {
+        }
+
+        return Handle<H>(index, generation);
+    }
+
+    Handle<H> insert(const T &data)
+    {
+        return emplace(data);
+    }
+
+    void remove(const Handle<H> &handle)
+    {
+        Slot *slot = slotAt(handle.m_index);
+        if (!slot)
+            return;
+
+        // Only the thread that successfully bumps the generation gets to recycle the slot
+        uint32_t expected = handle.m_generation;
+        if (!isAlive(expected) || !slot->generation.compare_exchange_strong(expected, expected + 1, std::memory_order_acq_rel))
+            return;
+
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+        pushFreeIndex(handle.m_index);
+    }
+
+    // Not thread-safe with respect to concurrent emplace() calls
+    void clear()
+    {
+        const uint32_t count = usedSlotCount();
+        for (uint32_t i = 0; i < count; ++i) {
+            const auto handle = handleForIndex(i);
+            if (handle.isValid())
+                remove(handle);
+        }
+    }
+
+    // Convert an entry index into a Handle<H>, if possible otherwise returns an invalid handle
+    Handle<H> handleForIndex(uint32_t entryIndex) const
+    {
+        Slot *slot = slotAt(entryIndex);
+        if (!slot)
+            return {};
+        const uint32_t generation = slot->generation.load(std::memory_order_acquire);
+        if (!isAlive(generation))
+            return {};
+        return Handle<H>{ entryIndex, generation };
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> generation{ 0 };
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *data() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<uint32_t> freeIndices;
+    };
+
+    static bool isAlive(uint32_t generation) noexcept { return (generation & 1U) != 0; }
+
+    uint32_t usedSlotCount() const noexcept
+    {
+        const uint32_t next = m_nextIndex.load(std::memory_order_acquire);
+        return next < MaxSize ? next : MaxSize;
+    }
+
+    Slot *slotAt(uint32_t index) const noexcept
+    {
+        if (!m_chunks || index >= MaxSize)
+            return nullptr;
+        Slot *chunk = m_chunks[index >> ChunkSizeLog2].load(std::memory_order_acquire);
+        if (!chunk)
+            return nullptr;
+        return chunk + (index & (ChunkSize - 1));
+    }
+
+    // Returns the chunk containing index, allocating and publishing it if needed
+    Slot *chunkAt(uint32_t index)
+    {
+        std::atomic<Slot *> &chunkPtr = m_chunks[index >> ChunkSizeLog2];
+        Slot *chunk = chunkPtr.load(std::memory_order_acquire);
+        if (chunk)
+            return chunk;
+
+        Slot *newChunk = new Slot[ChunkSize];
+        if (chunkPtr.compare_exchange_strong(chunk, newChunk, std::memory_order_acq_rel)) {
+            m_capacity.fetch_add(ChunkSize, std::memory_order_relaxed);
+            return newChunk;
+        }
+
+        // Another thread published this chunk first
+        delete[] newChunk;
+        return chunk;
+    }
+
+    static uint32_t currentShard() noexcept
+    {
+        static std::atomic<uint32_t> s_nextShard{ 0 };
+        thread_local const uint32_t shard = s_nextShard.fetch_add(1, std::memory_order_relaxed) % ShardCount;
+        return shard;
+    }
+
+    void pushFreeIndex(uint32_t index)
+    {
+        Shard &shard = m_shards[currentShard()];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.freeIndices.push_back(index);
+    }
+
+    bool popFreeIndex(uint32_t &index)
+    {
+        const uint32_t firstShard = currentShard();
+        for (uint32_t i = 0; i < ShardCount; ++i) {
+            Shard &shard = m_shards[(firstShard + i) % ShardCount];
+            // Only block on our own shard, steal from others opportunistically
+            std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+            if (i == 0)
+                lock.lock();
+            else if (!lock.try_lock())
+                continue;
+            if (!shard.freeIndices.empty()) {
+                index = shard.freeIndices.back();
+                shard.freeIndices.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void destroyAll() noexcept
+    {
+        if (!m_chunks)
+            return;
+        for (uint32_t c = 0; c < MaxChunkCount; ++c) {
+            Slot *chunk = m_chunks[c].load(std::memory_order_relaxed);
+            if (!chunk)
+                continue;
+            for (uint32_t i = 0; i < ChunkSize; ++i) {
+                if (chunk[i].generation.load(std::memory_order_relaxed) != 0)
+                    chunk[i].data()->~T();
+            }
+            delete[] chunk;
+            m_chunks[c].store(nullptr, std::memory_order_relaxed);
+        }
+        m_chunks.reset();
+        m_shards.reset();
+        m_capacity.store(0, std::memory_order_relaxed);
+        m_nextIndex.store(0, std::memory_order_relaxed);
+        m_size.store(0, std::memory_order_relaxed);
+        resetStatistics();
+    }
+
+    std::unique_ptr<std::atomic<Slot *>[]> m_chunks;
+    std::unique_ptr<Shard[]> m_shards;
+    std::atomic<uint32_t> m_capacity;
+    std::atomic<uint32_t> m_nextIndex;
+    std::atomic<uint32_t> m_size;
+
+    // Usage statistics
+    std::atomic<uint32_t> m_highWaterMark;
+    std::atomic<uint64_t> m_insertCount;
+    std::atomic<uint64_t> m_reuseCount;
+};
+
+} // namespace KDGpu
@@ -0,0 +1,52 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/handle.h>
+
+#include <chrono>
+#include <stdint.h>
+
+namespace KDGpu {
+
+struct MemoryPool_t;
+
+enum class DefragmentationStrategy : uint32_t {
+    Fast = 0, // Cheap passes, frees fewer blocks
+    Balanced = 1,
+    Full = 2, // Most moves, best packing
+};
+
+struct DefragmentationOptions {
+    Handle<MemoryPool_t> memoryPool{}; // Defragments the default memory when invalid
+    DefragmentationStrategy strategy{ DefragmentationStrategy::Balanced };
+    std::chrono::microseconds timeBudget{ 1000 }; // CPU time spent preparing the moves of a step
+    DeviceSize maxBytesPerPass{ 0 }; // 0 for no limit
+    uint32_t maxAllocationsPerPass{ 0 }; // 0 for no limit
+};
+
+/**
+    @brief Progress of the defragmentation of a Device
+    @ingroup public
+    @headerfile defragmentation.h <KDGpu/defragmentation.h>
+*/
+struct DefragmentationStatistics {
+    bool active{ false };
+    uint32_t passCount{ 0 };
+    uint64_t allocationsMoved{ 0 };
+    DeviceSize bytesMoved{ 0 };
+    uint64_t allocationsSkipped{ 0 }; // Could not be moved this pass (textures, mapped buffers, out of time)
+    DeviceSize bytesFreed{ 0 }; // Only known once the defragmentation has ended
+    uint32_t memoryBlocksFreed{ 0 }; // Only known once the defragmentation has ended
+};
+
+} // namespace KDGpu
@@ -0,0 +1,32 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace KDGpu {
+
+/**
+    @brief Holds counters describing the state of a Device's deferred deletion queue
+    @ingroup public
+    @headerfile deletion_queue_statistics.h <KDGpu/deletion_queue_statistics.h>
+*/
+struct DeletionQueueStatistics {
+    uint64_t pendingDeletions{ 0 }; // Objects waiting for the GPU to retire their last submission
+    uint64_t peakPendingDeletions{ 0 };
+    uint64_t deferredDeletions{ 0 }; // Total number of deletions that could not be honored immediately
+    uint64_t completedDeletions{ 0 }; // Total number of objects destroyed through the queue
+    uint32_t submissionsInFlight{ 0 };
+    uint64_t lastSubmittedSerial{ 0 };
+    uint64_t lastCompletedSerial{ 0 };
+};
+
+} // namespace KDGpu
@@ -16,6 +16,7 @@
 #include <KDGpu/api/api_device.h>
 #include <KDGpu/bind_group_options.h>
 #include <KDGpu/bind_group_layout_options.h>
+#include <KDGpu/memory_pool_options.h>
 
 namespace KDGpu {
 
@@ -60,6 +61,7 @@ Device::Device()
 Device::Device(Adapter *adapter, GraphicsApi *api, const DeviceOptions &options)
     : m_api(api)
     , m_adapter(adapter)
+    , m_enabledFeatures(options.requestedFeatures)
 {
     // Pass in a vector of queue requests which will be populated with the actual set of
     // queues requested by the device creation.
@@ -69,11 +71,11 @@ Device::Device(Adapter *adapter, GraphicsApi *api, const DeviceOptions &options)
 
     // To fetch the queues from the device we pass in the actual set of queue requests so that
     // we can match up the queues to the queue family indices and other properties
-    const auto queueDescriptions = apiDevice->getQueues(m_api->resourceManager(), queueRequests, adapter->queueTypes());
+    const auto queueDescriptions = apiDevice->getQueues(m_api->resourceManager(), m_device, queueRequests, adapter->queueTypes());
     const uint32_t queueCount = queueDescriptions.size();
     m_queues.reserve(queueCount);
     for (uint32_t i = 0; i < queueCount; ++i)
-        m_queues.emplace_back(Queue(m_api, m_device, queueDescriptions[i]));
+        m_queues.emplace_back(Queue(m_api, m_device, queueDescriptions[i], options.stagingRingSize));
 }
 
 Device::Device(Device &&other)
@@ -82,6 +84,7 @@ Device::Device(Device &&other)
     m_device = other.m_device;
     m_queues = std::move(other.m_queues);
     m_adapter = other.m_adapter;
+    m_enabledFeatures = other.m_enabledFeatures;
 
     other.m_api = nullptr;
     other.m_device = {};
@@ -92,13 +95,16 @@ Device::Device(Device &&other)
 Device &Device::operator=(Device &&other)
 {
     if (this != &other) {
-        if (isValid())
+        if (isValid()) {
+            releaseStagingRings();
             m_api->resourceManager()->deleteDevice(handle());
+        }
 
         m_api = other.m_api;
         m_device = other.m_device;
         m_queues = std::move(other.m_queues);
         m_adapter = other.m_adapter;
+        m_enabledFeatures = other.m_enabledFeatures;
 
         other.m_api = nullptr;
         other.m_device = {};
@@ -110,8 +116,19 @@ Device &Device::operator=(Device &&other)
 
 Device::~Device()
 {
-    if (isValid())
+    if (isValid()) {
+        releaseStagingRings();
         m_api->resourceManager()->deleteDevice(handle());
+    }
+}
+
+void Device::releaseStagingRings()
+{
+    // Copies of the queues may outlive the device, the staging memory must not
+    for (Queue &queue : m_queues) {
+        if (queue.m_stagingRing)
+            queue.m_stagingRing->release();
+    }
 }
 
 const Adapter *Device::adapter() const
@@ -128,16 +145,150 @@ void Device::waitUntilIdle()
     apiDevice->waitUntilIdle();
 }
 
+/**
+ * @brief Destroys the resources whose deletion was deferred because the GPU could still be using them.
+ *
+ * Releasing a resource (e.g. a Buffer going out of scope) while previously submitted work may still
+ * reference it does not destroy the underlying API object right away. Instead it is queued and
+ * destroyed once all the submissions made before its release have completed. This is checked
+ * whenever commands are submitted and when waiting for the device to become idle; calling this
+ * function allows to reclaim the memory at a specific point, typically once per frame.
+ */
+void Device::collectGarbage()
+{
+    auto apiDevice = m_api->resourceManager()->getDevice(m_device);
+    apiDevice->collectGarbage();
+}
+
+/**
+ * @brief Ends the frame of the bind groups created with BindGroupOptions::transient.
+ *
+ * All the transient bind groups created since the previous call become invalid. Their descriptor pools
+ * are reset as a whole and reused once the submissions made until now have completed, so creating
+ * transient bind groups every frame does not grow memory usage. Typically called once per frame,
+ * after submitting the work using them.
+ */
+void Device::resetTransientBindGroups()
+{
+    auto apiDevice = m_api->resourceManager()->getDevice(m_device);
+    apiDevice->resetTransientBindGroups();
+}
+
+/**
+ * @brief Returns counters about the queue of resources waiting for the GPU before being destroyed.
+ */
+DeletionQueueStatistics Device::deletionQueueStatistics() const
+{
+    auto apiDevice = m_api->resourceManager()->getDevice(m_device);
+    return apiDevice->deletionQueueStatistics();
+}
+
+/**
+ * @brief Returns the usage and budget of each memory heap of the device.
+ *
+ * Uses VK_EXT_memory_budget when the adapter supports it, in which case the usage accounts for all the
+ * memory used by the process, and the budget for what the OS grants it given the other processes sharing
+ * the GPU. Otherwise both are estimated from the memory allocated by this device and the heap sizes.
+ */
+MemoryBudget Device::memoryBudget() const
+{
+    auto apiDevice = m_api->resourceManager()->getDevice(m_device);
+    return apiDevice->memoryBudget();
+}
+
+/**
+ * @brief Sets a callback invoked when the usage of a heap reaches usageThreshold (a fraction of its budget).
+ *
+ * The usage is checked whenever a buffer or texture is created and on collectGarbage(). The callback is
+ * invoked once per heap when its usage goes over the threshold, and again only after the usage went back
+ * under the threshold. This allows to release caches before allocations start to fail. Passing an empty
+ * callback disables the monitoring.
+ */
+void Device::setMemoryBudgetCallback(float usageThreshold, const MemoryBudgetCallback &callback)
+{
+    auto apiDevice = m_api->resourceManager()->getDevice(m_device);
+    apiDevice->setMemoryBudgetCallback(usageThreshold, callback);
+}
+
+/**
+ * @brief Starts compacting the memory of the device, or of options.memoryPool, to free partially used memory blocks.
+ *
+ * The work is spread over calls to defragmentationStep(), typically one per frame. Returns false if a
+ * defragmentation is already in progress.
+ */
+bool Device::beginDefragmentation(const DefragmentationOptions &options)
+{
+    return m_api->resourceManager()->beginDefragmentation(m_device, options);
+}
+
+/**
+ * @brief Relocates the allocations of one defragmentation pass, spending at most the time budget on preparing moves.
+ *
+ * Buffers are moved behind their existing handles: their Vulkan object is recreated on the new memory and the
+ * bind groups referencing them are rewritten. Device local buffers are copied on \a queue and must have been
+ * created with both TransferSrcBit and TransferDstBit usages. Textures and mapped buffers are never moved.
+ *
+ * The step never waits for the GPU. The copies are submitted to \a queue after the work already submitted to it,
+ * and the pass ends in a later step, once they have retired. Until then no new pass is started. While work is in
+ * flight, host visible buffers and buffers referenced by bind groups are left where they are. Buffers used on
+ * other queues must not be in use there during the step.
+ *
+ * Command buffers recorded before the step reference the old buffers and must be recorded again. Once everything
+ * that could be moved has been, the defragmentation ends by itself and the returned statistics are no longer active.
+ */
+DefragmentationStatistics Device::defragmentationStep(Queue &queue)
+{
+    return m_api->resourceManager()->defragmentationStep(m_device, queue.handle());
+}
+
+/**
+ * @brief Ends the defragmentation in progress, if any, and releases the memory blocks it emptied.
+ *
+ * Waits for the copies of a pass still in flight.
+ */
+DefragmentationStatistics Device::endDefragmentation()
+{
+    return m_api->resourceManager()->endDefragmentation(m_device);
+}
+
 Swapchain Device::createSwapchain(const SwapchainOptions &options)
 {
     return Swapchain(m_api, m_device, options);
 }
 
+/**
+ * @brief Creates a texture.
+ *
+ * Attachments which are never loaded nor stored, such as multisampled color or depth targets, should use the
+ * TransientAttachmentBit usage with MemoryUsage::GpuLazilyAllocated. On tiled GPUs their memory is then only
+ * committed if the contents have to leave the tile memory. Devices without lazily allocated memory fall back to
+ * GpuOnly memory; createAliasedTextures() can reduce their footprint there.
+ */
 Texture Device::createTexture(const TextureOptions &options)
 {
     return Texture(m_api, m_device, options);
 }
 
+/**
+ * @brief Creates textures which all share a single memory allocation, sized for the largest of them.
+ *
+ * Only one of the textures holds valid contents at any time, so their use within a frame must not overlap.
+ * Switching from one texture to another requires a barrier and a transition from TextureLayout::Undefined,
+ * the previous contents are lost. This is typically used for transient attachments of different passes.
+ *
+ * The memory usage and memory pool of the first options are used for all the textures. Returns an empty vector
+ * if the textures have no memory type in common, or none the memory pool allocates from.
+ */
+std::vector<Texture> Device::createAliasedTextures(const std::vector<TextureOptions> &options)
+{
+    const std::vector<Handle<Texture_t>> handles = m_api->resourceManager()->createAliasedTextures(m_device, options);
+    std::vector<Texture> textures;
+    textures.reserve(handles.size());
+    for (const Handle<Texture_t> &handle : handles)
+        textures.emplace_back(Texture(m_api, m_device, handle));
+    return textures;
+}
+
 Buffer Device::createBuffer(const BufferOptions &options, const void *initialData)
 {
     return Buffer(m_api, m_device, options, initialData);
@@ -193,6 +344,59 @@ Fence Device::createFence(const FenceOptions &options)
     return Fence(m_api, m_device, options);
 }
 
+MemoryPool Device::createMemoryPool(const MemoryPoolOptions &options)
+{
+    return MemoryPool(m_api, m_device, options);
+}
+
+TransientBufferAllocator Device::createTransientBufferAllocator(const TransientBufferAllocatorOptions &options)
+{
+    return TransientBufferAllocator(this, options);
+}
+
+AsyncUploader Device::createAsyncUploader(const Queue &destinationQueue, const AsyncUploaderOptions &options)
+{
+    for (const Queue &queue : m_queues) {
+        const QueueFlags flags = queue.flags();
+        if (flags.testFlag(QueueFlagBits::TransferBit) &&
+            !flags.testFlag(QueueFlagBits::GraphicsBit) &&
+            !flags.testFlag(QueueFlagBits::ComputeBit) &&
+            queue.queueTypeIndex() != destinationQueue.queueTypeIndex())
+            return AsyncUploader(m_api, m_device, queue, destinationQueue, options);
+    }
+    return AsyncUploader(m_api, m_device, destinationQueue, destinationQueue, options);
+}
+
+ReadbackRing Device::createReadbackRing(const Queue &queue, const ReadbackRingOptions &options)
+{
+    return ReadbackRing(m_api, m_device, queue, options);
+}
+
+/**
+    @brief Returns a MipmapGenerator which records its work through this Device
+
+    The Device must outlive the generator and must not be moved while it is in use.
+ */
+MipmapGenerator Device::createMipmapGenerator()
+{
+    return MipmapGenerator(this);
+}
+
+StreamingTexture Device::createStreamingTexture(const Queue &queue, const StreamingTextureOptions &options)
+{
+    return StreamingTexture(this, queue, options);
+}
+
+TextureAtlas Device::createTextureAtlas(const Queue &queue, const TextureAtlasOptions &options)
+{
+    return TextureAtlas(this, queue, options);
+}
+
+BindlessTable Device::createBindlessTable(const BindlessTableOptions &options)
+{
+    return BindlessTable(this, options);
+}
+
 GraphicsApi *Device::graphicsApi() const
 {
     return m_api;
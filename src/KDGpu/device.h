@@ -10,23 +10,34 @@
 
 #pragma once
 
+#include <KDGpu/async_uploader.h>
 #include <KDGpu/bind_group.h>
 #include <KDGpu/bind_group_layout.h>
+#include <KDGpu/bindless_table.h>
 #include <KDGpu/buffer.h>
 #include <KDGpu/command_recorder.h>
+#include <KDGpu/deletion_queue_statistics.h>
 #include <KDGpu/compute_pipeline.h>
+#include <KDGpu/defragmentation.h>
 #include <KDGpu/device_options.h>
 #include <KDGpu/fence.h>
 #include <KDGpu/gpu_semaphore.h>
 #include <KDGpu/graphics_pipeline.h>
+#include <KDGpu/memory_budget.h>
+#include <KDGpu/memory_pool.h>
+#include <KDGpu/mipmap_generator.h>
 #include <KDGpu/handle.h>
 #include <KDGpu/pipeline_layout.h>
 #include <KDGpu/pipeline_layout_options.h>
 #include <KDGpu/queue.h>
+#include <KDGpu/readback_ring.h>
 #include <KDGpu/sampler.h>
 #include <KDGpu/sampler_options.h>
 #include <KDGpu/shader_module.h>
+#include <KDGpu/streaming_texture.h>
+#include <KDGpu/texture_atlas.h>
 #include <KDGpu/swapchain.h>
+#include <KDGpu/transient_buffer_allocator.h>
 
 #include <KDGpu/kdgpu_export.h>
 
@@ -71,10 +82,24 @@ public:
 
     void waitUntilIdle();
 
+    void collectGarbage();
+    DeletionQueueStatistics deletionQueueStatistics() const;
+
+    void resetTransientBindGroups();
+
+    MemoryBudget memoryBudget() const;
+    void setMemoryBudgetCallback(float usageThreshold, const MemoryBudgetCallback &callback);
+
+    bool beginDefragmentation(const DefragmentationOptions &options = DefragmentationOptions());
+    DefragmentationStatistics defragmentationStep(Queue &queue);
+    DefragmentationStatistics endDefragmentation();
+
     const Adapter *adapter() const;
+    const AdapterFeatures &enabledFeatures() const noexcept { return m_enabledFeatures; }
 
     Swapchain createSwapchain(const SwapchainOptions &options);
     Texture createTexture(const TextureOptions &options);
+    std::vector<Texture> createAliasedTextures(const std::vector<TextureOptions> &options);
 
     // TODO: If initialData is set, upload this to the newly created buffer.
     // OR should this helper functionality go in a slightly higher layer that
@@ -102,15 +127,40 @@ public:
 
     Fence createFence(const FenceOptions &options = FenceOptions());
 
+    MemoryPool createMemoryPool(const MemoryPoolOptions &options);
+
+    TransientBufferAllocator createTransientBufferAllocator(const TransientBufferAllocatorOptions &options = TransientBufferAllocatorOptions());
+
+    // Uploads on the first transfer only queue of the device, if any, and hands the
+    // resources over to destinationQueue. Otherwise uploads on destinationQueue.
+    AsyncUploader createAsyncUploader(const Queue &destinationQueue, const AsyncUploaderOptions &options = AsyncUploaderOptions());
+
+    // Copies buffers and textures back from the GPU through the given queue
+    ReadbackRing createReadbackRing(const Queue &queue, const ReadbackRingOptions &options = ReadbackRingOptions());
+
+    MipmapGenerator createMipmapGenerator();
+
+    // Uploads the mip levels of the texture through queue over several frames, coarsest first
+    StreamingTexture createStreamingTexture(const Queue &queue, const StreamingTextureOptions &options);
+
+    // Packs many small images into a texture or texture array, uploaded through queue
+    TextureAtlas createTextureAtlas(const Queue &queue, const TextureAtlasOptions &options = TextureAtlasOptions());
+
+    // Global array of resources indexed from shaders, needs the descriptor indexing features
+    BindlessTable createBindlessTable(const BindlessTableOptions &options = BindlessTableOptions());
+
     GraphicsApi *graphicsApi() const;
 
 private:
     Device(Adapter *adapter, GraphicsApi *api, const DeviceOptions &options);
 
+    void releaseStagingRings();
+
     GraphicsApi *m_api{ nullptr };
     Adapter *m_adapter{ nullptr };
     Handle<Device_t> m_device;
     std::vector<Queue> m_queues;
+    AdapterFeatures m_enabledFeatures{};
 
     friend class Adapter;
     friend class VulkanGraphicsApi;
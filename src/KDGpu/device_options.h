@@ -11,6 +11,7 @@
 #pragma once
 
 #include <KDGpu/adapter_features.h>
+#include <KDGpu/gpu_core.h>
 
 #include <stdint.h>
 #include <string>
@@ -29,6 +30,7 @@ struct DeviceOptions {
     std::vector<std::string> extensions;
     std::vector<QueueRequest> queues;
     AdapterFeatures requestedFeatures;
+    DeviceSize stagingRingSize{ 16 * 1024 * 1024 }; // Per queue, see Queue::stageBufferUpload()
 };
 
 } // namespace KDGpu
@@ -74,6 +74,9 @@ void Fence::wait()
 
 FenceStatus Fence::status() const
 {
+    // Nothing to wait for, e.g. an upload which did not need a submission
+    if (!isValid())
+        return FenceStatus::Signalled;
     return m_api->resourceManager()->getFence(handle())->status();
 }
 
@@ -60,6 +60,9 @@ private:
     friend KDGPU_EXPORT bool operator==(const Fence &, const Fence &);
     friend class Device;
     friend class Queue;
+    friend class StagingRing;
+    friend class ReadbackRing;
+    friend class AsyncUploader;
 };
 
 KDGPU_EXPORT bool operator==(const Fence &a, const Fence &b);
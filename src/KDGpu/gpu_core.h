@@ -635,6 +635,8 @@ struct TextureSubresourceRange {
     uint32_t levelCount{ remainingMipLevels };
     uint32_t baseArrayLayer{ 0 };
     uint32_t layerCount{ remainingArrayLayers };
+
+    friend bool operator==(const TextureSubresourceRange &, const TextureSubresourceRange &) = default;
 };
 
 struct TextureSubresourceLayers {
@@ -733,6 +735,17 @@ enum class ResourceBindingType {
     MaxEnum = 0x7fffffff
 };
 
+// Need the matching descriptor indexing features of the adapter
+enum class ResourceBindingFlagBits : uint32_t {
+    None = 0x00000000,
+    UpdateAfterBindBit = 0x00000001, // Descriptors may be written after the bind group is bound, until submission
+    UpdateUnusedWhilePendingBit = 0x00000002, // Descriptors not used by pending submissions may be written
+    PartiallyBoundBit = 0x00000004, // Descriptors not used by the shaders need not be written
+    VariableBindGroupEntriesCountBit = 0x00000008, // Only for the highest binding, count becomes an upper bound
+    MaxEnum = 0x7fffffff
+};
+using ResourceBindingFlags = KDUtils::Flags<ResourceBindingFlagBits>;
+
 enum class PrimitiveTopology {
     PointList = 0,
     LineList = 1,
@@ -1074,6 +1087,7 @@ OPERATORS_FOR_FLAGS(KDGpu::TextureUsageFlags)
 OPERATORS_FOR_FLAGS(KDGpu::TextureAspectFlags)
 OPERATORS_FOR_FLAGS(KDGpu::BufferUsageFlags)
 OPERATORS_FOR_FLAGS(KDGpu::ShaderStageFlags)
+OPERATORS_FOR_FLAGS(KDGpu::ResourceBindingFlags)
 OPERATORS_FOR_FLAGS(KDGpu::CullModeFlags)
 OPERATORS_FOR_FLAGS(KDGpu::ColorComponentFlags)
 OPERATORS_FOR_FLAGS(KDGpu::AccessFlags)
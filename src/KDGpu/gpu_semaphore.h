@@ -53,6 +53,7 @@ private:
     Handle<GpuSemaphore_t> m_gpuSemaphore;
 
     friend class Device;
+    friend class AsyncUploader;
 };
 
 } // namespace KDGpu
@@ -47,6 +47,10 @@ private:
 
     template<typename U, typename V>
     friend class Pool;
+    template<typename U, typename V>
+    friend class ConcurrentPool;
+    template<typename U, typename V>
+    friend class TransientPool;
 };
 
 template<typename T>
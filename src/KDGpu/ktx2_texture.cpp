@@ -0,0 +1,372 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "ktx2_texture.h"
+
+#include <KDGpu/adapter.h>
+#include <KDGpu/device.h>
+#include <KDGpu/utils/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(PLATFORM_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace KDGpu {
+
+namespace {
+
+constexpr uint8_t ktx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// Layout of the start of a KTX2 file, all fields are little endian
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80);
+
+struct Ktx2LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Start of the basic data format descriptor block, following the total size of the descriptor
+struct Ktx2BasicDescriptor {
+    uint32_t totalSize;
+    uint32_t vendorIdAndDescriptorType;
+    uint16_t versionNumber;
+    uint16_t descriptorBlockSize;
+    uint8_t colorModel;
+    uint8_t colorPrimaries;
+    uint8_t transferFunction;
+    uint8_t flags;
+    uint8_t texelBlockDimension[4]; // Minus one
+    uint8_t bytesPlane[8];
+};
+static_assert(sizeof(Ktx2BasicDescriptor) == 28);
+
+constexpr uint32_t maxLevelCount = 32;
+
+// Whether the range lies within a file of fileSize bytes, without overflowing
+bool isInFile(uint64_t offset, uint64_t byteSize, size_t fileSize)
+{
+    return offset <= fileSize && byteSize <= fileSize - offset;
+}
+
+// Multiplies a by b, returning false instead if the product would exceed limit
+bool multiplyWithin(uint64_t &a, uint64_t b, uint64_t limit)
+{
+    if (b != 0 && a > limit / b)
+        return false;
+    a *= b;
+    return true;
+}
+
+bool inRange(Format format, Format first, Format last)
+{
+    return static_cast<int>(format) >= static_cast<int>(first) && static_cast<int>(format) <= static_cast<int>(last);
+}
+
+} // namespace
+
+struct Ktx2Texture::MappedFile {
+    ~MappedFile()
+    {
+#if defined(PLATFORM_WIN32)
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (data)
+            munmap(const_cast<uint8_t *>(data), size);
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    bool map(const std::string &path)
+    {
+#if defined(PLATFORM_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return false;
+        size = static_cast<size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+            return false;
+        data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+            return false;
+        size = static_cast<size_t>(fileStat.st_size);
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+            return false;
+        data = static_cast<const uint8_t *>(mapped);
+#endif
+        return data != nullptr;
+    }
+
+    const uint8_t *data{ nullptr };
+    size_t size{ 0 };
+#if defined(PLATFORM_WIN32)
+    HANDLE file{ INVALID_HANDLE_VALUE };
+    HANDLE mapping{ nullptr };
+#else
+    int fd{ -1 };
+#endif
+};
+
+Ktx2Texture::Ktx2Texture() = default;
+
+Ktx2Texture::Ktx2Texture(const std::string &path)
+    : m_file(std::make_unique<MappedFile>())
+{
+    if (!m_file->map(path)) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Failed to map KTX2 file {}", path);
+        m_file.reset();
+        return;
+    }
+    if (!parse()) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Unsupported or invalid KTX2 file {}", path);
+        m_file.reset();
+        m_levels.clear();
+    }
+}
+
+Ktx2Texture::Ktx2Texture(Ktx2Texture &&other)
+{
+    *this = std::move(other);
+}
+
+Ktx2Texture &Ktx2Texture::operator=(Ktx2Texture &&other)
+{
+    if (this != &other) {
+        m_file = std::move(other.m_file);
+        m_format = other.m_format;
+        m_type = other.m_type;
+        m_extent = other.m_extent;
+        m_arrayLayers = other.m_arrayLayers;
+        m_levels = std::move(other.m_levels);
+
+        other.m_format = Format::UNDEFINED;
+        other.m_extent = { 0, 0, 0 };
+        other.m_arrayLayers = 1;
+        other.m_levels.clear();
+    }
+    return *this;
+}
+
+Ktx2Texture::~Ktx2Texture() = default;
+
+bool Ktx2Texture::parse()
+{
+    if (m_file->size < sizeof(Ktx2Header))
+        return false;
+
+    Ktx2Header header;
+    std::memcpy(&header, m_file->data, sizeof(Ktx2Header));
+    if (std::memcmp(header.identifier, ktx2Identifier, sizeof(ktx2Identifier)) != 0)
+        return false;
+
+    // Basis Universal files have no format, Zstandard ones would need to be inflated first
+    if (header.vkFormat == 0 || header.supercompressionScheme != 0)
+        return false;
+    if (header.pixelWidth == 0 || (header.faceCount != 1 && header.faceCount != 6))
+        return false;
+
+    // A level count of 0 asks for the mip chain to be generated, only the first level is stored
+    const uint32_t levelCount = std::max(header.levelCount, 1U);
+    if (levelCount > maxLevelCount)
+        return false;
+    if (m_file->size < sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex))
+        return false;
+
+    // The texel block size comes from the data format descriptor, which every KTX2 file has
+    if (header.dfdByteLength < sizeof(Ktx2BasicDescriptor) || !isInFile(header.dfdByteOffset, header.dfdByteLength, m_file->size))
+        return false;
+    Ktx2BasicDescriptor descriptor;
+    std::memcpy(&descriptor, m_file->data + header.dfdByteOffset, sizeof(Ktx2BasicDescriptor));
+    const uint32_t bytesPerBlock = descriptor.bytesPlane[0];
+    if (descriptor.vendorIdAndDescriptorType != 0 || bytesPerBlock == 0) // Multi-planar formats have no single block size
+        return false;
+
+    const uint64_t layerCount = uint64_t(std::max(header.layerCount, 1U)) * header.faceCount;
+    if (layerCount > std::numeric_limits<uint32_t>::max())
+        return false;
+    m_levels.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        Ktx2LevelIndex index;
+        std::memcpy(&index, m_file->data + sizeof(Ktx2Header) + level * sizeof(Ktx2LevelIndex), sizeof(Ktx2LevelIndex));
+        if (!isInFile(index.byteOffset, index.byteLength, m_file->size))
+            return false;
+
+        // Without supercompression a level holds exactly the blocks of all its layers and faces
+        uint64_t expectedByteLength = bytesPerBlock;
+        const uint32_t extent[3] = { header.pixelWidth, std::max(header.pixelHeight, 1U), std::max(header.pixelDepth, 1U) };
+        for (uint32_t i = 0; i < 3; ++i) {
+            const uint64_t blockExtent = descriptor.texelBlockDimension[i] + 1ULL;
+            const uint64_t levelExtent = std::max(extent[i] >> level, 1U);
+            if (!multiplyWithin(expectedByteLength, (levelExtent + blockExtent - 1) / blockExtent, m_file->size))
+                return false;
+        }
+        if (!multiplyWithin(expectedByteLength, layerCount, m_file->size) || index.byteLength != expectedByteLength)
+            return false;
+
+        m_levels[level] = { .offset = index.byteOffset, .byteSize = index.byteLength };
+    }
+
+    m_format = static_cast<Format>(header.vkFormat);
+    m_extent = {
+        .width = header.pixelWidth,
+        .height = std::max(header.pixelHeight, 1U),
+        .depth = std::max(header.pixelDepth, 1U)
+    };
+    m_arrayLayers = static_cast<uint32_t>(layerCount);
+
+    if (header.faceCount == 6)
+        m_type = TextureType::TextureTypeCube;
+    else if (header.pixelDepth > 0)
+        m_type = TextureType::TextureType3D;
+    else if (header.pixelHeight == 0)
+        m_type = TextureType::TextureType1D;
+    else
+        m_type = TextureType::TextureType2D;
+
+    return true;
+}
+
+bool Ktx2Texture::isFormatSupported(const Device &device, Format format)
+{
+    const AdapterFeatures &features = device.enabledFeatures();
+    if (inRange(format, Format::BC1_RGB_UNORM_BLOCK, Format::BC7_SRGB_BLOCK) && !features.textureCompressionBC)
+        return false;
+    if (inRange(format, Format::ETC2_R8G8B8_UNORM_BLOCK, Format::EAC_R11G11_SNORM_BLOCK) && !features.textureCompressionETC2)
+        return false;
+    if (inRange(format, Format::ASTC_4x4_UNORM_BLOCK, Format::ASTC_12x12_SRGB_BLOCK) && !features.textureCompressionASTC_LDR)
+        return false;
+
+    const Adapter *adapter = device.adapter();
+    if (!adapter)
+        return false;
+    const FormatProperties properties = adapter->formatProperties(format);
+    return properties.optimalTilingFeatures.testFlag(FormatFeatureFlagBit::SampledImageBit);
+}
+
+Ktx2Texture Ktx2Texture::loadBestSupported(const Device &device, const std::vector<std::string> &paths)
+{
+    // Mapping a file only reads its header, the texel data is not paged in until uploaded
+    for (const std::string &path : paths) {
+        Ktx2Texture texture(path);
+        if (texture.isValid() && isFormatSupported(device, texture.format()))
+            return texture;
+    }
+    SPDLOG_LOGGER_WARN(Logger::logger(), "None of the {} KTX2 files has a format supported by the device", paths.size());
+    return {};
+}
+
+std::span<const uint8_t> Ktx2Texture::levelData(uint32_t mipLevel) const
+{
+    if (!isValid() || mipLevel >= m_levels.size())
+        return {};
+    const Level &level = m_levels[mipLevel];
+    return { m_file->data + level.offset, static_cast<size_t>(level.byteSize) };
+}
+
+TextureOptions Ktx2Texture::textureOptions(TextureUsageFlags usage, MemoryUsage memoryUsage) const
+{
+    return TextureOptions{
+        .type = m_type,
+        .format = m_format,
+        .extent = m_extent,
+        .mipLevels = mipLevels(),
+        .arrayLayers = m_arrayLayers,
+        .usage = usage | TextureUsageFlagBits::TransferDstBit,
+        .memoryUsage = memoryUsage
+    };
+}
+
+TextureUploadOptions Ktx2Texture::uploadOptions(const Ktx2UploadOptions &options) const
+{
+    if (!isValid())
+        return {};
+
+    // Levels are stored from the smallest to the largest, possibly padded in between.
+    // Uploading the range spanning all of them needs a single staging copy.
+    DeviceSize begin = m_levels.front().offset;
+    DeviceSize end = 0;
+    for (const Level &level : m_levels) {
+        begin = std::min(begin, level.offset);
+        end = std::max(end, level.offset + level.byteSize);
+    }
+
+    std::vector<BufferTextureCopyRegion> regions;
+    regions.reserve(m_levels.size());
+    for (uint32_t mipLevel = 0; mipLevel < m_levels.size(); ++mipLevel) {
+        // The images of all the layers and faces of a level are tightly packed
+        regions.push_back(BufferTextureCopyRegion{
+                .bufferOffset = m_levels[mipLevel].offset - begin,
+                .textureSubResource = {
+                        .aspectMask = TextureAspectFlagBits::ColorBit,
+                        .mipLevel = mipLevel,
+                        .baseArrayLayer = 0,
+                        .layerCount = m_arrayLayers },
+                .textureExtent = {
+                        .width = std::max(m_extent.width >> mipLevel, 1U),
+                        .height = std::max(m_extent.height >> mipLevel, 1U),
+                        .depth = std::max(m_extent.depth >> mipLevel, 1U) } });
+    }
+
+    return TextureUploadOptions{
+        .destinationTexture = options.destinationTexture,
+        .dstStages = options.dstStages,
+        .dstMask = options.dstMask,
+        .data = m_file->data + begin,
+        .byteSize = end - begin,
+        .oldLayout = options.oldLayout,
+        .newLayout = options.newLayout,
+        .regions = std::move(regions)
+    };
+}
+
+} // namespace KDGpu
@@ -0,0 +1,114 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/handle.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace KDGpu {
+
+class Device;
+struct Texture_t;
+
+struct Ktx2UploadOptions {
+    Handle<Texture_t> destinationTexture;
+    PipelineStageFlags dstStages{ PipelineStageFlagBit::FragmentShaderBit };
+    AccessFlags dstMask{ AccessFlagBit::ShaderReadBit };
+    TextureLayout oldLayout{ TextureLayout::Undefined };
+    TextureLayout newLayout{ TextureLayout::ShaderReadOnlyOptimal };
+};
+
+/**
+    @brief A texture stored in a KTX2 container
+    @ingroup public
+    @headerfile ktx2_texture.h <KDGpu/ktx2_texture.h>
+
+    The file is memory mapped rather than read, its texel data is only ever
+    copied once, into the staging memory of the upload.
+
+    All the mip levels, array layers and cube faces of the file are uploaded with
+    a single copy command, from the contiguous range of the file holding them.
+    Block compressed formats (BCn, ETC2, ASTC) are uploaded as is.
+
+    Supercompressed files (Basis Universal, Zstandard) are not supported.
+
+    @code{.cpp}
+    // Variants of the same asset, in order of preference
+    Ktx2Texture ktx = Ktx2Texture::loadBestSupported(device, { "albedo.astc.ktx2", "albedo.bc7.ktx2", "albedo.rgba8.ktx2" });
+    Texture texture = device.createTexture(ktx.textureOptions());
+    queue.uploadTextureData(ktx.uploadOptions({ .destinationTexture = texture }));
+    @endcode
+ */
+class KDGPU_EXPORT Ktx2Texture
+{
+public:
+    Ktx2Texture();
+    explicit Ktx2Texture(const std::string &path);
+    ~Ktx2Texture();
+
+    Ktx2Texture(Ktx2Texture &&);
+    Ktx2Texture &operator=(Ktx2Texture &&);
+
+    Ktx2Texture(const Ktx2Texture &) = delete;
+    Ktx2Texture &operator=(const Ktx2Texture &) = delete;
+
+    // Returns the first of paths whose format can be sampled on device, or an invalid Ktx2Texture
+    static Ktx2Texture loadBestSupported(const Device &device, const std::vector<std::string> &paths);
+
+    // Whether format can be sampled on device, including having enabled the compression feature it needs
+    static bool isFormatSupported(const Device &device, Format format);
+
+    bool isValid() const noexcept { return m_file != nullptr; }
+
+    Format format() const noexcept { return m_format; }
+    TextureType type() const noexcept { return m_type; }
+    Extent3D extent() const noexcept { return m_extent; }
+    uint32_t mipLevels() const noexcept { return static_cast<uint32_t>(m_levels.size()); }
+    uint32_t arrayLayers() const noexcept { return m_arrayLayers; } // Including the 6 faces of cube maps
+    bool isCubeMap() const noexcept { return m_type == TextureType::TextureTypeCube; }
+
+    // All the layers and faces of a mip level, as stored in the file
+    std::span<const uint8_t> levelData(uint32_t mipLevel) const;
+
+    // Options to create a texture matching the file, with TransferDstBit added to usage
+    TextureOptions textureOptions(TextureUsageFlags usage = TextureUsageFlagBits::SampledBit,
+                                  MemoryUsage memoryUsage = MemoryUsage::GpuOnly) const;
+
+    // Upload of all the mip levels and layers. The data points into the mapping of
+    // the file, it must be uploaded before this Ktx2Texture is destroyed.
+    TextureUploadOptions uploadOptions(const Ktx2UploadOptions &options) const;
+
+private:
+    struct MappedFile;
+    struct Level {
+        DeviceSize offset{ 0 }; // From the start of the file
+        DeviceSize byteSize{ 0 };
+    };
+
+    bool parse();
+
+    std::unique_ptr<MappedFile> m_file;
+    Format m_format{ Format::UNDEFINED };
+    TextureType m_type{ TextureType::TextureType2D };
+    Extent3D m_extent{ 0, 0, 0 };
+    uint32_t m_arrayLayers{ 1 };
+    std::vector<Level> m_levels;
+};
+
+} // namespace KDGpu
@@ -0,0 +1,58 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/gpu_core.h>
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+namespace KDGpu {
+
+/**
+    @brief Usage of a memory heap of a Device compared to the budget granted to the process
+    @ingroup public
+    @headerfile memory_budget.h <KDGpu/memory_budget.h>
+*/
+struct MemoryHeapBudget {
+    uint32_t heapIndex{ 0 };
+    bool deviceLocal{ false };
+    DeviceSize heapSize{ 0 };
+    DeviceSize usage{ 0 }; // Memory used by the process in this heap, including other devices and APIs
+    DeviceSize budget{ 0 }; // Memory the process can use before allocations start failing or degrading
+    DeviceSize blockBytes{ 0 }; // Memory allocated by this Device
+    DeviceSize allocationBytes{ 0 }; // Part of blockBytes used by resources
+
+    float usageRatio() const noexcept
+    {
+        return budget > 0 ? static_cast<float>(static_cast<double>(usage) / static_cast<double>(budget)) : 0.0f;
+    }
+};
+
+/**
+    @brief Per heap memory budget of a Device
+    @ingroup public
+    @headerfile memory_budget.h <KDGpu/memory_budget.h>
+
+    When the memory budget extension is not available, usage and budget are
+    estimated from the allocations of the Device and the size of the heaps.
+*/
+struct MemoryBudget {
+    bool budgetExtensionEnabled{ false };
+    std::vector<MemoryHeapBudget> heaps;
+};
+
+// Called with the heap whose usage crossed the threshold. May be invoked from any
+// thread creating buffers or textures, or calling Device::collectGarbage().
+using MemoryBudgetCallback = std::function<void(const MemoryHeapBudget &)>;
+
+} // namespace KDGpu
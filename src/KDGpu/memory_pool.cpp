@@ -0,0 +1,80 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "memory_pool.h"
+
+#include <KDGpu/graphics_api.h>
+#include <KDGpu/resource_manager.h>
+#include <KDGpu/api/api_memory_pool.h>
+
+namespace KDGpu {
+
+MemoryPool::MemoryPool() = default;
+
+MemoryPool::~MemoryPool()
+{
+    if (isValid())
+        m_api->resourceManager()->deleteMemoryPool(handle());
+}
+
+MemoryPool::MemoryPool(GraphicsApi *api, const Handle<Device_t> &device, const MemoryPoolOptions &options)
+    : m_api(api)
+    , m_device(device)
+    , m_memoryPool(m_api->resourceManager()->createMemoryPool(m_device, options))
+{
+}
+
+MemoryPool::MemoryPool(MemoryPool &&other)
+{
+    m_api = other.m_api;
+    m_device = other.m_device;
+    m_memoryPool = other.m_memoryPool;
+
+    other.m_api = nullptr;
+    other.m_device = {};
+    other.m_memoryPool = {};
+}
+
+MemoryPool &MemoryPool::operator=(MemoryPool &&other)
+{
+    if (this != &other) {
+        if (isValid())
+            m_api->resourceManager()->deleteMemoryPool(handle());
+
+        m_api = other.m_api;
+        m_device = other.m_device;
+        m_memoryPool = other.m_memoryPool;
+
+        other.m_api = nullptr;
+        other.m_device = {};
+        other.m_memoryPool = {};
+    }
+    return *this;
+}
+
+MemoryPoolStatistics MemoryPool::statistics() const
+{
+    if (!isValid())
+        return {};
+    auto apiMemoryPool = m_api->resourceManager()->getMemoryPool(m_memoryPool);
+    return apiMemoryPool->statistics();
+}
+
+bool operator==(const MemoryPool &a, const MemoryPool &b)
+{
+    return a.m_api == b.m_api && a.m_device == b.m_device && a.m_memoryPool == b.m_memoryPool;
+}
+
+bool operator!=(const MemoryPool &a, const MemoryPool &b)
+{
+    return !(a == b);
+}
+
+} // namespace KDGpu
@@ -0,0 +1,80 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/handle.h>
+#include <KDGpu/kdgpu_export.h>
+
+namespace KDGpu {
+
+class GraphicsApi;
+struct Device_t;
+struct MemoryPool_t;
+struct MemoryPoolOptions;
+
+/**
+    @brief Memory held by a MemoryPool
+    @ingroup public
+    @headerfile memory_pool.h <KDGpu/memory_pool.h>
+*/
+struct MemoryPoolStatistics {
+    uint32_t blockCount{ 0 };
+    uint32_t allocationCount{ 0 };
+    DeviceSize blockBytes{ 0 };
+    DeviceSize allocationBytes{ 0 };
+};
+
+/**
+ * @brief MemoryPool
+ * @ingroup public
+ *
+ * A set of memory blocks dedicated to the buffers and textures created with
+ * BufferOptions::memoryPool or TextureOptions::memoryPool. Keeping resources
+ * with different sizes and lifetimes (e.g. staging, per frame and static data)
+ * in separate pools prevents them from fragmenting each other's blocks.
+ *
+ * A MemoryPool must outlive the resources allocated from it.
+ */
+class KDGPU_EXPORT MemoryPool
+{
+public:
+    MemoryPool();
+    ~MemoryPool();
+
+    MemoryPool(MemoryPool &&);
+    MemoryPool &operator=(MemoryPool &&);
+
+    MemoryPool(const MemoryPool &) = delete;
+    MemoryPool &operator=(const MemoryPool &) = delete;
+
+    Handle<MemoryPool_t> handle() const noexcept { return m_memoryPool; }
+    bool isValid() const noexcept { return m_memoryPool.isValid(); }
+
+    operator Handle<MemoryPool_t>() const noexcept { return m_memoryPool; }
+
+    MemoryPoolStatistics statistics() const;
+
+private:
+    MemoryPool(GraphicsApi *api, const Handle<Device_t> &device, const MemoryPoolOptions &options);
+
+    GraphicsApi *m_api{ nullptr };
+    Handle<Device_t> m_device;
+    Handle<MemoryPool_t> m_memoryPool;
+
+    friend class Device;
+    friend KDGPU_EXPORT bool operator==(const MemoryPool &, const MemoryPool &);
+};
+
+KDGPU_EXPORT bool operator==(const MemoryPool &a, const MemoryPool &b);
+KDGPU_EXPORT bool operator!=(const MemoryPool &a, const MemoryPool &b);
+
+} // namespace KDGpu
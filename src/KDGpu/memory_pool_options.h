@@ -0,0 +1,37 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/gpu_core.h>
+
+#include <stddef.h>
+
+namespace KDGpu {
+
+enum class MemoryPoolAlgorithm : uint32_t {
+    Default = 0, // General purpose, suited to resources of mixed sizes and lifetimes
+    Linear = 1, // Stack/ring-buffer like, suited to resources released in (or in reverse) allocation order
+};
+
+struct MemoryPoolOptions {
+    MemoryUsage memoryUsage{ MemoryUsage::GpuOnly };
+    // The memory type of the pool is picked so that resources with these usages
+    // can be allocated from it. Textures are considered if textureUsage is set.
+    BufferUsageFlags bufferUsage{};
+    TextureUsageFlags textureUsage{};
+    Format textureFormat{ Format::R8G8B8A8_UNORM };
+    MemoryPoolAlgorithm algorithm{ MemoryPoolAlgorithm::Default };
+    DeviceSize blockSize{ 0 }; // 0 to let the allocator decide
+    size_t minBlockCount{ 0 }; // Blocks allocated upfront and never released
+    size_t maxBlockCount{ 0 }; // 0 for no limit
+};
+
+} // namespace KDGpu
@@ -0,0 +1,439 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "mipmap_generator.h"
+
+#include <KDGpu/adapter.h>
+#include <KDGpu/bind_group_layout_options.h>
+#include <KDGpu/bind_group_options.h>
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/compute_pipeline_options.h>
+#include <KDGpu/device.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/texture.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/utils/logging.h>
+
+#include <cmrc/cmrc.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+CMRC_DECLARE(KDGpu::ShaderResources);
+
+namespace KDGpu {
+
+namespace {
+
+constexpr uint32_t workGroupSize = 8; // Must match the local size of mipmap_downsample.comp
+
+bool isIntegerFormat(Format format)
+{
+    switch (format) {
+    case Format::R8_UINT:
+    case Format::R8_SINT:
+    case Format::R8G8_UINT:
+    case Format::R8G8_SINT:
+    case Format::R8G8B8_UINT:
+    case Format::R8G8B8_SINT:
+    case Format::B8G8R8_UINT:
+    case Format::B8G8R8_SINT:
+    case Format::R8G8B8A8_UINT:
+    case Format::R8G8B8A8_SINT:
+    case Format::B8G8R8A8_UINT:
+    case Format::B8G8R8A8_SINT:
+    case Format::A8B8G8R8_UINT_PACK32:
+    case Format::A8B8G8R8_SINT_PACK32:
+    case Format::A2R10G10B10_UINT_PACK32:
+    case Format::A2R10G10B10_SINT_PACK32:
+    case Format::A2B10G10R10_UINT_PACK32:
+    case Format::A2B10G10R10_SINT_PACK32:
+    case Format::R16_UINT:
+    case Format::R16_SINT:
+    case Format::R16G16_UINT:
+    case Format::R16G16_SINT:
+    case Format::R16G16B16_UINT:
+    case Format::R16G16B16_SINT:
+    case Format::R16G16B16A16_UINT:
+    case Format::R16G16B16A16_SINT:
+    case Format::R32_UINT:
+    case Format::R32_SINT:
+    case Format::R32G32_UINT:
+    case Format::R32G32_SINT:
+    case Format::R32G32B32_UINT:
+    case Format::R32G32B32_SINT:
+    case Format::R32G32B32A32_UINT:
+    case Format::R32G32B32A32_SINT:
+    case Format::R64_UINT:
+    case Format::R64_SINT:
+    case Format::R64G64_UINT:
+    case Format::R64G64_SINT:
+    case Format::R64G64B64_UINT:
+    case Format::R64G64B64_SINT:
+    case Format::R64G64B64A64_UINT:
+    case Format::R64G64B64A64_SINT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+TextureAspectFlags aspectMaskForFormat(Format format)
+{
+    switch (format) {
+    case Format::D16_UNORM:
+    case Format::X8_D24_UNORM_PACK32:
+    case Format::D32_SFLOAT:
+        return TextureAspectFlagBits::DepthBit;
+    case Format::S8_UINT:
+        return TextureAspectFlagBits::StencilBit;
+    case Format::D16_UNORM_S8_UINT:
+    case Format::D24_UNORM_S8_UINT:
+    case Format::D32_SFLOAT_S8_UINT:
+        return TextureAspectFlagBits::DepthBit | TextureAspectFlagBits::StencilBit;
+    default:
+        return TextureAspectFlagBits::ColorBit;
+    }
+}
+
+FormatFeatureFlags formatFeatures(const Adapter *adapter, const TextureOptions &textureOptions)
+{
+    const FormatProperties formatProperties = adapter->formatProperties(textureOptions.format);
+    return (textureOptions.tiling == TextureTiling::Linear)
+            ? formatProperties.linearTilingFeatures
+            : formatProperties.optimalTilingFeatures;
+}
+
+// Depth, stencil and integer formats must be blitted with nearest filtering, even when
+// the format reports linear filtering support for sampling
+bool canFilterLinearly(Format format, FormatFeatureFlags features)
+{
+    return aspectMaskForFormat(format) == TextureAspectFlagBits::ColorBit &&
+            !isIntegerFormat(format) &&
+            features.testFlag(FormatFeatureFlagBit::SampledImageFilterLinearBit);
+}
+
+uint32_t mipExtent(uint32_t extent, uint32_t mipLevel)
+{
+    return std::max(extent >> mipLevel, 1U);
+}
+
+std::vector<uint32_t> readEmbeddedShader(const std::string &filename)
+{
+    auto fs = cmrc::KDGpu::ShaderResources::get_filesystem();
+    auto file = fs.open(filename);
+    const std::size_t byteSize = file.size();
+    std::vector<uint32_t> buffer(byteSize / 4);
+    std::memcpy(buffer.data(), file.cbegin(), byteSize);
+    return buffer;
+}
+
+} // namespace
+
+MipmapGenerator::MipmapGenerator() = default;
+
+MipmapGenerator::MipmapGenerator(Device *device)
+    : m_device(device)
+{
+}
+
+MipmapGenerator::MipmapGenerator(MipmapGenerator &&other)
+{
+    *this = std::move(other);
+}
+
+MipmapGenerator &MipmapGenerator::operator=(MipmapGenerator &&other)
+{
+    if (this != &other) {
+        m_device = other.m_device;
+        m_transientBindGroups = std::move(other.m_transientBindGroups);
+        m_transientViews = std::move(other.m_transientViews);
+        m_pipeline = std::move(other.m_pipeline);
+        m_pipelineLayout = std::move(other.m_pipelineLayout);
+        m_bindGroupLayout = std::move(other.m_bindGroupLayout);
+        m_shaderModule = std::move(other.m_shaderModule);
+        m_sampler = std::move(other.m_sampler);
+
+        other.m_device = nullptr;
+        other.m_transientBindGroups.clear();
+        other.m_transientViews.clear();
+    }
+    return *this;
+}
+
+MipmapGenerator::~MipmapGenerator() = default;
+
+MipmapGenerationMethod MipmapGenerator::method(const TextureOptions &textureOptions) const
+{
+    if (!isValid() || textureOptions.mipLevels < 2)
+        return MipmapGenerationMethod::Unsupported;
+
+    const Adapter *adapter = m_device->adapter();
+    const FormatFeatureFlags features = formatFeatures(adapter, textureOptions);
+
+    const bool canBlit = textureOptions.usage.testFlag(TextureUsageFlagBits::TransferSrcBit) &&
+            textureOptions.usage.testFlag(TextureUsageFlagBits::TransferDstBit) &&
+            adapter->supportsBlitting(textureOptions.format, textureOptions.tiling, textureOptions.format, textureOptions.tiling);
+
+    // Linear blits are both the cheapest and the best looking option
+    if (canBlit && canFilterLinearly(textureOptions.format, features))
+        return MipmapGenerationMethod::Blit;
+
+    const bool canDispatch = textureOptions.type != TextureType::TextureType3D &&
+            textureOptions.type != TextureType::TextureType1D &&
+            aspectMaskForFormat(textureOptions.format) == TextureAspectFlagBits::ColorBit &&
+            !isIntegerFormat(textureOptions.format) &&
+            textureOptions.usage.testFlag(TextureUsageFlagBits::SampledBit) &&
+            textureOptions.usage.testFlag(TextureUsageFlagBits::StorageBit) &&
+            features.testFlag(FormatFeatureFlagBit::SampledImageBit) &&
+            features.testFlag(FormatFeatureFlagBit::StorageImageBit) &&
+            m_device->enabledFeatures().shaderStorageImageWriteWithoutFormat;
+    if (canDispatch)
+        return MipmapGenerationMethod::Compute;
+
+    // Depth, stencil and integer formats can only ever be blitted, with nearest filtering
+    if (canBlit)
+        return MipmapGenerationMethod::Blit;
+
+    return MipmapGenerationMethod::Unsupported;
+}
+
+bool MipmapGenerator::generate(CommandRecorder &commandRecorder, const Texture &texture,
+                               const TextureOptions &textureOptions, const MipmapGenerationOptions &options)
+{
+    const MipmapGenerationMethod generationMethod = method(textureOptions);
+    if (generationMethod == MipmapGenerationMethod::Unsupported || !texture.isValid())
+        return false;
+    if (generationMethod == MipmapGenerationMethod::Compute && !createComputePipeline())
+        return false;
+
+    const bool useBlits = generationMethod == MipmapGenerationMethod::Blit;
+    const TextureAspectFlags aspectMask = aspectMaskForFormat(textureOptions.format);
+    const TextureLayout levelLayout = useBlits ? TextureLayout::TransferSrcOptimal : TextureLayout::ShaderReadOnlyOptimal;
+    const PipelineStageFlags levelStages = useBlits ? PipelineStageFlags(PipelineStageFlagBit::TransferBit)
+                                                    : PipelineStageFlags(PipelineStageFlagBit::ComputeShaderBit);
+
+    // Mip level 0 becomes the source of the first downsampling and the other
+    // levels its destinations. Their previous contents are discarded.
+    commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+            .srcStages = options.srcStages,
+            .srcMask = options.srcMask,
+            .dstStages = levelStages,
+            .dstMask = useBlits ? AccessFlags(AccessFlagBit::TransferReadBit) : AccessFlags(AccessFlagBit::ShaderReadBit),
+            .oldLayout = options.oldLayout,
+            .newLayout = levelLayout,
+            .texture = texture,
+            .range = { .aspectMask = aspectMask, .baseMipLevel = 0, .levelCount = 1 },
+    });
+    commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+            .srcStages = PipelineStageFlagBit::TopOfPipeBit,
+            .srcMask = AccessFlagBit::None,
+            .dstStages = levelStages,
+            .dstMask = useBlits ? AccessFlags(AccessFlagBit::TransferWriteBit) : AccessFlags(AccessFlagBit::ShaderWriteBit),
+            .oldLayout = TextureLayout::Undefined,
+            .newLayout = useBlits ? TextureLayout::TransferDstOptimal : TextureLayout::General,
+            .texture = texture,
+            .range = { .aspectMask = aspectMask, .baseMipLevel = 1 },
+    });
+
+    if (useBlits)
+        recordBlits(commandRecorder, texture, textureOptions);
+    else
+        recordDispatches(commandRecorder, texture, textureOptions);
+
+    // All levels now are in levelLayout, hand them over to their consumers
+    commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+            .srcStages = levelStages,
+            .srcMask = useBlits ? AccessFlags(AccessFlagBit::TransferReadBit) : AccessFlags(AccessFlagBit::ShaderReadBit),
+            .dstStages = options.dstStages,
+            .dstMask = options.dstMask,
+            .oldLayout = levelLayout,
+            .newLayout = options.newLayout,
+            .texture = texture,
+            .range = { .aspectMask = aspectMask },
+    });
+
+    return true;
+}
+
+Fence MipmapGenerator::generate(Queue &queue, const Texture &texture,
+                                const TextureOptions &textureOptions, const MipmapGenerationOptions &options)
+{
+    if (!isValid())
+        return {};
+
+    CommandRecorder commandRecorder = m_device->createCommandRecorder({ .queue = queue });
+    if (!generate(commandRecorder, texture, textureOptions, options))
+        return {};
+    CommandBuffer commandBuffer = commandRecorder.finish();
+
+    Fence fence = m_device->createFence({ .createSignalled = false });
+    queue.submit(SubmitOptions{
+            .commandBuffers = { commandBuffer },
+            .signalFence = fence,
+    });
+    return fence;
+}
+
+void MipmapGenerator::releaseTransientResources()
+{
+    // Destruction is deferred by the device until the submissions using them have completed
+    m_transientBindGroups.clear();
+    m_transientViews.clear();
+}
+
+FilterMode MipmapGenerator::blitFilter(const TextureOptions &textureOptions) const
+{
+    if (!isValid())
+        return FilterMode::Nearest;
+    const FormatFeatureFlags features = formatFeatures(m_device->adapter(), textureOptions);
+    return canFilterLinearly(textureOptions.format, features) ? FilterMode::Linear : FilterMode::Nearest;
+}
+
+void MipmapGenerator::recordBlits(CommandRecorder &commandRecorder, const Texture &texture, const TextureOptions &textureOptions)
+{
+    const FilterMode filter = blitFilter(textureOptions);
+
+    const TextureAspectFlags aspectMask = aspectMaskForFormat(textureOptions.format);
+    const bool is3D = textureOptions.type == TextureType::TextureType3D;
+    const uint32_t layerCount = is3D ? 1 : textureOptions.arrayLayers;
+
+    // Each level is downsampled from the previous one rather than from level 0,
+    // which halves the work of every blit and filters all texels
+    for (uint32_t mipLevel = 1; mipLevel < textureOptions.mipLevels; ++mipLevel) {
+        const uint32_t srcLevel = mipLevel - 1;
+        commandRecorder.blitTexture(TextureBlitOptions{
+                .srcTexture = texture,
+                .srcLayout = TextureLayout::TransferSrcOptimal,
+                .dstTexture = texture,
+                .dstLayout = TextureLayout::TransferDstOptimal,
+                .regions = {
+                        {
+                                .srcSubresource = { .aspectMask = aspectMask, .mipLevel = srcLevel, .baseArrayLayer = 0, .layerCount = layerCount },
+                                .srcOffset = {},
+                                .srcExtent = {
+                                        .width = mipExtent(textureOptions.extent.width, srcLevel),
+                                        .height = mipExtent(textureOptions.extent.height, srcLevel),
+                                        .depth = is3D ? mipExtent(textureOptions.extent.depth, srcLevel) : 1,
+                                },
+                                .dstSubresource = { .aspectMask = aspectMask, .mipLevel = mipLevel, .baseArrayLayer = 0, .layerCount = layerCount },
+                                .dstOffset = {},
+                                .dstExtent = {
+                                        .width = mipExtent(textureOptions.extent.width, mipLevel),
+                                        .height = mipExtent(textureOptions.extent.height, mipLevel),
+                                        .depth = is3D ? mipExtent(textureOptions.extent.depth, mipLevel) : 1,
+                                },
+                        },
+                },
+                .scalingFilter = filter,
+        });
+
+        // The level just written is the source of the next blit
+        commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+                .srcStages = PipelineStageFlagBit::TransferBit,
+                .srcMask = AccessFlagBit::TransferWriteBit,
+                .dstStages = PipelineStageFlagBit::TransferBit,
+                .dstMask = AccessFlagBit::TransferReadBit,
+                .oldLayout = TextureLayout::TransferDstOptimal,
+                .newLayout = TextureLayout::TransferSrcOptimal,
+                .texture = texture,
+                .range = { .aspectMask = aspectMask, .baseMipLevel = mipLevel, .levelCount = 1 },
+        });
+    }
+}
+
+void MipmapGenerator::recordDispatches(CommandRecorder &commandRecorder, const Texture &texture, const TextureOptions &textureOptions)
+{
+    const uint32_t layerCount = textureOptions.arrayLayers;
+
+    auto levelView = [&](uint32_t mipLevel) -> const TextureView & {
+        m_transientViews.emplace_back(texture.createView(TextureViewOptions{
+                .viewType = ViewType::ViewType2DArray,
+                .format = textureOptions.format,
+                .range = {
+                        .aspectMask = TextureAspectFlagBits::ColorBit,
+                        .baseMipLevel = mipLevel,
+                        .levelCount = 1,
+                        .baseArrayLayer = 0,
+                        .layerCount = layerCount,
+                },
+        }));
+        return m_transientViews.back();
+    };
+
+    for (uint32_t mipLevel = 1; mipLevel < textureOptions.mipLevels; ++mipLevel) {
+        const Handle<TextureView_t> srcView = levelView(mipLevel - 1);
+        const Handle<TextureView_t> dstView = levelView(mipLevel);
+        m_transientBindGroups.emplace_back(m_device->createBindGroup(BindGroupOptions{
+                .layout = m_bindGroupLayout,
+                .resources = {
+                        { .binding = 0, .resource = TextureViewSamplerBinding{ .textureView = srcView, .sampler = m_sampler } },
+                        { .binding = 1, .resource = ImageBinding{ .textureView = dstView } },
+                },
+        }));
+
+        const uint32_t width = mipExtent(textureOptions.extent.width, mipLevel);
+        const uint32_t height = mipExtent(textureOptions.extent.height, mipLevel);
+
+        ComputePassCommandRecorder computePass = commandRecorder.beginComputePass();
+        computePass.setPipeline(m_pipeline);
+        computePass.setBindGroup(0, m_transientBindGroups.back(), m_pipelineLayout);
+        computePass.dispatchCompute(ComputeCommand{
+                .workGroupX = (width + workGroupSize - 1) / workGroupSize,
+                .workGroupY = (height + workGroupSize - 1) / workGroupSize,
+                .workGroupZ = layerCount,
+        });
+        computePass.end();
+
+        // The level just written is sampled by the next dispatch
+        commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+                .srcStages = PipelineStageFlagBit::ComputeShaderBit,
+                .srcMask = AccessFlagBit::ShaderWriteBit,
+                .dstStages = PipelineStageFlagBit::ComputeShaderBit,
+                .dstMask = AccessFlagBit::ShaderReadBit,
+                .oldLayout = TextureLayout::General,
+                .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+                .texture = texture,
+                .range = { .aspectMask = TextureAspectFlagBits::ColorBit, .baseMipLevel = mipLevel, .levelCount = 1 },
+        });
+    }
+}
+
+bool MipmapGenerator::createComputePipeline()
+{
+    if (m_pipeline.isValid())
+        return true;
+
+    m_shaderModule = m_device->createShaderModule(readEmbeddedShader("mipmap_downsample.comp.spv"));
+    if (!m_shaderModule.isValid()) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "MipmapGenerator failed to create its downsampling shader");
+        return false;
+    }
+
+    m_bindGroupLayout = m_device->createBindGroupLayout(BindGroupLayoutOptions{
+            .bindings = {
+                    { .binding = 0, .count = 1, .resourceType = ResourceBindingType::CombinedImageSampler, .shaderStages = ShaderStageFlagBits::ComputeBit },
+                    { .binding = 1, .count = 1, .resourceType = ResourceBindingType::StorageImage, .shaderStages = ShaderStageFlagBits::ComputeBit },
+            },
+    });
+    m_pipelineLayout = m_device->createPipelineLayout(PipelineLayoutOptions{
+            .bindGroupLayouts = { m_bindGroupLayout },
+    });
+    m_pipeline = m_device->createComputePipeline(ComputePipelineOptions{
+            .layout = m_pipelineLayout,
+            .shaderStage = { .shaderModule = m_shaderModule },
+    });
+    // The shader only ever uses texelFetch, the filtering is irrelevant
+    m_sampler = m_device->createSampler();
+
+    return m_pipeline.isValid();
+}
+
+} // namespace KDGpu
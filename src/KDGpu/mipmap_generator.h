@@ -0,0 +1,123 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/bind_group.h>
+#include <KDGpu/bind_group_layout.h>
+#include <KDGpu/compute_pipeline.h>
+#include <KDGpu/fence.h>
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/pipeline_layout.h>
+#include <KDGpu/sampler.h>
+#include <KDGpu/shader_module.h>
+#include <KDGpu/texture_view.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <vector>
+
+namespace KDGpu {
+
+class CommandRecorder;
+class Device;
+class Queue;
+class Texture;
+struct TextureOptions;
+
+enum class MipmapGenerationMethod {
+    Unsupported = 0,
+    Blit,
+    Compute
+};
+
+struct MipmapGenerationOptions {
+    TextureLayout oldLayout{ TextureLayout::Undefined }; // Of mip level 0, which holds the data to downsample
+    TextureLayout newLayout{ TextureLayout::ShaderReadOnlyOptimal }; // Of all the mip levels once done
+    PipelineStageFlags srcStages{ PipelineStageFlagBit::TransferBit }; // Work which wrote mip level 0
+    AccessFlags srcMask{ AccessFlagBit::TransferWriteBit };
+    PipelineStageFlags dstStages{ PipelineStageFlagBit::FragmentShaderBit }; // Work which will read the mip levels
+    AccessFlags dstMask{ AccessFlagBit::ShaderReadBit };
+};
+
+/**
+    @brief Generates the mip chain of textures from their first mip level
+    @ingroup public
+    @headerfile mipmap_generator.h <KDGpu/mipmap_generator.h>
+
+    Each mip level is downsampled from the previous one, for all the array layers
+    of the texture (and hence all the faces of cube maps), with linear blits.
+
+    Formats which cannot be blitted with linear filtering are downsampled with a
+    compute shader instead, provided the format supports storage images, the
+    texture has the SampledBit and StorageBit usages and the device was created
+    with the shaderStorageImageWriteWithoutFormat feature. 3D, depth, stencil and
+    integer textures are only supported with blits, which then use nearest
+    filtering as linear filtering isn't allowed for them.
+
+    The texture views and bind groups needed by the compute path are kept alive
+    until releaseTransientResources() is called or the generator is destroyed,
+    which may happen as soon as the recorded commands have been submitted.
+
+    @sa Device::createMipmapGenerator
+ */
+class KDGPU_EXPORT MipmapGenerator
+{
+public:
+    MipmapGenerator();
+    ~MipmapGenerator();
+
+    MipmapGenerator(MipmapGenerator &&);
+    MipmapGenerator &operator=(MipmapGenerator &&);
+
+    MipmapGenerator(const MipmapGenerator &) = delete;
+    MipmapGenerator &operator=(const MipmapGenerator &) = delete;
+
+    bool isValid() const noexcept { return m_device != nullptr; }
+
+    MipmapGenerationMethod method(const TextureOptions &textureOptions) const;
+
+    // Filter used by the blits: Linear for color formats supporting it, Nearest for depth,
+    // stencil, integer and other formats
+    FilterMode blitFilter(const TextureOptions &textureOptions) const;
+
+    // Records the generation into commandRecorder. Returns false if the texture is not supported.
+    bool generate(CommandRecorder &commandRecorder, const Texture &texture,
+                  const TextureOptions &textureOptions, const MipmapGenerationOptions &options = MipmapGenerationOptions());
+
+    // Records and submits the generation to queue. Returns a fence signalled once it has
+    // completed, or an invalid fence if the texture is not supported.
+    Fence generate(Queue &queue, const Texture &texture,
+                   const TextureOptions &textureOptions, const MipmapGenerationOptions &options = MipmapGenerationOptions());
+
+    void releaseTransientResources();
+
+private:
+    explicit MipmapGenerator(Device *device);
+
+    void recordBlits(CommandRecorder &commandRecorder, const Texture &texture, const TextureOptions &textureOptions);
+    void recordDispatches(CommandRecorder &commandRecorder, const Texture &texture, const TextureOptions &textureOptions);
+    bool createComputePipeline();
+
+    Device *m_device{ nullptr };
+
+    // Created on first use of the compute path
+    ShaderModule m_shaderModule;
+    BindGroupLayout m_bindGroupLayout;
+    PipelineLayout m_pipelineLayout;
+    ComputePipeline m_pipeline;
+    Sampler m_sampler;
+
+    std::vector<TextureView> m_transientViews;
+    std::vector<BindGroup> m_transientBindGroups;
+
+    friend class Device;
+};
+
+} // namespace KDGpu
@@ -31,6 +31,8 @@ struct BindGroupLayout_t;
 struct PipelineLayoutOptions {
     std::vector<Handle<BindGroupLayout_t>> bindGroupLayouts;
     std::vector<PushConstantRange> pushConstantRanges;
+
+    friend bool operator==(const PipelineLayoutOptions &, const PipelineLayoutOptions &) = default;
 };
 
 } // namespace KDGpu
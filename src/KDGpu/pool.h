@@ -1,9 +1,13 @@
 #pragma once
 
 #include "handle.h"
+#include "pool_statistics.h"
 
 #include <assert.h>
 #include <limits>
+#include <memory>
+#include <new>
+#include <utility>
 #include <vector>
 #include <KDGpu/utils/logging.h>
 
@@ -22,91 +26,155 @@ namespace KDGpu {
 /**
  * @brief Pool
  * @internal
+ *
+ * A slot map handing out generational handles to its entries.
+ *
+ * Each slot keeps its generation next to the storage of the entry so that a
+ * lookup only touches a single cache line. The lowest bit of the generation
+ * tells whether the slot is alive (odd) or free (even), a generation of 0 is
+ * never handed out. Entries are constructed in place in their slot.
+ *
+ * The indices of the alive slots are additionally kept in a dense array which
+ * allows forEach() to visit the alive entries in O(size()) rather than having
+ * to probe every slot.
+ *
+ * Removing an entry does not call its destructor, the slot is only marked as
+ * available for reuse. The destructor of a removed entry is called when its
+ * slot gets reused or when the pool goes out of scope.
  */
 template<typename T, typename H>
 class Pool
 {
 public:
     Pool() noexcept
-        : m_data(), m_generations(), m_freeIndices(), m_capacity(0)
+        : m_slots(), m_liveIndices(), m_freeIndices(), m_slotCount(0), m_capacity(0), m_highWaterMark(0), m_insertCount(0), m_reuseCount(0)
     {
     }
 
     explicit Pool(uint32_t size)
-        : m_data(), m_generations(), m_freeIndices(), m_capacity(size)
+        : Pool()
     {
-        m_data.reserve(size);
-        m_generations.reserve(size);
-        m_freeIndices.reserve(size);
+        reserve(size);
+    }
+
+    ~Pool()
+    {
+        destroyAll();
     }
 
     Pool(Pool const &other) = delete;
     Pool &operator=(Pool const &other) = delete;
 
     Pool(Pool &&other) noexcept
-        : m_data(std::move(other.m_data))
-        , m_generations(std::move(other.m_generations))
+        : m_slots(std::move(other.m_slots))
+        , m_liveIndices(std::move(other.m_liveIndices))
         , m_freeIndices(std::move(other.m_freeIndices))
-        , m_capacity(std::move(other.m_capacity))
+        , m_slotCount(other.m_slotCount)
+        , m_capacity(other.m_capacity)
+        , m_highWaterMark(other.m_highWaterMark)
+        , m_insertCount(other.m_insertCount)
+        , m_reuseCount(other.m_reuseCount)
     {
-        other.m_data = {};
-        other.m_generations = {};
+        other.m_liveIndices = {};
         other.m_freeIndices = {};
+        other.m_slotCount = 0;
         other.m_capacity = 0;
+        other.resetStatistics();
     }
 
     Pool &operator=(Pool &&other) noexcept
     {
-        m_data = std::move(other.m_data);
-        m_generations = std::move(other.m_generations);
-        m_freeIndices = std::move(other.m_freeIndices);
-        m_capacity = std::move(other.m_capacity);
-
-        other.m_data = {};
-        other.m_generations = {};
-        other.m_freeIndices = {};
-        other.m_capacity = 0;
-
+        if (this != &other) {
+            destroyAll();
+
+            m_slots = std::move(other.m_slots);
+            m_liveIndices = std::move(other.m_liveIndices);
+            m_freeIndices = std::move(other.m_freeIndices);
+            m_slotCount = other.m_slotCount;
+            m_capacity = other.m_capacity;
+            m_highWaterMark = other.m_highWaterMark;
+            m_insertCount = other.m_insertCount;
+            m_reuseCount = other.m_reuseCount;
+
+            other.m_liveIndices = {};
+            other.m_freeIndices = {};
+            other.m_slotCount = 0;
+            other.m_capacity = 0;
+            other.resetStatistics();
+        }
         return *this;
     }
 
     uint32_t capacity() const noexcept { return m_capacity; }
-    uint32_t size() const noexcept { return m_data.size() - m_freeIndices.size(); }
+    uint32_t size() const noexcept { return static_cast<uint32_t>(m_liveIndices.size()); }
+
+    // Only reads a handful of counters, cheap enough to be polled every frame
+    PoolStatistics statistics() const noexcept
+    {
+        return PoolStatistics{
+            .liveCount = size(),
+            .highWaterMark = m_highWaterMark,
+            .capacity = m_capacity,
+            .insertCount = m_insertCount,
+            .reuseCount = m_reuseCount
+        };
+    }
+
+    void resetStatistics() noexcept
+    {
+        m_highWaterMark = size();
+        m_insertCount = 0;
+        m_reuseCount = 0;
+    }
 
     T *get(const Handle<H> &handle) const noexcept
     {
-        if (!canUseHandle(handle))
+        if (handle.m_index >= m_slotCount)
+            return nullptr;
+        Slot &slot = m_slots[handle.m_index];
+        if (slot.generation != handle.m_generation || !isAlive(slot.generation))
             return nullptr;
-        return const_cast<T *>(&m_data[handle.m_index]);
+        return slot.data();
     }
 
     template<typename... Args>
     Handle<H> emplace(Args &&...args)
     {
-        if (size() >= m_capacity)
+        if (m_freeIndices.empty() && m_slotCount >= m_capacity)
             growCapacity();
 
-        if (m_freeIndices.size() > 0) {
-            // We have a gap in the m_data vector, use that.
-            Handle<H> handle;
-            handle.m_index = m_freeIndices.back();
+        uint32_t index;
+        if (!m_freeIndices.empty()) {
+            // We have a gap in the slots, reuse it. The entry that used to live
+            // there has only been marked as removed so far, destroy it now.
+            index = m_freeIndices.back();
             m_freeIndices.pop_back();
-            handle.m_generation = m_generations[handle.m_index].generation; // The generation was already bumped when this entry was removed
-            m_generations[handle.m_index].isAlive = true;
-            m_data[handle.m_index] = T(std::forward<Args>(args)...);
-
-            return handle;
+            Slot &slot = m_slots[index];
+            if (slot.hasValue()) {
+                slot.data()->~T();
+                slot.denseIndex = Slot::NoValue;
+            }
+            ++m_reuseCount;
         } else {
+            // No gaps, use the next never used slot
+            index = m_slotCount++;
+            m_slots[index].generation = 0;
+            m_slots[index].denseIndex = Slot::NoValue;
+        }
 
-            // SPDLOG_LOGGER_WARN(Logger::logger(), "Grow {} {} {}", __FUNCTION__, typeid(T).name(), m_data.size());
+        Slot &slot = m_slots[index];
+        new (slot.storage) T(std::forward<Args>(args)...);
 
-            // No gaps in the m_data vector, add a new element at the end
-            m_data.emplace_back(args...);
-            m_generations.emplace_back(GenerationEntry{ 1, true });
+        // Free slots have an even generation, bumping it makes it odd (alive)
+        ++slot.generation;
+        slot.denseIndex = static_cast<uint32_t>(m_liveIndices.size());
+        m_liveIndices.push_back(index);
 
-            Handle<H> handle(m_data.size() - 1, 1);
-            return handle;
-        }
+        ++m_insertCount;
+        if (size() > m_highWaterMark)
+            m_highWaterMark = size();
+
+        return Handle<H>(index, slot.generation);
     }
 
     Handle<H> insert(const T &data)
@@ -116,69 +184,147 @@ public:
 
     void remove(const Handle<H> &handle)
     {
-        if (!canUseHandle(handle))
+        if (!get(handle))
             return;
 
         // The contained data dtor is not called here, we simply mark the slot as available
         // for reuse. So if you need that, this Pool is not the Pool you are looking for.
-        // The dtor will only be called when the entire pool goes out of scope.
+        // The dtor will only be called when the slot is reused or the pool goes out of scope.
+        Slot &slot = m_slots[handle.m_index];
+
+        // Swap the last alive entry into the place of the removed one in the dense array
+        const uint32_t denseIndex = slot.denseIndex;
+        const uint32_t lastIndex = m_liveIndices.back();
+        m_liveIndices[denseIndex] = lastIndex;
+        m_slots[lastIndex].denseIndex = denseIndex;
+        m_liveIndices.pop_back();
 
         // Bump the generation so we know not to deref this data from any existing handles
-        auto &generation = m_generations[handle.m_index];
-        ++generation.generation;
-        generation.isAlive = false;
+        ++slot.generation;
+        slot.denseIndex = Slot::StaleValue;
 
-        // Store the position of the unused gap in the data array
+        // Store the position of the unused gap in the slots
         m_freeIndices.push_back(handle.m_index);
     }
 
     void clear()
     {
-        const uint32_t dataSize = static_cast<uint32_t>(m_data.size());
-        for (uint32_t i = 0; i < dataSize; ++i) {
-            const auto handle = handleForIndex(i);
-            remove(handle);
-        }
+        while (!m_liveIndices.empty())
+            remove(handleForIndex(m_liveIndices.back()));
     }
 
     // Convert an entry index into a Handle<H>, if possible otherwise returns an invalid handle
     Handle<H> handleForIndex(uint32_t entryIndex) const
     {
-        if (entryIndex >= m_generations.size() || m_generations[entryIndex].isAlive == false)
+        if (entryIndex >= m_slotCount || !isAlive(m_slots[entryIndex].generation))
             return {};
-        return Handle<H>{ entryIndex, m_generations[entryIndex].generation };
+        return Handle<H>{ entryIndex, m_slots[entryIndex].generation };
     }
 
-private:
-    bool canUseHandle(const Handle<H> &handle) const noexcept
+    // Calls func(const Handle<H> &, T &) for every alive entry. func may remove the entry it is given.
+    template<typename Func>
+    void forEach(Func &&func)
     {
-        return handle.m_index < m_data.size() && handle.m_generation == m_generations[handle.m_index].generation && m_generations[handle.m_index].isAlive;
+        for (uint32_t i = size(); i > 0; --i) {
+            const uint32_t index = m_liveIndices[i - 1];
+            Slot &slot = m_slots[index];
+            func(Handle<H>(index, slot.generation), *slot.data());
+        }
     }
 
-    void growCapacity();
+    // Ensures that at least newCapacity entries can be stored without reallocating
+    void reserve(uint32_t newCapacity)
+    {
+        if (newCapacity > m_capacity)
+            reallocate(newCapacity);
+    }
+
+    // Releases the storage that was never used. Handles to removed entries remain invalid.
+    void shrink()
+    {
+        if (m_slotCount < m_capacity)
+            reallocate(m_slotCount);
+        m_liveIndices.shrink_to_fit();
+        m_freeIndices.shrink_to_fit();
+    }
+
+private:
+    struct Slot {
+        // Sentinels for denseIndex when the slot is not alive
+        static constexpr uint32_t NoValue = std::numeric_limits<uint32_t>::max();
+        static constexpr uint32_t StaleValue = NoValue - 1;
+
+        uint32_t generation;
+        uint32_t denseIndex;
+        alignas(T) unsigned char storage[sizeof(T)];
 
-    struct GenerationEntry {
-        uint32_t generation{ 0 };
-        bool isAlive{ false };
+        bool hasValue() const noexcept { return denseIndex != NoValue; }
+        T *data() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
     };
 
-    std::vector<T> m_data;
-    std::vector<GenerationEntry> m_generations;
+    static bool isAlive(uint32_t generation) noexcept { return (generation & 1U) != 0; }
+
+    void growCapacity();
+    void reallocate(uint32_t newCapacity);
+
+    void destroyAll() noexcept
+    {
+        for (uint32_t i = 0; i < m_slotCount; ++i) {
+            if (m_slots[i].hasValue())
+                m_slots[i].data()->~T();
+        }
+        m_slots.reset();
+        m_liveIndices.clear();
+        m_freeIndices.clear();
+        m_slotCount = 0;
+        m_capacity = 0;
+        resetStatistics();
+    }
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::vector<uint32_t> m_liveIndices;
     std::vector<uint32_t> m_freeIndices;
+    uint32_t m_slotCount; // Number of slots that have been used at least once
     uint32_t m_capacity;
+
+    // Usage statistics
+    uint32_t m_highWaterMark;
+    uint64_t m_insertCount;
+    uint64_t m_reuseCount;
 };
 
 template<typename T, typename H>
 void Pool<T, H>::growCapacity()
 {
     // Keep it simple for now and just double the capacity when we need to grow
-    m_capacity *= 2;
-    if (m_capacity == 0)
-        m_capacity = 1;
-    assert(m_capacity < std::numeric_limits<uint32_t>::max());
-    m_data.reserve(m_capacity);
-    m_generations.reserve(m_capacity);
-    m_freeIndices.reserve(m_capacity);
+    uint32_t newCapacity = m_capacity * 2;
+    if (newCapacity == 0)
+        newCapacity = 1;
+    assert(newCapacity < std::numeric_limits<uint32_t>::max());
+    reallocate(newCapacity);
+}
+
+template<typename T, typename H>
+void Pool<T, H>::reallocate(uint32_t newCapacity)
+{
+    assert(newCapacity >= m_slotCount);
+
+    std::unique_ptr<Slot[]> newSlots(newCapacity > 0 ? new Slot[newCapacity] : nullptr);
+    for (uint32_t i = 0; i < m_slotCount; ++i) {
+        Slot &src = m_slots[i];
+        Slot &dst = newSlots[i];
+        dst.generation = src.generation;
+        dst.denseIndex = src.denseIndex;
+        if (src.hasValue()) {
+            new (dst.storage) T(std::move(*src.data()));
+            src.data()->~T();
+        }
+    }
+
+    m_slots = std::move(newSlots);
+    m_capacity = newCapacity;
+    m_liveIndices.reserve(newCapacity);
+    m_freeIndices.reserve(newCapacity);
 }
 
 } // namespace KDGpu
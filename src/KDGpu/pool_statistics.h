@@ -0,0 +1,35 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace KDGpu {
+
+/**
+    @brief Usage counters of one of the ResourceManager pools
+    @ingroup public
+    @headerfile pool_statistics.h <KDGpu/pool_statistics.h>
+*/
+struct PoolStatistics {
+    uint32_t liveCount{ 0 };
+    uint32_t highWaterMark{ 0 }; // Largest liveCount seen so far
+    uint32_t capacity{ 0 };
+    uint64_t insertCount{ 0 };
+    uint64_t reuseCount{ 0 }; // Insertions which recycled the slot of a removed entry
+
+    float reuseRate() const noexcept
+    {
+        return insertCount > 0 ? static_cast<float>(reuseCount) / static_cast<float>(insertCount) : 0.0f;
+    }
+};
+
+} // namespace KDGpu
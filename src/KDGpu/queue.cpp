@@ -14,11 +14,43 @@
 #include <KDGpu/command_recorder.h>
 #include <KDGpu/graphics_api.h>
 #include <KDGpu/resource_manager.h>
+#include <KDGpu/api/api_buffer.h>
 #include <KDGpu/api/api_queue.h>
 #include <KDGpu/api/api_device.h>
 
+#include <algorithm>
+#include <limits>
+
 namespace KDGpu {
 
+TextureSubresourceRange textureUploadRange(const std::vector<BufferTextureCopyRegion> &regions)
+{
+    if (regions.empty())
+        return { .aspectMask = TextureAspectFlags(TextureAspectFlagBits::ColorBit), .levelCount = 1 };
+
+    TextureAspectFlags aspectMask;
+    uint32_t minLevel = std::numeric_limits<uint32_t>::max();
+    uint32_t maxLevel = 0;
+    uint32_t minLayer = std::numeric_limits<uint32_t>::max();
+    uint32_t maxLayer = 0;
+    for (const BufferTextureCopyRegion &region : regions) {
+        const TextureSubresourceLayers &layers = region.textureSubResource;
+        aspectMask = aspectMask | layers.aspectMask;
+        minLevel = std::min(minLevel, layers.mipLevel);
+        maxLevel = std::max(maxLevel, layers.mipLevel);
+        minLayer = std::min(minLayer, layers.baseArrayLayer);
+        maxLayer = std::max(maxLayer, layers.baseArrayLayer + layers.layerCount - 1);
+    }
+
+    return TextureSubresourceRange{
+        .aspectMask = aspectMask,
+        .baseMipLevel = minLevel,
+        .levelCount = maxLevel - minLevel + 1,
+        .baseArrayLayer = minLayer,
+        .layerCount = maxLayer - minLayer + 1
+    };
+}
+
 /**
     @class SubmitOptions
     @brief Holds information required to perform a queue submission.
@@ -27,6 +59,8 @@ namespace KDGpu {
     @var waitSemaphores holds a vector of handles to GpuSemaphore instances commands will have to wait for before execution begin
     @var signalSemaphores holds a vector of handles to GpuSemaphore instances that will be signalled when execution of the commands completes
     @var signalFence holds a handle to Fence instance to be signalled when execution of the commands completes
+    @var waitStages holds the pipeline stages of the commands which wait for each of the waitSemaphores. Stages
+    which are not listed start before the semaphores are signalled. Defaults to all the stages.
 
     @ingroup public
     @headerfile queue.h <KDGpu/queue.h>
@@ -75,7 +109,7 @@ Queue::Queue()
 {
 }
 
-Queue::Queue(GraphicsApi *api, const Handle<Device_t> &device, const QueueDescription &description)
+Queue::Queue(GraphicsApi *api, const Handle<Device_t> &device, const QueueDescription &description, DeviceSize stagingRingSize)
     : m_api(api)
     , m_device(device)
     , m_queue(description.queue)
@@ -84,6 +118,8 @@ Queue::Queue(GraphicsApi *api, const Handle<Device_t> &device, const QueueDescri
     , m_minImageTransferGranularity(description.minImageTransferGranularity)
     , m_queueTypeIndex(description.queueTypeIndex)
 {
+    if (m_device.isValid())
+        m_stagingRing = std::make_shared<StagingRing>(m_api, m_device, m_queue, stagingRingSize);
 }
 
 Queue::~Queue()
@@ -101,9 +137,13 @@ void Queue::waitUntilIdle()
 
 /**
  * @brief Submit commands for execution based on the SubmitOptions @a options provided
+ *
+ * The uploads staged since the previous submission are submitted first, so that @a options can use their results.
  */
 void Queue::submit(const SubmitOptions &options)
 {
+    submitStagedUploads();
+
     auto apiQueue = m_api->resourceManager()->getQueue(m_queue);
     apiQueue->submit(options);
 }
@@ -125,6 +165,14 @@ std::vector<PresentResult> Queue::lastPerSwapchainPresentResults() const
 
 void Queue::waitForUploadBufferData(const WaitForBufferUploadOptions &options)
 {
+    // No copy needed if the buffer lives in host visible device local memory
+    // Staged copies to the buffer must not overwrite the data written directly
+    if (m_stagingRing && m_stagingRing->hasPendingUploadTo(options.destinationBuffer))
+        submitStagedUploads();
+    auto apiBuffer = m_api->resourceManager()->getBuffer(options.destinationBuffer);
+    if (apiBuffer && apiBuffer->writeDirectly(options.data, options.dstOffset, options.byteSize))
+        return;
+
     // Create a staging buffer and upload initial data to it by map(), memcpy(), unmap().
     BufferOptions bufferOptions = {
         .size = options.byteSize,
@@ -155,6 +203,15 @@ void Queue::waitForUploadBufferData(const WaitForBufferUploadOptions &options)
 
 UploadStagingBuffer Queue::uploadBufferData(const BufferUploadOptions &options)
 {
+    // No copy needed if the buffer lives in host visible device local memory. The returned
+    // fence is then invalid, which reports itself as signalled.
+    // Staged copies to the buffer must not overwrite the data written directly
+    if (m_stagingRing && m_stagingRing->hasPendingUploadTo(options.destinationBuffer))
+        submitStagedUploads();
+    auto apiBuffer = m_api->resourceManager()->getBuffer(options.destinationBuffer);
+    if (apiBuffer && apiBuffer->writeDirectly(options.data, options.dstOffset, options.byteSize))
+        return {};
+
     // Create a staging buffer and upload initial data to it by map(), memcpy(), unmap().
     BufferOptions bufferOptions = {
         .size = options.byteSize,
@@ -219,11 +276,8 @@ void Queue::waitForUploadTextureData(const WaitForTextureUploadOptions &options)
     };
     CommandRecorder commandRecorder(m_api, m_device, commandRecorderOptions);
 
-    // Specify which subresource we will be copying and transitioning
-    const TextureSubresourceRange range = {
-        .aspectMask = TextureAspectFlags(TextureAspectFlagBits::ColorBit),
-        .levelCount = 1
-    };
+    // Specify which subresources we will be copying and transitioning
+    const TextureSubresourceRange range = textureUploadRange(options.regions);
 
     // We first need to transition the texture into the TextureLayout::TransferDstOptimal layout
     const TextureMemoryBarrierOptions toTransferDstOptimal = {
@@ -283,15 +337,13 @@ UploadStagingBuffer Queue::uploadTextureData(const TextureUploadOptions &options
     };
     CommandRecorder commandRecorder(m_api, m_device, commandRecorderOptions);
 
-    // Specify which subresource we will be copying and transitioning
-    const TextureSubresourceRange range = {
-        .aspectMask = TextureAspectFlags(TextureAspectFlagBits::ColorBit),
-        .levelCount = 1
-    };
+    // Specify which subresources we will be copying and transitioning
+    const TextureSubresourceRange range = textureUploadRange(options.regions);
 
     // We first need to transition the texture into the TextureLayout::TransferDstOptimal layout
     const TextureMemoryBarrierOptions toTransferDstOptimal = {
-        .srcStages = PipelineStageFlags(PipelineStageFlagBit::TopOfPipeBit),
+        .srcStages = options.srcStages,
+        .srcMask = options.srcMask,
         .dstStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
         .dstMask = AccessFlags(AccessFlagBit::TransferWriteBit),
         .oldLayout = options.oldLayout,
@@ -342,4 +394,87 @@ UploadStagingBuffer Queue::uploadTextureData(const TextureUploadOptions &options
     return uploadStagingBuffer;
 }
 
+/**
+ * @brief Copies @a options.data into the staging ring of the queue and records the upload into its command buffer.
+ *
+ * Unlike uploadBufferData(), no staging buffer, command buffer nor fence is created per upload: all the uploads
+ * staged until the next call to submit() or submitStagedUploads() are submitted together. The staging memory is
+ * reclaimed automatically once the GPU is done with it. The data can be released as soon as this returns.
+ *
+ * GpuOnly buffers placed in host visible device local memory are written directly instead, provided the
+ * submissions using the buffer have completed and no staged copy to it is waiting to be submitted, see
+ * BufferUploadStatistics.
+ */
+void Queue::stageBufferUpload(const BufferUploadOptions &options)
+{
+    if (!m_stagingRing)
+        return;
+    m_stagingRing->uploadBufferData(options);
+}
+
+/**
+ * @brief Same as stageBufferUpload() for the upload of a texture
+ */
+void Queue::stageTextureUpload(const TextureUploadOptions &options)
+{
+    if (!m_stagingRing)
+        return;
+    m_stagingRing->uploadTextureData(options);
+}
+
+/**
+ * @brief Submits the staged uploads with a single submission and reclaims the staging memory of completed ones.
+ *
+ * Called by submit(), only needed when staged uploads have to start before the next submission.
+ */
+void Queue::submitStagedUploads()
+{
+    if (!m_stagingRing)
+        return;
+    m_stagingRing->submit();
+}
+
+/**
+ * @brief Returns the number of the staged submission which will carry the uploads staged from now on.
+ *
+ * Lets the completion of staged uploads be tracked with hasStagedSubmissionCompleted(). Read it right after
+ * staging an upload: making room in the staging ring may submit the uploads staged before it.
+ */
+uint64_t Queue::pendingStagedSubmission() const
+{
+    if (!m_stagingRing)
+        return 0;
+    return m_stagingRing->pendingSubmission();
+}
+
+/**
+ * @brief Returns true if an upload of @a byteSize bytes can be staged without waiting for the GPU to release
+ * staging memory.
+ *
+ * Lets uploads which can be deferred, such as texture streaming, try again later rather than stall.
+ */
+bool Queue::canStageUploadWithoutWaiting(DeviceSize byteSize)
+{
+    if (!m_stagingRing)
+        return true;
+    return m_stagingRing->canUploadWithoutWaiting(byteSize);
+}
+
+/**
+ * @brief Returns true once the staged @a submission, as returned by pendingStagedSubmission(), has completed.
+ */
+bool Queue::hasStagedSubmissionCompleted(uint64_t submission)
+{
+    if (!m_stagingRing)
+        return true;
+    return m_stagingRing->hasCompleted(submission);
+}
+
+StagingRingStatistics Queue::stagingRingStatistics() const
+{
+    if (!m_stagingRing)
+        return {};
+    return m_stagingRing->statistics();
+}
+
 } // namespace KDGpu
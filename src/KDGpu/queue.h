@@ -17,8 +17,10 @@
 #include <KDGpu/gpu_core.h>
 #include <KDGpu/handle.h>
 #include <KDGpu/queue_description.h>
+#include <KDGpu/staging_ring.h>
 #include <KDGpu/kdgpu_export.h>
 
+#include <memory>
 #include <vector>
 
 namespace KDGpu {
@@ -40,6 +42,7 @@ struct SubmitOptions {
     std::vector<Handle<GpuSemaphore_t>> waitSemaphores;
     std::vector<Handle<GpuSemaphore_t>> signalSemaphores;
     Handle<Fence_t> signalFence;
+    std::vector<PipelineStageFlags> waitStages; // Per wait semaphore, AllCommandsBit for the missing ones
 };
 
 /**
@@ -110,8 +113,20 @@ struct TextureUploadOptions {
     TextureLayout oldLayout{ TextureLayout::Undefined };
     TextureLayout newLayout{ TextureLayout::Undefined };
     std::vector<BufferTextureCopyRegion> regions;
+    // Work which may still access the texture, the copy waits for it. Needed when updating
+    // parts of a texture which earlier submissions may still be reading.
+    PipelineStageFlags srcStages{ PipelineStageFlagBit::TopOfPipeBit };
+    AccessFlags srcMask{ AccessFlagBit::None };
 };
 
+/**
+    @brief Returns the smallest subresource range covering all of regions
+
+    This is the range the texture uploads transition, so that all the mip levels
+    and array layers of a texture can be uploaded at once.
+*/
+KDGPU_EXPORT TextureSubresourceRange textureUploadRange(const std::vector<BufferTextureCopyRegion> &regions);
+
 /**
     @ingroup public
     @headerfile queue.h <KDGpu/queue.h>
@@ -149,8 +164,17 @@ public:
     void waitForUploadTextureData(const WaitForTextureUploadOptions &options);
     UploadStagingBuffer uploadTextureData(const TextureUploadOptions &options);
 
+    void stageBufferUpload(const BufferUploadOptions &options);
+    void stageTextureUpload(const TextureUploadOptions &options);
+    void submitStagedUploads();
+    uint64_t pendingStagedSubmission() const;
+    bool canStageUploadWithoutWaiting(DeviceSize byteSize);
+    bool hasStagedSubmissionCompleted(uint64_t submission);
+    StagingRingStatistics stagingRingStatistics() const;
+
 private:
-    Queue(GraphicsApi *api, const Handle<Device_t> &device, const QueueDescription &queueDescription);
+    Queue(GraphicsApi *api, const Handle<Device_t> &device, const QueueDescription &queueDescription,
+          DeviceSize stagingRingSize = StagingRing::DefaultSize);
 
     GraphicsApi *m_api{ nullptr };
     Handle<Device_t> m_device;
@@ -160,6 +184,9 @@ private:
     Extent3D m_minImageTransferGranularity;
     uint32_t m_queueTypeIndex;
 
+    // Shared by all the copies of this Queue
+    std::shared_ptr<StagingRing> m_stagingRing;
+
     friend class Device;
     friend class VulkanGraphicsApi;
 };
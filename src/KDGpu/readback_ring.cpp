@@ -0,0 +1,360 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "readback_ring.h"
+
+#include <KDGpu/buffer.h>
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/command_buffer.h>
+#include <KDGpu/fence.h>
+#include <KDGpu/utils/logging.h>
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+namespace KDGpu {
+
+struct ReadbackSubmission {
+    Fence fence;
+    CommandBuffer commandBuffer;
+    bool submitted{ false };
+
+    bool isComplete() const { return submitted && fence.status() == FenceStatus::Signalled; }
+};
+
+struct ReadbackSlot {
+    Buffer buffer;
+    DeviceSize capacity{ 0 };
+    std::shared_ptr<ReadbackSubmission> submission; // Of the last copy into the buffer
+};
+
+namespace {
+
+uint64_t layerEnd(const TextureSubresourceRange &range)
+{
+    return range.layerCount == remainingArrayLayers ? std::numeric_limits<uint64_t>::max()
+                                                    : uint64_t(range.baseArrayLayer) + range.layerCount;
+}
+
+// Regions often share a mip level (several rectangles of it) or overlap in layers. A subresource must only be
+// transitioned once, so the layers of each aspect and level are merged into disjoint ranges.
+std::vector<TextureSubresourceRange> subresourceRanges(const std::vector<BufferTextureCopyRegion> &regions)
+{
+    std::vector<TextureSubresourceRange> ranges;
+    ranges.reserve(regions.size());
+    for (const BufferTextureCopyRegion &region : regions) {
+        ranges.push_back(TextureSubresourceRange{
+                .aspectMask = region.textureSubResource.aspectMask,
+                .baseMipLevel = region.textureSubResource.mipLevel,
+                .levelCount = 1,
+                .baseArrayLayer = region.textureSubResource.baseArrayLayer,
+                .layerCount = region.textureSubResource.layerCount });
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const TextureSubresourceRange &a, const TextureSubresourceRange &b) {
+        return std::make_tuple(a.aspectMask.toInt(), a.baseMipLevel, a.baseArrayLayer) <
+                std::make_tuple(b.aspectMask.toInt(), b.baseMipLevel, b.baseArrayLayer);
+    });
+
+    std::vector<TextureSubresourceRange> merged;
+    for (const TextureSubresourceRange &range : ranges) {
+        if (!merged.empty()) {
+            TextureSubresourceRange &last = merged.back();
+            if (last.aspectMask == range.aspectMask && last.baseMipLevel == range.baseMipLevel && range.baseArrayLayer <= layerEnd(last)) {
+                if (range.layerCount == remainingArrayLayers)
+                    last.layerCount = remainingArrayLayers;
+                else if (layerEnd(range) > layerEnd(last))
+                    last.layerCount = range.baseArrayLayer + range.layerCount - last.baseArrayLayer;
+                continue;
+            }
+        }
+        merged.push_back(range);
+    }
+    return merged;
+}
+
+} // namespace
+
+Readback::Readback() = default;
+
+Readback::Readback(const std::shared_ptr<ReadbackSlot> &slot, DeviceSize byteSize)
+    : m_slot(slot)
+    , m_byteSize(byteSize)
+{
+}
+
+Readback::~Readback() = default;
+
+Readback::Readback(Readback &&other)
+{
+    *this = std::move(other);
+}
+
+Readback &Readback::operator=(Readback &&other)
+{
+    if (this != &other) {
+        m_slot = std::move(other.m_slot);
+        m_byteSize = std::exchange(other.m_byteSize, 0);
+        m_invalidated = std::exchange(other.m_invalidated, false);
+    }
+    return *this;
+}
+
+bool Readback::isReady() const
+{
+    return isValid() && m_slot->submission->isComplete();
+}
+
+bool Readback::wait()
+{
+    if (!isValid())
+        return false;
+
+    ReadbackSubmission *submission = m_slot->submission.get();
+    if (!submission->submitted) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Waiting for a readback which was not submitted, call ReadbackRing::submit() first");
+        return false;
+    }
+    if (submission->fence.status() != FenceStatus::Signalled)
+        submission->fence.wait();
+    return true;
+}
+
+const void *Readback::data()
+{
+    if (!wait())
+        return nullptr;
+
+    // Only needed for memory which is not host coherent
+    if (!m_invalidated) {
+        m_slot->buffer.invalidate(0, m_byteSize);
+        m_invalidated = true;
+    }
+    return m_slot->buffer.mappedData();
+}
+
+ReadbackRing::ReadbackRing() = default;
+
+ReadbackRing::ReadbackRing(GraphicsApi *api, const Handle<Device_t> &device, const Queue &queue, const ReadbackRingOptions &options)
+    : m_api(api)
+    , m_device(device)
+    , m_queue(queue)
+    , m_minBufferSize(options.minBufferSize)
+{
+}
+
+ReadbackRing::~ReadbackRing()
+{
+    release();
+}
+
+ReadbackRing::ReadbackRing(ReadbackRing &&other)
+{
+    *this = std::move(other);
+}
+
+ReadbackRing &ReadbackRing::operator=(ReadbackRing &&other)
+{
+    if (this != &other) {
+        release();
+
+        m_api = std::exchange(other.m_api, nullptr);
+        m_device = std::exchange(other.m_device, {});
+        m_queue = other.m_queue;
+        m_minBufferSize = other.m_minBufferSize;
+        m_slots = std::move(other.m_slots);
+        m_recorder = std::move(other.m_recorder);
+        m_pendingSubmission = std::move(other.m_pendingSubmission);
+        m_readbackCount = std::exchange(other.m_readbackCount, 0);
+        m_submissionCount = std::exchange(other.m_submissionCount, 0);
+        m_reuseCount = std::exchange(other.m_reuseCount, 0);
+
+        other.m_slots.clear();
+        other.m_recorder.reset();
+    }
+    return *this;
+}
+
+Readback ReadbackRing::readBufferData(const BufferReadbackOptions &options)
+{
+    if (!isValid() || options.byteSize == 0)
+        return {};
+
+    std::shared_ptr<ReadbackSlot> slot = acquireSlot(options.byteSize);
+    CommandRecorder &commandRecorder = recorder();
+
+    commandRecorder.bufferMemoryBarrier(BufferMemoryBarrierOptions{
+            .srcStages = options.srcStages,
+            .srcMask = options.srcMask,
+            .dstStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
+            .dstMask = AccessFlags(AccessFlagBit::TransferReadBit),
+            .buffer = options.sourceBuffer,
+            .offset = options.srcOffset,
+            .size = options.byteSize });
+
+    commandRecorder.copyBuffer(BufferCopy{
+            .src = options.sourceBuffer,
+            .srcOffset = options.srcOffset,
+            .dst = slot->buffer,
+            .byteSize = options.byteSize });
+
+    commandRecorder.bufferMemoryBarrier(BufferMemoryBarrierOptions{
+            .srcStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
+            .srcMask = AccessFlags(AccessFlagBit::TransferWriteBit),
+            .dstStages = PipelineStageFlags(PipelineStageFlagBit::HostBit),
+            .dstMask = AccessFlags(AccessFlagBit::HostReadBit),
+            .buffer = slot->buffer,
+            .size = options.byteSize });
+
+    ++m_readbackCount;
+    return Readback(slot, options.byteSize);
+}
+
+Readback ReadbackRing::readTextureData(const TextureReadbackOptions &options)
+{
+    if (!isValid() || options.byteSize == 0 || options.regions.empty())
+        return {};
+
+    std::shared_ptr<ReadbackSlot> slot = acquireSlot(options.byteSize);
+    CommandRecorder &commandRecorder = recorder();
+
+    const std::vector<TextureSubresourceRange> ranges = subresourceRanges(options.regions);
+    for (const TextureSubresourceRange &range : ranges) {
+        commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+                .srcStages = options.srcStages,
+                .srcMask = options.srcMask,
+                .dstStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
+                .dstMask = AccessFlags(AccessFlagBit::TransferReadBit),
+                .oldLayout = options.layout,
+                .newLayout = TextureLayout::TransferSrcOptimal,
+                .texture = options.sourceTexture,
+                .range = range });
+    }
+
+    commandRecorder.copyTextureToBuffer(TextureToBufferCopy{
+            .srcTexture = options.sourceTexture,
+            .srcTextureLayout = TextureLayout::TransferSrcOptimal,
+            .dstBuffer = slot->buffer,
+            .regions = options.regions });
+
+    // Hand the texture back in its original layout to whatever uses it next
+    for (const TextureSubresourceRange &range : ranges) {
+        commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+                .srcStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
+                .dstStages = PipelineStageFlags(PipelineStageFlagBit::AllCommandsBit),
+                .dstMask = AccessFlagBit::MemoryReadBit | AccessFlagBit::MemoryWriteBit,
+                .oldLayout = TextureLayout::TransferSrcOptimal,
+                .newLayout = options.layout,
+                .texture = options.sourceTexture,
+                .range = range });
+    }
+
+    commandRecorder.bufferMemoryBarrier(BufferMemoryBarrierOptions{
+            .srcStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
+            .srcMask = AccessFlags(AccessFlagBit::TransferWriteBit),
+            .dstStages = PipelineStageFlags(PipelineStageFlagBit::HostBit),
+            .dstMask = AccessFlags(AccessFlagBit::HostReadBit),
+            .buffer = slot->buffer,
+            .size = options.byteSize });
+
+    ++m_readbackCount;
+    return Readback(slot, options.byteSize);
+}
+
+void ReadbackRing::submit()
+{
+    if (!m_recorder)
+        return;
+
+    m_pendingSubmission->commandBuffer = m_recorder->finish();
+    m_recorder.reset();
+
+    m_queue.submit(SubmitOptions{
+            .commandBuffers = { m_pendingSubmission->commandBuffer.handle() },
+            .signalFence = m_pendingSubmission->fence.handle() });
+    m_pendingSubmission->submitted = true;
+    m_pendingSubmission.reset();
+    ++m_submissionCount;
+}
+
+ReadbackRingStatistics ReadbackRing::statistics() const noexcept
+{
+    ReadbackRingStatistics stats{
+        .bufferCount = static_cast<uint32_t>(m_slots.size()),
+        .readbackCount = m_readbackCount,
+        .submissionCount = m_submissionCount,
+        .reuseCount = m_reuseCount
+    };
+    for (const std::shared_ptr<ReadbackSlot> &slot : m_slots) {
+        stats.allocatedBytes += slot->capacity;
+        if (slot.use_count() > 1 || (slot->submission && !slot->submission->isComplete()))
+            ++stats.buffersInUse;
+    }
+    return stats;
+}
+
+std::shared_ptr<ReadbackSlot> ReadbackRing::acquireSlot(DeviceSize byteSize)
+{
+    // Recycle the smallest released buffer which is large enough and no longer written to
+    std::shared_ptr<ReadbackSlot> slot;
+    for (const std::shared_ptr<ReadbackSlot> &candidate : m_slots) {
+        if (candidate.use_count() > 1 || candidate->capacity < byteSize)
+            continue;
+        if (candidate->submission && !candidate->submission->isComplete())
+            continue;
+        if (!slot || candidate->capacity < slot->capacity)
+            slot = candidate;
+    }
+
+    if (slot) {
+        ++m_reuseCount;
+    } else {
+        slot = std::make_shared<ReadbackSlot>();
+        slot->capacity = std::max(byteSize, m_minBufferSize);
+        slot->buffer = Buffer(m_api, m_device,
+                              BufferOptions{
+                                      .size = slot->capacity,
+                                      .usage = BufferUsageFlagBits::TransferDstBit,
+                                      .memoryUsage = MemoryUsage::GpuToCpu,
+                                      .persistentlyMapped = true },
+                              nullptr);
+        m_slots.push_back(slot);
+    }
+
+    if (!m_pendingSubmission) {
+        m_pendingSubmission = std::make_shared<ReadbackSubmission>();
+        m_pendingSubmission->fence = Fence(m_api, m_device, FenceOptions{ .createSignalled = false });
+    }
+    slot->submission = m_pendingSubmission;
+    return slot;
+}
+
+CommandRecorder &ReadbackRing::recorder()
+{
+    if (!m_recorder)
+        m_recorder.emplace(CommandRecorder(m_api, m_device, CommandRecorderOptions{ .queue = m_queue.handle() }));
+    return *m_recorder;
+}
+
+void ReadbackRing::release()
+{
+    if (!isValid())
+        return;
+
+    // Readbacks still held by the application must not wait forever
+    submit();
+    for (const std::shared_ptr<ReadbackSlot> &slot : m_slots) {
+        if (slot->submission && slot->submission->submitted)
+            slot->submission->fence.wait();
+    }
+    m_slots.clear();
+}
+
+} // namespace KDGpu
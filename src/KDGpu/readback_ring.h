@@ -0,0 +1,179 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/handle.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace KDGpu {
+
+class GraphicsApi;
+
+struct Buffer_t;
+struct Device_t;
+struct Texture_t;
+
+// Internal state shared between a ReadbackRing and the Readbacks it handed out
+struct ReadbackSlot;
+struct ReadbackSubmission;
+
+/**
+    @ingroup public
+    @headerfile readback_ring.h <KDGpu/readback_ring.h>
+*/
+struct BufferReadbackOptions {
+    Handle<Buffer_t> sourceBuffer;
+    PipelineStageFlags srcStages; // Stages of the work which wrote the data
+    AccessFlags srcMask;
+    DeviceSize srcOffset{ 0 };
+    DeviceSize byteSize{ 0 };
+};
+
+/**
+    @ingroup public
+    @headerfile readback_ring.h <KDGpu/readback_ring.h>
+*/
+struct TextureReadbackOptions {
+    Handle<Texture_t> sourceTexture;
+    PipelineStageFlags srcStages; // Stages of the work which wrote the data
+    AccessFlags srcMask;
+    TextureLayout layout{ TextureLayout::Undefined }; // Layout of the texture, restored after the copy
+    DeviceSize byteSize{ 0 };
+    std::vector<BufferTextureCopyRegion> regions; // Buffer offsets are relative to the start of the data
+};
+
+struct ReadbackRingOptions {
+    DeviceSize minBufferSize{ 64 * 1024 };
+};
+
+struct ReadbackRingStatistics {
+    uint32_t bufferCount{ 0 };
+    DeviceSize allocatedBytes{ 0 };
+    uint32_t buffersInUse{ 0 }; // Held by a Readback or waiting for the GPU
+    uint64_t readbackCount{ 0 };
+    uint64_t submissionCount{ 0 };
+    uint64_t reuseCount{ 0 }; // Readbacks which recycled the buffer of an earlier one
+};
+
+/**
+    @brief Result of a copy from the GPU, available once the copy has completed
+    @ingroup public
+    @headerfile readback_ring.h <KDGpu/readback_ring.h>
+
+    The copy only starts once ReadbackRing::submit() has been called. The buffer
+    holding the data goes back to the ring when the Readback is destroyed.
+ */
+class KDGPU_EXPORT Readback
+{
+public:
+    Readback();
+    ~Readback();
+
+    Readback(Readback &&);
+    Readback &operator=(Readback &&);
+
+    Readback(const Readback &) = delete;
+    Readback &operator=(const Readback &) = delete;
+
+    bool isValid() const noexcept { return m_slot != nullptr; }
+    DeviceSize byteSize() const noexcept { return m_byteSize; }
+
+    // True once the copy has completed, never blocks
+    bool isReady() const;
+
+    // Blocks until the copy has completed. Returns false if it was never submitted.
+    bool wait();
+
+    // Waits for the copy and returns the data, valid for the lifetime of the Readback.
+    // Returns nullptr if the copy was never submitted.
+    const void *data();
+
+private:
+    explicit Readback(const std::shared_ptr<ReadbackSlot> &slot, DeviceSize byteSize);
+
+    std::shared_ptr<ReadbackSlot> m_slot;
+    DeviceSize m_byteSize{ 0 };
+    bool m_invalidated{ false };
+
+    friend class ReadbackRing;
+};
+
+/**
+    @brief Asynchronous copies of buffers and textures into host visible memory
+    @ingroup public
+    @headerfile readback_ring.h <KDGpu/readback_ring.h>
+
+    Each readback copies into a GpuToCpu buffer recycled from the ones of earlier
+    readbacks which have been released. The copies are all recorded into the same
+    command buffer which submit() submits to the queue of the ring, after the
+    work already submitted to it. Rather than waiting for the queue to go idle, the
+    returned Readbacks can be polled, so that the results of a frame can be read
+    while the following frames are being rendered. Textures can be read back
+    whatever their tiling.
+
+    Readbacks must not outlive the Device. A ReadbackRing is not thread safe.
+
+    @sa Device::createReadbackRing
+ */
+class KDGPU_EXPORT ReadbackRing
+{
+public:
+    ReadbackRing();
+    ~ReadbackRing();
+
+    ReadbackRing(ReadbackRing &&);
+    ReadbackRing &operator=(ReadbackRing &&);
+
+    ReadbackRing(const ReadbackRing &) = delete;
+    ReadbackRing &operator=(const ReadbackRing &) = delete;
+
+    bool isValid() const noexcept { return m_api != nullptr; }
+    bool hasPendingReadbacks() const noexcept { return m_recorder.has_value(); }
+
+    Readback readBufferData(const BufferReadbackOptions &options);
+    Readback readTextureData(const TextureReadbackOptions &options);
+
+    // Submits the copies recorded since the last submission, if any
+    void submit();
+
+    ReadbackRingStatistics statistics() const noexcept;
+
+private:
+    explicit ReadbackRing(GraphicsApi *api, const Handle<Device_t> &device, const Queue &queue, const ReadbackRingOptions &options);
+
+    std::shared_ptr<ReadbackSlot> acquireSlot(DeviceSize byteSize);
+    CommandRecorder &recorder();
+    void release();
+
+    GraphicsApi *m_api{ nullptr };
+    Handle<Device_t> m_device;
+    Queue m_queue;
+    DeviceSize m_minBufferSize{ 0 };
+
+    std::vector<std::shared_ptr<ReadbackSlot>> m_slots;
+    std::optional<CommandRecorder> m_recorder;
+    std::shared_ptr<ReadbackSubmission> m_pendingSubmission;
+
+    uint64_t m_readbackCount{ 0 };
+    uint64_t m_submissionCount{ 0 };
+    uint64_t m_reuseCount{ 0 };
+
+    friend class Device;
+};
+
+} // namespace KDGpu
@@ -14,11 +14,14 @@
 #include <KDGpu/adapter.h>
 #include <KDGpu/bind_group.h>
 #include <KDGpu/bind_group_description.h>
+#include <KDGpu/defragmentation.h>
 #include <KDGpu/device.h>
 #include <KDGpu/gpu_semaphore.h>
+#include <KDGpu/memory_pool.h>
 #include <KDGpu/handle.h>
 #include <KDGpu/pool.h>
 #include <KDGpu/queue.h>
+#include <KDGpu/resource_statistics.h>
 #include <KDGpu/swapchain.h>
 #include <KDGpu/surface.h>
 #include <KDGpu/texture.h>
@@ -42,6 +45,7 @@ struct ApiFence;
 struct ApiGpuSemaphore;
 struct ApiGraphicsPipeline;
 struct ApiInstance;
+struct ApiMemoryPool;
 struct ApiPipelineLayout;
 struct ApiQueue;
 struct ApiRenderPass;
@@ -62,6 +66,7 @@ struct FenceOptions;
 struct GpuSemaphoreOptions;
 struct GraphicsPipelineOptions;
 struct InstanceOptions;
+struct MemoryPoolOptions;
 struct PipelineLayoutOptions;
 struct RenderPassCommandRecorderOptions;
 struct SamplerOptions;
@@ -73,6 +78,7 @@ struct CommandRecorder_t;
 struct ComputePipeline_t;
 struct Fence_t;
 struct GraphicsPipeline_t;
+struct MemoryPool_t;
 struct PipelineLayout_t;
 struct RenderPass_t;
 struct Sampler_t;
@@ -121,6 +127,7 @@ public:
     virtual ApiSwapchain *getSwapchain(const Handle<Swapchain_t> &handle) const = 0;
 
     virtual Handle<Texture_t> createTexture(const Handle<Device_t> &deviceHandle, const TextureOptions &options) = 0;
+    virtual std::vector<Handle<Texture_t>> createAliasedTextures(const Handle<Device_t> &deviceHandle, const std::vector<TextureOptions> &options) = 0;
     virtual void deleteTexture(const Handle<Texture_t> &handle) = 0;
     virtual ApiTexture *getTexture(const Handle<Texture_t> &handle) const = 0;
 
@@ -191,6 +198,19 @@ public:
     virtual void deleteFence(const Handle<Fence_t> &handle) = 0;
     virtual ApiFence *getFence(const Handle<Fence_t> &handle) const = 0;
 
+    virtual Handle<MemoryPool_t> createMemoryPool(const Handle<Device_t> &deviceHandle, const MemoryPoolOptions &options) = 0;
+    virtual void deleteMemoryPool(const Handle<MemoryPool_t> &handle) = 0;
+    virtual ApiMemoryPool *getMemoryPool(const Handle<MemoryPool_t> &handle) const = 0;
+
+    // Statistics are gathered from running counters and are cheap enough to be queried every frame
+    virtual ResourceStatistics statistics() const = 0;
+    virtual DeviceResourceStatistics deviceStatistics(const Handle<Device_t> &deviceHandle) const = 0;
+
+    // Relocation of the memory of a device's resources, behind their handles
+    virtual bool beginDefragmentation(const Handle<Device_t> &deviceHandle, const DefragmentationOptions &options) = 0;
+    virtual DefragmentationStatistics defragmentationStep(const Handle<Device_t> &deviceHandle, const Handle<Queue_t> &queueHandle) = 0;
+    virtual DefragmentationStatistics endDefragmentation(const Handle<Device_t> &deviceHandle) = 0;
+
 protected:
     ResourceManager();
 };
@@ -0,0 +1,147 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/deletion_queue_statistics.h>
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/pool_statistics.h>
+
+#include <array>
+#include <stdint.h>
+
+namespace KDGpu {
+
+/**
+    @brief Per pool statistics for all the resources held by a ResourceManager
+    @ingroup public
+    @headerfile resource_statistics.h <KDGpu/resource_statistics.h>
+*/
+struct ResourceStatistics {
+    PoolStatistics instances;
+    PoolStatistics adapters;
+    PoolStatistics devices;
+    PoolStatistics queues;
+    PoolStatistics surfaces;
+    PoolStatistics swapchains;
+    PoolStatistics textures;
+    PoolStatistics textureViews;
+    PoolStatistics buffers;
+    PoolStatistics shaderModules;
+    PoolStatistics pipelineLayouts;
+    PoolStatistics bindGroupLayouts;
+    PoolStatistics bindGroups;
+    PoolStatistics graphicsPipelines;
+    PoolStatistics computePipelines;
+    PoolStatistics gpuSemaphores;
+    PoolStatistics commandRecorders;
+    PoolStatistics renderPassCommandRecorders;
+    PoolStatistics computePassCommandRecorders;
+    PoolStatistics commandBuffers;
+    PoolStatistics renderPasses;
+    PoolStatistics framebuffers;
+    PoolStatistics samplers;
+    PoolStatistics fences;
+    PoolStatistics memoryPools;
+};
+
+/**
+    @brief Memory held by the buffers and textures allocated with a given MemoryUsage
+    @ingroup public
+    @headerfile resource_statistics.h <KDGpu/resource_statistics.h>
+*/
+struct MemoryUsageStatistics {
+    uint32_t allocationCount{ 0 };
+    DeviceSize allocatedBytes{ 0 };
+};
+
+/**
+    @brief Occupancy of the descriptor pools bind groups are allocated from
+    @ingroup public
+    @headerfile resource_statistics.h <KDGpu/resource_statistics.h>
+*/
+struct DescriptorPoolStatistics {
+    uint32_t poolCount{ 0 }; // Including the transient pools
+    uint32_t allocatedSets{ 0 };
+    uint32_t maxSets{ 0 };
+    uint32_t freeSets{ 0 }; // Released sets waiting to be reused by bind groups of the same layout
+    uint32_t transientPoolCount{ 0 };
+};
+
+/**
+    @brief Which path the buffer uploads of a Device have taken
+    @ingroup public
+    @headerfile resource_statistics.h <KDGpu/resource_statistics.h>
+
+    GpuOnly buffers which may receive uploads are placed in host visible memory
+    when all of the device local memory is host visible (resizable BAR or unified
+    memory). Uploads to them are then written directly unless the GPU could still
+    be using the buffer.
+*/
+struct BufferUploadStatistics {
+    bool hostVisibleDeviceLocalMemory{ false };
+    uint64_t directWriteCount{ 0 };
+    DeviceSize directWriteBytes{ 0 };
+    uint64_t stagedUploadCount{ 0 };
+    DeviceSize stagedUploadBytes{ 0 };
+};
+
+/**
+    @brief How the descriptors of the bind groups of a Device have been written
+    @ingroup public
+    @headerfile resource_statistics.h <KDGpu/resource_statistics.h>
+
+    Updates setting every binding of a bind group, such as the initial resources
+    of BindGroupOptions, go through the update template of its layout. Other
+    updates write all of their entries in one batch.
+*/
+struct DescriptorUpdateStatistics {
+    uint64_t batchedUpdateCount{ 0 };
+    uint64_t templateUpdateCount{ 0 };
+    uint64_t descriptorCount{ 0 }; // Descriptors written by either kind of update
+};
+
+/**
+    @brief Objects shared between identical descriptions by a cache of a Device
+    @ingroup public
+    @headerfile resource_statistics.h <KDGpu/resource_statistics.h>
+*/
+struct ObjectCacheStatistics {
+    uint32_t objectCount{ 0 }; // Distinct API objects alive
+    uint64_t hitCount{ 0 }; // Creations which returned an existing object
+};
+
+constexpr uint32_t MemoryUsageCount = static_cast<uint32_t>(MemoryUsage::GpuLazilyAllocated) + 1;
+
+/**
+    @brief Statistics about the resources owned by a single Device
+    @ingroup public
+    @headerfile resource_statistics.h <KDGpu/resource_statistics.h>
+*/
+struct DeviceResourceStatistics {
+    std::array<MemoryUsageStatistics, MemoryUsageCount> memoryUsage; // Indexed by MemoryUsage
+    DescriptorPoolStatistics descriptorPools;
+    DescriptorUpdateStatistics descriptorUpdates;
+    uint32_t cachedRenderPasses{ 0 };
+    uint32_t cachedFramebuffers{ 0 };
+    DeletionQueueStatistics deletionQueue;
+    BufferUploadStatistics bufferUploads;
+    ObjectCacheStatistics samplerCache;
+    ObjectCacheStatistics textureViewCache;
+    ObjectCacheStatistics bindGroupLayoutCache;
+    ObjectCacheStatistics pipelineLayoutCache;
+
+    const MemoryUsageStatistics &memoryFor(MemoryUsage usage) const
+    {
+        return memoryUsage[static_cast<uint32_t>(usage)];
+    }
+};
+
+} // namespace KDGpu
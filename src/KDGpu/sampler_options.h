@@ -34,6 +34,8 @@ struct SamplerOptions {
     CompareOperation compare{ CompareOperation::Never };
 
     bool normalizedCoordinates{ true };
+
+    friend bool operator==(const SamplerOptions &, const SamplerOptions &) = default;
 };
 
 } // namespace KDGpu
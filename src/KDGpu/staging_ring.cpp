@@ -0,0 +1,318 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "staging_ring.h"
+
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/graphics_api.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/resource_manager.h>
+#include <KDGpu/api/api_buffer.h>
+#include <KDGpu/api/api_queue.h>
+
+#include <cstring>
+#include <limits>
+
+namespace KDGpu {
+
+namespace {
+
+// Size granularity of the allocations and alignment of the buffer copies
+constexpr DeviceSize StagingAlignment = 16;
+
+// Buffer to texture copies need offsets which are a multiple of the texel block size and of 4.
+// This is a multiple of all of them: 1, 2, 3, 4, 6, 8, 12, 16, 24 and 32 bytes.
+constexpr DeviceSize TextureStagingAlignment = 96;
+
+constexpr DeviceSize NoSpace = std::numeric_limits<DeviceSize>::max();
+
+DeviceSize alignUp(DeviceSize value, DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+StagingRing::StagingRing(GraphicsApi *api, const Handle<Device_t> &device, const Handle<Queue_t> &queue, DeviceSize size)
+    : m_api(api)
+    , m_device(device)
+    , m_queue(queue)
+    , m_size(alignUp(size, StagingAlignment))
+{
+}
+
+StagingRing::~StagingRing()
+{
+    release();
+}
+
+bool StagingRing::uploadBufferData(const BufferUploadOptions &options)
+{
+    // A direct write would land before the copies to the buffer which are still to be submitted.
+    // Once submitted, the direct path is not taken as long as they are in flight.
+    if (hasPendingUploadTo(options.destinationBuffer))
+        submit();
+
+    auto apiBuffer = m_api->resourceManager()->getBuffer(options.destinationBuffer);
+    if (apiBuffer && apiBuffer->writeDirectly(options.data, options.dstOffset, options.byteSize))
+        return false;
+
+    const auto [srcBuffer, srcOffset] = stage(options.data, options.byteSize, StagingAlignment);
+
+    CommandRecorder &commandRecorder = recorder();
+    commandRecorder.copyBuffer(BufferCopy{
+            .src = srcBuffer,
+            .srcOffset = srcOffset,
+            .dst = options.destinationBuffer,
+            .dstOffset = options.dstOffset,
+            .byteSize = options.byteSize });
+
+    commandRecorder.bufferMemoryBarrier(BufferMemoryBarrierOptions{
+            .srcStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
+            .srcMask = AccessFlags(AccessFlagBit::TransferWriteBit),
+            .dstStages = releasesOwnership() ? PipelineStageFlags(PipelineStageFlagBit::BottomOfPipeBit) : options.dstStages,
+            .dstMask = releasesOwnership() ? AccessFlags(AccessFlagBit::None) : options.dstMask,
+            .srcQueueTypeIndex = m_srcQueueTypeIndex,
+            .dstQueueTypeIndex = m_dstQueueTypeIndex,
+            .buffer = options.destinationBuffer });
+
+    m_pendingBuffers.insert(options.destinationBuffer);
+    ++m_uploadCount;
+    return true;
+}
+
+void StagingRing::uploadTextureData(const TextureUploadOptions &options)
+{
+    const auto [srcBuffer, srcOffset] = stage(options.data, options.byteSize, TextureStagingAlignment);
+
+    CommandRecorder &commandRecorder = recorder();
+
+    // Specify which subresources we will be copying and transitioning
+    const TextureSubresourceRange range = textureUploadRange(options.regions);
+
+    commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+            .srcStages = options.srcStages,
+            .srcMask = options.srcMask,
+            .dstStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
+            .dstMask = AccessFlags(AccessFlagBit::TransferWriteBit),
+            .oldLayout = options.oldLayout,
+            .newLayout = TextureLayout::TransferDstOptimal,
+            .texture = options.destinationTexture,
+            .range = range });
+
+    // The regions are relative to the start of the data
+    std::vector<BufferTextureCopyRegion> regions = options.regions;
+    for (BufferTextureCopyRegion &region : regions)
+        region.bufferOffset += srcOffset;
+
+    commandRecorder.copyBufferToTexture(BufferToTextureCopy{
+            .srcBuffer = srcBuffer,
+            .dstTexture = options.destinationTexture,
+            .dstTextureLayout = TextureLayout::TransferDstOptimal,
+            .regions = std::move(regions) });
+
+    commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+            .srcStages = PipelineStageFlags(PipelineStageFlagBit::TransferBit),
+            .srcMask = AccessFlags(AccessFlagBit::TransferWriteBit),
+            .dstStages = releasesOwnership() ? PipelineStageFlags(PipelineStageFlagBit::BottomOfPipeBit) : options.dstStages,
+            .dstMask = releasesOwnership() ? AccessFlags(AccessFlagBit::None) : options.dstMask,
+            .oldLayout = TextureLayout::TransferDstOptimal,
+            .newLayout = options.newLayout,
+            .srcQueueTypeIndex = m_srcQueueTypeIndex,
+            .dstQueueTypeIndex = m_dstQueueTypeIndex,
+            .texture = options.destinationTexture,
+            .range = range });
+
+    ++m_uploadCount;
+}
+
+void StagingRing::setQueueOwnershipTransfer(uint32_t srcQueueTypeIndex, uint32_t dstQueueTypeIndex)
+{
+    m_srcQueueTypeIndex = srcQueueTypeIndex;
+    m_dstQueueTypeIndex = dstQueueTypeIndex;
+}
+
+void StagingRing::submit(const std::vector<Handle<GpuSemaphore_t>> &signalSemaphores)
+{
+    reclaim();
+
+    // Submitted directly to the API queue, Queue::submit() submits the staged uploads itself
+    auto apiQueue = m_api->resourceManager()->getQueue(m_queue);
+    if (!m_recorder) {
+        // The semaphores are signalled once the uploads submitted earlier have completed
+        if (!signalSemaphores.empty())
+            apiQueue->submit(SubmitOptions{ .signalSemaphores = signalSemaphores });
+        return;
+    }
+
+    CommandBuffer commandBuffer = m_recorder->finish();
+    m_recorder.reset();
+    m_pendingBuffers.clear();
+
+    Fence fence(m_api, m_device, FenceOptions{ .createSignalled = false });
+
+    apiQueue->submit(SubmitOptions{
+            .commandBuffers = { commandBuffer.handle() },
+            .signalSemaphores = signalSemaphores,
+            .signalFence = fence.handle() });
+
+    m_submissions.push_back(Submission{
+            .fence = std::move(fence),
+            .commandBuffer = std::move(commandBuffer),
+            .byteSize = m_pendingBytes,
+            .dedicatedBuffers = std::move(m_pendingDedicatedBuffers) });
+    m_pendingBytes = 0;
+    m_pendingDedicatedBuffers.clear();
+    ++m_submissionCount;
+}
+
+void StagingRing::reclaim()
+{
+    while (!m_submissions.empty() && m_submissions.front().fence.status() == FenceStatus::Signalled) {
+        m_usedBytes -= m_submissions.front().byteSize;
+        m_submissions.pop_front();
+    }
+
+    // Once drained, allocations start over from the beginning of the ring
+    if (m_usedBytes == 0)
+        m_head = 0;
+}
+
+bool StagingRing::canUploadWithoutWaiting(DeviceSize byteSize)
+{
+    reclaim();
+    const DeviceSize alignedSize = alignUp(byteSize, StagingAlignment);
+    if (alignedSize > m_size || m_usedBytes == 0)
+        return true;
+
+    // Texture uploads need the strictest alignment, this holds for buffer uploads as well
+    const auto [offset, skipped] = placement(alignedSize, TextureStagingAlignment);
+    return m_usedBytes + skipped + alignedSize <= m_size;
+}
+
+bool StagingRing::hasCompleted(uint64_t submission)
+{
+    // Submissions are reclaimed in order, the ones no longer tracked have completed
+    reclaim();
+    return submission <= m_submissionCount - m_submissions.size();
+}
+
+void StagingRing::release()
+{
+    for (Submission &submission : m_submissions)
+        submission.fence.wait();
+    m_submissions.clear();
+    m_recorder.reset();
+    m_pendingDedicatedBuffers.clear();
+    m_pendingBuffers.clear();
+    m_buffer = {};
+    m_mapped = nullptr;
+    m_head = 0;
+    m_usedBytes = 0;
+    m_pendingBytes = 0;
+}
+
+StagingRingStatistics StagingRing::statistics() const noexcept
+{
+    return StagingRingStatistics{
+        .capacity = m_buffer.isValid() ? m_size : 0,
+        .usedBytes = m_usedBytes,
+        .submissionsInFlight = static_cast<uint32_t>(m_submissions.size()),
+        .uploadCount = m_uploadCount,
+        .submissionCount = m_submissionCount,
+        .dedicatedBufferCount = m_dedicatedBufferCount,
+        .stallCount = m_stallCount
+    };
+}
+
+std::pair<Handle<Buffer_t>, DeviceSize> StagingRing::stage(const void *data, DeviceSize byteSize, DeviceSize alignment)
+{
+    const DeviceSize offset = allocate(byteSize, alignment);
+    if (offset == NoSpace) {
+        // Too large for the ring, use a buffer of its own released with the submission
+        Buffer stagingBuffer(m_api, m_device,
+                             BufferOptions{
+                                     .size = byteSize,
+                                     .usage = BufferUsageFlagBits::TransferSrcBit,
+                                     .memoryUsage = MemoryUsage::CpuToGpu },
+                             data);
+        const Handle<Buffer_t> handle = stagingBuffer.handle();
+        m_pendingDedicatedBuffers.push_back(std::move(stagingBuffer));
+        ++m_dedicatedBufferCount;
+        return { handle, 0 };
+    }
+
+    std::memcpy(m_mapped + offset, data, byteSize);
+    m_buffer.flush(offset, byteSize);
+    return { m_buffer.handle(), offset };
+}
+
+DeviceSize StagingRing::allocate(DeviceSize byteSize, DeviceSize alignment)
+{
+    const DeviceSize alignedSize = alignUp(byteSize, StagingAlignment);
+    if (alignedSize > m_size)
+        return NoSpace;
+
+    if (!m_buffer.isValid()) {
+        m_buffer = Buffer(m_api, m_device,
+                          BufferOptions{
+                                  .size = m_size,
+                                  .usage = BufferUsageFlagBits::TransferSrcBit,
+                                  .memoryUsage = MemoryUsage::CpuToGpu,
+                                  .persistentlyMapped = true },
+                          nullptr);
+        m_mapped = static_cast<uint8_t *>(m_buffer.mappedData());
+        if (!m_mapped) {
+            m_buffer = {};
+            return NoSpace;
+        }
+    }
+
+    for (;;) {
+        if (m_usedBytes == 0)
+            m_head = 0;
+
+        const auto [offset, skipped] = placement(alignedSize, alignment);
+        if (m_usedBytes + skipped + alignedSize <= m_size) {
+            m_head = offset + alignedSize;
+            m_usedBytes += skipped + alignedSize;
+            m_pendingBytes += skipped + alignedSize;
+            return offset;
+        }
+
+        // The ring is full. The pending uploads are submitted so that their space can be recycled.
+        if (m_submissions.empty())
+            submit();
+        if (m_submissions.empty())
+            return NoSpace; // Nothing to wait for, fall back to a dedicated buffer
+        ++m_stallCount;
+        m_submissions.front().fence.wait();
+        reclaim();
+    }
+}
+
+std::pair<DeviceSize, DeviceSize> StagingRing::placement(DeviceSize alignedSize, DeviceSize alignment) const noexcept
+{
+    // An allocation never straddles the end of the ring, the remainder is skipped
+    DeviceSize offset = alignUp(m_head, alignment);
+    if (offset + alignedSize > m_size)
+        offset = 0;
+    const DeviceSize skipped = offset >= m_head ? offset - m_head : m_size - m_head;
+    return { offset, skipped };
+}
+
+CommandRecorder &StagingRing::recorder()
+{
+    if (!m_recorder)
+        m_recorder.emplace(CommandRecorder(m_api, m_device, CommandRecorderOptions{ .queue = m_queue }));
+    return *m_recorder;
+}
+
+} // namespace KDGpu
@@ -0,0 +1,147 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/buffer.h>
+#include <KDGpu/command_buffer.h>
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/fence.h>
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/handle.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <deque>
+#include <optional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace KDGpu {
+
+class GraphicsApi;
+
+struct BufferUploadOptions;
+struct Device_t;
+struct GpuSemaphore_t;
+struct Queue_t;
+struct TextureUploadOptions;
+
+struct StagingRingStatistics {
+    DeviceSize capacity{ 0 }; // 0 until the first upload
+    DeviceSize usedBytes{ 0 }; // Pending and in flight uploads
+    uint32_t submissionsInFlight{ 0 };
+    uint64_t uploadCount{ 0 };
+    uint64_t submissionCount{ 0 };
+    uint64_t dedicatedBufferCount{ 0 }; // Uploads too large for the ring
+    uint64_t stallCount{ 0 }; // Times the ring was full and had to wait for the GPU
+};
+
+/**
+    @brief Persistently mapped staging memory shared by the uploads of a Queue
+    @ingroup public
+    @headerfile staging_ring.h <KDGpu/staging_ring.h>
+
+    Uploads are copied into a ring buffer and their copy commands are all
+    recorded into the same command buffer, which is submitted with a single
+    submission by submit(). The space used by a submission is reclaimed once its
+    fence has signalled. When the ring is full, the oldest submission is waited
+    upon; uploads larger than the whole ring use a dedicated staging buffer.
+
+    The staging buffer is only allocated on the first upload. A StagingRing is
+    not thread safe.
+
+    @sa Queue::stageBufferUpload
+ */
+class KDGPU_EXPORT StagingRing
+{
+public:
+    static constexpr DeviceSize DefaultSize = 16 * 1024 * 1024;
+
+    explicit StagingRing(GraphicsApi *api, const Handle<Device_t> &device, const Handle<Queue_t> &queue, DeviceSize size = DefaultSize);
+    ~StagingRing();
+
+    StagingRing(const StagingRing &) = delete;
+    StagingRing &operator=(const StagingRing &) = delete;
+
+    DeviceSize size() const noexcept { return m_size; }
+    bool hasPendingUploads() const noexcept { return m_recorder.has_value(); }
+    bool hasPendingUploadTo(const Handle<Buffer_t> &buffer) const { return m_pendingBuffers.contains(buffer); }
+
+    // Returns false if the data could be written directly into the buffer, without a copy
+    bool uploadBufferData(const BufferUploadOptions &options);
+    void uploadTextureData(const TextureUploadOptions &options);
+
+    // Ends the uploads with a queue family ownership release to dstQueueTypeIndex rather than with a
+    // barrier for options.dstStages. The matching acquire must be recorded on the destination queue.
+    void setQueueOwnershipTransfer(uint32_t srcQueueTypeIndex, uint32_t dstQueueTypeIndex);
+
+    // Submits the uploads recorded since the last submission, if any. The semaphores are
+    // signalled even if there is nothing to submit.
+    void submit(const std::vector<Handle<GpuSemaphore_t>> &signalSemaphores = {});
+
+    // Releases the space of the submissions which have completed
+    void reclaim();
+
+    // Whether an upload of byteSize bytes can be staged without waiting for the GPU. Uploads
+    // too large for the ring always can, they use a dedicated buffer.
+    bool canUploadWithoutWaiting(DeviceSize byteSize);
+
+    // Number of the submission which will carry the uploads recorded from now on
+    uint64_t pendingSubmission() const noexcept { return m_submissionCount + 1; }
+    // Whether a submission, as numbered by pendingSubmission(), has completed
+    bool hasCompleted(uint64_t submission);
+
+    // Waits for the submitted uploads and frees the staging memory. Pending uploads are dropped.
+    void release();
+
+    StagingRingStatistics statistics() const noexcept;
+
+private:
+    struct Submission {
+        Fence fence;
+        CommandBuffer commandBuffer;
+        DeviceSize byteSize; // Including the space skipped when wrapping around
+        std::vector<Buffer> dedicatedBuffers;
+    };
+
+    // Copies data into the ring and returns where it landed
+    std::pair<Handle<Buffer_t>, DeviceSize> stage(const void *data, DeviceSize byteSize, DeviceSize alignment);
+    DeviceSize allocate(DeviceSize byteSize, DeviceSize alignment);
+    // Where an allocation would land in the ring and how much space before it would be skipped
+    std::pair<DeviceSize, DeviceSize> placement(DeviceSize alignedSize, DeviceSize alignment) const noexcept;
+    bool releasesOwnership() const noexcept { return m_dstQueueTypeIndex != IgnoreQueueType && m_srcQueueTypeIndex != m_dstQueueTypeIndex; }
+    CommandRecorder &recorder();
+
+    GraphicsApi *m_api{ nullptr };
+    Handle<Device_t> m_device;
+    Handle<Queue_t> m_queue;
+    DeviceSize m_size{ 0 };
+    uint32_t m_srcQueueTypeIndex{ IgnoreQueueType };
+    uint32_t m_dstQueueTypeIndex{ IgnoreQueueType };
+
+    Buffer m_buffer;
+    uint8_t *m_mapped{ nullptr };
+    DeviceSize m_head{ 0 };
+    DeviceSize m_usedBytes{ 0 };
+    DeviceSize m_pendingBytes{ 0 };
+
+    std::optional<CommandRecorder> m_recorder;
+    std::vector<Buffer> m_pendingDedicatedBuffers;
+    std::unordered_set<Handle<Buffer_t>> m_pendingBuffers; // Destinations of the copies not submitted yet
+    std::deque<Submission> m_submissions;
+
+    uint64_t m_uploadCount{ 0 };
+    uint64_t m_submissionCount{ 0 };
+    uint64_t m_dedicatedBufferCount{ 0 };
+    uint64_t m_stallCount{ 0 };
+};
+
+} // namespace KDGpu
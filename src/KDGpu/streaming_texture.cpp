@@ -0,0 +1,192 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "streaming_texture.h"
+
+#include <KDGpu/device.h>
+#include <KDGpu/utils/logging.h>
+
+#include <algorithm>
+
+namespace KDGpu {
+
+StreamingTexture::StreamingTexture() = default;
+
+StreamingTexture::StreamingTexture(Device *device, const Queue &queue, const StreamingTextureOptions &options)
+    : m_queue(queue)
+    , m_textureOptions(options.textureOptions)
+    , m_levelData(options.levelData)
+    , m_viewType(options.viewType)
+    , m_dstStages(options.dstStages)
+    , m_dstMask(options.dstMask)
+{
+    if (m_levelData.size() != m_textureOptions.mipLevels || m_textureOptions.mipLevels == 0) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "StreamingTexture needs the data of each of its {} mip levels", m_textureOptions.mipLevels);
+        return;
+    }
+
+    m_textureOptions.usage = m_textureOptions.usage | TextureUsageFlagBits::TransferDstBit;
+    m_texture = device->createTexture(m_textureOptions);
+    m_mipLevels = m_textureOptions.mipLevels;
+    m_residentLevel = m_mipLevels;
+    m_submittedLevel = m_mipLevels;
+}
+
+StreamingTexture::StreamingTexture(StreamingTexture &&other)
+{
+    *this = std::move(other);
+}
+
+StreamingTexture &StreamingTexture::operator=(StreamingTexture &&other)
+{
+    if (this != &other) {
+        m_uploadsInFlight = std::move(other.m_uploadsInFlight);
+        m_view = std::move(other.m_view);
+        m_texture = std::move(other.m_texture);
+        m_queue = other.m_queue;
+        m_textureOptions = std::move(other.m_textureOptions);
+        m_levelData = std::move(other.m_levelData);
+        m_viewType = other.m_viewType;
+        m_dstStages = other.m_dstStages;
+        m_dstMask = other.m_dstMask;
+        m_mipLevels = other.m_mipLevels;
+        m_residentLevel = other.m_residentLevel;
+        m_submittedLevel = other.m_submittedLevel;
+        m_uploadedBytes = other.m_uploadedBytes;
+
+        other.m_uploadsInFlight.clear();
+        other.m_levelData.clear();
+        other.m_mipLevels = 0;
+        other.m_residentLevel = 0;
+        other.m_submittedLevel = 0;
+        other.m_uploadedBytes = 0;
+    }
+    return *this;
+}
+
+StreamingTexture::~StreamingTexture()
+{
+    // Copies into the texture must not be submitted after it is gone, its destruction is deferred past them
+    if (!m_uploadsInFlight.empty())
+        m_queue.submitStagedUploads();
+}
+
+bool StreamingTexture::update(DeviceSize byteBudget)
+{
+    if (!isValid())
+        return false;
+
+    const bool residencyChanged = retireCompletedUploads();
+
+    DeviceSize budgetLeft = byteBudget;
+    while (m_submittedLevel > 0) {
+        const uint32_t mipLevel = m_submittedLevel - 1;
+        const DeviceSize byteSize = m_levelData[mipLevel].size();
+        // Oversized levels go on their own, so that they cannot stall streaming forever
+        const bool fitsBudget = byteSize <= budgetLeft;
+        const bool oversizedAlone = budgetLeft == byteBudget && m_uploadsInFlight.empty();
+        if (!fitsBudget && !oversizedAlone)
+            break;
+
+        if (!uploadLevel(mipLevel))
+            break;
+        budgetLeft -= std::min(byteSize, budgetLeft);
+        if (!fitsBudget)
+            break;
+    }
+
+    return residencyChanged;
+}
+
+StreamingTextureStatistics StreamingTexture::statistics() const noexcept
+{
+    DeviceSize remainingBytes = 0;
+    for (uint32_t mipLevel = 0; mipLevel < m_submittedLevel; ++mipLevel)
+        remainingBytes += m_levelData[mipLevel].size();
+
+    return StreamingTextureStatistics{
+        .residentMipLevel = m_residentLevel,
+        .levelsInFlight = static_cast<uint32_t>(m_uploadsInFlight.size()),
+        .uploadedBytes = m_uploadedBytes,
+        .remainingBytes = remainingBytes
+    };
+}
+
+bool StreamingTexture::retireCompletedUploads()
+{
+    // Levels are submitted coarsest first on a single queue, they become resident in that order
+    const uint32_t previousResidentLevel = m_residentLevel;
+    auto firstPending = m_uploadsInFlight.begin();
+    while (firstPending != m_uploadsInFlight.end() && m_queue.hasStagedSubmissionCompleted(firstPending->submission)) {
+        m_residentLevel = firstPending->mipLevel;
+        ++firstPending;
+    }
+    m_uploadsInFlight.erase(m_uploadsInFlight.begin(), firstPending);
+
+    if (m_residentLevel == previousResidentLevel)
+        return false;
+
+    // The previous view may still be in use by frames in flight, its destruction is deferred
+    m_view = m_texture.createView(TextureViewOptions{
+            .viewType = m_viewType,
+            .format = m_textureOptions.format,
+            .range = {
+                    .aspectMask = TextureAspectFlagBits::ColorBit,
+                    .baseMipLevel = m_residentLevel,
+                    .levelCount = m_mipLevels - m_residentLevel,
+            },
+    });
+    return true;
+}
+
+bool StreamingTexture::uploadLevel(uint32_t mipLevel)
+{
+    const std::span<const uint8_t> data = m_levelData[mipLevel];
+    const Extent3D &extent = m_textureOptions.extent;
+    const bool is3D = m_textureOptions.type == TextureType::TextureType3D;
+
+    // Try again next frame rather than stall the frame until the staging ring drains
+    if (!m_queue.canStageUploadWithoutWaiting(data.size()))
+        return false;
+
+    m_queue.stageTextureUpload(TextureUploadOptions{
+            .destinationTexture = m_texture,
+            .dstStages = m_dstStages,
+            .dstMask = m_dstMask,
+            .data = data.data(),
+            .byteSize = data.size(),
+            .oldLayout = TextureLayout::Undefined,
+            .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+            .regions = {
+                    {
+                            .textureSubResource = {
+                                    .aspectMask = TextureAspectFlagBits::ColorBit,
+                                    .mipLevel = mipLevel,
+                                    .baseArrayLayer = 0,
+                                    .layerCount = is3D ? 1 : m_textureOptions.arrayLayers,
+                            },
+                            .textureExtent = {
+                                    .width = std::max(extent.width >> mipLevel, 1U),
+                                    .height = std::max(extent.height >> mipLevel, 1U),
+                                    .depth = is3D ? std::max(extent.depth >> mipLevel, 1U) : 1,
+                            },
+                    },
+            },
+    });
+
+    // Only known once staged, making room in the ring may have submitted the uploads staged before
+    const uint64_t submission = m_queue.pendingStagedSubmission();
+    m_uploadsInFlight.push_back(LevelUpload{ .mipLevel = mipLevel, .submission = submission });
+    m_uploadedBytes += data.size();
+    m_submittedLevel = mipLevel;
+    return true;
+}
+
+} // namespace KDGpu
@@ -0,0 +1,132 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/texture.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/texture_view.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <span>
+#include <vector>
+
+namespace KDGpu {
+
+class Device;
+
+struct StreamingTextureOptions {
+    TextureOptions textureOptions; // Describes the full mip chain, TransferDstBit is added to the usage
+    // The data of each mip level, all its array layers tightly packed one after the other.
+    // It must remain valid until update() has staged the level.
+    std::vector<std::span<const uint8_t>> levelData;
+    ViewType viewType{ ViewType::ViewType2D };
+    PipelineStageFlags dstStages{ PipelineStageFlagBit::FragmentShaderBit };
+    AccessFlags dstMask{ AccessFlagBit::ShaderReadBit };
+};
+
+struct StreamingTextureStatistics {
+    uint32_t residentMipLevel{ 0 }; // Finest level which can be sampled, mipLevels when none is resident yet
+    uint32_t levelsInFlight{ 0 };
+    DeviceSize uploadedBytes{ 0 };
+    DeviceSize remainingBytes{ 0 };
+};
+
+/**
+    @brief A texture whose mip levels are uploaded over several frames, coarsest first
+    @ingroup public
+    @headerfile streaming_texture.h <KDGpu/streaming_texture.h>
+
+    The full mip chain is allocated up front. Each call to update() stages the
+    next levels into the staging ring of the queue, starting with the mip tail
+    and moving to finer levels, as long as they fit within the byte budget of
+    the frame. A level larger than the whole budget is uploaded on its own once
+    no other level is in flight, so that streaming always makes progress. A
+    level which does not fit in the staging ring before earlier uploads have
+    completed is left for a later frame rather than waited upon. The staged
+    levels are submitted with the next Queue::submit().
+
+    Only the levels which have completed their upload are sampled, as view()
+    starts at the resident level. It changes as finer levels arrive, update()
+    returns true when bind groups using it need to be recreated.
+
+    @code{.cpp}
+    StreamingTexture texture = device.createStreamingTexture(queue, StreamingTextureOptions{
+            .textureOptions = ktx.textureOptions(),
+            .levelData = levels });
+
+    // Every frame
+    if (texture.update(256 * 1024))
+        bindGroup = createBindGroup(texture.view());
+    @endcode
+
+    @sa Device::createStreamingTexture
+ */
+class KDGPU_EXPORT StreamingTexture
+{
+public:
+    StreamingTexture();
+    ~StreamingTexture();
+
+    StreamingTexture(StreamingTexture &&);
+    StreamingTexture &operator=(StreamingTexture &&);
+
+    StreamingTexture(const StreamingTexture &) = delete;
+    StreamingTexture &operator=(const StreamingTexture &) = delete;
+
+    bool isValid() const noexcept { return m_texture.isValid(); }
+
+    const Texture &texture() const noexcept { return m_texture; }
+
+    // Covers the resident levels, invalid until the first level is resident
+    const TextureView &view() const noexcept { return m_view; }
+
+    bool isResident() const noexcept { return m_residentLevel < m_mipLevels; }
+    bool isFullyResident() const noexcept { return m_residentLevel == 0; }
+    uint32_t residentMipLevel() const noexcept { return m_residentLevel; }
+
+    // Retires the completed uploads and starts new ones worth at most byteBudget.
+    // Returns true if the resident level, and hence view(), has changed.
+    bool update(DeviceSize byteBudget);
+
+    StreamingTextureStatistics statistics() const noexcept;
+
+private:
+    explicit StreamingTexture(Device *device, const Queue &queue, const StreamingTextureOptions &options);
+
+    struct LevelUpload {
+        uint32_t mipLevel;
+        uint64_t submission; // Staged submission of the queue carrying the level
+    };
+
+    bool retireCompletedUploads();
+    bool uploadLevel(uint32_t mipLevel);
+
+    Queue m_queue;
+    Texture m_texture;
+    TextureView m_view;
+    TextureOptions m_textureOptions;
+    std::vector<std::span<const uint8_t>> m_levelData;
+    ViewType m_viewType{ ViewType::ViewType2D };
+    PipelineStageFlags m_dstStages;
+    AccessFlags m_dstMask;
+
+    uint32_t m_mipLevels{ 0 };
+    uint32_t m_residentLevel{ 0 }; // Levels [m_residentLevel, m_mipLevels) can be sampled
+    uint32_t m_submittedLevel{ 0 }; // Levels [m_submittedLevel, m_mipLevels) have been submitted
+    std::vector<LevelUpload> m_uploadsInFlight;
+    DeviceSize m_uploadedBytes{ 0 };
+
+    friend class Device;
+};
+
+} // namespace KDGpu
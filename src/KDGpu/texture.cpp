@@ -15,6 +15,8 @@
 #include <KDGpu/api/api_texture.h>
 #include <KDGpu/texture_options.h>
 #include <KDGpu/command_recorder.h>
+#include <KDGpu/device.h>
+#include <KDGpu/mipmap_generator.h>
 
 namespace KDGpu {
 
@@ -98,101 +100,31 @@ SubresourceLayout Texture::getSubresourceLayout(const TextureSubresource &subres
     return apiTexture->getSubresourceLayout(subresource);
 }
 
+/**
+    @brief Generates all the mip levels of the texture from its first one and waits for completion
+
+    Kept for convenience, all the levels are left in TextureLayout::TransferSrcOptimal.
+    Use a MipmapGenerator to record the generation into your own command buffers
+    or to avoid blocking.
+
+    @sa Device::createMipmapGenerator
+ */
 bool Texture::generateMipMaps(Device &device, Queue &transferQueue, const TextureOptions &options, TextureLayout oldLayout)
 {
-    const Adapter *adapter = device.adapter();
-    if (!adapter)
-        return false;
-
-    if (!adapter->supportsBlitting(options.format, options.tiling))
+    MipmapGenerator generator = device.createMipmapGenerator();
+    Fence fence = generator.generate(transferQueue, *this, options,
+                                     MipmapGenerationOptions{
+                                             .oldLayout = oldLayout,
+                                             .newLayout = TextureLayout::TransferSrcOptimal,
+                                             .srcStages = PipelineStageFlagBit::TransferBit,
+                                             .srcMask = AccessFlagBit::TransferWriteBit,
+                                             .dstStages = PipelineStageFlagBit::TransferBit,
+                                             .dstMask = AccessFlagBit::TransferReadBit,
+                                     });
+    if (!fence.isValid())
         return false;
 
-    CommandRecorder commandRecorder = device.createCommandRecorder();
-
-    // Transition base miplevel to TransferSrcOptimal
-    if (oldLayout != TextureLayout::TransferSrcOptimal)
-        commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
-                .srcStages = PipelineStageFlagBit::TransferBit,
-                .srcMask = AccessFlagBit::None,
-                .dstStages = PipelineStageFlagBit::TransferBit,
-                .dstMask = AccessFlagBit::TransferReadBit,
-                .oldLayout = oldLayout,
-                .newLayout = TextureLayout::TransferSrcOptimal,
-                .texture = m_texture,
-                .range = {
-                        .aspectMask = TextureAspectFlagBits::ColorBit,
-                        .baseMipLevel = 0,
-                        .levelCount = 1,
-                },
-        });
-
-    for (uint32_t mipLevel = 1; mipLevel < options.mipLevels; ++mipLevel) {
-
-        // Transition miplevel to TransforDstOptimal
-        commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
-                .srcStages = PipelineStageFlagBit::TransferBit,
-                .srcMask = AccessFlagBit::None,
-                .dstStages = PipelineStageFlagBit::TransferBit,
-                .dstMask = AccessFlagBit::TransferWriteBit,
-                .oldLayout = TextureLayout::Undefined,
-                .newLayout = TextureLayout::TransferDstOptimal,
-                .texture = m_texture,
-                .range = {
-                        .aspectMask = TextureAspectFlagBits::ColorBit,
-                        .baseMipLevel = mipLevel,
-                        .levelCount = 1,
-                },
-        });
-
-        // Blit main mip level into sub level
-        commandRecorder.blitTexture(TextureBlitOptions{
-                .srcTexture = m_texture,
-                .srcLayout = TextureLayout::TransferSrcOptimal,
-                .dstTexture = m_texture,
-                .dstLayout = TextureLayout::TransferDstOptimal,
-                .regions = {
-                        {
-                                .srcSubresource = {
-                                        .aspectMask = TextureAspectFlagBits::ColorBit,
-                                        .mipLevel = 0,
-                                },
-                                .srcOffset = {
-                                        .x = 0,
-                                        .y = 0,
-                                        .z = 0,
-                                },
-                                .srcExtent = {
-                                        .width = options.extent.width,
-                                        .height = options.extent.height,
-                                        .depth = 1,
-                                },
-                                .dstSubresource = {
-                                        .aspectMask = TextureAspectFlagBits::ColorBit,
-                                        .mipLevel = mipLevel,
-                                },
-                                .dstOffset = {
-                                        .x = 0,
-                                        .y = 0,
-                                        .z = 0,
-                                },
-                                .dstExtent = {
-                                        .width = (options.extent.width >> mipLevel),
-                                        .height = (options.extent.height >> mipLevel),
-                                        .depth = 1,
-                                },
-                        },
-                },
-                .scalingFilter = FilterMode::Linear,
-        });
-    }
-
-    CommandBuffer commandBuffer = commandRecorder.finish();
-
-    transferQueue.submit(SubmitOptions{
-            .commandBuffers = { commandBuffer },
-    });
-
-    transferQueue.waitUntilIdle();
+    fence.wait();
     return true;
 }
 
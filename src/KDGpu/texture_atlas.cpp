@@ -0,0 +1,373 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "texture_atlas.h"
+
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/device.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/utils/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace KDGpu {
+
+namespace {
+
+// Size in bytes of a texel of the uncompressed color formats which can be packed, 0 for the others
+uint32_t texelSize(Format format)
+{
+    switch (format) {
+    case Format::R8_UNORM:
+    case Format::R8_SNORM:
+    case Format::R8_UINT:
+    case Format::R8_SINT:
+    case Format::R8_SRGB:
+        return 1;
+    case Format::R8G8_UNORM:
+    case Format::R8G8_SNORM:
+    case Format::R8G8_UINT:
+    case Format::R8G8_SINT:
+    case Format::R8G8_SRGB:
+    case Format::R16_UNORM:
+    case Format::R16_SFLOAT:
+        return 2;
+    case Format::R8G8B8A8_UNORM:
+    case Format::R8G8B8A8_SNORM:
+    case Format::R8G8B8A8_UINT:
+    case Format::R8G8B8A8_SINT:
+    case Format::R8G8B8A8_SRGB:
+    case Format::B8G8R8A8_UNORM:
+    case Format::B8G8R8A8_SRGB:
+    case Format::R16G16_SFLOAT:
+    case Format::R32_SFLOAT:
+    case Format::R32_UINT:
+        return 4;
+    case Format::R16G16B16A16_UNORM:
+    case Format::R16G16B16A16_SFLOAT:
+    case Format::R32G32_SFLOAT:
+        return 8;
+    case Format::R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+TextureAtlas::TextureAtlas() = default;
+
+TextureAtlas::TextureAtlas(Device *device, const Queue &queue, const TextureAtlasOptions &options)
+    : m_queue(queue)
+    , m_format(options.format)
+    , m_extent(options.extent)
+    , m_texelSize(texelSize(options.format))
+    , m_padding(options.padding)
+    , m_dstStages(options.dstStages)
+    , m_dstMask(options.dstMask)
+{
+    if (m_texelSize == 0 || m_extent.width == 0 || m_extent.height == 0 || options.layerCount == 0) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "TextureAtlas needs a non empty extent and an uncompressed color format");
+        return;
+    }
+
+    m_texture = device->createTexture(TextureOptions{
+            .type = TextureType::TextureType2D,
+            .format = m_format,
+            .extent = { m_extent.width, m_extent.height, 1 },
+            .mipLevels = 1,
+            .arrayLayers = options.layerCount,
+            .usage = options.usage | TextureUsageFlagBits::TransferDstBit,
+            .memoryUsage = MemoryUsage::GpuOnly,
+    });
+    if (!m_texture.isValid())
+        return;
+
+    const TextureSubresourceRange fullRange = {
+        .aspectMask = TextureAspectFlagBits::ColorBit,
+        .levelCount = 1,
+        .layerCount = options.layerCount,
+    };
+    m_view = m_texture.createView(TextureViewOptions{
+            .viewType = options.layerCount > 1 ? ViewType::ViewType2DArray : ViewType::ViewType2D,
+            .format = m_format,
+            .range = fullRange,
+    });
+
+    // Every upload covers several layers, some of which may not have been written yet. Moving
+    // them all to their sampled layout once means uploads never discard what is already there.
+    CommandRecorder commandRecorder = device->createCommandRecorder({ .queue = queue });
+    commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+            .srcStages = PipelineStageFlagBit::TopOfPipeBit,
+            .dstStages = m_dstStages,
+            .dstMask = m_dstMask,
+            .oldLayout = TextureLayout::Undefined,
+            .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+            .texture = m_texture,
+            .range = fullRange,
+    });
+    UploadStagingBuffer transition{ .fence = device->createFence({ .createSignalled = false }) };
+    transition.commandBuffer = commandRecorder.finish();
+    m_queue.submit(SubmitOptions{
+            .commandBuffers = { transition.commandBuffer },
+            .signalFence = transition.fence,
+    });
+    m_uploadsInFlight.push_back(std::move(transition));
+
+    m_skylines.resize(options.layerCount);
+    for (std::vector<SkylineNode> &skyline : m_skylines)
+        skyline.push_back(SkylineNode{ .x = 0, .y = 0, .width = static_cast<int32_t>(m_extent.width) });
+}
+
+TextureAtlas::TextureAtlas(TextureAtlas &&other)
+{
+    *this = std::move(other);
+}
+
+TextureAtlas &TextureAtlas::operator=(TextureAtlas &&other)
+{
+    if (this != &other) {
+        // Our own copies may still be reading their staging buffers and writing the texture
+        waitForUploadsInFlight();
+
+        m_uploadsInFlight = std::move(other.m_uploadsInFlight);
+        m_view = std::move(other.m_view);
+        m_texture = std::move(other.m_texture);
+        m_queue = other.m_queue;
+        m_format = other.m_format;
+        m_extent = other.m_extent;
+        m_texelSize = other.m_texelSize;
+        m_padding = other.m_padding;
+        m_dstStages = other.m_dstStages;
+        m_dstMask = other.m_dstMask;
+        m_skylines = std::move(other.m_skylines);
+        m_imageCount = other.m_imageCount;
+        m_usedArea = other.m_usedArea;
+        m_pendingData = std::move(other.m_pendingData);
+        m_pendingRegions = std::move(other.m_pendingRegions);
+        m_uploadCount = other.m_uploadCount;
+
+        other.m_uploadsInFlight.clear();
+        other.m_skylines.clear();
+        other.m_pendingData.clear();
+        other.m_pendingRegions.clear();
+        other.m_imageCount = 0;
+        other.m_usedArea = 0;
+        other.m_uploadCount = 0;
+    }
+    return *this;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    waitForUploadsInFlight();
+}
+
+TextureAtlasRegion TextureAtlas::add(const void *data, uint32_t width, uint32_t height)
+{
+    if (!isValid() || data == nullptr || width == 0 || height == 0)
+        return {};
+
+    if (width > m_extent.width || height > m_extent.height)
+        return {};
+
+    // The padding is only reserved to the right and below, the neighbours provide the rest
+    const int32_t paddedWidth = static_cast<int32_t>(std::min(width + m_padding, m_extent.width));
+    const int32_t paddedHeight = static_cast<int32_t>(std::min(height + m_padding, m_extent.height));
+
+    for (uint32_t layer = 0; layer < m_skylines.size(); ++layer) {
+        std::vector<SkylineNode> &skyline = m_skylines[layer];
+        size_t nodeIndex = 0;
+        Offset2D offset;
+        if (!findPosition(skyline, paddedWidth, paddedHeight, nodeIndex, offset))
+            continue;
+
+        addSkylineLevel(skyline, nodeIndex, offset, paddedWidth, paddedHeight);
+        ++m_imageCount;
+        m_usedArea += static_cast<uint64_t>(paddedWidth) * static_cast<uint64_t>(paddedHeight);
+
+        // Offsets into the staging buffer must be a multiple of both the texel size and 4
+        const DeviceSize byteSize = static_cast<DeviceSize>(width) * height * m_texelSize;
+        const DeviceSize alignment = std::max<DeviceSize>(m_texelSize, 4);
+        const DeviceSize bufferOffset = (m_pendingData.size() + alignment - 1) / alignment * alignment;
+        m_pendingData.resize(bufferOffset + byteSize);
+        std::memcpy(m_pendingData.data() + bufferOffset, data, byteSize);
+
+        m_pendingRegions.push_back(BufferTextureCopyRegion{
+                .bufferOffset = bufferOffset,
+                .textureSubResource = {
+                        .aspectMask = TextureAspectFlagBits::ColorBit,
+                        .mipLevel = 0,
+                        .baseArrayLayer = layer,
+                        .layerCount = 1,
+                },
+                .textureOffset = { .x = offset.x, .y = offset.y, .z = 0 },
+                .textureExtent = { .width = width, .height = height, .depth = 1 },
+        });
+
+        const float atlasWidth = static_cast<float>(m_extent.width);
+        const float atlasHeight = static_cast<float>(m_extent.height);
+        return TextureAtlasRegion{
+            .layer = layer,
+            .offset = offset,
+            .extent = { width, height },
+            .uvOffset = { static_cast<float>(offset.x) / atlasWidth, static_cast<float>(offset.y) / atlasHeight },
+            .uvScale = { static_cast<float>(width) / atlasWidth, static_cast<float>(height) / atlasHeight },
+        };
+    }
+
+    return {};
+}
+
+bool TextureAtlas::upload()
+{
+    retireCompletedUploads();
+    if (!isValid() || m_pendingRegions.empty())
+        return false;
+
+    // Draws submitted earlier may still be sampling the atlas, the copy must wait for them
+    UploadStagingBuffer upload = m_queue.uploadTextureData(TextureUploadOptions{
+            .destinationTexture = m_texture,
+            .dstStages = m_dstStages,
+            .dstMask = m_dstMask,
+            .data = m_pendingData.data(),
+            .byteSize = m_pendingData.size(),
+            .oldLayout = TextureLayout::ShaderReadOnlyOptimal,
+            .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+            .regions = std::move(m_pendingRegions),
+            .srcStages = m_dstStages,
+            .srcMask = m_dstMask,
+    });
+    m_uploadsInFlight.push_back(std::move(upload));
+    ++m_uploadCount;
+
+    m_pendingData.clear();
+    m_pendingRegions.clear();
+    return true;
+}
+
+void TextureAtlas::clear()
+{
+    for (std::vector<SkylineNode> &skyline : m_skylines) {
+        skyline.clear();
+        skyline.push_back(SkylineNode{ .x = 0, .y = 0, .width = static_cast<int32_t>(m_extent.width) });
+    }
+    m_imageCount = 0;
+    m_usedArea = 0;
+    m_pendingData.clear();
+    m_pendingRegions.clear();
+}
+
+TextureAtlasStatistics TextureAtlas::statistics() const noexcept
+{
+    uint32_t layersInUse = 0;
+    for (const std::vector<SkylineNode> &skyline : m_skylines) {
+        const bool empty = skyline.size() == 1 && skyline.front().y == 0;
+        if (!empty)
+            ++layersInUse;
+    }
+
+    const uint64_t totalArea = static_cast<uint64_t>(m_extent.width) * m_extent.height * m_skylines.size();
+    return TextureAtlasStatistics{
+        .imageCount = m_imageCount,
+        .layersInUse = layersInUse,
+        .occupancy = totalArea > 0 ? static_cast<float>(m_usedArea) / static_cast<float>(totalArea) : 0.0f,
+        .pendingImageCount = static_cast<uint32_t>(m_pendingRegions.size()),
+        .pendingBytes = m_pendingData.size(),
+        .uploadCount = m_uploadCount
+    };
+}
+
+bool TextureAtlas::findPosition(const std::vector<SkylineNode> &skyline, int32_t width, int32_t height,
+                                size_t &nodeIndex, Offset2D &offset) const
+{
+    // Bottom-left rule: lowest top edge first, then the narrowest node to limit wasted space
+    const int32_t atlasWidth = static_cast<int32_t>(m_extent.width);
+    const int32_t atlasHeight = static_cast<int32_t>(m_extent.height);
+    int32_t bestTop = std::numeric_limits<int32_t>::max();
+    int32_t bestWidth = std::numeric_limits<int32_t>::max();
+    bool found = false;
+
+    for (size_t i = 0; i < skyline.size(); ++i) {
+        const int32_t x = skyline[i].x;
+        if (x + width > atlasWidth)
+            break;
+
+        // The image rests on the highest of the nodes it spans
+        int32_t y = 0;
+        int32_t widthLeft = width;
+        for (size_t j = i; widthLeft > 0; ++j) {
+            y = std::max(y, skyline[j].y);
+            widthLeft -= skyline[j].width;
+        }
+        if (y + height > atlasHeight)
+            continue;
+
+        if (y + height < bestTop || (y + height == bestTop && skyline[i].width < bestWidth)) {
+            bestTop = y + height;
+            bestWidth = skyline[i].width;
+            nodeIndex = i;
+            offset = Offset2D{ .x = x, .y = y };
+            found = true;
+        }
+    }
+    return found;
+}
+
+void TextureAtlas::addSkylineLevel(std::vector<SkylineNode> &skyline, size_t nodeIndex, const Offset2D &offset,
+                                   int32_t width, int32_t height)
+{
+    skyline.insert(skyline.begin() + nodeIndex, SkylineNode{ .x = offset.x, .y = offset.y + height, .width = width });
+
+    // Shrink or drop the nodes now covered by the new one
+    for (size_t i = nodeIndex + 1; i < skyline.size();) {
+        const SkylineNode &previous = skyline[i - 1];
+        SkylineNode &node = skyline[i];
+        const int32_t overlap = previous.x + previous.width - node.x;
+        if (overlap <= 0)
+            break;
+        if (overlap < node.width) {
+            node.x += overlap;
+            node.width -= overlap;
+            break;
+        }
+        skyline.erase(skyline.begin() + i);
+    }
+
+    // Merge neighbours at the same height
+    for (size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void TextureAtlas::retireCompletedUploads()
+{
+    std::erase_if(m_uploadsInFlight, [](UploadStagingBuffer &upload) {
+        return upload.fence.status() == FenceStatus::Signalled;
+    });
+}
+
+void TextureAtlas::waitForUploadsInFlight()
+{
+    // The staging buffers must outlive the copies reading them
+    for (UploadStagingBuffer &upload : m_uploadsInFlight)
+        upload.fence.wait();
+    m_uploadsInFlight.clear();
+}
+
+} // namespace KDGpu
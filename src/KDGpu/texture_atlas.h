@@ -0,0 +1,158 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/texture.h>
+#include <KDGpu/texture_view.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <array>
+#include <vector>
+
+namespace KDGpu {
+
+class Device;
+
+struct TextureAtlasOptions {
+    Format format{ Format::R8G8B8A8_UNORM }; // Only uncompressed color formats can be packed
+    Extent2D extent{ 2048, 2048 };
+    uint32_t layerCount{ 1 }; // More than one layer creates a texture array
+    uint32_t padding{ 1 }; // Texels kept free between images, so that filtering does not bleed
+    TextureUsageFlags usage{ TextureUsageFlagBits::SampledBit }; // TransferDstBit is always added
+    PipelineStageFlags dstStages{ PipelineStageFlagBit::FragmentShaderBit };
+    AccessFlags dstMask{ AccessFlagBit::ShaderReadBit };
+};
+
+/**
+    @brief Where an image has been placed in a TextureAtlas
+    @ingroup public
+    @headerfile texture_atlas.h <KDGpu/texture_atlas.h>
+
+    The normalized coordinates of the image map to the atlas as
+    uv * uvScale + uvOffset, in array layer layer.
+ */
+struct TextureAtlasRegion {
+    uint32_t layer{ 0 };
+    Offset2D offset{};
+    Extent2D extent{ 0, 0 };
+    std::array<float, 2> uvOffset{ 0.0f, 0.0f };
+    std::array<float, 2> uvScale{ 0.0f, 0.0f };
+
+    bool isValid() const noexcept { return extent.width > 0 && extent.height > 0; }
+};
+
+struct TextureAtlasStatistics {
+    uint32_t imageCount{ 0 };
+    uint32_t layersInUse{ 0 };
+    float occupancy{ 0.0f }; // Fraction of the texels of all the layers covered by images and their padding
+    uint32_t pendingImageCount{ 0 };
+    DeviceSize pendingBytes{ 0 };
+    uint64_t uploadCount{ 0 };
+};
+
+/**
+    @brief Packs many small images into a single 2D texture or texture array
+    @ingroup public
+    @headerfile texture_atlas.h <KDGpu/texture_atlas.h>
+
+    Images are placed with a bottom-left skyline packer, filling the layers in
+    order. add() only copies the texels into a staging area, all the images
+    added since the last call are then transferred by upload() with a single
+    copy submission. Every image can then be sampled through view() with the
+    UV transform and layer of its TextureAtlasRegion, so that a single bind
+    group covers all of them.
+
+    Images cannot be removed individually, clear() makes the whole atlas
+    available again once nothing is drawn from the previous regions anymore.
+
+    @code{.cpp}
+    TextureAtlas atlas = device.createTextureAtlas(queue, TextureAtlasOptions{ .layerCount = 4 });
+    for (Icon &icon : icons)
+        icon.region = atlas.add(icon.pixels.data(), icon.width, icon.height);
+    atlas.upload();
+    @endcode
+
+    @sa Device::createTextureAtlas
+ */
+class KDGPU_EXPORT TextureAtlas
+{
+public:
+    TextureAtlas();
+    ~TextureAtlas();
+
+    TextureAtlas(TextureAtlas &&);
+    TextureAtlas &operator=(TextureAtlas &&);
+
+    TextureAtlas(const TextureAtlas &) = delete;
+    TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+    bool isValid() const noexcept { return m_texture.isValid(); }
+
+    const Texture &texture() const noexcept { return m_texture; }
+    const TextureView &view() const noexcept { return m_view; } // 2D array view when there are several layers
+    Extent2D extent() const noexcept { return m_extent; }
+    uint32_t layerCount() const noexcept { return static_cast<uint32_t>(m_skylines.size()); }
+
+    // Finds room for a tightly packed width x height image in the format of the atlas and
+    // stages its texels. Returns an invalid region if no layer has enough room left.
+    TextureAtlasRegion add(const void *data, uint32_t width, uint32_t height);
+
+    bool hasPendingUploads() const noexcept { return !m_pendingRegions.empty(); }
+
+    // Transfers all the pending images in a single submission. Returns false if there was nothing to upload.
+    bool upload();
+
+    // Forgets all the regions, the texture keeps its contents until they are overwritten
+    void clear();
+
+    TextureAtlasStatistics statistics() const noexcept;
+
+private:
+    explicit TextureAtlas(Device *device, const Queue &queue, const TextureAtlasOptions &options);
+
+    struct SkylineNode {
+        int32_t x;
+        int32_t y;
+        int32_t width;
+    };
+
+    bool findPosition(const std::vector<SkylineNode> &skyline, int32_t width, int32_t height,
+                      size_t &nodeIndex, Offset2D &offset) const;
+    void addSkylineLevel(std::vector<SkylineNode> &skyline, size_t nodeIndex, const Offset2D &offset,
+                         int32_t width, int32_t height);
+    void retireCompletedUploads();
+    void waitForUploadsInFlight();
+
+    Queue m_queue;
+    Texture m_texture;
+    TextureView m_view;
+    Format m_format{ Format::UNDEFINED };
+    Extent2D m_extent{ 0, 0 };
+    uint32_t m_texelSize{ 0 };
+    uint32_t m_padding{ 0 };
+    PipelineStageFlags m_dstStages;
+    AccessFlags m_dstMask;
+
+    std::vector<std::vector<SkylineNode>> m_skylines; // One per layer
+    uint32_t m_imageCount{ 0 };
+    uint64_t m_usedArea{ 0 };
+
+    std::vector<uint8_t> m_pendingData;
+    std::vector<BufferTextureCopyRegion> m_pendingRegions;
+    std::vector<UploadStagingBuffer> m_uploadsInFlight;
+    uint64_t m_uploadCount{ 0 };
+
+    friend class Device;
+};
+
+} // namespace KDGpu
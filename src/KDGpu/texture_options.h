@@ -11,11 +11,14 @@
 #pragma once
 
 #include <KDGpu/gpu_core.h>
+#include <KDGpu/handle.h>
 
 #include <vector>
 
 namespace KDGpu {
 
+struct MemoryPool_t;
+
 struct TextureOptions {
     TextureType type;
     Format format;
@@ -29,6 +32,7 @@ struct TextureOptions {
     SharingMode sharingMode{ SharingMode::Exclusive };
     std::vector<uint32_t> queueTypeIndices{};
     TextureLayout initialLayout{ TextureLayout::Undefined };
+    Handle<MemoryPool_t> memoryPool{}; // Allocate from this pool rather than from the default ones
     // TODO: TextureFlags flags;
 };
 
@@ -20,6 +20,8 @@ struct TextureViewOptions {
     ViewType viewType{ ViewType::ViewType2D };
     Format format{ Format::UNDEFINED };
     TextureSubresourceRange range{};
+
+    friend bool operator==(const TextureViewOptions &, const TextureViewOptions &) = default;
 };
 
 } // namespace KDGpu
@@ -0,0 +1,151 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "transient_buffer_allocator.h"
+
+#include <KDGpu/adapter.h>
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/device.h>
+#include <KDGpu/fence.h>
+#include <KDGpu/utils/logging.h>
+
+#include <algorithm>
+
+namespace KDGpu {
+
+namespace {
+
+DeviceSize alignUp(DeviceSize value, DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+TransientBufferAllocator::TransientBufferAllocator() = default;
+
+TransientBufferAllocator::TransientBufferAllocator(Device *device, const TransientBufferAllocatorOptions &options)
+{
+    if (options.framesInFlight == 0 || options.sizePerFrame == 0)
+        return;
+
+    // Every sub-allocation must be usable as a dynamic offset for the bindings the buffer is used with
+    const AdapterLimits &limits = device->adapter()->properties().limits;
+    DeviceSize alignment = 1;
+    if (options.usage.testFlag(BufferUsageFlagBits::UniformBufferBit))
+        alignment = std::max(alignment, limits.minUniformBufferOffsetAlignment);
+    if (options.usage.testFlag(BufferUsageFlagBits::StorageBufferBit))
+        alignment = std::max(alignment, limits.minStorageBufferOffsetAlignment);
+
+    m_alignment = alignment;
+    m_regionSize = alignUp(options.sizePerFrame, m_alignment);
+    m_framesInFlight = options.framesInFlight;
+
+    m_buffer = device->createBuffer(BufferOptions{
+            .size = m_regionSize * m_framesInFlight,
+            .usage = options.usage,
+            .memoryUsage = options.memoryUsage,
+            .persistentlyMapped = true });
+
+    m_mapped = static_cast<uint8_t *>(m_buffer.mappedData());
+    if (!m_mapped) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "TransientBufferAllocator requires host visible memory");
+        m_buffer = {};
+    }
+}
+
+TransientBufferAllocator::TransientBufferAllocator(TransientBufferAllocator &&other)
+{
+    *this = std::move(other);
+}
+
+TransientBufferAllocator &TransientBufferAllocator::operator=(TransientBufferAllocator &&other)
+{
+    if (this != &other) {
+        m_buffer = std::move(other.m_buffer);
+        m_mapped = other.m_mapped;
+        m_alignment = other.m_alignment;
+        m_regionSize = other.m_regionSize;
+        m_framesInFlight = other.m_framesInFlight;
+        m_currentRegion = other.m_currentRegion;
+        m_head = other.m_head;
+        m_peakUsedBytes = other.m_peakUsedBytes;
+        m_allocationCount = other.m_allocationCount;
+        m_failedAllocationCount = other.m_failedAllocationCount;
+
+        other.m_mapped = nullptr;
+        other.m_alignment = 1;
+        other.m_regionSize = 0;
+        other.m_framesInFlight = 0;
+        other.m_currentRegion = 0;
+        other.m_head = 0;
+        other.m_peakUsedBytes = 0;
+        other.m_allocationCount = 0;
+        other.m_failedAllocationCount = 0;
+    }
+    return *this;
+}
+
+TransientBufferAllocator::~TransientBufferAllocator() = default;
+
+void TransientBufferAllocator::beginFrame()
+{
+    if (!isValid())
+        return;
+    m_currentRegion = (m_currentRegion + 1) % m_framesInFlight;
+    m_head = 0;
+}
+
+void TransientBufferAllocator::beginFrame(Fence &frameFence)
+{
+    if (frameFence.isValid() && frameFence.status() != FenceStatus::Signalled)
+        frameFence.wait();
+    beginFrame();
+}
+
+TransientAllocation TransientBufferAllocator::allocate(DeviceSize size)
+{
+    const DeviceSize offset = alignUp(m_head, m_alignment);
+    if (!isValid() || size == 0 || offset + size > m_regionSize) {
+        ++m_failedAllocationCount;
+        return {};
+    }
+
+    m_head = offset + size;
+    m_peakUsedBytes = std::max(m_peakUsedBytes, m_head);
+    ++m_allocationCount;
+
+    const DeviceSize bufferOffset = m_currentRegion * m_regionSize + offset;
+    return TransientAllocation{
+        .buffer = m_buffer,
+        .offset = bufferOffset,
+        .size = size,
+        .data = m_mapped + bufferOffset
+    };
+}
+
+void TransientBufferAllocator::flush()
+{
+    if (!isValid() || m_head == 0)
+        return;
+    m_buffer.flush(m_currentRegion * m_regionSize, m_head);
+}
+
+TransientBufferAllocatorStatistics TransientBufferAllocator::statistics() const noexcept
+{
+    return TransientBufferAllocatorStatistics{
+        .usedBytes = m_head,
+        .peakUsedBytes = m_peakUsedBytes,
+        .allocationCount = m_allocationCount,
+        .failedAllocationCount = m_failedAllocationCount
+    };
+}
+
+} // namespace KDGpu
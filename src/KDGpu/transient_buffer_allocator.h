@@ -0,0 +1,152 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/bind_group_description.h>
+#include <KDGpu/buffer.h>
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/handle.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace KDGpu {
+
+class Device;
+class Fence;
+
+struct TransientBufferAllocatorOptions {
+    DeviceSize sizePerFrame{ 1024 * 1024 };
+    uint32_t framesInFlight{ 2 };
+    BufferUsageFlags usage{ BufferUsageFlagBits::UniformBufferBit };
+    MemoryUsage memoryUsage{ MemoryUsage::CpuToGpu };
+};
+
+/**
+    @brief A sub-allocation handed out by a TransientBufferAllocator
+    @ingroup public
+    @headerfile transient_buffer_allocator.h <KDGpu/transient_buffer_allocator.h>
+
+    Only valid until the allocator recycles the frame it was allocated in.
+ */
+struct TransientAllocation {
+    Handle<Buffer_t> buffer;
+    DeviceSize offset{ 0 };
+    DeviceSize size{ 0 };
+    void *data{ nullptr };
+
+    bool isValid() const noexcept { return data != nullptr; }
+
+    // To be passed to setBindGroup() for a DynamicUniformBufferBinding of the allocator's buffer
+    uint32_t dynamicOffset() const noexcept { return static_cast<uint32_t>(offset); }
+};
+
+struct TransientBufferAllocatorStatistics {
+    DeviceSize usedBytes{ 0 }; // In the current frame
+    DeviceSize peakUsedBytes{ 0 }; // Over all frames
+    uint64_t allocationCount{ 0 };
+    uint64_t failedAllocationCount{ 0 };
+};
+
+/**
+    @brief Linear allocator for per frame uniform and dynamic data
+    @ingroup public
+    @headerfile transient_buffer_allocator.h <KDGpu/transient_buffer_allocator.h>
+
+    Owns a single persistently mapped buffer split into one region per frame in
+    flight. Allocations are bumped linearly within the region of the current frame
+    and aligned to the minimum offset alignment of the buffer usage, so they can be
+    used as dynamic offsets into a single DynamicUniformBufferBinding. Allocating
+    therefore never creates buffers nor bind groups.
+
+    A region is recycled as a whole when beginFrame() comes back to it,
+    framesInFlight frames later, once the fence of the frame which last used it
+    has signalled.
+ */
+class KDGPU_EXPORT TransientBufferAllocator
+{
+public:
+    TransientBufferAllocator();
+    ~TransientBufferAllocator();
+
+    TransientBufferAllocator(TransientBufferAllocator &&);
+    TransientBufferAllocator &operator=(TransientBufferAllocator &&);
+
+    TransientBufferAllocator(const TransientBufferAllocator &) = delete;
+    TransientBufferAllocator &operator=(const TransientBufferAllocator &) = delete;
+
+    bool isValid() const noexcept { return m_buffer.isValid(); }
+
+    const Buffer &buffer() const noexcept { return m_buffer; }
+    DeviceSize alignment() const noexcept { return m_alignment; }
+    DeviceSize regionSize() const noexcept { return m_regionSize; }
+    uint32_t framesInFlight() const noexcept { return m_framesInFlight; }
+    uint32_t currentFrameIndex() const noexcept { return m_currentRegion; }
+
+    // Switches to the region of the next frame in flight and recycles it. The caller
+    // must have waited for the submission of the frame which last used that region.
+    void beginFrame();
+
+    // Same as above but waits for frameFence first. frameFence must be the fence
+    // signalled by the frame which last used the region and must not have been reset since.
+    void beginFrame(Fence &frameFence);
+
+    // Returns an invalid allocation if the region of the current frame is exhausted
+    TransientAllocation allocate(DeviceSize size);
+
+    TransientAllocation upload(const void *data, DeviceSize size)
+    {
+        TransientAllocation allocation = allocate(size);
+        if (allocation.isValid())
+            std::memcpy(allocation.data, data, size);
+        return allocation;
+    }
+
+    template<typename T>
+    TransientAllocation upload(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be uploaded");
+        return upload(&value, sizeof(T));
+    }
+
+    // Makes the writes of the current frame visible to the device. Only needed for
+    // memory which is not host coherent, call it before submitting the frame.
+    void flush();
+
+    // Binding covering elementSize bytes, to be offset with TransientAllocation::dynamicOffset()
+    DynamicUniformBufferBinding dynamicUniformBufferBinding(uint32_t elementSize) const
+    {
+        return DynamicUniformBufferBinding{ .buffer = m_buffer, .offset = 0, .size = elementSize };
+    }
+
+    TransientBufferAllocatorStatistics statistics() const noexcept;
+
+private:
+    explicit TransientBufferAllocator(Device *device, const TransientBufferAllocatorOptions &options);
+
+    Buffer m_buffer;
+    uint8_t *m_mapped{ nullptr };
+    DeviceSize m_alignment{ 1 };
+    DeviceSize m_regionSize{ 0 };
+    uint32_t m_framesInFlight{ 0 };
+    uint32_t m_currentRegion{ 0 };
+    DeviceSize m_head{ 0 }; // Relative to the start of the current region
+
+    DeviceSize m_peakUsedBytes{ 0 };
+    uint64_t m_allocationCount{ 0 };
+    uint64_t m_failedAllocationCount{ 0 };
+
+    friend class Device;
+};
+
+} // namespace KDGpu
@@ -0,0 +1,276 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include "handle.h"
+#include "pool_statistics.h"
+
+#include <assert.h>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace KDGpu {
+
+/**
+ * @brief TransientPool
+ * @internal
+ *
+ * A bump allocating arena for short lived objects such as command recorders,
+ * which are created and destroyed every frame.
+ *
+ * Entries are appended at the end of the arena and are never recycled
+ * individually. Once the last alive entry has been removed, which happens when
+ * all the recording of a frame is done, the whole arena is rewound at once and
+ * its storage is reused for the next frame. After the first few frames no more
+ * memory is allocated.
+ *
+ * Entries which outlive their frame, such as a recorder kept alive across frames,
+ * prevent that rewind. When the end of the arena is reached while at least half
+ * of it is free, the arena wraps around instead of growing and the following
+ * entries fill the free slots from the beginning, stepping over the alive ones.
+ * Its size is then bounded by twice the number of alive entries.
+ *
+ * Handles are generation checked like those of Pool. Every rewind or wrap around
+ * starts a new epoch and entries are stamped with the epoch they were created in,
+ * so a handle from a previous frame never resolves to an entry of the current one.
+ *
+ * Entries live in fixed size chunks, so pointers to them remain valid while new
+ * entries are added. Unlike Pool, removing an entry calls its destructor.
+ */
+template<typename T, typename H>
+class TransientPool
+{
+public:
+    static constexpr uint32_t ChunkSizeLog2 = 5;
+    static constexpr uint32_t ChunkSize = 1U << ChunkSizeLog2;
+
+    TransientPool() noexcept
+        : m_chunks(), m_top(0), m_usedSlotCount(0), m_liveCount(0), m_epoch(1), m_highWaterMark(0), m_insertCount(0), m_reuseCount(0)
+    {
+    }
+
+    explicit TransientPool(uint32_t size)
+        : TransientPool()
+    {
+        reserve(size);
+    }
+
+    ~TransientPool()
+    {
+        destroyAll();
+    }
+
+    TransientPool(TransientPool const &other) = delete;
+    TransientPool &operator=(TransientPool const &other) = delete;
+
+    TransientPool(TransientPool &&other) noexcept
+        : m_chunks(std::move(other.m_chunks))
+        , m_top(other.m_top)
+        , m_usedSlotCount(other.m_usedSlotCount)
+        , m_liveCount(other.m_liveCount)
+        , m_epoch(other.m_epoch)
+        , m_highWaterMark(other.m_highWaterMark)
+        , m_insertCount(other.m_insertCount)
+        , m_reuseCount(other.m_reuseCount)
+    {
+        other.m_chunks.clear();
+        other.m_top = 0;
+        other.m_usedSlotCount = 0;
+        other.m_liveCount = 0;
+        other.advanceEpoch();
+        other.resetStatistics();
+    }
+
+    TransientPool &operator=(TransientPool &&other) noexcept
+    {
+        if (this != &other) {
+            destroyAll();
+
+            m_chunks = std::move(other.m_chunks);
+            m_top = other.m_top;
+            m_usedSlotCount = other.m_usedSlotCount;
+            m_liveCount = other.m_liveCount;
+            m_epoch = other.m_epoch;
+            m_highWaterMark = other.m_highWaterMark;
+            m_insertCount = other.m_insertCount;
+            m_reuseCount = other.m_reuseCount;
+
+            other.m_chunks.clear();
+            other.m_top = 0;
+            other.m_usedSlotCount = 0;
+            other.m_liveCount = 0;
+            other.advanceEpoch();
+            other.resetStatistics();
+        }
+        return *this;
+    }
+
+    uint32_t capacity() const noexcept { return static_cast<uint32_t>(m_chunks.size()) * ChunkSize; }
+    uint32_t size() const noexcept { return m_liveCount; }
+
+    T *get(const Handle<H> &handle) const noexcept
+    {
+        if (!handle.isValid() || handle.m_index >= capacity())
+            return nullptr;
+        Slot &slot = slotAt(handle.m_index);
+        if (slot.generation != handle.m_generation)
+            return nullptr;
+        return slot.data();
+    }
+
+    template<typename... Args>
+    Handle<H> emplace(Args &&...args)
+    {
+        const uint32_t index = acquireSlot();
+        Slot &slot = slotAt(index);
+        new (slot.storage) T(std::forward<Args>(args)...);
+        slot.generation = m_epoch;
+
+        ++m_liveCount;
+        ++m_insertCount;
+        if (index < m_usedSlotCount)
+            ++m_reuseCount;
+        else
+            m_usedSlotCount = index + 1;
+        if (m_liveCount > m_highWaterMark)
+            m_highWaterMark = m_liveCount;
+
+        return Handle<H>(index, m_epoch);
+    }
+
+    Handle<H> insert(const T &data)
+    {
+        return emplace(data);
+    }
+
+    void remove(const Handle<H> &handle)
+    {
+        T *data = get(handle);
+        if (!data)
+            return;
+
+        data->~T();
+        slotAt(handle.m_index).generation = 0;
+
+        // Nothing references the arena any longer, start over from the beginning
+        if (--m_liveCount == 0)
+            rewind();
+    }
+
+    // Destroys all the entries and rewinds the arena. All existing handles are invalidated.
+    void clear()
+    {
+        // Entries from before a wrap around may be above the top of the arena
+        for (uint32_t i = 0; i < m_usedSlotCount; ++i) {
+            Slot &slot = slotAt(i);
+            if (slot.generation != 0) {
+                slot.data()->~T();
+                slot.generation = 0;
+            }
+        }
+        m_liveCount = 0;
+        rewind();
+    }
+
+    // Ensures that at least newCapacity entries can be stored without allocating
+    void reserve(uint32_t newCapacity)
+    {
+        while (capacity() < newCapacity)
+            m_chunks.emplace_back(new Slot[ChunkSize]);
+    }
+
+    PoolStatistics statistics() const noexcept
+    {
+        return PoolStatistics{
+            .liveCount = m_liveCount,
+            .highWaterMark = m_highWaterMark,
+            .capacity = capacity(),
+            .insertCount = m_insertCount,
+            .reuseCount = m_reuseCount
+        };
+    }
+
+    void resetStatistics() noexcept
+    {
+        m_highWaterMark = m_liveCount;
+        m_insertCount = 0;
+        m_reuseCount = 0;
+    }
+
+private:
+    struct Slot {
+        uint32_t generation{ 0 }; // Epoch the entry was created in, 0 when it has been removed
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *data() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+    Slot &slotAt(uint32_t index) const noexcept
+    {
+        return m_chunks[index >> ChunkSizeLog2][index & (ChunkSize - 1)];
+    }
+
+    uint32_t acquireSlot()
+    {
+        // Step over the entries left alive by earlier epochs
+        while (m_top < capacity() && slotAt(m_top).generation != 0)
+            ++m_top;
+
+        if (m_top == capacity()) {
+            if (m_liveCount < capacity() / 2) {
+                m_top = 0;
+                advanceEpoch();
+                while (slotAt(m_top).generation != 0)
+                    ++m_top;
+            } else {
+                m_chunks.emplace_back(new Slot[ChunkSize]);
+            }
+        }
+
+        return m_top++;
+    }
+
+    void rewind() noexcept
+    {
+        assert(m_liveCount == 0);
+        m_top = 0;
+        advanceEpoch();
+    }
+
+    void advanceEpoch() noexcept
+    {
+        // 0 is reserved for invalid handles and removed entries
+        if (++m_epoch == 0)
+            m_epoch = 1;
+    }
+
+    void destroyAll() noexcept
+    {
+        clear();
+        m_chunks.clear();
+        m_usedSlotCount = 0;
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> m_chunks;
+    uint32_t m_top; // Next slot to hand out in the current epoch
+    uint32_t m_usedSlotCount; // Number of slots that have been used at least once
+    uint32_t m_liveCount;
+    uint32_t m_epoch;
+
+    // Usage statistics
+    uint32_t m_highWaterMark;
+    uint64_t m_insertCount;
+    uint64_t m_reuseCount;
+};
+
+} // namespace KDGpu
@@ -61,6 +61,10 @@ AdapterProperties VulkanAdapter::queryAdapterProperties()
 
     deviceProperties2.pNext = &multiViewProperties;
 
+    VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+    descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    multiViewProperties.pNext = &descriptorIndexingProperties;
+
     vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties2);
 
     const VkPhysicalDeviceProperties &deviceProperties = deviceProperties2.properties;
@@ -233,6 +237,17 @@ AdapterProperties VulkanAdapter::queryAdapterProperties()
             .maxMultiViewCount = multiViewProperties.maxMultiviewViewCount,
             .maxMultiviewInstanceIndex = multiViewProperties.maxMultiviewInstanceIndex,
         },
+        .descriptorIndexingProperties = {
+            .maxUpdateAfterBindDescriptorsInAllPools = descriptorIndexingProperties.maxUpdateAfterBindDescriptorsInAllPools,
+            .maxPerStageDescriptorUpdateAfterBindSamplers = descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+            .maxPerStageDescriptorUpdateAfterBindSampledImages = descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            .maxPerStageDescriptorUpdateAfterBindStorageImages = descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindStorageImages,
+            .maxPerStageDescriptorUpdateAfterBindStorageBuffers = descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+            .maxDescriptorSetUpdateAfterBindSamplers = descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+            .maxDescriptorSetUpdateAfterBindSampledImages = descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+            .maxDescriptorSetUpdateAfterBindStorageImages = descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindStorageImages,
+            .maxDescriptorSetUpdateAfterBindStorageBuffers = descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        },
     };
     // clang-format-on
     return properties;
@@ -247,6 +262,10 @@ AdapterFeatures VulkanAdapter::queryAdapterFeatures()
     multiViewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
     deviceFeatures2.pNext = &multiViewFeatures; // So that it gets filled by the vkGetPhysicalDeviceFeatures2 call
 
+    VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures {};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    multiViewFeatures.pNext = &descriptorIndexingFeatures;
+
     vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
     const VkPhysicalDeviceFeatures &deviceFeatures = deviceFeatures2.features;
 
@@ -314,6 +333,16 @@ AdapterFeatures VulkanAdapter::queryAdapterFeatures()
         .multiView = static_cast<bool>(multiViewFeatures.multiview),
         .multiViewGeometryShader = static_cast<bool>(multiViewFeatures.multiviewGeometryShader),
         .multiViewTessellationShader = static_cast<bool>(multiViewFeatures.multiviewTessellationShader),
+        .shaderSampledImageArrayNonUniformIndexing = static_cast<bool>(descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing),
+        .shaderStorageImageArrayNonUniformIndexing = static_cast<bool>(descriptorIndexingFeatures.shaderStorageImageArrayNonUniformIndexing),
+        .shaderStorageBufferArrayNonUniformIndexing = static_cast<bool>(descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing),
+        .descriptorBindingSampledImageUpdateAfterBind = static_cast<bool>(descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind),
+        .descriptorBindingStorageImageUpdateAfterBind = static_cast<bool>(descriptorIndexingFeatures.descriptorBindingStorageImageUpdateAfterBind),
+        .descriptorBindingStorageBufferUpdateAfterBind = static_cast<bool>(descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind),
+        .descriptorBindingUpdateUnusedWhilePending = static_cast<bool>(descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending),
+        .descriptorBindingPartiallyBound = static_cast<bool>(descriptorIndexingFeatures.descriptorBindingPartiallyBound),
+        .descriptorBindingVariableDescriptorCount = static_cast<bool>(descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount),
+        .runtimeDescriptorArray = static_cast<bool>(descriptorIndexingFeatures.runtimeDescriptorArray),
     };
     return features;
 }
@@ -10,11 +10,39 @@
 
 #include "vulkan_bind_group.h"
 #include <KDGpu/bind_group_options.h>
+#include <KDGpu/vulkan/vulkan_bind_group_layout.h>
 #include <KDGpu/vulkan/vulkan_device.h>
 #include <KDGpu/vulkan/vulkan_resource_manager.h>
 
+#include <algorithm>
+
 namespace KDGpu {
 
+namespace {
+
+Handle<Buffer_t> boundBuffer(const BindingResource &resource)
+{
+    switch (resource.type()) {
+    case ResourceBindingType::UniformBuffer:
+        return resource.uniformBufferBinding().buffer;
+    case ResourceBindingType::StorageBuffer:
+        return resource.storageBufferBinding().buffer;
+    case ResourceBindingType::DynamicUniformBuffer:
+        return resource.dynamicUniformBufferBinding().buffer;
+    default:
+        return {};
+    }
+}
+
+bool isBufferDescriptor(VkDescriptorType type)
+{
+    return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+            type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+            type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+}
+
+} // namespace
+
 VulkanBindGroup::VulkanBindGroup(VkDescriptorSet _descriptorSet,
                                  VkDescriptorPool _descriptorPool,
                                  VulkanResourceManager *_vulkanResourceManager,
@@ -27,111 +55,192 @@ VulkanBindGroup::VulkanBindGroup(VkDescriptorSet _descriptorSet,
 }
 
 void VulkanBindGroup::update(const BindGroupEntry &entry)
+{
+    update(std::vector<BindGroupEntry>{ entry });
+}
+
+void VulkanBindGroup::update(const std::vector<BindGroupEntry> &entries)
 {
     VulkanDevice *vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
 
-    VkDescriptorBufferInfo bufferInfo{};
+    std::vector<PendingDescriptor> descriptors;
+    descriptors.reserve(entries.size());
+    for (const BindGroupEntry &entry : entries) {
+        PendingDescriptor descriptor{ .binding = entry.binding, .arrayElement = entry.arrayElement };
+        if (toDescriptor(entry.resource, descriptor))
+            descriptors.push_back(descriptor);
+    }
+
+    if (!descriptors.empty()) {
+        VulkanDescriptorUpdateCounters &counters = *vulkanDevice->descriptorUpdateCounters;
+        counters.descriptors.fetch_add(descriptors.size(), std::memory_order_relaxed);
+
+        if (writeWithTemplate(vulkanDevice, descriptors)) {
+            counters.templateUpdates.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            std::vector<VkWriteDescriptorSet> descriptorWrites;
+            descriptorWrites.reserve(descriptors.size());
+            for (const PendingDescriptor &descriptor : descriptors) {
+                VkWriteDescriptorSet descriptorWrite{};
+                descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrite.dstSet = descriptorSet;
+                descriptorWrite.dstBinding = descriptor.binding;
+                descriptorWrite.dstArrayElement = descriptor.arrayElement;
+                descriptorWrite.descriptorCount = 1;
+                descriptorWrite.descriptorType = descriptor.descriptorType;
+                if (isBufferDescriptor(descriptor.descriptorType))
+                    descriptorWrite.pBufferInfo = &descriptor.slot.buffer;
+                else
+                    descriptorWrite.pImageInfo = &descriptor.slot.image;
+                descriptorWrites.push_back(descriptorWrite);
+            }
+            vkUpdateDescriptorSets(vulkanDevice->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+            counters.batchedUpdates.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
 
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    // Remember which buffer each descriptor refers to, in case it gets relocated
+    for (const BindGroupEntry &entry : entries) {
+        const uint64_t key = (uint64_t(entry.binding) << 32) | entry.arrayElement;
+        if (boundBuffer(entry.resource).isValid())
+            bufferEntries.insert_or_assign(key, entry);
+        else
+            bufferEntries.erase(key);
+    }
+}
 
-    VkWriteDescriptorSet descriptorWrite{};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = descriptorSet;
-    descriptorWrite.dstBinding = entry.binding;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorCount = 0;
-    descriptorWrite.pImageInfo = nullptr;
-    descriptorWrite.pTexelBufferView = nullptr;
-    descriptorWrite.pBufferInfo = nullptr;
-    descriptorWrite.pTexelBufferView = nullptr;
+bool VulkanBindGroup::toDescriptor(const BindingResource &resource, PendingDescriptor &descriptor) const
+{
+    VkDescriptorImageInfo &imageInfo = descriptor.slot.image;
+    VkDescriptorBufferInfo &bufferInfo = descriptor.slot.buffer;
 
-    switch (entry.resource.type()) {
+    switch (resource.type()) {
     case ResourceBindingType::CombinedImageSampler: {
-        const TextureViewSamplerBinding &textureViewBinding = entry.resource.textureViewSamplerBinding();
+        const TextureViewSamplerBinding &textureViewBinding = resource.textureViewSamplerBinding();
         VulkanTextureView *textView = vulkanResourceManager->getTextureView(textureViewBinding.textureView);
         VulkanSampler *sampler = vulkanResourceManager->getSampler(textureViewBinding.sampler);
+        imageInfo = {};
         imageInfo.imageView = textView->imageView;
-        imageInfo.sampler = sampler->sampler;
-
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pImageInfo = &imageInfo;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        break;
+        // No sampler for bindings with immutable samplers, it would be ignored anyway
+        imageInfo.sampler = sampler ? sampler->sampler : VK_NULL_HANDLE;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        descriptor.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        return true;
     }
     case ResourceBindingType::SampledImage: {
-        const TextureViewBinding &textureViewBinding = entry.resource.textureViewBinding();
+        const TextureViewBinding &textureViewBinding = resource.textureViewBinding();
         VulkanTextureView *textView = vulkanResourceManager->getTextureView(textureViewBinding.textureView);
+        imageInfo = {};
         imageInfo.imageView = textView->imageView;
-
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pImageInfo = &imageInfo;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        break;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        descriptor.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        return true;
     }
     case ResourceBindingType::Sampler: {
-        const SamplerBinding &samplerBinding = entry.resource.samplerBinding();
+        // Bindings with immutable samplers must not be written
+        const SamplerBinding &samplerBinding = resource.samplerBinding();
         VulkanSampler *sampler = vulkanResourceManager->getSampler(samplerBinding.sampler);
+        if (!sampler)
+            return false;
+        imageInfo = {};
         imageInfo.sampler = sampler->sampler;
-
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pImageInfo = &imageInfo;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-        break;
+        descriptor.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        return true;
     }
     case ResourceBindingType::StorageImage: {
-        const ImageBinding &imageBinding = entry.resource.imageBinding();
+        const ImageBinding &imageBinding = resource.imageBinding();
         VulkanTextureView *textView = vulkanResourceManager->getTextureView(imageBinding.textureView);
+        imageInfo = {};
         imageInfo.imageView = textView->imageView;
         imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL; // Since we can read or write to these types of resources
-
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pImageInfo = &imageInfo;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        break;
+        descriptor.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        return true;
     }
     case ResourceBindingType::UniformBuffer: {
-        const UniformBufferBinding &bufferBinding = entry.resource.uniformBufferBinding();
+        const UniformBufferBinding &bufferBinding = resource.uniformBufferBinding();
         VulkanBuffer *buffer = vulkanResourceManager->getBuffer(bufferBinding.buffer);
+        bufferInfo = {};
         bufferInfo.buffer = buffer->buffer; // VkBuffer
         bufferInfo.offset = bufferBinding.offset;
         bufferInfo.range = (bufferBinding.size == UniformBufferBinding::WholeSize) ? VK_WHOLE_SIZE : bufferBinding.size;
-
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        break;
+        descriptor.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        return true;
     }
     case ResourceBindingType::StorageBuffer: {
-        const StorageBufferBinding &bufferBinding = entry.resource.storageBufferBinding();
+        const StorageBufferBinding &bufferBinding = resource.storageBufferBinding();
         VulkanBuffer *buffer = vulkanResourceManager->getBuffer(bufferBinding.buffer);
+        bufferInfo = {};
         bufferInfo.buffer = buffer->buffer; // VkBuffer
         bufferInfo.offset = bufferBinding.offset;
         bufferInfo.range = (bufferBinding.size == StorageBufferBinding::WholeSize) ? VK_WHOLE_SIZE : bufferBinding.size;
-
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        break;
+        descriptor.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        return true;
     }
     case ResourceBindingType::DynamicUniformBuffer: {
-        const DynamicUniformBufferBinding &bufferBinding = entry.resource.dynamicUniformBufferBinding();
+        const DynamicUniformBufferBinding &bufferBinding = resource.dynamicUniformBufferBinding();
         VulkanBuffer *buffer = vulkanResourceManager->getBuffer(bufferBinding.buffer);
+        bufferInfo = {};
         bufferInfo.buffer = buffer->buffer; // VkBuffer
         bufferInfo.offset = bufferBinding.offset;
         bufferInfo.range = (bufferBinding.size == StorageBufferBinding::WholeSize) ? VK_WHOLE_SIZE : bufferBinding.size;
-
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        break;
+        descriptor.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        return true;
     }
     default:
-        break;
+        return false;
     }
+}
 
-    if (descriptorWrite.descriptorCount > 0)
-        vkUpdateDescriptorSets(vulkanDevice->device, 1, &descriptorWrite, 0, nullptr);
+bool VulkanBindGroup::writeWithTemplate(VulkanDevice *vulkanDevice, const std::vector<PendingDescriptor> &descriptors) const
+{
+    const VulkanBindGroupLayout *layout = vulkanResourceManager->getBindGroupLayout(layoutHandle);
+    if (!layout || layout->updateTemplate == VK_NULL_HANDLE || descriptors.size() < layout->templateSlotCount)
+        return false;
+
+    // The template writes every descriptor, so it can only be used when all of them are provided
+    std::vector<VulkanDescriptorSlot> data(layout->templateSlotCount);
+    std::vector<bool> written(layout->templateSlotCount, false);
+    uint32_t writtenCount = 0;
+    for (const PendingDescriptor &descriptor : descriptors) {
+        const auto bindingIt = std::find_if(layout->templateBindings.begin(), layout->templateBindings.end(),
+                                            [&](const VulkanBindGroupLayout::TemplateBinding &templateBinding) {
+                                                return templateBinding.binding == descriptor.binding;
+                                            });
+        if (bindingIt == layout->templateBindings.end() || bindingIt->descriptorType != descriptor.descriptorType ||
+            descriptor.arrayElement >= bindingIt->count)
+            return false;
+
+        const uint32_t slot = bindingIt->firstSlot + descriptor.arrayElement;
+        data[slot] = descriptor.slot;
+        if (!written[slot]) {
+            written[slot] = true;
+            ++writtenCount;
+        }
+    }
+    if (writtenCount != layout->templateSlotCount)
+        return false;
+
+    vkUpdateDescriptorSetWithTemplate(vulkanDevice->device, descriptorSet, layout->updateTemplate, data.data());
+    return true;
+}
+
+void VulkanBindGroup::rewriteBufferEntries(const std::vector<Handle<Buffer_t>> &buffers)
+{
+    // update() modifies bufferEntries, gather the entries to rewrite first
+    std::vector<BindGroupEntry> entries;
+    for (const auto &[key, entry] : bufferEntries) {
+        const Handle<Buffer_t> buffer = boundBuffer(entry.resource);
+        if (std::find(buffers.begin(), buffers.end(), buffer) != buffers.end())
+            entries.push_back(entry);
+    }
+    if (!entries.empty())
+        update(entries);
+}
+
+void VulkanBindGroup::collectBoundBuffers(std::vector<Handle<Buffer_t>> &buffers) const
+{
+    for (const auto &[key, entry] : bufferEntries)
+        buffers.push_back(boundBuffer(entry.resource));
 }
 
 } // namespace KDGpu
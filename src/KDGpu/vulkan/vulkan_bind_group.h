@@ -11,13 +11,21 @@
 #pragma once
 
 #include <KDGpu/api/api_bind_group.h>
+#include <KDGpu/bind_group_options.h>
 #include <KDGpu/handle.h>
 #include <KDGpu/kdgpu_export.h>
+#include <KDGpu/vulkan/vulkan_bind_group_layout.h>
 #include <vulkan/vulkan.h>
 
+#include <unordered_map>
+#include <vector>
+
 namespace KDGpu {
 
+struct VulkanDevice;
 class VulkanResourceManager;
+struct BindGroupLayout_t;
+struct Buffer_t;
 struct Device_t;
 
 /**
@@ -32,11 +40,34 @@ struct KDGPU_EXPORT VulkanBindGroup : public ApiBindGroup {
                              const Handle<Device_t> &_deviceHandle);
 
     void update(const BindGroupEntry &entry) final;
+    // Writes all the entries with a single call, through the update template of the layout when they cover it
+    void update(const std::vector<BindGroupEntry> &entries) final;
+
+    // Rewrites the descriptors referencing any of the buffers, after their VkBuffer got replaced
+    void rewriteBufferEntries(const std::vector<Handle<Buffer_t>> &buffers);
+    // Appends the buffers referenced by the descriptors to buffers
+    void collectBoundBuffers(std::vector<Handle<Buffer_t>> &buffers) const;
 
     VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
     VkDescriptorPool descriptorPool{ VK_NULL_HANDLE };
     VulkanResourceManager *vulkanResourceManager;
     Handle<Device_t> deviceHandle;
+    Handle<BindGroupLayout_t> layoutHandle; // The set is recycled for other bind groups of this layout
+    bool transient{ false };
+
+    // The entries currently bound to a buffer, keyed by binding and array element
+    std::unordered_map<uint64_t, BindGroupEntry> bufferEntries;
+
+private:
+    struct PendingDescriptor {
+        uint32_t binding;
+        uint32_t arrayElement;
+        VkDescriptorType descriptorType{ VK_DESCRIPTOR_TYPE_MAX_ENUM };
+        VulkanDescriptorSlot slot{};
+    };
+
+    bool toDescriptor(const BindingResource &resource, PendingDescriptor &descriptor) const;
+    bool writeWithTemplate(VulkanDevice *vulkanDevice, const std::vector<PendingDescriptor> &descriptors) const;
 };
 
 } // namespace KDGpu
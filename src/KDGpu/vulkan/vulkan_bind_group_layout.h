@@ -11,14 +11,55 @@
 #pragma once
 
 #include <KDGpu/api/api_bind_group_layout.h>
+#include <KDGpu/bind_group_layout_options.h>
 #include <KDGpu/handle.h>
+#include <KDGpu/utils/hash_utils.h>
 #include <KDGpu/kdgpu_export.h>
 #include <vulkan/vulkan.h>
 
+#include <vector>
+
 namespace KDGpu {
 
 class VulkanResourceManager;
 struct Device_t;
+struct Sampler_t;
+
+struct VulkanBindGroupLayoutKey {
+    explicit VulkanBindGroupLayoutKey(const BindGroupLayoutOptions &_options)
+        : options(_options)
+    {
+        for (const ResourceBindingLayout &binding : options.bindings) {
+            KDGpu::hash_combine(hash, binding.binding);
+            KDGpu::hash_combine(hash, binding.count);
+            KDGpu::hash_combine(hash, binding.resourceType);
+            KDGpu::hash_combine(hash, binding.shaderStages.toInt());
+            for (const Handle<Sampler_t> &sampler : binding.immutableSamplers)
+                KDGpu::hash_combine(hash, sampler);
+            KDGpu::hash_combine(hash, binding.flags.toInt());
+        }
+    }
+
+    // Immutable samplers are shared by the sampler cache, identical ones have the same handle
+    bool operator==(const VulkanBindGroupLayoutKey &other) const noexcept
+    {
+        return hash == other.hash && options == other.options;
+    }
+
+    bool operator!=(const VulkanBindGroupLayoutKey &other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+    BindGroupLayoutOptions options;
+    uint64_t hash{ 0 };
+};
+
+// The data of a descriptor update template holds one of these per descriptor
+union VulkanDescriptorSlot {
+    VkDescriptorImageInfo image;
+    VkDescriptorBufferInfo buffer;
+};
 
 /**
  * @brief VulkanBindGroupLayout
@@ -31,6 +72,32 @@ struct KDGPU_EXPORT VulkanBindGroupLayout : public ApiBindGroupLayout {
 
     VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
     Handle<Device_t> deviceHandle;
+    std::vector<Handle<Sampler_t>> immutableSamplers; // Each holds a reference on the sampler
+
+    struct TemplateBinding {
+        uint32_t binding;
+        VkDescriptorType descriptorType;
+        uint32_t firstSlot;
+        uint32_t count;
+    };
+
+    // Writes every descriptor of a set from an array of templateSlotCount VulkanDescriptorSlots.
+    // Bindings which cannot be written by a BindGroupEntry are left out.
+    VkDescriptorUpdateTemplate updateTemplate{ VK_NULL_HANDLE };
+    std::vector<TemplateBinding> templateBindings;
+    uint32_t templateSlotCount{ 0 };
 };
 
 } // namespace KDGpu
+
+namespace std {
+
+template<>
+struct hash<KDGpu::VulkanBindGroupLayoutKey> {
+    size_t operator()(const KDGpu::VulkanBindGroupLayoutKey &key) const
+    {
+        return key.hash;
+    }
+};
+
+} // namespace std
@@ -13,14 +13,25 @@
 #include <KDGpu/vulkan/vulkan_device.h>
 #include <KDGpu/vulkan/vulkan_resource_manager.h>
 
+#include <cstring>
+
 namespace KDGpu {
 
 VulkanBuffer::VulkanBuffer(VkBuffer _buffer,
                            VmaAllocation _allocation,
+                           MemoryUsage _memoryUsage,
+                           DeviceSize _allocationSize,
+                           void *_persistentMapping,
+                           bool _hostCoherent,
                            VulkanResourceManager *_vulkanResourceManager,
                            const Handle<Device_t> &_deviceHandle)
     : buffer(_buffer)
     , allocation(_allocation)
+    , mapped(_persistentMapping)
+    , persistentlyMapped(_persistentMapping != nullptr)
+    , hostCoherent(_hostCoherent)
+    , memoryUsage(_memoryUsage)
+    , allocationSize(_allocationSize)
     , vulkanResourceManager(_vulkanResourceManager)
     , deviceHandle(_deviceHandle)
 {
@@ -28,6 +39,8 @@ VulkanBuffer::VulkanBuffer(VkBuffer _buffer,
 
 void *VulkanBuffer::map()
 {
+    if (persistentlyMapped)
+        return mapped;
     auto vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
     vmaMapMemory(vulkanDevice->allocator, allocation, &mapped);
     return mapped;
@@ -35,9 +48,61 @@ void *VulkanBuffer::map()
 
 void VulkanBuffer::unmap()
 {
+    // VMA releases the persistent mapping together with the allocation
+    if (persistentlyMapped)
+        return;
     auto vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
     vmaUnmapMemory(vulkanDevice->allocator, allocation);
     mapped = nullptr;
 }
 
+void *VulkanBuffer::mappedData() const
+{
+    return mapped;
+}
+
+void VulkanBuffer::flush(DeviceSize offset, DeviceSize size)
+{
+    if (hostCoherent)
+        return;
+    // VMA takes care of aligning the range to nonCoherentAtomSize
+    auto vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
+    vmaFlushAllocation(vulkanDevice->allocator, allocation, offset, size);
+}
+
+void VulkanBuffer::invalidate(DeviceSize offset, DeviceSize size)
+{
+    if (hostCoherent)
+        return;
+    auto vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
+    vmaInvalidateAllocation(vulkanDevice->allocator, allocation, offset, size);
+}
+
+bool VulkanBuffer::writeDirectly(const void *data, DeviceSize offset, DeviceSize size)
+{
+    auto vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
+    VulkanBufferUploadCounters *counters = vulkanDevice->bufferUploadCounters.get();
+
+    // Other memory usages are either mapped by the application or never host visible.
+    // A staged copy is ordered with the work already submitted, a direct write is not,
+    // so only take that path once the submissions using the buffer have completed.
+    const bool direct = memoryUsage == MemoryUsage::GpuOnly && hostVisible &&
+            vulkanDevice->deletionQueue->hasRetired(lastUseSerial);
+
+    if (!direct) {
+        counters->stagedUploads.fetch_add(1, std::memory_order_relaxed);
+        counters->stagedUploadBytes.fetch_add(size, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto bufferData = static_cast<uint8_t *>(map());
+    std::memcpy(bufferData + offset, data, size);
+    flush(offset, size);
+    unmap();
+
+    counters->directWrites.fetch_add(1, std::memory_order_relaxed);
+    counters->directWriteBytes.fetch_add(size, std::memory_order_relaxed);
+    return true;
+}
+
 } // namespace KDGpu
@@ -11,12 +11,15 @@
 #pragma once
 
 #include <KDGpu/api/api_buffer.h>
+#include <KDGpu/gpu_core.h>
 #include <KDGpu/kdgpu_export.h>
 #include <KDGpu/handle.h>
 
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 
+#include <vector>
+
 namespace KDGpu {
 
 class VulkanResourceManager;
@@ -31,15 +34,35 @@ struct Device_t;
 struct KDGPU_EXPORT VulkanBuffer : public ApiBuffer {
     explicit VulkanBuffer(VkBuffer _buffer,
                           VmaAllocation _allocation,
+                          MemoryUsage _memoryUsage,
+                          DeviceSize _allocationSize,
+                          void *_persistentMapping,
+                          bool _hostCoherent,
                           VulkanResourceManager *_vulkanResourceManager,
                           const Handle<Device_t> &_deviceHandle);
 
     void *map() final;
     void unmap() final;
+    void *mappedData() const final;
+    void flush(DeviceSize offset, DeviceSize size) final;
+    void invalidate(DeviceSize offset, DeviceSize size) final;
+    bool writeDirectly(const void *data, DeviceSize offset, DeviceSize size) final;
 
     VkBuffer buffer{ VK_NULL_HANDLE };
     VmaAllocation allocation{ VK_NULL_HANDLE };
     void *mapped{ nullptr };
+    bool persistentlyMapped{ false };
+    bool hostCoherent{ false };
+    bool hostVisible{ false };
+    MemoryUsage memoryUsage{ MemoryUsage::Unknown };
+    DeviceSize allocationSize{ 0 };
+    uint64_t lastUseSerial{ 0 }; // Last submission of a command buffer referencing the buffer
+
+    // Needed to recreate the VkBuffer when defragmentation relocates its memory
+    DeviceSize size{ 0 };
+    VkBufferUsageFlags usage{ 0 };
+    VkSharingMode sharingMode{ VK_SHARING_MODE_EXCLUSIVE };
+    std::vector<uint32_t> queueFamilyIndices;
 
     VulkanResourceManager *vulkanResourceManager;
     Handle<Device_t> deviceHandle;
@@ -28,6 +28,8 @@ VulkanCommandBuffer::VulkanCommandBuffer(VkCommandBuffer _commandBuffer,
 
 void VulkanCommandBuffer::begin()
 {
+    usedBuffers.clear();
+
     // Begin recording
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -16,8 +16,11 @@
 
 #include <vulkan/vulkan.h>
 
+#include <vector>
+
 namespace KDGpu {
 
+struct Buffer_t;
 struct Device_t;
 class VulkanResourceManager;
 
@@ -41,6 +44,9 @@ struct KDGPU_EXPORT VulkanCommandBuffer : public ApiCommandBuffer {
     VkCommandBufferLevel commandLevel{ VK_COMMAND_BUFFER_LEVEL_PRIMARY };
     VulkanResourceManager *vulkanResourceManager{ nullptr };
     Handle<Device_t> deviceHandle;
+
+    // Referenced by the recorded commands, each submission stamps them with its serial
+    std::vector<Handle<Buffer_t>> usedBuffers;
 };
 
 } // namespace KDGpu
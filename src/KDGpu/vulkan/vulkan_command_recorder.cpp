@@ -216,6 +216,8 @@ void VulkanCommandRecorder::copyBuffer(const BufferCopy &copy)
     bufferCopy.srcOffset = copy.srcOffset;
 
     vkCmdCopyBuffer(commandBuffer, srcBuf->buffer, dstBuf->buffer, 1, &bufferCopy);
+    useBuffer(copy.src);
+    useBuffer(copy.dst);
 }
 
 void VulkanCommandRecorder::copyBufferToTexture(const BufferToTextureCopy &copy)
@@ -230,6 +232,7 @@ void VulkanCommandRecorder::copyBufferToTexture(const BufferToTextureCopy &copy)
                            textureLayoutToVkImageLayout(copy.dstTextureLayout),
                            static_cast<uint32_t>(vkRegions.size()),
                            vkRegions.data());
+    useBuffer(copy.srcBuffer);
 }
 
 void VulkanCommandRecorder::copyTextureToBuffer(const TextureToBufferCopy &copy)
@@ -244,6 +247,7 @@ void VulkanCommandRecorder::copyTextureToBuffer(const TextureToBufferCopy &copy)
                            dstVulkanBuffer->buffer,
                            static_cast<uint32_t>(vkRegions.size()),
                            vkRegions.data());
+    useBuffer(copy.dstBuffer);
 }
 
 void VulkanCommandRecorder::copyTextureToTexture(const TextureToTextureCopy &copy)
@@ -399,6 +403,8 @@ void VulkanCommandRecorder::executeSecondaryCommandBuffer(const Handle<CommandBu
 {
     VulkanCommandBuffer *vulkanSecondaryCommandBuffer = vulkanResourceManager->getCommandBuffer(secondaryCommandBuffer);
     vkCmdExecuteCommands(commandBuffer, 1, &vulkanSecondaryCommandBuffer->commandBuffer);
+    for (const Handle<Buffer_t> &buffer : vulkanSecondaryCommandBuffer->usedBuffers)
+        useBuffer(buffer);
 }
 
 void VulkanCommandRecorder::resolveTexture(const TextureResolveOptions &options)
@@ -423,4 +429,10 @@ Handle<CommandBuffer_t> VulkanCommandRecorder::finish()
     return commandBufferHandle;
 }
 
+void VulkanCommandRecorder::useBuffer(const Handle<Buffer_t> &buffer)
+{
+    if (VulkanCommandBuffer *vulkanCommandBuffer = vulkanResourceManager->getCommandBuffer(commandBufferHandle))
+        vulkanCommandBuffer->usedBuffers.push_back(buffer);
+}
+
 } // namespace KDGpu
@@ -47,6 +47,8 @@ struct KDGPU_EXPORT VulkanCommandRecorder : public ApiCommandRecorder {
     void resolveTexture(const TextureResolveOptions &options) final;
     Handle<CommandBuffer_t> finish() final;
 
+    void useBuffer(const Handle<Buffer_t> &buffer);
+
     VkCommandPool commandPool{ VK_NULL_HANDLE };
     VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
     Handle<CommandBuffer_t> commandBufferHandle;
@@ -9,6 +9,7 @@
 */
 
 #include "vulkan_compute_pass_command_recorder.h"
+#include <KDGpu/vulkan/vulkan_command_buffer.h>
 #include <KDGpu/vulkan/vulkan_compute_pipeline.h>
 #include <KDGpu/vulkan/vulkan_resource_manager.h>
 #include <KDGpu/vulkan/vulkan_enums.h>
@@ -16,10 +17,12 @@
 namespace KDGpu {
 
 VulkanComputePassCommandRecorder::VulkanComputePassCommandRecorder(VkCommandBuffer _commandBuffer,
+                                                                   const Handle<CommandBuffer_t> &_commandBufferHandle,
                                                                    VulkanResourceManager *_vulkanResourceManager,
                                                                    const Handle<Device_t> &_deviceHandle)
     : ApiComputePassCommandRecorder()
     , commandBuffer(_commandBuffer)
+    , commandBufferHandle(_commandBufferHandle)
     , vulkanResourceManager(_vulkanResourceManager)
     , deviceHandle(_deviceHandle)
 {
@@ -35,33 +38,35 @@ void VulkanComputePassCommandRecorder::setPipeline(const Handle<ComputePipeline_
 void VulkanComputePassCommandRecorder::setBindGroup(uint32_t group, const Handle<BindGroup_t> &_bindGroup,
                                                     const Handle<PipelineLayout_t> &pipelineLayout, const std::vector<uint32_t> &dynamicBufferOffsets)
 {
-    VulkanBindGroup *bindGroup = vulkanResourceManager->getBindGroup(_bindGroup);
-    VkDescriptorSet set = bindGroup->descriptorSet;
-
     // Use the pipeline layout provided, otherwise fallback to the one from the currently
     // bound pipeline (if any).
-    VkPipelineLayout vkPipelineLayout{ VK_NULL_HANDLE };
-    if (pipelineLayout.isValid()) {
-        VulkanPipelineLayout *vulkanPipelineLayout = vulkanResourceManager->getPipelineLayout(pipelineLayout);
-        if (vulkanPipelineLayout)
-            vkPipelineLayout = vulkanPipelineLayout->pipelineLayout;
-    } else if (pipeline.isValid()) {
+    Handle<PipelineLayout_t> pipelineLayoutHandle = pipelineLayout;
+    if (!pipelineLayoutHandle.isValid() && pipeline.isValid()) {
         VulkanComputePipeline *vulkanPipeline = vulkanResourceManager->getComputePipeline(pipeline);
-        if (vulkanPipeline) {
-            VulkanPipelineLayout *vulkanPipelineLayout = vulkanResourceManager->getPipelineLayout(vulkanPipeline->pipelineLayoutHandle);
-            if (vulkanPipelineLayout)
-                vkPipelineLayout = vulkanPipelineLayout->pipelineLayout;
-        }
+        if (vulkanPipeline)
+            pipelineLayoutHandle = vulkanPipeline->pipelineLayoutHandle;
     }
 
-    assert(vkPipelineLayout != VK_NULL_HANDLE); // The PipelineLayout should outlive the pipelines
+    VulkanPipelineLayout *vulkanPipelineLayout = vulkanResourceManager->getPipelineLayout(pipelineLayoutHandle);
+    assert(vulkanPipelineLayout != nullptr); // The PipelineLayout should outlive the pipelines
+
+    // Nothing to do if the set is still bound through a compatible layout, which identical
+    // layouts are as they are deduplicated
+    if (!boundBindGroups.bind(vulkanResourceManager, group, _bindGroup, pipelineLayoutHandle, dynamicBufferOffsets))
+        return;
+
+    VulkanBindGroup *bindGroup = vulkanResourceManager->getBindGroup(_bindGroup);
+    VkDescriptorSet set = bindGroup->descriptorSet;
 
     // Bind Descriptor Set
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-                            vkPipelineLayout,
+                            vulkanPipelineLayout->pipelineLayout,
                             group,
                             1, &set,
                             dynamicBufferOffsets.size(), dynamicBufferOffsets.data());
+
+    if (VulkanCommandBuffer *vulkanCommandBuffer = vulkanResourceManager->getCommandBuffer(commandBufferHandle))
+        bindGroup->collectBoundBuffers(vulkanCommandBuffer->usedBuffers);
 }
 
 void VulkanComputePassCommandRecorder::dispatchCompute(const ComputeCommand &command)
@@ -79,6 +84,7 @@ void VulkanComputePassCommandRecorder::dispatchComputeIndirect(const ComputeComm
 {
     VulkanBuffer *vulkanBuffer = vulkanResourceManager->getBuffer(command.buffer);
     vkCmdDispatchIndirect(commandBuffer, vulkanBuffer->buffer, command.offset);
+    useBuffer(command.buffer);
 }
 
 void VulkanComputePassCommandRecorder::dispatchComputeIndirect(const std::vector<ComputeCommandIndirect> &commands)
@@ -106,4 +112,10 @@ void VulkanComputePassCommandRecorder::end()
     // No op
 }
 
+void VulkanComputePassCommandRecorder::useBuffer(const Handle<Buffer_t> &buffer)
+{
+    if (VulkanCommandBuffer *vulkanCommandBuffer = vulkanResourceManager->getCommandBuffer(commandBufferHandle))
+        vulkanCommandBuffer->usedBuffers.push_back(buffer);
+}
+
 } // namespace KDGpu
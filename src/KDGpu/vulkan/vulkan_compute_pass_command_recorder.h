@@ -13,12 +13,15 @@
 #include <KDGpu/api/api_compute_pass_command_recorder.h>
 #include <KDGpu/handle.h>
 #include <KDGpu/kdgpu_export.h>
+#include <KDGpu/vulkan/vulkan_pipeline_layout.h>
 #include <vulkan/vulkan.h>
 
 namespace KDGpu {
 
 class VulkanResourceManager;
 
+struct Buffer_t;
+struct CommandBuffer_t;
 struct ComputePipeline_t;
 struct Device_t;
 
@@ -30,6 +33,7 @@ struct Device_t;
 struct KDGPU_EXPORT VulkanComputePassCommandRecorder : public ApiComputePassCommandRecorder {
 
     explicit VulkanComputePassCommandRecorder(VkCommandBuffer _commandBuffer,
+                                              const Handle<CommandBuffer_t> &_commandBufferHandle,
                                               VulkanResourceManager *_vulkanResourceManager,
                                               const Handle<Device_t> &_deviceHandle);
 
@@ -43,10 +47,14 @@ struct KDGPU_EXPORT VulkanComputePassCommandRecorder : public ApiComputePassComm
     void pushConstant(const PushConstantRange &constantRange, const void *data) final;
     void end() final;
 
+    void useBuffer(const Handle<Buffer_t> &buffer);
+
     VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+    Handle<CommandBuffer_t> commandBufferHandle;
     VulkanResourceManager *vulkanResourceManager{ nullptr };
     Handle<Device_t> deviceHandle;
     Handle<ComputePipeline_t> pipeline;
+    VulkanBoundBindGroups boundBindGroups;
 };
 
 } // namespace KDGpu
@@ -0,0 +1,265 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "vulkan_deletion_queue.h"
+
+#include <KDGpu/utils/logging.h>
+
+#include <algorithm>
+#include <assert.h>
+
+namespace KDGpu {
+
+VulkanDeletionQueue::VulkanDeletionQueue(VkDevice device, VmaAllocator allocator)
+    : m_device(device)
+    , m_allocator(allocator)
+{
+}
+
+VulkanDeletionQueue::~VulkanDeletionQueue()
+{
+    // flush() must have been called while the device and allocator were still alive
+    assert(m_pendingDeletions.empty());
+    assert(m_inFlightSubmissions.empty());
+}
+
+VkFence VulkanDeletionQueue::acquireSubmissionFence()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_freeFences.empty()) {
+            VkFence fence = m_freeFences.back();
+            m_freeFences.pop_back();
+            return fence;
+        }
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence{ VK_NULL_HANDLE };
+    if (vkCreateFence(m_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Failed to create submission tracking fence");
+        return VK_NULL_HANDLE;
+    }
+    return fence;
+}
+
+uint64_t VulkanDeletionQueue::trackSubmission(VkFence fence, bool ownsFence)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_lastSubmittedSerial;
+    m_inFlightSubmissions.push_back({ m_lastSubmittedSerial, fence, ownsFence });
+    return m_lastSubmittedSerial;
+}
+
+void VulkanDeletionQueue::releaseSubmissionFence(VkFence fence)
+{
+    if (fence == VK_NULL_HANDLE)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeFences.push_back(fence);
+}
+
+void VulkanDeletionQueue::enqueueObject(VkObjectType type, uint64_t object, uint64_t parent, VmaAllocation allocation)
+{
+    if (object == 0)
+        return;
+
+    const PendingDeletion deletion{
+        .serial = 0,
+        .type = type,
+        .object = object,
+        .parent = parent,
+        .allocation = allocation
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Nothing submitted since the last retirement can be referencing this object
+    if (m_lastCompletedSerial >= m_lastSubmittedSerial) {
+        destroyObject(deletion);
+        ++m_completedDeletions;
+        return;
+    }
+
+    m_pendingDeletions.push_back(deletion);
+    m_pendingDeletions.back().serial = m_lastSubmittedSerial;
+    ++m_deferredDeletions;
+    m_peakPendingDeletions = std::max<uint64_t>(m_peakPendingDeletions, m_pendingDeletions.size());
+}
+
+uint64_t VulkanDeletionQueue::lastSubmittedSerial() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastSubmittedSerial;
+}
+
+bool VulkanDeletionQueue::hasRetired(uint64_t serial)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Only poll the fences when the last known state is not enough
+    if (serial > m_lastCompletedSerial)
+        retireCompletedSubmissions();
+    return serial <= m_lastCompletedSerial;
+}
+
+void VulkanDeletionQueue::waitUntilRetired(uint64_t serial)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (serial <= m_lastCompletedSerial)
+        return;
+
+    std::vector<VkFence> fences;
+    for (const auto &submission : m_inFlightSubmissions) {
+        if (submission.serial <= serial)
+            fences.push_back(submission.fence);
+    }
+    if (!fences.empty())
+        vkWaitForFences(m_device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+    retireCompletedSubmissions();
+}
+
+void VulkanDeletionQueue::collect()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    retireCompletedSubmissions();
+    destroyRetiredObjects();
+}
+
+void VulkanDeletionQueue::retireAll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_inFlightSubmissions.empty()) {
+        for (const auto &submission : m_inFlightSubmissions) {
+            if (!submission.ownsFence)
+                continue;
+            vkResetFences(m_device, 1, &submission.fence);
+            m_freeFences.push_back(submission.fence);
+        }
+        m_inFlightSubmissions.clear();
+    }
+    m_lastCompletedSerial = m_lastSubmittedSerial;
+    destroyRetiredObjects();
+}
+
+void VulkanDeletionQueue::flush()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_inFlightSubmissions.empty())
+            vkDeviceWaitIdle(m_device);
+    }
+    retireAll();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (VkFence fence : m_freeFences)
+        vkDestroyFence(m_device, fence, nullptr);
+    m_freeFences.clear();
+}
+
+DeletionQueueStatistics VulkanDeletionQueue::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return DeletionQueueStatistics{
+        .pendingDeletions = m_pendingDeletions.size(),
+        .peakPendingDeletions = m_peakPendingDeletions,
+        .deferredDeletions = m_deferredDeletions,
+        .completedDeletions = m_completedDeletions,
+        .submissionsInFlight = static_cast<uint32_t>(m_inFlightSubmissions.size()),
+        .lastSubmittedSerial = m_lastSubmittedSerial,
+        .lastCompletedSerial = m_lastCompletedSerial
+    };
+}
+
+void VulkanDeletionQueue::retireCompletedSubmissions()
+{
+    // Submissions may retire out of order when several queues are in use, so only
+    // advance the completed serial up to the oldest submission still in flight.
+    auto it = std::remove_if(m_inFlightSubmissions.begin(), m_inFlightSubmissions.end(),
+                             [this](const InFlightSubmission &submission) {
+                                 if (vkGetFenceStatus(m_device, submission.fence) != VK_SUCCESS)
+                                     return false;
+                                 if (!submission.ownsFence)
+                                     return true;
+                                 vkResetFences(m_device, 1, &submission.fence);
+                                 m_freeFences.push_back(submission.fence);
+                                 return true;
+                             });
+    m_inFlightSubmissions.erase(it, m_inFlightSubmissions.end());
+
+    if (m_inFlightSubmissions.empty())
+        m_lastCompletedSerial = m_lastSubmittedSerial;
+    else
+        m_lastCompletedSerial = m_inFlightSubmissions.front().serial - 1;
+}
+
+void VulkanDeletionQueue::destroyRetiredObjects()
+{
+    while (!m_pendingDeletions.empty() && m_pendingDeletions.front().serial <= m_lastCompletedSerial) {
+        destroyObject(m_pendingDeletions.front());
+        m_pendingDeletions.pop_front();
+        ++m_completedDeletions;
+    }
+}
+
+void VulkanDeletionQueue::destroyObject(const PendingDeletion &deletion)
+{
+    switch (deletion.type) {
+    case VK_OBJECT_TYPE_BUFFER:
+        vmaDestroyBuffer(m_allocator, reinterpret_cast<VkBuffer>(deletion.object), deletion.allocation);
+        break;
+    case VK_OBJECT_TYPE_IMAGE:
+        vmaDestroyImage(m_allocator, reinterpret_cast<VkImage>(deletion.object), deletion.allocation);
+        break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        vkDestroyImageView(m_device, reinterpret_cast<VkImageView>(deletion.object), nullptr);
+        break;
+    case VK_OBJECT_TYPE_SAMPLER:
+        vkDestroySampler(m_device, reinterpret_cast<VkSampler>(deletion.object), nullptr);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE:
+        vkDestroyPipeline(m_device, reinterpret_cast<VkPipeline>(deletion.object), nullptr);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        vkDestroyPipelineLayout(m_device, reinterpret_cast<VkPipelineLayout>(deletion.object), nullptr);
+        break;
+    case VK_OBJECT_TYPE_RENDER_PASS:
+        vkDestroyRenderPass(m_device, reinterpret_cast<VkRenderPass>(deletion.object), nullptr);
+        break;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+        vkDestroyFramebuffer(m_device, reinterpret_cast<VkFramebuffer>(deletion.object), nullptr);
+        break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+        vkDestroyDescriptorPool(m_device, reinterpret_cast<VkDescriptorPool>(deletion.object), nullptr);
+        break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_SET: {
+        VkDescriptorSet descriptorSet = reinterpret_cast<VkDescriptorSet>(deletion.object);
+        vkFreeDescriptorSets(m_device, reinterpret_cast<VkDescriptorPool>(deletion.parent), 1, &descriptorSet);
+        break;
+    }
+    case VK_OBJECT_TYPE_COMMAND_POOL:
+        vkDestroyCommandPool(m_device, reinterpret_cast<VkCommandPool>(deletion.object), nullptr);
+        break;
+    case VK_OBJECT_TYPE_COMMAND_BUFFER: {
+        VkCommandBuffer commandBuffer = reinterpret_cast<VkCommandBuffer>(deletion.object);
+        vkFreeCommandBuffers(m_device, reinterpret_cast<VkCommandPool>(deletion.parent), 1, &commandBuffer);
+        break;
+    }
+    case MemoryPoolObjectType:
+        vmaDestroyPool(m_allocator, reinterpret_cast<VmaPool>(deletion.object));
+        break;
+    default:
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Unsupported object type {} in deletion queue", static_cast<int>(deletion.type));
+        break;
+    }
+}
+
+} // namespace KDGpu
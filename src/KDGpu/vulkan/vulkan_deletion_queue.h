@@ -0,0 +1,125 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/deletion_queue_statistics.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace KDGpu {
+
+/**
+ * @brief VulkanDeletionQueue
+ * \ingroup vulkan
+ *
+ * Defers the destruction of Vulkan objects until the GPU has retired all the
+ * work that was submitted before the object was released.
+ *
+ * Every queue submission made through VulkanQueue is assigned an increasing
+ * serial and tracked with its own fence, or with an internally recycled one
+ * when it has none. A released object is
+ * tagged with the last submitted serial and is only destroyed once every
+ * submission up to and including that serial has completed. When nothing is
+ * in flight the object is destroyed straight away.
+ */
+class KDGPU_EXPORT VulkanDeletionQueue
+{
+public:
+    // VMA objects have no VkObjectType of their own
+    static constexpr VkObjectType MemoryPoolObjectType = VK_OBJECT_TYPE_UNKNOWN;
+
+    VulkanDeletionQueue(VkDevice device, VmaAllocator allocator);
+    ~VulkanDeletionQueue();
+
+    VulkanDeletionQueue(const VulkanDeletionQueue &) = delete;
+    VulkanDeletionQueue &operator=(const VulkanDeletionQueue &) = delete;
+
+    // Submission tracking
+    VkFence acquireSubmissionFence();
+    // Fences which are not owned, those of the submissions themselves, are neither reset nor recycled
+    // Returns the serial of the submission
+    uint64_t trackSubmission(VkFence fence, bool ownsFence = true);
+    void releaseSubmissionFence(VkFence fence);
+
+    template<typename T>
+    void enqueue(VkObjectType type, T object, VmaAllocation allocation = VK_NULL_HANDLE)
+    {
+        enqueueObject(type, reinterpret_cast<uint64_t>(object), 0, allocation);
+    }
+
+    // For objects which are returned to a parent pool (VkDescriptorSet, VkCommandBuffer)
+    template<typename T, typename P>
+    void enqueueWithParent(VkObjectType type, T object, P parent)
+    {
+        enqueueObject(type, reinterpret_cast<uint64_t>(object), reinterpret_cast<uint64_t>(parent), VK_NULL_HANDLE);
+    }
+
+    // For objects recycled by their owner rather than destroyed: tag them with
+    // lastSubmittedSerial() on release and reuse them once hasRetired() is true
+    uint64_t lastSubmittedSerial() const;
+    bool hasRetired(uint64_t serial);
+
+    // Blocks until every submission up to and including serial has completed
+    void waitUntilRetired(uint64_t serial);
+
+    // Polls the submission fences and destroys everything whose submissions have retired
+    void collect();
+
+    // To be called once the device or all queues are known to be idle
+    void retireAll();
+
+    // Waits for the device if needed and destroys every pending object and internal fence
+    void flush();
+
+    DeletionQueueStatistics statistics() const;
+
+private:
+    struct PendingDeletion {
+        uint64_t serial{ 0 };
+        VkObjectType type{ VK_OBJECT_TYPE_UNKNOWN };
+        uint64_t object{ 0 };
+        uint64_t parent{ 0 };
+        VmaAllocation allocation{ VK_NULL_HANDLE };
+    };
+
+    struct InFlightSubmission {
+        uint64_t serial{ 0 };
+        VkFence fence{ VK_NULL_HANDLE };
+        bool ownsFence{ true };
+    };
+
+    void enqueueObject(VkObjectType type, uint64_t object, uint64_t parent, VmaAllocation allocation);
+    void retireCompletedSubmissions();
+    void destroyRetiredObjects();
+    void destroyObject(const PendingDeletion &deletion);
+
+    VkDevice m_device{ VK_NULL_HANDLE };
+    VmaAllocator m_allocator{ VK_NULL_HANDLE };
+
+    mutable std::mutex m_mutex;
+    std::deque<PendingDeletion> m_pendingDeletions; // Ordered by serial
+    std::vector<InFlightSubmission> m_inFlightSubmissions; // Ordered by serial
+    std::vector<VkFence> m_freeFences;
+
+    uint64_t m_lastSubmittedSerial{ 0 };
+    uint64_t m_lastCompletedSerial{ 0 };
+    uint64_t m_peakPendingDeletions{ 0 };
+    uint64_t m_deferredDeletions{ 0 };
+    uint64_t m_completedDeletions{ 0 };
+};
+
+} // namespace KDGpu
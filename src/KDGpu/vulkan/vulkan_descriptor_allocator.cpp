@@ -0,0 +1,394 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "vulkan_descriptor_allocator.h"
+
+#include <KDGpu/vulkan/vulkan_deletion_queue.h>
+#include <KDGpu/utils/logging.h>
+
+#include <algorithm>
+#include <assert.h>
+
+namespace KDGpu {
+
+namespace {
+
+// Transient pools are shared by all layouts, don't let a single large binding blow up their size
+constexpr uint32_t MaxTransientDescriptorsPerSet = 64;
+
+} // namespace
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator(VkDevice device, VulkanDeletionQueue *deletionQueue)
+    : m_device(device)
+    , m_deletionQueue(deletionQueue)
+{
+}
+
+VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+{
+    // destroyAll() must have been called while the device was still alive
+    assert(m_layouts.empty());
+    assert(m_transientPoolCount == 0);
+}
+
+void VulkanDescriptorAllocator::registerLayout(const Handle<BindGroupLayout_t> &layoutHandle, VkDescriptorSetLayout layout,
+                                               std::vector<VkDescriptorPoolSize> setSizes, bool updateAfterBind,
+                                               std::optional<VariableBinding> variableBinding)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Layouts which can't be allocated from the transient pools must not change their sizes. Their
+    // transient bind groups get sets from the pools of their layout instead.
+    const bool transient = !updateAfterBind && !variableBinding.has_value() &&
+            std::all_of(setSizes.begin(), setSizes.end(), [](const VkDescriptorPoolSize &setSize) {
+                return setSize.descriptorCount <= MaxTransientDescriptorsPerSet;
+            });
+    bool transientSizesChanged = false;
+    if (transient) {
+        for (const VkDescriptorPoolSize &setSize : setSizes) {
+            const uint32_t count = setSize.descriptorCount;
+            auto it = std::find_if(m_transientSetSizes.begin(), m_transientSetSizes.end(), [&](const VkDescriptorPoolSize &size) {
+                return size.type == setSize.type;
+            });
+            if (it == m_transientSetSizes.end()) {
+                m_transientSetSizes.push_back({ setSize.type, count });
+                transientSizesChanged = true;
+            } else if (it->descriptorCount < count) {
+                it->descriptorCount = count;
+                transientSizesChanged = true;
+            }
+        }
+    }
+
+    // The idle transient pools can't serve the new layout, replace them on demand
+    if (transientSizesChanged) {
+        ++m_transientSizesVersion;
+        for (VkDescriptorPool pool : m_freeTransientPools)
+            vkDestroyDescriptorPool(m_device, pool, nullptr);
+        m_transientPoolCount -= static_cast<uint32_t>(m_freeTransientPools.size());
+        m_freeTransientPools.clear();
+    }
+
+    LayoutPools &layoutPools = m_layouts[layoutHandle];
+    layoutPools.layout = layout;
+    layoutPools.setSizes = std::move(setSizes);
+    layoutPools.poolFlags = updateAfterBind ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
+    layoutPools.variableBinding = variableBinding;
+    layoutPools.transient = transient;
+}
+
+void VulkanDescriptorAllocator::unregisterLayout(const Handle<BindGroupLayout_t> &layoutHandle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_layouts.find(layoutHandle);
+    if (it == m_layouts.end())
+        return;
+
+    // Bind groups may outlive their layout, its pools go with the last of them
+    it->second.unregistered = true;
+    it->second.layout = VK_NULL_HANDLE;
+    if (it->second.liveSets == 0) {
+        destroyLayoutPools(it->second);
+        m_layouts.erase(it);
+    }
+}
+
+std::pair<VkDescriptorSet, VkDescriptorPool> VulkanDescriptorAllocator::allocate(const Handle<BindGroupLayout_t> &layoutHandle, uint32_t variableCount)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_layouts.find(layoutHandle);
+    if (it == m_layouts.end() || it->second.unregistered)
+        return { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    LayoutPools &layoutPools = it->second;
+
+    if (layoutPools.variableBinding)
+        return allocateVariable(layoutPools, variableCount);
+
+    // Sets released before the submissions still in flight may not be overwritten yet
+    if (!layoutPools.freeSets.empty() && m_deletionQueue->hasRetired(layoutPools.freeSets.front().serial)) {
+        const ReleasedSet releasedSet = layoutPools.freeSets.front();
+        layoutPools.freeSets.pop_front();
+        ++layoutPools.liveSets;
+        return { releasedSet.descriptorSet, releasedSet.pool };
+    }
+
+    if (layoutPools.remainingInLastPool == 0) {
+        const uint32_t maxSets = layoutPools.nextPoolSize;
+        VkDescriptorPool pool = createPool(layoutPools.setSizes, maxSets, layoutPools.poolFlags);
+        if (pool == VK_NULL_HANDLE)
+            return { VK_NULL_HANDLE, VK_NULL_HANDLE };
+        layoutPools.pools.push_back(pool);
+        layoutPools.capacity += maxSets;
+        layoutPools.remainingInLastPool = maxSets;
+        layoutPools.nextPoolSize = std::min(maxSets * 2, MaxSetsPerPool);
+    }
+
+    // The pool is sized for exactly maxSets sets of this layout and never freed into, this cannot run out
+    VkDescriptorPool pool = layoutPools.pools.back();
+    VkDescriptorSet descriptorSet = allocateFromPool(pool, layoutPools.layout);
+    if (descriptorSet == VK_NULL_HANDLE)
+        return { VK_NULL_HANDLE, VK_NULL_HANDLE };
+
+    --layoutPools.remainingInLastPool;
+    ++layoutPools.liveSets;
+    return { descriptorSet, pool };
+}
+
+void VulkanDescriptorAllocator::release(const Handle<BindGroupLayout_t> &layoutHandle, VkDescriptorSet descriptorSet, VkDescriptorPool pool)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_layouts.find(layoutHandle);
+    if (it == m_layouts.end())
+        return;
+    LayoutPools &layoutPools = it->second;
+
+    assert(layoutPools.liveSets > 0);
+    --layoutPools.liveSets;
+
+    // The pool only held this set
+    if (layoutPools.variableBinding) {
+        std::erase(layoutPools.pools, pool);
+        --layoutPools.capacity;
+        m_deletionQueue->enqueue(VK_OBJECT_TYPE_DESCRIPTOR_POOL, pool);
+    }
+
+    if (layoutPools.unregistered && layoutPools.liveSets == 0) {
+        destroyLayoutPools(layoutPools);
+        m_layouts.erase(it);
+        return;
+    }
+    if (layoutPools.variableBinding)
+        return;
+
+    layoutPools.freeSets.push_back(ReleasedSet{
+            .serial = m_deletionQueue->lastSubmittedSerial(),
+            .descriptorSet = descriptorSet,
+            .pool = pool });
+}
+
+bool VulkanDescriptorAllocator::supportsTransient(const Handle<BindGroupLayout_t> &layoutHandle) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_layouts.find(layoutHandle);
+    return it != m_layouts.end() && it->second.transient;
+}
+
+std::pair<VkDescriptorSet, VkDescriptorPool> VulkanDescriptorAllocator::allocateTransient(const Handle<BindGroupLayout_t> &layoutHandle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_layouts.find(layoutHandle);
+    if (it == m_layouts.end() || it->second.unregistered)
+        return { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    const VkDescriptorSetLayout layout = it->second.layout;
+
+    recycleRetiredTransientFrames();
+
+    if (!m_currentFrame.pools.empty()) {
+        VkDescriptorPool pool = m_currentFrame.pools.back().pool;
+        if (VkDescriptorSet descriptorSet = allocateFromPool(pool, layout); descriptorSet != VK_NULL_HANDLE) {
+            ++m_transientSets;
+            return { descriptorSet, pool };
+        }
+    }
+
+    // The current pool is exhausted, move on to a fresh one
+    VkDescriptorPool pool = acquireTransientPool();
+    if (pool == VK_NULL_HANDLE)
+        return { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    VkDescriptorSet descriptorSet = allocateFromPool(pool, layout);
+    if (descriptorSet == VK_NULL_HANDLE) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "The layout of a transient bind group does not fit in a transient descriptor pool");
+        return { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    }
+    ++m_transientSets;
+    return { descriptorSet, pool };
+}
+
+void VulkanDescriptorAllocator::addTransientBindGroup(const Handle<BindGroup_t> &bindGroupHandle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_currentFrame.bindGroups.push_back(bindGroupHandle);
+}
+
+std::vector<Handle<BindGroup_t>> VulkanDescriptorAllocator::beginTransientFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<Handle<BindGroup_t>> bindGroups = std::move(m_currentFrame.bindGroups);
+    m_currentFrame.bindGroups.clear();
+    m_transientSets = 0;
+
+    if (!m_currentFrame.pools.empty()) {
+        m_currentFrame.serial = m_deletionQueue->lastSubmittedSerial();
+        m_retiredFrames.push_back(std::move(m_currentFrame));
+        m_currentFrame = TransientFrame{};
+    }
+
+    return bindGroups;
+}
+
+void VulkanDescriptorAllocator::destroyAll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto &[layoutHandle, layoutPools] : m_layouts) {
+        for (VkDescriptorPool pool : layoutPools.pools)
+            vkDestroyDescriptorPool(m_device, pool, nullptr);
+    }
+    m_layouts.clear();
+
+    m_retiredFrames.push_back(std::move(m_currentFrame));
+    m_currentFrame = TransientFrame{};
+    for (const TransientFrame &frame : m_retiredFrames) {
+        for (const TransientPool &transientPool : frame.pools)
+            vkDestroyDescriptorPool(m_device, transientPool.pool, nullptr);
+    }
+    m_retiredFrames.clear();
+    for (VkDescriptorPool pool : m_freeTransientPools)
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+    m_freeTransientPools.clear();
+    m_transientPoolCount = 0;
+    m_transientSets = 0;
+}
+
+DescriptorPoolStatistics VulkanDescriptorAllocator::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    DescriptorPoolStatistics stats;
+    for (const auto &[layoutHandle, layoutPools] : m_layouts) {
+        stats.poolCount += static_cast<uint32_t>(layoutPools.pools.size());
+        stats.allocatedSets += layoutPools.liveSets;
+        stats.maxSets += layoutPools.capacity;
+        stats.freeSets += static_cast<uint32_t>(layoutPools.freeSets.size());
+    }
+    stats.poolCount += m_transientPoolCount;
+    stats.allocatedSets += m_transientSets;
+    stats.maxSets += m_transientPoolCount * TransientSetsPerPool;
+    stats.transientPoolCount = m_transientPoolCount;
+    return stats;
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::createPool(const std::vector<VkDescriptorPoolSize> &setSizes, uint32_t maxSets,
+                                                       VkDescriptorPoolCreateFlags flags) const
+{
+    std::vector<VkDescriptorPoolSize> poolSizes = setSizes;
+    for (VkDescriptorPoolSize &poolSize : poolSizes)
+        poolSize.descriptorCount *= maxSets;
+
+    // No VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, sets are recycled rather than freed
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = maxSets;
+    poolInfo.flags = flags;
+
+    VkDescriptorPool pool{ VK_NULL_HANDLE };
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Failed to create a descriptor pool for {} sets", maxSets);
+        return VK_NULL_HANDLE;
+    }
+    return pool;
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::allocateFromPool(VkDescriptorPool pool, VkDescriptorSetLayout layout, const uint32_t *variableCount) const
+{
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo = {};
+    if (variableCount) {
+        variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        variableCountInfo.descriptorSetCount = 1;
+        variableCountInfo.pDescriptorCounts = variableCount;
+        allocInfo.pNext = &variableCountInfo;
+    }
+
+    VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return descriptorSet;
+}
+
+std::pair<VkDescriptorSet, VkDescriptorPool> VulkanDescriptorAllocator::allocateVariable(LayoutPools &layoutPools, uint32_t variableCount)
+{
+    const VariableBinding &variableBinding = *layoutPools.variableBinding;
+    const uint32_t count = std::min(variableCount, variableBinding.maxCount);
+
+    // Pool sizes can't be 0, even when the set asks for no variable descriptor at all
+    std::vector<VkDescriptorPoolSize> setSizes = layoutPools.setSizes;
+    auto it = std::find_if(setSizes.begin(), setSizes.end(), [&](const VkDescriptorPoolSize &size) {
+        return size.type == variableBinding.type;
+    });
+    if (it == setSizes.end())
+        setSizes.push_back({ variableBinding.type, std::max(count, 1u) });
+    else
+        it->descriptorCount += count;
+
+    VkDescriptorPool pool = createPool(setSizes, 1, layoutPools.poolFlags);
+    if (pool == VK_NULL_HANDLE)
+        return { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    VkDescriptorSet descriptorSet = allocateFromPool(pool, layoutPools.layout, &count);
+    if (descriptorSet == VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+        return { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    }
+
+    layoutPools.pools.push_back(pool);
+    ++layoutPools.capacity;
+    ++layoutPools.liveSets;
+    return { descriptorSet, pool };
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::acquireTransientPool()
+{
+    VkDescriptorPool pool{ VK_NULL_HANDLE };
+    if (!m_freeTransientPools.empty()) {
+        pool = m_freeTransientPools.back();
+        m_freeTransientPools.pop_back();
+    } else {
+        pool = createPool(m_transientSetSizes, TransientSetsPerPool);
+        if (pool == VK_NULL_HANDLE)
+            return VK_NULL_HANDLE;
+        ++m_transientPoolCount;
+    }
+
+    m_currentFrame.pools.push_back(TransientPool{ .pool = pool, .sizesVersion = m_transientSizesVersion });
+    return pool;
+}
+
+void VulkanDescriptorAllocator::recycleRetiredTransientFrames()
+{
+    while (!m_retiredFrames.empty() && m_deletionQueue->hasRetired(m_retiredFrames.front().serial)) {
+        for (const TransientPool &transientPool : m_retiredFrames.front().pools) {
+            if (transientPool.sizesVersion == m_transientSizesVersion) {
+                vkResetDescriptorPool(m_device, transientPool.pool, 0);
+                m_freeTransientPools.push_back(transientPool.pool);
+            } else {
+                vkDestroyDescriptorPool(m_device, transientPool.pool, nullptr);
+                --m_transientPoolCount;
+            }
+        }
+        m_retiredFrames.pop_front();
+    }
+}
+
+void VulkanDescriptorAllocator::destroyLayoutPools(const LayoutPools &layoutPools)
+{
+    // Sets released just before may still be in use by submissions in flight
+    for (VkDescriptorPool pool : layoutPools.pools)
+        m_deletionQueue->enqueue(VK_OBJECT_TYPE_DESCRIPTOR_POOL, pool);
+}
+
+} // namespace KDGpu
@@ -0,0 +1,157 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/handle.h>
+#include <KDGpu/resource_statistics.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace KDGpu {
+
+class VulkanDeletionQueue;
+struct BindGroup_t;
+struct BindGroupLayout_t;
+
+/**
+ * @brief VulkanDescriptorAllocator
+ * \ingroup vulkan
+ *
+ * Allocates the descriptor sets of the bind groups of a device.
+ *
+ * Every bind group layout gets pools of its own, sized from its bindings so
+ * that no descriptor is wasted. Each new pool holds twice as many sets as the
+ * previous one, up to MaxSetsPerPool. Released sets are kept on a free list of
+ * their layout and handed out again once the submissions which could be using
+ * them have retired, so allocating is O(1) and sets are never returned to
+ * their pool. The pools of a layout are destroyed once the layout and all of
+ * its sets are gone.
+ *
+ * Transient sets are allocated from pools belonging to the current frame.
+ * beginTransientFrame() closes the frame, its pools are reset as a whole with
+ * vkResetDescriptorPool and reused once its submissions have retired. Layouts
+ * with large bindings would blow up the size of these shared pools, their
+ * transient bind groups are allocated like the other ones.
+ *
+ * Layouts with a variable count binding get one pool per set, sized for the
+ * number of descriptors that set asks for. The pool is destroyed through the
+ * deletion queue when the set is released.
+ */
+class KDGPU_EXPORT VulkanDescriptorAllocator
+{
+public:
+    static constexpr uint32_t MaxSetsPerPool = 1024;
+    static constexpr uint32_t TransientSetsPerPool = 256;
+
+    VulkanDescriptorAllocator(VkDevice device, VulkanDeletionQueue *deletionQueue);
+    ~VulkanDescriptorAllocator();
+
+    VulkanDescriptorAllocator(const VulkanDescriptorAllocator &) = delete;
+    VulkanDescriptorAllocator &operator=(const VulkanDescriptorAllocator &) = delete;
+
+    // The binding of a layout whose number of descriptors is chosen by each set
+    struct VariableBinding {
+        VkDescriptorType type;
+        uint32_t maxCount;
+    };
+
+    // setSizes holds the number of descriptors of each type needed by a single set, leaving out
+    // the variable count binding. Layouts created for update after bind need pools created for it.
+    void registerLayout(const Handle<BindGroupLayout_t> &layoutHandle, VkDescriptorSetLayout layout,
+                        std::vector<VkDescriptorPoolSize> setSizes, bool updateAfterBind = false,
+                        std::optional<VariableBinding> variableBinding = std::nullopt);
+    void unregisterLayout(const Handle<BindGroupLayout_t> &layoutHandle);
+
+    // Returns the set and the pool it came from, or VK_NULL_HANDLEs on failure. variableCount
+    // is the number of descriptors of the variable count binding of the layout, if any.
+    std::pair<VkDescriptorSet, VkDescriptorPool> allocate(const Handle<BindGroupLayout_t> &layoutHandle, uint32_t variableCount = 0);
+    void release(const Handle<BindGroupLayout_t> &layoutHandle, VkDescriptorSet descriptorSet, VkDescriptorPool pool);
+
+    // Transient pools are shared by all the layouts, they can't serve the update after bind
+    // and variable count ones, nor those with large bindings
+    bool supportsTransient(const Handle<BindGroupLayout_t> &layoutHandle) const;
+
+    std::pair<VkDescriptorSet, VkDescriptorPool> allocateTransient(const Handle<BindGroupLayout_t> &layoutHandle);
+    // Records a bind group using a transient set, to be invalidated when its frame is closed
+    void addTransientBindGroup(const Handle<BindGroup_t> &bindGroupHandle);
+    // Closes the current frame and returns the bind groups allocated during it
+    std::vector<Handle<BindGroup_t>> beginTransientFrame();
+
+    // Destroys every pool straight away, the device must be idle
+    void destroyAll();
+
+    DescriptorPoolStatistics statistics() const;
+
+private:
+    struct ReleasedSet {
+        uint64_t serial;
+        VkDescriptorSet descriptorSet;
+        VkDescriptorPool pool;
+    };
+
+    struct TransientPool {
+        VkDescriptorPool pool;
+        uint32_t sizesVersion; // Pools created for outdated sizes are not recycled
+    };
+
+    struct LayoutPools {
+        VkDescriptorSetLayout layout{ VK_NULL_HANDLE };
+        std::vector<VkDescriptorPoolSize> setSizes;
+        std::vector<VkDescriptorPool> pools;
+        uint32_t nextPoolSize{ 16 };
+        uint32_t remainingInLastPool{ 0 };
+        uint32_t capacity{ 0 }; // Sets over all the pools
+        uint32_t liveSets{ 0 }; // Handed out and not released yet
+        std::deque<ReleasedSet> freeSets; // Ordered by serial
+        VkDescriptorPoolCreateFlags poolFlags{ 0 };
+        std::optional<VariableBinding> variableBinding; // Then every set has a pool of its own
+        bool transient{ false }; // Can be allocated from the transient pools
+        bool unregistered{ false };
+    };
+
+    struct TransientFrame {
+        uint64_t serial{ 0 };
+        std::vector<TransientPool> pools;
+        std::vector<Handle<BindGroup_t>> bindGroups;
+    };
+
+    VkDescriptorPool createPool(const std::vector<VkDescriptorPoolSize> &setSizes, uint32_t maxSets,
+                                VkDescriptorPoolCreateFlags flags = 0) const;
+    VkDescriptorSet allocateFromPool(VkDescriptorPool pool, VkDescriptorSetLayout layout, const uint32_t *variableCount = nullptr) const;
+    std::pair<VkDescriptorSet, VkDescriptorPool> allocateVariable(LayoutPools &layoutPools, uint32_t variableCount);
+    VkDescriptorPool acquireTransientPool();
+    void recycleRetiredTransientFrames();
+    void destroyLayoutPools(const LayoutPools &layoutPools);
+
+    VkDevice m_device{ VK_NULL_HANDLE };
+    VulkanDeletionQueue *m_deletionQueue{ nullptr };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<Handle<BindGroupLayout_t>, LayoutPools> m_layouts;
+
+    TransientFrame m_currentFrame;
+    std::deque<TransientFrame> m_retiredFrames; // Ordered by serial
+    std::vector<VkDescriptorPool> m_freeTransientPools;
+    std::vector<VkDescriptorPoolSize> m_transientSetSizes; // Grown to cover every registered layout
+    uint32_t m_transientSizesVersion{ 0 };
+    uint32_t m_transientPoolCount{ 0 };
+    uint32_t m_transientSets{ 0 }; // Allocated in the current frame
+};
+
+} // namespace KDGpu
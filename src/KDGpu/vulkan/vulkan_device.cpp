@@ -14,6 +14,7 @@
 #include <KDGpu/vulkan/vulkan_queue.h>
 #include <KDGpu/vulkan/vulkan_resource_manager.h>
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace KDGpu {
@@ -32,15 +33,56 @@ VulkanDevice::VulkanDevice(VkDevice _device,
     VulkanAdapter *vulkanAdapter = vulkanResourceManager->getAdapter(adapterHandle);
     VulkanInstance *vulkanInstance = vulkanResourceManager->getInstance(vulkanAdapter->instanceHandle);
 
+    // Check which of the optional extensions we make use of are available. We only enable
+    // them when creating the VkDevice ourselves, so don't rely on them for a wrapped device.
+    const auto adapterExtensions = vulkanAdapter->extensions();
+    for (const auto &extension : adapterExtensions) {
+        if (extension.name == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)
+            memoryBudgetEnabled = isOwned;
+    }
+
     VmaAllocatorCreateInfo allocatorInfo = {};
     allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_2;
     allocatorInfo.instance = vulkanInstance->instance;
     allocatorInfo.physicalDevice = vulkanAdapter->physicalDevice;
     allocatorInfo.device = device;
+    if (memoryBudgetEnabled)
+        allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
 
     if (vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS)
         SPDLOG_LOGGER_CRITICAL(Logger::logger(), "Failed to create Vulkan memory allocator!");
 
+    // Objects released while the GPU may still be using them are destroyed once their submissions retire
+    deletionQueue = std::make_unique<VulkanDeletionQueue>(device, allocator);
+    descriptorAllocator = std::make_unique<VulkanDescriptorAllocator>(device, deletionQueue.get());
+    memoryUsageCounters = std::make_unique<VulkanMemoryUsageCounters>();
+    memoryBudgetMonitor = std::make_unique<VulkanMemoryBudgetMonitor>();
+    aliasedAllocations = std::make_unique<VulkanAliasedAllocations>();
+    bufferUploadCounters = std::make_unique<VulkanBufferUploadCounters>();
+    descriptorUpdateCounters = std::make_unique<VulkanDescriptorUpdateCounters>();
+    samplerCache = std::make_unique<VulkanObjectCache<VulkanSamplerKey, Sampler_t>>();
+    textureViewCache = std::make_unique<VulkanObjectCache<VulkanTextureViewKey, TextureView_t>>();
+    bindGroupLayoutCache = std::make_unique<VulkanObjectCache<VulkanBindGroupLayoutKey, BindGroupLayout_t>>();
+    pipelineLayoutCache = std::make_unique<VulkanObjectCache<VulkanPipelineLayoutKey, PipelineLayout_t>>();
+
+    // With resizable BAR or on unified memory architectures the largest device local heap is
+    // host visible. Without it, only a small window of device local memory is mappable which
+    // we don't want GpuOnly buffers to compete for.
+    const VkPhysicalDeviceMemoryProperties *memoryProperties = nullptr;
+    vmaGetMemoryProperties(allocator, &memoryProperties);
+    VkDeviceSize largestDeviceLocalHeap = 0;
+    VkDeviceSize largestMappableDeviceLocalHeap = 0;
+    constexpr VkMemoryPropertyFlags mappableDeviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    for (uint32_t i = 0; i < memoryProperties->memoryTypeCount; ++i) {
+        const VkMemoryType &memoryType = memoryProperties->memoryTypes[i];
+        const VkDeviceSize heapSize = memoryProperties->memoryHeaps[memoryType.heapIndex].size;
+        if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0)
+            largestDeviceLocalHeap = std::max(largestDeviceLocalHeap, heapSize);
+        if ((memoryType.propertyFlags & mappableDeviceLocal) == mappableDeviceLocal)
+            largestMappableDeviceLocalHeap = std::max(largestMappableDeviceLocalHeap, heapSize);
+    }
+    hostVisibleDeviceLocalMemory = largestDeviceLocalHeap > 0 && largestMappableDeviceLocalHeap == largestDeviceLocalHeap;
+
     // Resize the vector of command pools to have one for each queue family
     const auto queueTypes = vulkanAdapter->queryQueueTypes();
     const auto queueTypeCount = queueTypes.size();
@@ -49,7 +91,6 @@ VulkanDevice::VulkanDevice(VkDevice _device,
         commandPools[i] = VK_NULL_HANDLE;
 
     // Check to see if we have the VK_KHR_synchronization2 extension or not
-    const auto adapterExtensions = vulkanAdapter->extensions();
     for (const auto &extension : adapterExtensions) {
         if (extension.name == "VK_KHR_synchronization2") {
             PFN_vkCmdPipelineBarrier2KHR vkCmdPipelineBarrier2KHR = PFN_vkCmdPipelineBarrier2KHR(
@@ -61,6 +102,7 @@ VulkanDevice::VulkanDevice(VkDevice _device,
 }
 
 std::vector<QueueDescription> VulkanDevice::getQueues(ResourceManager *resourceManager,
+                                                      const Handle<Device_t> &deviceHandle,
                                                       const std::vector<QueueRequest> &queueRequests,
                                                       std::span<AdapterQueueType> queueTypes)
 {
@@ -80,7 +122,7 @@ std::vector<QueueDescription> VulkanDevice::getQueues(ResourceManager *resourceM
         for (uint32_t j = 0; j < queueCountForFamily; ++j) {
             VkQueue vkQueue{ VK_NULL_HANDLE };
             vkGetDeviceQueue(device, queueRequest.queueTypeIndex, j, &vkQueue);
-            const auto queueHandle = vulkanResourceManager->insertQueue(VulkanQueue{ vkQueue, vulkanResourceManager });
+            const auto queueHandle = vulkanResourceManager->insertQueue(VulkanQueue{ vkQueue, vulkanResourceManager, deviceHandle });
 
             QueueDescription queueDescription{
                 .queue = queueHandle,
@@ -101,6 +143,96 @@ std::vector<QueueDescription> VulkanDevice::getQueues(ResourceManager *resourceM
 void VulkanDevice::waitUntilIdle()
 {
     vkDeviceWaitIdle(device);
+
+    // Everything submitted so far has completed, release anything waiting on it
+    deletionQueue->retireAll();
+}
+
+void VulkanDevice::resetTransientBindGroups()
+{
+    vulkanResourceManager->removeTransientBindGroups(descriptorAllocator->beginTransientFrame());
+}
+
+void VulkanDevice::collectGarbage()
+{
+    deletionQueue->collect();
+    checkMemoryBudget();
+}
+
+DeletionQueueStatistics VulkanDevice::deletionQueueStatistics() const
+{
+    return deletionQueue->statistics();
+}
+
+MemoryBudget VulkanDevice::memoryBudget() const
+{
+    MemoryBudget memoryBudget;
+    memoryBudget.budgetExtensionEnabled = memoryBudgetEnabled;
+    if (allocator == VK_NULL_HANDLE)
+        return memoryBudget;
+
+    const VkPhysicalDeviceMemoryProperties *memoryProperties = nullptr;
+    vmaGetMemoryProperties(allocator, &memoryProperties);
+
+    // Without the extension VMA estimates the usage from its own allocations
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> vmaBudgets{};
+    vmaGetHeapBudgets(allocator, vmaBudgets.data());
+
+    const uint32_t heapCount = memoryProperties->memoryHeapCount;
+    memoryBudget.heaps.reserve(heapCount);
+    for (uint32_t i = 0; i < heapCount; ++i) {
+        const VkMemoryHeap &heap = memoryProperties->memoryHeaps[i];
+        const VmaBudget &vmaBudget = vmaBudgets[i];
+        memoryBudget.heaps.push_back(MemoryHeapBudget{
+                .heapIndex = i,
+                .deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+                .heapSize = heap.size,
+                .usage = vmaBudget.usage,
+                .budget = vmaBudget.budget,
+                .blockBytes = vmaBudget.statistics.blockBytes,
+                .allocationBytes = vmaBudget.statistics.allocationBytes });
+    }
+    return memoryBudget;
+}
+
+void VulkanDevice::setMemoryBudgetCallback(float usageThreshold, const MemoryBudgetCallback &callback)
+{
+    std::lock_guard<std::mutex> lock(memoryBudgetMonitor->mutex);
+    memoryBudgetMonitor->usageThreshold = usageThreshold;
+    memoryBudgetMonitor->callback = callback;
+    memoryBudgetMonitor->heapsOverThreshold.clear();
+    memoryBudgetMonitor->enabled.store(static_cast<bool>(callback), std::memory_order_release);
+}
+
+void VulkanDevice::checkMemoryBudget()
+{
+    if (!memoryBudgetMonitor->enabled.load(std::memory_order_acquire))
+        return;
+
+    const MemoryBudget budget = memoryBudget();
+
+    // Collect the heaps which just crossed the threshold, and invoke the callback
+    // without holding the lock so that it may release resources or reset the callback.
+    std::vector<MemoryHeapBudget> crossedHeaps;
+    MemoryBudgetCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(memoryBudgetMonitor->mutex);
+        auto &heapsOverThreshold = memoryBudgetMonitor->heapsOverThreshold;
+        heapsOverThreshold.resize(budget.heaps.size(), false);
+        for (const MemoryHeapBudget &heap : budget.heaps) {
+            const bool overThreshold = heap.usageRatio() >= memoryBudgetMonitor->usageThreshold;
+            if (overThreshold && !heapsOverThreshold[heap.heapIndex])
+                crossedHeaps.push_back(heap);
+            heapsOverThreshold[heap.heapIndex] = overThreshold;
+        }
+        if (!crossedHeaps.empty())
+            callback = memoryBudgetMonitor->callback;
+    }
+
+    if (!callback)
+        return;
+    for (const MemoryHeapBudget &heap : crossedHeaps)
+        callback(heap);
 }
 
 } // namespace KDGpu
@@ -11,22 +11,206 @@
 #pragma once
 
 #include <KDGpu/api/api_device.h>
+#include <KDGpu/vulkan/vulkan_bind_group_layout.h>
+#include <KDGpu/vulkan/vulkan_deletion_queue.h>
+#include <KDGpu/vulkan/vulkan_descriptor_allocator.h>
 #include <KDGpu/vulkan/vulkan_framebuffer.h>
+#include <KDGpu/vulkan/vulkan_pipeline_layout.h>
 #include <KDGpu/vulkan/vulkan_render_pass.h>
+#include <KDGpu/vulkan/vulkan_sampler.h>
+#include <KDGpu/vulkan/vulkan_texture_view.h>
 
+#include <KDGpu/defragmentation.h>
 #include <KDGpu/handle.h>
 #include <KDGpu/kdgpu_export.h>
+#include <KDGpu/resource_statistics.h>
 
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace KDGpu {
 
 class VulkanResourceManager;
 
 struct Adapter_t;
+struct BindGroupLayout_t;
+struct Buffer_t;
+struct PipelineLayout_t;
+struct Sampler_t;
+struct TextureView_t;
+
+/**
+ * @brief VulkanMemoryUsageCounters
+ * \ingroup vulkan
+ *
+ * Running totals of the memory allocated for buffers and textures, bucketed by
+ * MemoryUsage. Buffers and textures may be created from several threads at
+ * once so the counters are relaxed atomics.
+ */
+struct KDGPU_EXPORT VulkanMemoryUsageCounters {
+    void add(MemoryUsage usage, DeviceSize size) noexcept
+    {
+        const auto index = static_cast<uint32_t>(usage);
+        allocationCounts[index].fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes[index].fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void remove(MemoryUsage usage, DeviceSize size) noexcept
+    {
+        const auto index = static_cast<uint32_t>(usage);
+        allocationCounts[index].fetch_sub(1, std::memory_order_relaxed);
+        allocatedBytes[index].fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint32_t>, MemoryUsageCount> allocationCounts{};
+    std::array<std::atomic<DeviceSize>, MemoryUsageCount> allocatedBytes{};
+};
+
+/**
+ * @brief VulkanBufferUploadCounters
+ * \ingroup vulkan
+ *
+ * Number of buffer uploads which wrote directly into host visible device local
+ * memory and of those which went through a staging copy.
+ */
+struct KDGPU_EXPORT VulkanBufferUploadCounters {
+    std::atomic<uint64_t> directWrites{ 0 };
+    std::atomic<DeviceSize> directWriteBytes{ 0 };
+    std::atomic<uint64_t> stagedUploads{ 0 };
+    std::atomic<DeviceSize> stagedUploadBytes{ 0 };
+};
+
+/**
+ * @brief VulkanDescriptorUpdateCounters
+ * \ingroup vulkan
+ *
+ * Number of bind group updates written with a single vkUpdateDescriptorSets
+ * and of those written with the update template of their layout.
+ */
+struct KDGPU_EXPORT VulkanDescriptorUpdateCounters {
+    std::atomic<uint64_t> batchedUpdates{ 0 };
+    std::atomic<uint64_t> templateUpdates{ 0 };
+    std::atomic<uint64_t> descriptors{ 0 };
+};
+
+/**
+ * @brief VulkanMemoryBudgetMonitor
+ * \ingroup vulkan
+ *
+ * Invokes the memory budget callback of a device once per heap when the usage
+ * of the heap goes over the threshold. The callback is armed again once the
+ * usage went back under the threshold.
+ */
+struct KDGPU_EXPORT VulkanMemoryBudgetMonitor {
+    std::mutex mutex;
+    std::atomic<bool> enabled{ false };
+    float usageThreshold{ 1.0f };
+    MemoryBudgetCallback callback;
+    std::vector<bool> heapsOverThreshold;
+};
+
+/**
+ * @brief VulkanAliasedAllocations
+ * \ingroup vulkan
+ *
+ * Number of textures still bound to each allocation shared by aliased textures.
+ * The allocation is released together with the last of its textures.
+ */
+struct KDGPU_EXPORT VulkanAliasedAllocations {
+    void add(VmaAllocation allocation, uint32_t textureCount)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        textureCounts[allocation] = textureCount;
+    }
+
+    // Returns true if this was the last texture using the allocation
+    bool release(VmaAllocation allocation)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = textureCounts.find(allocation);
+        if (it == textureCounts.end())
+            return true;
+        if (--it->second > 0)
+            return false;
+        textureCounts.erase(it);
+        return true;
+    }
+
+    std::mutex mutex;
+    std::unordered_map<VmaAllocation, uint32_t> textureCounts;
+};
+
+/**
+ * @brief VulkanObjectCache
+ * \ingroup vulkan
+ *
+ * Hash-conses the objects created from identical descriptions. Every lookup
+ * which finds an object adds a reference to it, the object must only be
+ * destroyed once release() reports that its last reference is gone.
+ *
+ * Callers hold the mutex around a lookup and the insertion of the object created
+ * on a miss, so that concurrent creations cannot duplicate an object.
+ */
+template<typename Key, typename H>
+struct VulkanObjectCache {
+    // Returns the cached object with one more reference, or an invalid handle
+    Handle<H> acquire(const Key &key)
+    {
+        const auto it = entries.find(key);
+        if (it == entries.end())
+            return {};
+        ++it->second.refCount;
+        ++hitCount;
+        return it->second.handle;
+    }
+
+    void insert(const Key &key, const Handle<H> &handle)
+    {
+        entries.emplace(key, Entry{ handle, 1 });
+        keys.emplace(handle, key);
+    }
+
+    // Adds a reference to a cached object, returns false if it is not cached
+    bool retain(const Handle<H> &handle)
+    {
+        const auto keyIt = keys.find(handle);
+        if (keyIt == keys.end())
+            return false;
+        ++entries.find(keyIt->second)->second.refCount;
+        return true;
+    }
+
+    // Returns true if this was the last reference, or if the object is not cached
+    bool release(const Handle<H> &handle)
+    {
+        const auto keyIt = keys.find(handle);
+        if (keyIt == keys.end())
+            return true;
+        const auto it = entries.find(keyIt->second);
+        if (--it->second.refCount > 0)
+            return false;
+        entries.erase(it);
+        keys.erase(keyIt);
+        return true;
+    }
+
+    struct Entry {
+        Handle<H> handle;
+        uint32_t refCount;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<Key, Entry> entries;
+    std::unordered_map<Handle<H>, Key> keys;
+    uint64_t hitCount{ 0 };
+};
 
 /**
  * @brief VulkanDevice
@@ -48,11 +232,22 @@ struct KDGPU_EXPORT VulkanDevice : public ApiDevice {
     VulkanDevice &operator=(VulkanDevice &&) noexcept = default;
 
     std::vector<QueueDescription> getQueues(ResourceManager *resourceManager,
+                                            const Handle<Device_t> &deviceHandle,
                                             const std::vector<QueueRequest> &queueRequests,
                                             std::span<AdapterQueueType> queueTypes) final;
 
     void waitUntilIdle() final;
 
+    void collectGarbage() final;
+    void resetTransientBindGroups() final;
+    DeletionQueueStatistics deletionQueueStatistics() const final;
+
+    MemoryBudget memoryBudget() const final;
+    void setMemoryBudgetCallback(float usageThreshold, const MemoryBudgetCallback &callback) final;
+
+    // Cheap when no callback is set, called after allocating device memory
+    void checkMemoryBudget();
+
     VkDevice device{ VK_NULL_HANDLE };
 
     VulkanResourceManager *vulkanResourceManager{ nullptr };
@@ -60,11 +255,33 @@ struct KDGPU_EXPORT VulkanDevice : public ApiDevice {
     VmaAllocator allocator{ VK_NULL_HANDLE };
     std::vector<QueueDescription> queueDescriptions;
     std::vector<VkCommandPool> commandPools; // Indexed by queue type (family)
-    std::vector<VkDescriptorPool> descriptorSetPools;
     std::unordered_map<VulkanRenderPassKey, Handle<RenderPass_t>> renderPasses;
     std::unordered_map<VulkanFramebufferKey, Handle<Framebuffer_t>> framebuffers;
+    std::unique_ptr<VulkanDeletionQueue> deletionQueue;
+    std::unique_ptr<VulkanDescriptorAllocator> descriptorAllocator;
+    std::unique_ptr<VulkanMemoryUsageCounters> memoryUsageCounters;
+    std::unique_ptr<VulkanMemoryBudgetMonitor> memoryBudgetMonitor;
+    std::unique_ptr<VulkanAliasedAllocations> aliasedAllocations;
+    std::unique_ptr<VulkanBufferUploadCounters> bufferUploadCounters;
+    std::unique_ptr<VulkanDescriptorUpdateCounters> descriptorUpdateCounters;
+    std::unique_ptr<VulkanObjectCache<VulkanSamplerKey, Sampler_t>> samplerCache;
+    std::unique_ptr<VulkanObjectCache<VulkanTextureViewKey, TextureView_t>> textureViewCache;
+    std::unique_ptr<VulkanObjectCache<VulkanBindGroupLayoutKey, BindGroupLayout_t>> bindGroupLayoutCache;
+    std::unique_ptr<VulkanObjectCache<VulkanPipelineLayoutKey, PipelineLayout_t>> pipelineLayoutCache;
+
+    // State of an ongoing defragmentation, see VulkanResourceManager::defragmentationStep()
+    VmaDefragmentationContext defragmentationContext{ VK_NULL_HANDLE };
+    std::chrono::microseconds defragmentationTimeBudget{ 0 };
+    DefragmentationStatistics defragmentationStatistics;
+    // Pass whose copies are in flight, it ends once defragmentationSerial has retired
+    VmaDefragmentationPassMoveInfo defragmentationPass{};
+    std::vector<std::pair<Handle<Buffer_t>, uint32_t>> defragmentationMoves; // Moved buffers and their move index
+    uint64_t defragmentationSerial{ 0 };
+    bool defragmentationPassPending{ false };
 
     PFN_vkCmdPipelineBarrier2KHR vkCmdPipelineBarrier2{ nullptr };
+    bool memoryBudgetEnabled{ false }; // VK_EXT_memory_budget
+    bool hostVisibleDeviceLocalMemory{ false }; // All of the device local memory is mappable (ReBAR or UMA)
     bool isOwned{ true };
 };
 
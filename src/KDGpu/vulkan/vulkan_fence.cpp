@@ -33,6 +33,8 @@ void VulkanFence::wait()
 void VulkanFence::reset()
 {
     auto vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
+    // The submission signalling the fence may be tracked with it, retire it while it is still signalled
+    vulkanDevice->deletionQueue->collect();
     vkResetFences(vulkanDevice->device, 1, &fence);
 }
 
@@ -48,7 +48,7 @@ Adapter VulkanGraphicsApi::createAdapterFromExistingVkPhysicalDevice(const Handl
 
 Queue VulkanGraphicsApi::createQueueFromExistingVkQueue(VkQueue vkQueue, const QueueFlags queueFlags)
 {
-    const Handle<Queue_t> queueHandle = m_vulkanResourceManager->insertQueue(VulkanQueue(vkQueue, m_vulkanResourceManager.get()));
+    const Handle<Queue_t> queueHandle = m_vulkanResourceManager->insertQueue(VulkanQueue(vkQueue, m_vulkanResourceManager.get(), {}));
     return Queue(this,
                  {},
                  QueueDescription{
@@ -81,6 +81,8 @@ Device VulkanGraphicsApi::createDeviceFromExistingVkDevice(Adapter *adapter,
     for (Queue &queue : device.m_queues) {
         if (!queue.m_device.isValid())
             queue.m_device = device.m_device; // Set device on queue since we couldn't do it when creating the queue with createQueueFromExistingVkQueue
+        if (VulkanQueue *vulkanQueue = m_vulkanResourceManager->getQueue(queue.handle()); vulkanQueue && !vulkanQueue->deviceHandle.isValid())
+            vulkanQueue->deviceHandle = device.m_device;
         descriptions.push_back(QueueDescription{
                 .queue = queue.handle(),
                 .flags = queue.flags(),
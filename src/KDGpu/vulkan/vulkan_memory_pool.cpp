@@ -0,0 +1,42 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "vulkan_memory_pool.h"
+
+#include <KDGpu/vulkan/vulkan_device.h>
+#include <KDGpu/vulkan/vulkan_resource_manager.h>
+
+namespace KDGpu {
+
+VulkanMemoryPool::VulkanMemoryPool(VmaPool _pool,
+                                   uint32_t _memoryTypeIndex,
+                                   VulkanResourceManager *_vulkanResourceManager,
+                                   const Handle<Device_t> &_deviceHandle)
+    : pool(_pool)
+    , memoryTypeIndex(_memoryTypeIndex)
+    , vulkanResourceManager(_vulkanResourceManager)
+    , deviceHandle(_deviceHandle)
+{
+}
+
+MemoryPoolStatistics VulkanMemoryPool::statistics() const
+{
+    auto vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
+    VmaStatistics vmaStatistics{};
+    vmaGetPoolStatistics(vulkanDevice->allocator, pool, &vmaStatistics);
+    return MemoryPoolStatistics{
+        .blockCount = vmaStatistics.blockCount,
+        .allocationCount = vmaStatistics.allocationCount,
+        .blockBytes = vmaStatistics.blockBytes,
+        .allocationBytes = vmaStatistics.allocationBytes
+    };
+}
+
+} // namespace KDGpu
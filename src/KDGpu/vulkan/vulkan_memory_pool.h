@@ -0,0 +1,45 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <KDGpu/api/api_memory_pool.h>
+#include <KDGpu/handle.h>
+#include <KDGpu/kdgpu_export.h>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+namespace KDGpu {
+
+class VulkanResourceManager;
+struct Device_t;
+
+/**
+ * @brief VulkanMemoryPool
+ * \ingroup vulkan
+ *
+ */
+struct KDGPU_EXPORT VulkanMemoryPool : public ApiMemoryPool {
+    explicit VulkanMemoryPool(VmaPool _pool,
+                              uint32_t _memoryTypeIndex,
+                              VulkanResourceManager *_vulkanResourceManager,
+                              const Handle<Device_t> &_deviceHandle);
+
+    MemoryPoolStatistics statistics() const final;
+
+    VmaPool pool{ VK_NULL_HANDLE };
+    uint32_t memoryTypeIndex{ 0 };
+
+    VulkanResourceManager *vulkanResourceManager{ nullptr };
+    Handle<Device_t> deviceHandle;
+};
+
+} // namespace KDGpu
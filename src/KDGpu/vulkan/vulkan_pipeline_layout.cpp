@@ -10,8 +10,27 @@
 
 #include "vulkan_pipeline_layout.h"
 
+#include <KDGpu/vulkan/vulkan_resource_manager.h>
+
+#include <algorithm>
+
 namespace KDGpu {
 
+namespace {
+
+bool areCompatibleForSet(VulkanResourceManager *vulkanResourceManager,
+                         const Handle<PipelineLayout_t> &a, const Handle<PipelineLayout_t> &b, uint32_t set)
+{
+    // Identical layouts are deduplicated, so this is the usual case
+    if (a == b)
+        return a.isValid();
+    const VulkanPipelineLayout *layoutA = vulkanResourceManager->getPipelineLayout(a);
+    const VulkanPipelineLayout *layoutB = vulkanResourceManager->getPipelineLayout(b);
+    return layoutA && layoutB && layoutA->isCompatibleForSet(*layoutB, set);
+}
+
+} // namespace
+
 VulkanPipelineLayout::VulkanPipelineLayout(VkPipelineLayout _pipelineLayout,
                                            std::vector<VkDescriptorSetLayout> &&_descriptorSetLayouts,
                                            VulkanResourceManager *_vulkanResourceManager,
@@ -24,4 +43,40 @@ VulkanPipelineLayout::VulkanPipelineLayout(VkPipelineLayout _pipelineLayout,
 {
 }
 
+bool VulkanPipelineLayout::isCompatibleForSet(const VulkanPipelineLayout &other, uint32_t set) const noexcept
+{
+    if (set >= descriptorSetLayouts.size() || set >= other.descriptorSetLayouts.size())
+        return false;
+    return pushConstantRanges == other.pushConstantRanges &&
+            std::equal(descriptorSetLayouts.begin(), descriptorSetLayouts.begin() + set + 1, other.descriptorSetLayouts.begin());
+}
+
+bool VulkanBoundBindGroups::bind(VulkanResourceManager *vulkanResourceManager,
+                                 uint32_t group,
+                                 const Handle<BindGroup_t> &bindGroup,
+                                 const Handle<PipelineLayout_t> &pipelineLayout,
+                                 const std::vector<uint32_t> &dynamicBufferOffsets)
+{
+    if (group < sets.size()) {
+        const BoundSet &bound = sets[group];
+        if (bound.bindGroup.isValid() && bound.bindGroup == bindGroup &&
+            bound.dynamicBufferOffsets == dynamicBufferOffsets &&
+            areCompatibleForSet(vulkanResourceManager, bound.pipelineLayout, pipelineLayout, group))
+            return false;
+    } else {
+        sets.resize(group + 1);
+    }
+
+    // The other sets are disturbed unless they were bound with a layout compatible for them
+    for (uint32_t i = 0; i < sets.size(); ++i) {
+        BoundSet &bound = sets[i];
+        if (i != group && bound.bindGroup.isValid() &&
+            !areCompatibleForSet(vulkanResourceManager, bound.pipelineLayout, pipelineLayout, i))
+            bound = {};
+    }
+
+    sets[group] = BoundSet{ bindGroup, pipelineLayout, dynamicBufferOffsets };
+    return true;
+}
+
 } // namespace KDGpu
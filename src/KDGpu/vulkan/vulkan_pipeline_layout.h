@@ -13,6 +13,8 @@
 #include <KDGpu/api/api_pipeline_layout.h>
 #include <KDGpu/kdgpu_export.h>
 #include <KDGpu/handle.h>
+#include <KDGpu/pipeline_layout_options.h>
+#include <KDGpu/utils/hash_utils.h>
 
 #include <vulkan/vulkan.h>
 
@@ -22,7 +24,37 @@ namespace KDGpu {
 
 class VulkanResourceManager;
 
+struct BindGroup_t;
 struct Device_t;
+struct PipelineLayout_t;
+
+struct VulkanPipelineLayoutKey {
+    explicit VulkanPipelineLayoutKey(const PipelineLayoutOptions &_options)
+        : options(_options)
+    {
+        for (const Handle<BindGroupLayout_t> &bindGroupLayout : options.bindGroupLayouts)
+            KDGpu::hash_combine(hash, bindGroupLayout);
+        for (const PushConstantRange &range : options.pushConstantRanges) {
+            KDGpu::hash_combine(hash, range.offset);
+            KDGpu::hash_combine(hash, range.size);
+            KDGpu::hash_combine(hash, range.shaderStages.toInt());
+        }
+    }
+
+    // Bind group layouts are deduplicated, identical ones have the same handle
+    bool operator==(const VulkanPipelineLayoutKey &other) const noexcept
+    {
+        return hash == other.hash && options == other.options;
+    }
+
+    bool operator!=(const VulkanPipelineLayoutKey &other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+    PipelineLayoutOptions options;
+    uint64_t hash{ 0 };
+};
 
 /**
  * @brief VulkanPipelineLayout
@@ -35,10 +67,52 @@ struct KDGPU_EXPORT VulkanPipelineLayout : public ApiPipelineLayout {
                                   VulkanResourceManager *_vulkanResourceManager,
                                   const Handle<Device_t> &_deviceHandle);
 
+    // Descriptor sets bound with one of the layouts can be used with the other for this set
+    // and the ones below it, as described by "Pipeline Layout Compatibility" in the Vulkan spec
+    bool isCompatibleForSet(const VulkanPipelineLayout &other, uint32_t set) const noexcept;
+
     VkPipelineLayout pipelineLayout;
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+    std::vector<PushConstantRange> pushConstantRanges;
     VulkanResourceManager *vulkanResourceManager{ nullptr };
     Handle<Device_t> deviceHandle;
 };
 
+/**
+ * @brief VulkanBoundBindGroups
+ * \ingroup vulkan
+ *
+ * Descriptor sets bound by a command recorder, so that binding a bind group
+ * which is still bound to the same group through a compatible pipeline layout
+ * records nothing. Binding pipelines does not disturb bound descriptor sets.
+ */
+struct KDGPU_EXPORT VulkanBoundBindGroups {
+    // Returns false if the bind group is bound already, otherwise the caller records the bind
+    bool bind(VulkanResourceManager *vulkanResourceManager,
+              uint32_t group,
+              const Handle<BindGroup_t> &bindGroup,
+              const Handle<PipelineLayout_t> &pipelineLayout,
+              const std::vector<uint32_t> &dynamicBufferOffsets);
+
+    struct BoundSet {
+        Handle<BindGroup_t> bindGroup;
+        Handle<PipelineLayout_t> pipelineLayout;
+        std::vector<uint32_t> dynamicBufferOffsets;
+    };
+
+    std::vector<BoundSet> sets; // Indexed by group, invalid bind groups for disturbed sets
+};
+
 } // namespace KDGpu
+
+namespace std {
+
+template<>
+struct hash<KDGpu::VulkanPipelineLayoutKey> {
+    size_t operator()(const KDGpu::VulkanPipelineLayoutKey &key) const
+    {
+        return key.hash;
+    }
+};
+
+} // namespace std
@@ -11,28 +11,35 @@
 #include "vulkan_queue.h"
 
 #include <KDGpu/queue.h>
+#include <KDGpu/vulkan/vulkan_device.h>
+#include <KDGpu/vulkan/vulkan_enums.h>
 #include <KDGpu/vulkan/vulkan_resource_manager.h>
 
 namespace KDGpu {
 
 VulkanQueue::VulkanQueue(VkQueue _queue,
-                         VulkanResourceManager *_vulkanResourceManager)
+                         VulkanResourceManager *_vulkanResourceManager,
+                         const Handle<Device_t> &_deviceHandle)
     : ApiQueue()
     , queue(_queue)
     , vulkanResourceManager(_vulkanResourceManager)
+    , deviceHandle(_deviceHandle)
 {
 }
 
 void VulkanQueue::waitUntilIdle()
 {
     vkQueueWaitIdle(queue);
+
+    // Release the objects whose last use was on this queue
+    VulkanDevice *vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
+    if (vulkanDevice)
+        vulkanDevice->deletionQueue->collect();
 }
 
 void VulkanQueue::submit(const SubmitOptions &options)
 {
     constexpr size_t MaxWaitSemaphore = 10;
-    // TODO: Do we need to expose the wait stage flags to the public API or is waiting
-    // for the semaphores at the top of the pipeline good enough?
     const uint32_t waitSemaphoreCount = static_cast<uint32_t>(options.waitSemaphores.size());
     m_vkWaitSemaphores.clear();
     m_vkWaitStageFlags.clear();
@@ -42,7 +49,10 @@ void VulkanQueue::submit(const SubmitOptions &options)
         auto vulkanSemaphore = vulkanResourceManager->getGpuSemaphore(options.waitSemaphores[i]);
         if (vulkanSemaphore) {
             m_vkWaitSemaphores.emplace_back(vulkanSemaphore->semaphore);
-            m_vkWaitStageFlags.emplace_back(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+            // Top of pipe alone would not make any command wait for the semaphore
+            m_vkWaitStageFlags.emplace_back(i < options.waitStages.size()
+                                                    ? pipelineStageFlagsToVkPipelineStageFlagBits(options.waitStages[i])
+                                                    : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
         }
     }
 
@@ -69,6 +79,13 @@ void VulkanQueue::submit(const SubmitOptions &options)
     if (vulkanFence)
         vkFenceToSignal = vulkanFence->fence;
 
+    // Track the submission so that objects released while it executes are destroyed once it retires.
+    // The fence of the caller does it if there is one, otherwise one of ours is signalled.
+    VulkanDevice *vulkanDevice = vulkanResourceManager->getDevice(deviceHandle);
+    const bool usesTrackingFence = vulkanDevice && vkFenceToSignal == VK_NULL_HANDLE;
+    if (usesTrackingFence)
+        vkFenceToSignal = vulkanDevice->deletionQueue->acquireSubmissionFence();
+
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.waitSemaphoreCount = m_vkWaitSemaphores.size();
@@ -87,6 +104,27 @@ void VulkanQueue::submit(const SubmitOptions &options)
     // vkResetFences(renderer()->vulkanDevice()->device(), 1, inFlightFences);
 
     VkResult result = vkQueueSubmit(queue, 1, &submitInfo, vkFenceToSignal);
+
+    if (vulkanDevice) {
+        if (result == VK_SUCCESS && vkFenceToSignal != VK_NULL_HANDLE) {
+            const uint64_t serial = vulkanDevice->deletionQueue->trackSubmission(vkFenceToSignal, usesTrackingFence);
+
+            // Lets the buffers be written directly again once this submission has completed
+            for (const Handle<CommandBuffer_t> &commandBufferHandle : options.commandBuffers) {
+                VulkanCommandBuffer *vulkanCommandBuffer = vulkanResourceManager->getCommandBuffer(commandBufferHandle);
+                if (!vulkanCommandBuffer)
+                    continue;
+                for (const Handle<Buffer_t> &bufferHandle : vulkanCommandBuffer->usedBuffers) {
+                    if (VulkanBuffer *vulkanBuffer = vulkanResourceManager->getBuffer(bufferHandle))
+                        vulkanBuffer->lastUseSerial = serial;
+                }
+            }
+        } else if (usesTrackingFence) {
+            vulkanDevice->deletionQueue->releaseSubmissionFence(vkFenceToSignal);
+        }
+
+        vulkanDevice->deletionQueue->collect();
+    }
 }
 
 namespace {
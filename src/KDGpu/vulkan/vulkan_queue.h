@@ -11,6 +11,7 @@
 #pragma once
 
 #include <KDGpu/api/api_queue.h>
+#include <KDGpu/handle.h>
 #include <KDGpu/kdgpu_export.h>
 #include <vulkan/vulkan.h>
 
@@ -18,6 +19,8 @@ namespace KDGpu {
 
 class VulkanResourceManager;
 
+struct Device_t;
+
 /**
  * @brief VulkanQueue
  * \ingroup vulkan
@@ -25,7 +28,8 @@ class VulkanResourceManager;
  */
 struct KDGPU_EXPORT VulkanQueue : public ApiQueue {
     explicit VulkanQueue(VkQueue _queue,
-                         VulkanResourceManager *_vulkanResourceManager);
+                         VulkanResourceManager *_vulkanResourceManager,
+                         const Handle<Device_t> &_deviceHandle);
 
     void waitUntilIdle() final;
     void submit(const SubmitOptions &options) final;
@@ -34,6 +38,7 @@ struct KDGPU_EXPORT VulkanQueue : public ApiQueue {
 
     VkQueue queue{ VK_NULL_HANDLE };
     VulkanResourceManager *vulkanResourceManager{ nullptr };
+    Handle<Device_t> deviceHandle; // Set by createDeviceFromExistingVkDevice() for queues created from a VkQueue
 
     // Submission
     std::vector<VkSemaphore> m_vkWaitSemaphores;
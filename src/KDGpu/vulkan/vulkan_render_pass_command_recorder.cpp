@@ -10,6 +10,7 @@
 
 #include "vulkan_render_pass_command_recorder.h"
 
+#include <KDGpu/vulkan/vulkan_command_buffer.h>
 #include <KDGpu/vulkan/vulkan_enums.h>
 #include <KDGpu/vulkan/vulkan_graphics_pipeline.h>
 #include <KDGpu/vulkan/vulkan_resource_manager.h>
@@ -19,11 +20,13 @@
 namespace KDGpu {
 
 VulkanRenderPassCommandRecorder::VulkanRenderPassCommandRecorder(VkCommandBuffer _commandBuffer,
+                                                                 const Handle<CommandBuffer_t> &_commandBufferHandle,
                                                                  VkRect2D _renderArea,
                                                                  VulkanResourceManager *_vulkanResourceManager,
                                                                  const Handle<Device_t> &_deviceHandle)
     : ApiRenderPassCommandRecorder()
     , commandBuffer(_commandBuffer)
+    , commandBufferHandle(_commandBufferHandle)
     , renderArea(_renderArea)
     , vulkanResourceManager(_vulkanResourceManager)
     , deviceHandle(_deviceHandle)
@@ -55,44 +58,48 @@ void VulkanRenderPassCommandRecorder::setVertexBuffer(uint32_t index, const Hand
     const std::array<VkDeviceSize, 1> offsets = { offset };
 
     vkCmdBindVertexBuffers(commandBuffer, index, 1, buffers.data(), offsets.data());
+    useBuffer(buffer);
 }
 
 void VulkanRenderPassCommandRecorder::setIndexBuffer(const Handle<Buffer_t> &buffer, DeviceSize offset, IndexType indexType)
 {
     VulkanBuffer *vulkanBuffer = vulkanResourceManager->getBuffer(buffer);
     vkCmdBindIndexBuffer(commandBuffer, vulkanBuffer->buffer, offset, indexTypeToVkIndexType(indexType));
+    useBuffer(buffer);
 }
 
 void VulkanRenderPassCommandRecorder::setBindGroup(uint32_t group, const Handle<BindGroup_t> &bindGroupH,
                                                    const Handle<PipelineLayout_t> &pipelineLayout, const std::vector<uint32_t> &dynamicBufferOffsets)
 {
-    VulkanBindGroup *bindGroup = vulkanResourceManager->getBindGroup(bindGroupH);
-    VkDescriptorSet set = bindGroup->descriptorSet;
-
     // Use the pipeline layout provided, otherwise fallback to the one from the currently
     // bound pipeline (if any).
-    VkPipelineLayout vkPipelineLayout{ VK_NULL_HANDLE };
-    if (pipelineLayout.isValid()) {
-        VulkanPipelineLayout *vulkanPipelineLayout = vulkanResourceManager->getPipelineLayout(pipelineLayout);
-        if (vulkanPipelineLayout)
-            vkPipelineLayout = vulkanPipelineLayout->pipelineLayout;
-    } else if (pipeline.isValid()) {
+    Handle<PipelineLayout_t> pipelineLayoutHandle = pipelineLayout;
+    if (!pipelineLayoutHandle.isValid() && pipeline.isValid()) {
         VulkanGraphicsPipeline *vulkanPipeline = vulkanResourceManager->getGraphicsPipeline(pipeline);
-        if (vulkanPipeline) {
-            VulkanPipelineLayout *vulkanPipelineLayout = vulkanResourceManager->getPipelineLayout(vulkanPipeline->pipelineLayoutHandle);
-            if (vulkanPipelineLayout)
-                vkPipelineLayout = vulkanPipelineLayout->pipelineLayout;
-        }
+        if (vulkanPipeline)
+            pipelineLayoutHandle = vulkanPipeline->pipelineLayoutHandle;
     }
 
-    assert(vkPipelineLayout != VK_NULL_HANDLE); // The PipelineLayout should outlive the pipelines
+    VulkanPipelineLayout *vulkanPipelineLayout = vulkanResourceManager->getPipelineLayout(pipelineLayoutHandle);
+    assert(vulkanPipelineLayout != nullptr); // The PipelineLayout should outlive the pipelines
+
+    // Nothing to do if the set is still bound through a compatible layout, which identical
+    // layouts are as they are deduplicated
+    if (!boundBindGroups.bind(vulkanResourceManager, group, bindGroupH, pipelineLayoutHandle, dynamicBufferOffsets))
+        return;
+
+    VulkanBindGroup *bindGroup = vulkanResourceManager->getBindGroup(bindGroupH);
+    VkDescriptorSet set = bindGroup->descriptorSet;
 
     // Bind Descriptor Set
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            vkPipelineLayout,
+                            vulkanPipelineLayout->pipelineLayout,
                             group,
                             1, &set,
                             dynamicBufferOffsets.size(), dynamicBufferOffsets.data());
+
+    if (VulkanCommandBuffer *vulkanCommandBuffer = vulkanResourceManager->getCommandBuffer(commandBufferHandle))
+        bindGroup->collectBoundBuffers(vulkanCommandBuffer->usedBuffers);
 }
 
 void VulkanRenderPassCommandRecorder::setViewport(const Viewport &viewport)
@@ -156,6 +163,7 @@ void VulkanRenderPassCommandRecorder::drawIndirect(const DrawIndirectCommand &dr
                       drawCommand.offset,
                       drawCommand.drawCount,
                       drawCommand.stride);
+    useBuffer(drawCommand.buffer);
 }
 
 void VulkanRenderPassCommandRecorder::drawIndirect(const std::vector<DrawIndirectCommand> &drawCommands)
@@ -172,6 +180,7 @@ void VulkanRenderPassCommandRecorder::drawIndexedIndirect(const DrawIndexedIndir
                              drawCommand.offset,
                              drawCommand.drawCount,
                              drawCommand.stride);
+    useBuffer(drawCommand.buffer);
 }
 
 void VulkanRenderPassCommandRecorder::drawIndexedIndirect(const std::vector<DrawIndexedIndirectCommand> &drawCommands)
@@ -199,4 +208,10 @@ void VulkanRenderPassCommandRecorder::end()
     vkCmdEndRenderPass(commandBuffer);
 }
 
+void VulkanRenderPassCommandRecorder::useBuffer(const Handle<Buffer_t> &buffer)
+{
+    if (VulkanCommandBuffer *vulkanCommandBuffer = vulkanResourceManager->getCommandBuffer(commandBufferHandle))
+        vulkanCommandBuffer->usedBuffers.push_back(buffer);
+}
+
 } // namespace KDGpu
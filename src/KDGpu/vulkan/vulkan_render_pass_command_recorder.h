@@ -12,6 +12,7 @@
 
 #include <KDGpu/api/api_render_pass_command_recorder.h>
 #include <KDGpu/kdgpu_export.h>
+#include <KDGpu/vulkan/vulkan_pipeline_layout.h>
 #include <KDGpu/handle.h>
 
 #include <vulkan/vulkan.h>
@@ -20,6 +21,7 @@ namespace KDGpu {
 
 class VulkanResourceManager;
 
+struct CommandBuffer_t;
 struct Device_t;
 
 /**
@@ -29,6 +31,7 @@ struct Device_t;
  */
 struct KDGPU_EXPORT VulkanRenderPassCommandRecorder : public ApiRenderPassCommandRecorder {
     explicit VulkanRenderPassCommandRecorder(VkCommandBuffer _commandBuffer,
+                                             const Handle<CommandBuffer_t> &_commandBufferHandle,
                                              VkRect2D _renderArea,
                                              VulkanResourceManager *_vulkanResourceManager,
                                              const Handle<Device_t> &_deviceHandle);
@@ -51,11 +54,15 @@ struct KDGPU_EXPORT VulkanRenderPassCommandRecorder : public ApiRenderPassComman
     void pushConstant(const PushConstantRange &constantRange, const void *data) final;
     void end() final;
 
+    void useBuffer(const Handle<Buffer_t> &buffer);
+
     VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+    Handle<CommandBuffer_t> commandBufferHandle;
     VkRect2D renderArea{};
     VulkanResourceManager *vulkanResourceManager{ nullptr };
     Handle<Device_t> deviceHandle;
     Handle<GraphicsPipeline_t> pipeline;
+    VulkanBoundBindGroups boundBindGroups;
 };
 
 } // namespace KDGpu
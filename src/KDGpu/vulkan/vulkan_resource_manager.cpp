@@ -16,13 +16,19 @@
 #include <KDGpu/compute_pipeline_options.h>
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/instance.h>
+#include <KDGpu/memory_pool_options.h>
 #include <KDGpu/sampler_options.h>
 #include <KDGpu/swapchain_options.h>
 #include <KDGpu/texture_options.h>
 #include <KDGpu/vulkan/vulkan_config.h>
 #include <KDGpu/vulkan/vulkan_enums.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <optional>
 #include <stdexcept>
 
 namespace {
@@ -66,6 +72,40 @@ void setupMultiViewInfo(VkRenderPassMultiviewCreateInfo &multiViewCreateInfo, ui
 } // namespace
 namespace KDGpu {
 
+namespace {
+
+// The returned info points into options for the queue family indices
+VkImageCreateInfo imageCreateInfo(const TextureOptions &options)
+{
+    VkImageCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    createInfo.imageType = textureTypeToVkImageType(options.type);
+    createInfo.format = formatToVkFormat(options.format);
+    createInfo.extent = {
+        .width = options.extent.width,
+        .height = options.extent.height,
+        .depth = options.extent.depth
+    };
+    createInfo.mipLevels = options.mipLevels;
+    createInfo.arrayLayers = options.arrayLayers;
+    createInfo.samples = sampleCountFlagBitsToVkSampleFlagBits(options.samples);
+    createInfo.tiling = textureTilingToVkImageTiling(options.tiling);
+    createInfo.usage = options.usage.toInt();
+    createInfo.sharingMode = sharingModeToVkSharingMode(options.sharingMode);
+    if (!options.queueTypeIndices.empty()) {
+        createInfo.queueFamilyIndexCount = options.queueTypeIndices.size();
+        createInfo.pQueueFamilyIndices = options.queueTypeIndices.data();
+    }
+    createInfo.initialLayout = textureLayoutToVkImageLayout(options.initialLayout);
+
+    if (options.type == TextureType::TextureTypeCube)
+        createInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+
+    return createInfo;
+}
+
+} // namespace
+
 VulkanResourceManager::VulkanResourceManager()
 {
 }
@@ -284,6 +324,22 @@ Handle<Device_t> VulkanResourceManager::createDevice(const Handle<Adapter_t> &ad
     multiViewFeatures.multiviewTessellationShader = options.requestedFeatures.multiViewTessellationShader;
     stdLayoutFeatures.pNext = &multiViewFeatures;
 
+    // Descriptor indexing, for bindless resource tables
+    const AdapterFeatures &requested = options.requestedFeatures;
+    VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = requested.shaderSampledImageArrayNonUniformIndexing;
+    descriptorIndexingFeatures.shaderStorageImageArrayNonUniformIndexing = requested.shaderStorageImageArrayNonUniformIndexing;
+    descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing = requested.shaderStorageBufferArrayNonUniformIndexing;
+    descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = requested.descriptorBindingSampledImageUpdateAfterBind;
+    descriptorIndexingFeatures.descriptorBindingStorageImageUpdateAfterBind = requested.descriptorBindingStorageImageUpdateAfterBind;
+    descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = requested.descriptorBindingStorageBufferUpdateAfterBind;
+    descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = requested.descriptorBindingUpdateUnusedWhilePending;
+    descriptorIndexingFeatures.descriptorBindingPartiallyBound = requested.descriptorBindingPartiallyBound;
+    descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount = requested.descriptorBindingVariableDescriptorCount;
+    descriptorIndexingFeatures.runtimeDescriptorArray = requested.runtimeDescriptorArray;
+    multiViewFeatures.pNext = &descriptorIndexingFeatures;
+
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pNext = &physicalDeviceFeatures2;
@@ -295,9 +351,18 @@ Handle<Device_t> VulkanResourceManager::createDevice(const Handle<Adapter_t> &ad
     createInfo.enabledExtensionCount = 0;
     createInfo.ppEnabledExtensionNames = nullptr;
 
+    VulkanAdapter vulkanAdapter = *getAdapter(adapterHandle);
+
     // TODO: Obey requested adapter features (e.g. geometry shaders)
     // TODO: Merge requested device extensions and layers with our defaults
-    const auto requestedDeviceExtensions = getDefaultRequestedDeviceExtensions();
+    auto requestedDeviceExtensions = getDefaultRequestedDeviceExtensions();
+
+    // Optional extensions, VulkanDevice checks for the same ones to know what got enabled
+    const auto adapterExtensions = vulkanAdapter.extensions();
+    for (const auto &extension : adapterExtensions) {
+        if (extension.name == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)
+            requestedDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
     if (!requestedDeviceExtensions.empty()) {
         createInfo.enabledExtensionCount = static_cast<uint32_t>(requestedDeviceExtensions.size());
         assert(requestedDeviceExtensions.size() <= std::numeric_limits<uint32_t>::max());
@@ -305,7 +370,6 @@ Handle<Device_t> VulkanResourceManager::createDevice(const Handle<Adapter_t> &ad
     }
 
     VkDevice vkDevice{ VK_NULL_HANDLE };
-    VulkanAdapter vulkanAdapter = *getAdapter(adapterHandle);
     VkResult result = vkCreateDevice(vulkanAdapter.physicalDevice, &createInfo, nullptr, &vkDevice);
     if (result != VK_SUCCESS)
         throw std::runtime_error(std::string{ "Failed to create a logical device: " } + getResultAsString(result));
@@ -326,6 +390,9 @@ void VulkanResourceManager::deleteDevice(const Handle<Device_t> &handle)
 {
     VulkanDevice *vulkanDevice = m_devices.get(handle);
 
+    // Destroy everything still waiting for the GPU before tearing down the pools it came from
+    vulkanDevice->deletionQueue->flush();
+
     // Destroy Render Passes
     for (const auto &[passKey, passHandle] : vulkanDevice->renderPasses) {
         VulkanRenderPass *pass = m_renderPasses.get(passHandle);
@@ -341,15 +408,14 @@ void VulkanResourceManager::deleteDevice(const Handle<Device_t> &handle)
     }
 
     // Destroy Descriptor Pools
-    for (VkDescriptorPool descriptorPool : vulkanDevice->descriptorSetPools)
-        vkDestroyDescriptorPool(vulkanDevice->device, descriptorPool, nullptr);
-    vulkanDevice->descriptorSetPools.clear();
+    vulkanDevice->descriptorAllocator->destroyAll();
 
     // Destroy Command Pool
     for (VkCommandPool commandPool : vulkanDevice->commandPools)
         vkDestroyCommandPool(vulkanDevice->device, commandPool, nullptr);
 
     // Destroy Memory Allocator
+    endDefragmentation(handle);
     vmaDestroyAllocator(vulkanDevice->allocator);
 
     // At last, destroy device if we allocated it
@@ -473,39 +539,43 @@ Handle<Texture_t> VulkanResourceManager::createTexture(const Handle<Device_t> &d
 {
     VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
 
-    VkImageCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    createInfo.imageType = textureTypeToVkImageType(options.type);
-    createInfo.format = formatToVkFormat(options.format);
-    createInfo.extent = {
-        .width = options.extent.width,
-        .height = options.extent.height,
-        .depth = options.extent.depth
-    };
-    createInfo.mipLevels = options.mipLevels;
-    createInfo.arrayLayers = options.arrayLayers;
-    createInfo.samples = sampleCountFlagBitsToVkSampleFlagBits(options.samples);
-    createInfo.tiling = textureTilingToVkImageTiling(options.tiling);
-    createInfo.usage = options.usage.toInt();
-    createInfo.sharingMode = sharingModeToVkSharingMode(options.sharingMode);
-    if (!options.queueTypeIndices.empty()) {
-        createInfo.queueFamilyIndexCount = options.queueTypeIndices.size();
-        createInfo.pQueueFamilyIndices = options.queueTypeIndices.data();
-    }
-    createInfo.initialLayout = textureLayoutToVkImageLayout(options.initialLayout);
+    const VkImageCreateInfo createInfo = imageCreateInfo(options);
 
-    if (options.type == TextureType::TextureTypeCube)
-        createInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+    MemoryUsage memoryUsage = options.memoryUsage;
+    if (memoryUsage == MemoryUsage::GpuLazilyAllocated && !options.usage.testFlag(TextureUsageFlagBits::TransientAttachmentBit)) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Lazily allocated memory requires the TransientAttachmentBit usage, using GpuOnly memory instead");
+        memoryUsage = MemoryUsage::GpuOnly;
+    }
 
     VmaAllocationCreateInfo allocInfo = {};
-    allocInfo.usage = memoryUsageToVmaMemoryUsage(options.memoryUsage);
+    allocInfo.usage = memoryUsageToVmaMemoryUsage(memoryUsage);
+    if (options.memoryPool.isValid()) {
+        VulkanMemoryPool *vulkanMemoryPool = m_memoryPools.get(options.memoryPool);
+        if (!vulkanMemoryPool)
+            return {};
+        allocInfo.pool = vulkanMemoryPool->pool;
+    }
 
     VkImage vkImage;
     VmaAllocation vmaAllocation;
 
-    if (vmaCreateImage(vulkanDevice->allocator, &createInfo, &allocInfo, &vkImage, &vmaAllocation, nullptr) != VK_SUCCESS)
+    VmaAllocationInfo allocationInfo;
+
+    VkResult result = vmaCreateImage(vulkanDevice->allocator, &createInfo, &allocInfo, &vkImage, &vmaAllocation, &allocationInfo);
+
+    // Desktop GPUs usually have no lazily allocated memory, fall back to regular device memory
+    if (result == VK_ERROR_FEATURE_NOT_PRESENT && memoryUsage == MemoryUsage::GpuLazilyAllocated && allocInfo.pool == VK_NULL_HANDLE) {
+        memoryUsage = MemoryUsage::GpuOnly;
+        allocInfo.usage = memoryUsageToVmaMemoryUsage(memoryUsage);
+        result = vmaCreateImage(vulkanDevice->allocator, &createInfo, &allocInfo, &vkImage, &vmaAllocation, &allocationInfo);
+    }
+
+    if (result != VK_SUCCESS)
         return {};
 
+    vulkanDevice->memoryUsageCounters->add(memoryUsage, allocationInfo.size);
+    vulkanDevice->checkMemoryBudget();
+
     const auto vulkanTextureHandle = m_textures.emplace(VulkanTexture(
             vkImage,
             vmaAllocation,
@@ -514,11 +584,121 @@ Handle<Texture_t> VulkanResourceManager::createTexture(const Handle<Device_t> &d
             options.mipLevels,
             options.arrayLayers,
             options.usage,
+            memoryUsage,
+            allocationInfo.size,
             this,
             deviceHandle));
     return vulkanTextureHandle;
 }
 
+std::vector<Handle<Texture_t>> VulkanResourceManager::createAliasedTextures(const Handle<Device_t> &deviceHandle, const std::vector<TextureOptions> &options)
+{
+    VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
+    if (!vulkanDevice || options.empty())
+        return {};
+
+    // Create the images first, the allocation has to satisfy the requirements of all of them
+    std::vector<VkImage> vkImages;
+    vkImages.reserve(options.size());
+    auto destroyImages = [&] {
+        for (VkImage vkImage : vkImages)
+            vkDestroyImage(vulkanDevice->device, vkImage, nullptr);
+    };
+
+    VkMemoryRequirements memoryRequirements = {};
+    memoryRequirements.alignment = 1;
+    memoryRequirements.memoryTypeBits = ~0U;
+    bool lazilyAllocatable = true;
+    for (const TextureOptions &textureOptions : options) {
+        const VkImageCreateInfo createInfo = imageCreateInfo(textureOptions);
+        VkImage vkImage = VK_NULL_HANDLE;
+        if (vkCreateImage(vulkanDevice->device, &createInfo, nullptr, &vkImage) != VK_SUCCESS) {
+            destroyImages();
+            return {};
+        }
+        vkImages.push_back(vkImage);
+
+        VkMemoryRequirements imageRequirements;
+        vkGetImageMemoryRequirements(vulkanDevice->device, vkImage, &imageRequirements);
+        memoryRequirements.size = std::max(memoryRequirements.size, imageRequirements.size);
+        memoryRequirements.alignment = std::max(memoryRequirements.alignment, imageRequirements.alignment);
+        memoryRequirements.memoryTypeBits &= imageRequirements.memoryTypeBits;
+
+        lazilyAllocatable &= textureOptions.usage.testFlag(TextureUsageFlagBits::TransientAttachmentBit);
+    }
+
+    if (memoryRequirements.memoryTypeBits == 0) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "The aliased textures have no memory type in common");
+        destroyImages();
+        return {};
+    }
+
+    MemoryUsage memoryUsage = options.front().memoryUsage;
+    if (memoryUsage == MemoryUsage::GpuLazilyAllocated && !lazilyAllocatable)
+        memoryUsage = MemoryUsage::GpuOnly;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = memoryUsageToVmaMemoryUsage(memoryUsage);
+    if (options.front().memoryPool.isValid()) {
+        VulkanMemoryPool *vulkanMemoryPool = m_memoryPools.get(options.front().memoryPool);
+        if (!vulkanMemoryPool || (memoryRequirements.memoryTypeBits & (1U << vulkanMemoryPool->memoryTypeIndex)) == 0) {
+            SPDLOG_LOGGER_WARN(Logger::logger(), "The memory pool can't hold the aliased textures");
+            destroyImages();
+            return {};
+        }
+        allocInfo.pool = vulkanMemoryPool->pool;
+    }
+
+    VmaAllocation vmaAllocation;
+    VmaAllocationInfo allocationInfo;
+    VkResult result = vmaAllocateMemory(vulkanDevice->allocator, &memoryRequirements, &allocInfo, &vmaAllocation, &allocationInfo);
+    if (result == VK_ERROR_FEATURE_NOT_PRESENT && memoryUsage == MemoryUsage::GpuLazilyAllocated && allocInfo.pool == VK_NULL_HANDLE) {
+        memoryUsage = MemoryUsage::GpuOnly;
+        allocInfo.usage = memoryUsageToVmaMemoryUsage(memoryUsage);
+        result = vmaAllocateMemory(vulkanDevice->allocator, &memoryRequirements, &allocInfo, &vmaAllocation, &allocationInfo);
+    }
+    if (result != VK_SUCCESS) {
+        destroyImages();
+        return {};
+    }
+
+    for (VkImage vkImage : vkImages) {
+        result = vmaBindImageMemory(vulkanDevice->allocator, vmaAllocation, vkImage);
+        if (result != VK_SUCCESS) {
+            SPDLOG_LOGGER_WARN(Logger::logger(), "Unable to bind aliased texture memory: {}", getResultAsString(result));
+            destroyImages();
+            vmaFreeMemory(vulkanDevice->allocator, vmaAllocation);
+            return {};
+        }
+    }
+
+    // The shared allocation is only accounted for once
+    vulkanDevice->memoryUsageCounters->add(memoryUsage, allocationInfo.size);
+    vulkanDevice->aliasedAllocations->add(vmaAllocation, static_cast<uint32_t>(vkImages.size()));
+    vulkanDevice->checkMemoryBudget();
+
+    std::vector<Handle<Texture_t>> textureHandles;
+    textureHandles.reserve(vkImages.size());
+    for (size_t i = 0; i < vkImages.size(); ++i) {
+        const TextureOptions &textureOptions = options[i];
+        const auto vulkanTextureHandle = m_textures.emplace(VulkanTexture(
+                vkImages[i],
+                vmaAllocation,
+                textureOptions.format,
+                textureOptions.extent,
+                textureOptions.mipLevels,
+                textureOptions.arrayLayers,
+                textureOptions.usage,
+                memoryUsage,
+                allocationInfo.size,
+                this,
+                deviceHandle));
+        m_textures.get(vulkanTextureHandle)->aliased = true;
+        textureHandles.push_back(vulkanTextureHandle);
+    }
+    return textureHandles;
+}
+
 void VulkanResourceManager::deleteTexture(const Handle<Texture_t> &handle)
 {
     VulkanTexture *vulkanTexture = m_textures.get(handle);
@@ -527,7 +707,11 @@ void VulkanResourceManager::deleteTexture(const Handle<Texture_t> &handle)
 
     VulkanDevice *vulkanDevice = m_devices.get(vulkanTexture->deviceHandle);
 
-    vmaDestroyImage(vulkanDevice->allocator, vulkanTexture->image, vulkanTexture->allocation);
+    // Aliased textures leave the shared allocation to the last of them
+    const bool releasesMemory = !vulkanTexture->aliased || vulkanDevice->aliasedAllocations->release(vulkanTexture->allocation);
+    vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_IMAGE, vulkanTexture->image, releasesMemory ? vulkanTexture->allocation : VK_NULL_HANDLE);
+    if (releasesMemory)
+        vulkanDevice->memoryUsageCounters->remove(vulkanTexture->memoryUsage, vulkanTexture->allocationSize);
 
     m_textures.remove(handle);
 }
@@ -544,6 +728,13 @@ Handle<TextureView_t> VulkanResourceManager::createTextureView(const Handle<Devi
     VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
     VulkanTexture *vulkanTexture = m_textures.get(textureHandle);
 
+    // Identical views of a texture share a single VkImageView
+    auto &cache = *vulkanDevice->textureViewCache;
+    const VulkanTextureViewKey key(textureHandle, options);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (const Handle<TextureView_t> cachedHandle = cache.acquire(key); cachedHandle.isValid())
+        return cachedHandle;
+
     VkImageViewCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     createInfo.image = vulkanTexture->image;
@@ -581,6 +772,7 @@ Handle<TextureView_t> VulkanResourceManager::createTextureView(const Handle<Devi
         return {};
 
     const auto vulkanTextureViewHandle = m_textureViews.emplace(VulkanTextureView(imageView, textureHandle, deviceHandle));
+    cache.insert(key, vulkanTextureViewHandle);
     return vulkanTextureViewHandle;
 }
 
@@ -588,7 +780,14 @@ void VulkanResourceManager::deleteTextureView(const Handle<TextureView_t> &handl
 {
     VulkanTextureView *vulkanTextureView = m_textureViews.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(vulkanTextureView->deviceHandle);
-    vkDestroyImageView(vulkanDevice->device, vulkanTextureView->imageView, nullptr);
+
+    // Only destroyed once all the TextureViews sharing it are gone
+    auto &cache = *vulkanDevice->textureViewCache;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (!cache.release(handle))
+        return;
+
+    vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_IMAGE_VIEW, vulkanTextureView->imageView);
 
     m_textureViews.remove(handle);
 }
@@ -614,18 +813,52 @@ Handle<Buffer_t> VulkanResourceManager::createBuffer(const Handle<Device_t> &dev
 
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = memoryUsageToVmaMemoryUsage(options.memoryUsage);
+    // VMA ignores the mapped bit for memory types that are not host visible
+    if (options.persistentlyMapped)
+        allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    if (options.memoryPool.isValid()) {
+        VulkanMemoryPool *vulkanMemoryPool = m_memoryPools.get(options.memoryPool);
+        if (!vulkanMemoryPool)
+            return {};
+        allocInfo.pool = vulkanMemoryPool->pool;
+    } else if (options.memoryUsage == MemoryUsage::GpuOnly && options.usage.testFlag(BufferUsageFlagBits::TransferDstBit) &&
+               vulkanDevice->hostVisibleDeviceLocalMemory) {
+        // Lets the uploads to the buffer write into it directly rather than through a staging copy
+        allocInfo.preferredFlags |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
 
     VkBuffer vkBuffer;
     VmaAllocation vmaAllocation;
-    if (vmaCreateBuffer(vulkanDevice->allocator, &createInfo, &allocInfo, &vkBuffer, &vmaAllocation, nullptr) != VK_SUCCESS)
+    VmaAllocationInfo allocationInfo;
+    if (vmaCreateBuffer(vulkanDevice->allocator, &createInfo, &allocInfo, &vkBuffer, &vmaAllocation, &allocationInfo) != VK_SUCCESS)
         return {};
 
-    const auto vulkanBufferHandle = m_buffers.emplace(VulkanBuffer(vkBuffer, vmaAllocation, this, deviceHandle));
+    VkMemoryPropertyFlags memoryProperties = 0;
+    vmaGetAllocationMemoryProperties(vulkanDevice->allocator, vmaAllocation, &memoryProperties);
+    const bool hostCoherent = (memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    vulkanDevice->memoryUsageCounters->add(options.memoryUsage, allocationInfo.size);
+    vulkanDevice->checkMemoryBudget();
+
+    const auto vulkanBufferHandle = m_buffers.emplace(VulkanBuffer(vkBuffer, vmaAllocation, options.memoryUsage, allocationInfo.size,
+                                                                   allocationInfo.pMappedData, hostCoherent, this, deviceHandle));
+
+    VulkanBuffer *vulkanBuffer = m_buffers.get(vulkanBufferHandle);
+    vulkanBuffer->size = options.size;
+    vulkanBuffer->usage = createInfo.usage;
+    vulkanBuffer->sharingMode = createInfo.sharingMode;
+    vulkanBuffer->queueFamilyIndices = options.queueTypeIndices;
+    vulkanBuffer->hostVisible = (memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+    // Lets defragmentation find the buffer owning an allocation. 0 is reserved for
+    // allocations that are not owned by a buffer.
+    vmaSetAllocationUserData(vulkanDevice->allocator, vmaAllocation,
+                             reinterpret_cast<void *>(static_cast<uintptr_t>(vulkanBufferHandle.index()) + 1));
 
     if (initialData) {
-        VulkanBuffer *vulkanBuffer = m_buffers.get(vulkanBufferHandle);
         auto bufferData = vulkanBuffer->map();
         std::memcpy(bufferData, initialData, createInfo.size);
+        vulkanBuffer->flush(0, createInfo.size);
         vulkanBuffer->unmap();
     }
 
@@ -637,7 +870,19 @@ void VulkanResourceManager::deleteBuffer(const Handle<Buffer_t> &handle)
     VulkanBuffer *vulkanBuffer = m_buffers.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(vulkanBuffer->deviceHandle);
 
-    vmaDestroyBuffer(vulkanDevice->allocator, vulkanBuffer->buffer, vulkanBuffer->allocation);
+    // The allocation of a buffer moved by a pending defragmentation pass is released by VMA
+    // when the pass ends, which must now also wait for the work using the buffer
+    const auto moveIt = std::find_if(vulkanDevice->defragmentationMoves.begin(), vulkanDevice->defragmentationMoves.end(),
+                                     [&handle](const auto &move) { return move.first == handle; });
+    if (moveIt != vulkanDevice->defragmentationMoves.end()) {
+        vulkanDevice->defragmentationPass.pMoves[moveIt->second].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+        vulkanDevice->defragmentationSerial = vulkanDevice->deletionQueue->lastSubmittedSerial();
+        vulkanDevice->defragmentationMoves.erase(moveIt);
+        vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_BUFFER, vulkanBuffer->buffer);
+    } else {
+        vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_BUFFER, vulkanBuffer->buffer, vulkanBuffer->allocation);
+    }
+    vulkanDevice->memoryUsageCounters->remove(vulkanBuffer->memoryUsage, vulkanBuffer->allocationSize);
 
     m_buffers.remove(handle);
 }
@@ -683,8 +928,14 @@ Handle<PipelineLayout_t> VulkanResourceManager::createPipelineLayout(const Handl
 {
     VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
 
-    // TODO: Extract the VkDescriptorSetLayout creation into a Device::createBindGroupLayout as we will need
-    // to use the VkDescriptorSetLayout when creating the PipelineLayout as well as when creating the BindGroup
+    // Identical pipeline layouts share a single VkPipelineLayout, which lets recorders
+    // keep the bind groups bound when switching between pipelines using them
+    auto &cache = *vulkanDevice->pipelineLayoutCache;
+    const VulkanPipelineLayoutKey key(options);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (const Handle<PipelineLayout_t> cachedHandle = cache.acquire(key); cachedHandle.isValid())
+        return cachedHandle;
+
     assert(options.bindGroupLayouts.size() <= std::numeric_limits<uint32_t>::max());
     const uint32_t bindGroupLayoutCount = static_cast<uint32_t>(options.bindGroupLayouts.size());
     std::vector<VkDescriptorSetLayout> vkDescriptorSetLayouts;
@@ -727,11 +978,10 @@ Handle<PipelineLayout_t> VulkanResourceManager::createPipelineLayout(const Handl
     }
 
     // Store the results
-    const auto vulkanPipelineLayoutHandle = m_pipelineLayouts.emplace(VulkanPipelineLayout(
-            vkPipelineLayout,
-            std::move(vkDescriptorSetLayouts),
-            this,
-            deviceHandle));
+    VulkanPipelineLayout vulkanPipelineLayout(vkPipelineLayout, std::move(vkDescriptorSetLayouts), this, deviceHandle);
+    vulkanPipelineLayout.pushConstantRanges = options.pushConstantRanges;
+    const auto vulkanPipelineLayoutHandle = m_pipelineLayouts.emplace(std::move(vulkanPipelineLayout));
+    cache.insert(key, vulkanPipelineLayoutHandle);
 
     return vulkanPipelineLayoutHandle;
 }
@@ -741,7 +991,12 @@ void VulkanResourceManager::deletePipelineLayout(const Handle<PipelineLayout_t>
     VulkanPipelineLayout *vulkanPipelineLayout = m_pipelineLayouts.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(vulkanPipelineLayout->deviceHandle);
 
-    vkDestroyPipelineLayout(vulkanDevice->device, vulkanPipelineLayout->pipelineLayout, nullptr);
+    auto &cache = *vulkanDevice->pipelineLayoutCache;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (!cache.release(handle))
+        return;
+
+    vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_PIPELINE_LAYOUT, vulkanPipelineLayout->pipelineLayout);
 
     m_pipelineLayouts.remove(handle);
 }
@@ -1110,8 +1365,8 @@ void VulkanResourceManager::deleteGraphicsPipeline(const Handle<GraphicsPipeline
     VulkanGraphicsPipeline *vulkanPipeline = m_graphicsPipelines.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(vulkanPipeline->deviceHandle);
 
-    vkDestroyPipeline(vulkanDevice->device, vulkanPipeline->pipeline, nullptr);
-    vkDestroyRenderPass(vulkanDevice->device, vulkanPipeline->renderPass, nullptr);
+    vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_PIPELINE, vulkanPipeline->pipeline);
+    vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_RENDER_PASS, vulkanPipeline->renderPass);
 
     m_graphicsPipelines.remove(handle);
 }
@@ -1169,7 +1424,7 @@ void VulkanResourceManager::deleteComputePipeline(const Handle<ComputePipeline_t
     VulkanComputePipeline *vulkanPipeline = m_computePipelines.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(vulkanPipeline->deviceHandle);
 
-    vkDestroyPipeline(vulkanDevice->device, vulkanPipeline->pipeline, nullptr);
+    vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_PIPELINE, vulkanPipeline->pipeline);
 
     m_computePipelines.remove(handle);
 }
@@ -1326,7 +1581,7 @@ void VulkanResourceManager::deleteCommandBuffer(const Handle<CommandBuffer_t> &h
     VulkanCommandBuffer *commandBuffer = m_commandBuffers.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(commandBuffer->deviceHandle);
 
-    vkFreeCommandBuffers(vulkanDevice->device, commandBuffer->commandPool, 1, &commandBuffer->commandBuffer);
+    vulkanDevice->deletionQueue->enqueueWithParent(VK_OBJECT_TYPE_COMMAND_BUFFER, commandBuffer->commandBuffer, commandBuffer->commandPool);
 
     m_commandBuffers.remove(handle);
 }
@@ -1474,7 +1729,7 @@ Handle<RenderPassCommandRecorder_t> VulkanResourceManager::createRenderPassComma
     vkCmdBeginRenderPass(vkCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
     const auto vulkanRenderPassCommandRecorderHandle = m_renderPassCommandRecorders.emplace(
-            VulkanRenderPassCommandRecorder(vkCommandBuffer, renderPassInfo.renderArea, this, deviceHandle));
+            VulkanRenderPassCommandRecorder(vkCommandBuffer, vulkanCommandRecorder->commandBufferHandle, renderPassInfo.renderArea, this, deviceHandle));
     return vulkanRenderPassCommandRecorderHandle;
 }
 
@@ -1504,7 +1759,7 @@ Handle<ComputePassCommandRecorder_t> VulkanResourceManager::createComputePassCom
     VkCommandBuffer vkCommandBuffer = vulkanCommandRecorder->commandBuffer;
 
     const auto vulkanComputePassCommandRecorderHandle = m_computePassCommandRecorders.emplace(
-            VulkanComputePassCommandRecorder(vkCommandBuffer, this, deviceHandle));
+            VulkanComputePassCommandRecorder(vkCommandBuffer, vulkanCommandRecorder->commandBufferHandle, this, deviceHandle));
     return vulkanComputePassCommandRecorderHandle;
 }
 
@@ -1720,82 +1975,53 @@ Handle<Framebuffer_t> VulkanResourceManager::createFramebuffer(const Handle<Devi
 Handle<BindGroup_t> VulkanResourceManager::createBindGroup(const Handle<Device_t> &deviceHandle, const BindGroupOptions &options)
 {
     VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
+    VulkanDescriptorAllocator &descriptorAllocator = *vulkanDevice->descriptorAllocator;
 
-    auto createDescriptorSetPool = [](VkDevice device) {
-        const std::vector<VkDescriptorPoolSize> poolSizes{
-            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 512 },
-            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 16 },
-            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 512 },
-            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 128 }
-        };
-
-        VkDescriptorPool pool{ VK_NULL_HANDLE };
-        VkDescriptorPoolCreateInfo poolInfo = {};
-        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        poolInfo.pPoolSizes = poolSizes.data();
-
-        poolInfo.maxSets = 1024;
-        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-        const VkResult result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool);
-        if (result != VK_SUCCESS)
-            return static_cast<VkDescriptorPool>(VK_NULL_HANDLE);
-        return pool;
-    };
-
-    auto allocateDescriptorSet = [](VkDevice device, VkDescriptorPool descriptorPool,
-                                    VulkanBindGroupLayout *bindGroupLayout, VkDescriptorSet &descriptorSet) {
-        VkDescriptorSetAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = &bindGroupLayout->descriptorSetLayout;
-
-        return vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
-    };
-
-    // Have we create a DescriptorSet pool already?
-    if (vulkanDevice->descriptorSetPools.empty())
-        vulkanDevice->descriptorSetPools.emplace_back(createDescriptorSetPool(vulkanDevice->device));
+    const bool transient = options.transient && descriptorAllocator.supportsTransient(options.layout);
+    if (options.transient && !transient)
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Bind groups with update after bind, variable count or large bindings can't be transient");
 
-    VulkanBindGroupLayout *bindGroupLayout = getBindGroupLayout(options.layout);
-    VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
-
-    //  Create DescriptorSet
-    VkResult result = allocateDescriptorSet(vulkanDevice->device, vulkanDevice->descriptorSetPools.back(),
-                                            bindGroupLayout, descriptorSet);
-
-    // If we have run out of pool memory
-    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
-        // We need to allocate a new DescriptorPool and retry
-        vulkanDevice->descriptorSetPools.emplace_back(createDescriptorSetPool(vulkanDevice->device));
-        result = allocateDescriptorSet(vulkanDevice->device, vulkanDevice->descriptorSetPools.back(),
-                                       bindGroupLayout, descriptorSet);
-    }
-    if (result != VK_SUCCESS)
+    const auto [descriptorSet, descriptorPool] = transient
+            ? descriptorAllocator.allocateTransient(options.layout)
+            : descriptorAllocator.allocate(options.layout, options.maxVariableArrayLength);
+    if (descriptorSet == VK_NULL_HANDLE)
         return {};
 
-    const auto vulkanBindGroupHandle = m_bindGroups.emplace(VulkanBindGroup(descriptorSet, vulkanDevice->descriptorSetPools.back(), this, deviceHandle));
+    const auto vulkanBindGroupHandle = m_bindGroups.emplace(VulkanBindGroup(descriptorSet, descriptorPool, this, deviceHandle));
     auto vulkanBindGroup = m_bindGroups.get(vulkanBindGroupHandle);
+    vulkanBindGroup->layoutHandle = options.layout;
+    vulkanBindGroup->transient = transient;
+    if (transient)
+        descriptorAllocator.addTransientBindGroup(vulkanBindGroupHandle);
 
-    // Set up the initial bindings
-    for (const auto &resource : options.resources)
-        vulkanBindGroup->update(resource);
+    // Set up the initial bindings, all at once
+    if (!options.resources.empty())
+        vulkanBindGroup->update(options.resources);
 
     return vulkanBindGroupHandle;
 }
 
 void VulkanResourceManager::deleteBindGroup(const Handle<BindGroup_t> &handle)
 {
+    // Transient bind groups are invalidated when their frame ends, possibly before the BindGroup goes away
     VulkanBindGroup *vulkanBindGroup = m_bindGroups.get(handle);
+    if (!vulkanBindGroup)
+        return;
     VulkanDevice *vulkanDevice = m_devices.get(vulkanBindGroup->deviceHandle);
 
-    vkFreeDescriptorSets(vulkanDevice->device, vulkanBindGroup->descriptorPool, 1, &vulkanBindGroup->descriptorSet);
+    // The sets of transient bind groups are reclaimed with the pools of their frame
+    if (!vulkanBindGroup->transient)
+        vulkanDevice->descriptorAllocator->release(vulkanBindGroup->layoutHandle, vulkanBindGroup->descriptorSet, vulkanBindGroup->descriptorPool);
 
     m_bindGroups.remove(handle);
 }
 
+void VulkanResourceManager::removeTransientBindGroups(const std::vector<Handle<BindGroup_t>> &handles)
+{
+    for (const Handle<BindGroup_t> &handle : handles)
+        m_bindGroups.remove(handle);
+}
+
 VulkanBindGroup *VulkanResourceManager::getBindGroup(const Handle<BindGroup_t> &handle) const
 {
     return m_bindGroups.get(handle);
@@ -1805,10 +2031,26 @@ Handle<BindGroupLayout_t> VulkanResourceManager::createBindGroupLayout(const Han
 {
     VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
 
+    // Identical layouts share a single VkDescriptorSetLayout so that their bind groups and
+    // the pipeline layouts built from them are compatible
+    auto &cache = *vulkanDevice->bindGroupLayoutCache;
+    const VulkanBindGroupLayoutKey key(options);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (const Handle<BindGroupLayout_t> cachedHandle = cache.acquire(key); cachedHandle.isValid())
+        return cachedHandle;
+
     assert(options.bindings.size() <= std::numeric_limits<uint32_t>::max());
     const uint32_t bindingLayoutCount = static_cast<uint32_t>(options.bindings.size());
     std::vector<VkDescriptorSetLayoutBinding> vkBindingLayouts;
     vkBindingLayouts.reserve(bindingLayoutCount);
+    std::vector<std::vector<VkSampler>> vkImmutableSamplers(bindingLayoutCount);
+    std::vector<Handle<Sampler_t>> immutableSamplers;
+    std::vector<VkDescriptorPoolSize> setSizes; // Descriptors of each type needed by a single set
+    std::vector<VkDescriptorBindingFlags> vkBindingFlags;
+    vkBindingFlags.reserve(bindingLayoutCount);
+    bool hasBindingFlags = false;
+    bool updateAfterBind = false;
+    std::optional<VulkanDescriptorAllocator::VariableBinding> variableBinding;
 
     for (uint32_t j = 0; j < bindingLayoutCount; ++j) {
         const auto &bindingLayout = options.bindings.at(j);
@@ -1818,7 +2060,51 @@ Handle<BindGroupLayout_t> VulkanResourceManager::createBindGroupLayout(const Han
         vkBindingLayout.descriptorCount = bindingLayout.count;
         vkBindingLayout.descriptorType = resourceBindingTypeToVkDescriptorType(bindingLayout.resourceType);
         vkBindingLayout.stageFlags = bindingLayout.shaderStages.toInt();
-        vkBindingLayout.pImmutableSamplers = nullptr; // TODO: Expose immutable samplers?
+        vkBindingLayout.pImmutableSamplers = nullptr;
+
+        const auto &samplers = bindingLayout.immutableSamplers;
+        const bool takesSamplers = bindingLayout.resourceType == ResourceBindingType::Sampler ||
+                bindingLayout.resourceType == ResourceBindingType::CombinedImageSampler;
+        const bool samplersValid = std::all_of(samplers.begin(), samplers.end(), [this](const Handle<Sampler_t> &sampler) {
+            return m_samplers.get(sampler) != nullptr;
+        });
+        if (!samplers.empty() && (!takesSamplers || !samplersValid || (samplers.size() != 1 && samplers.size() != bindingLayout.count))) {
+            SPDLOG_LOGGER_WARN(Logger::logger(), "Ignoring the immutable samplers of binding {}", bindingLayout.binding);
+        } else if (!samplers.empty()) {
+            // A single sampler is used for all the descriptors of the binding
+            std::vector<VkSampler> &vkSamplers = vkImmutableSamplers[j];
+            for (uint32_t i = 0; i < bindingLayout.count; ++i)
+                vkSamplers.push_back(m_samplers.get(samplers[samplers.size() == 1 ? 0 : i])->sampler);
+            vkBindingLayout.pImmutableSamplers = vkSamplers.data();
+            immutableSamplers.insert(immutableSamplers.end(), samplers.begin(), samplers.end());
+        }
+
+        const ResourceBindingFlags flags = bindingLayout.flags;
+        vkBindingFlags.push_back(flags.toInt());
+        hasBindingFlags |= flags.toInt() != 0;
+        updateAfterBind |= flags.testFlag(ResourceBindingFlagBits::UpdateAfterBindBit);
+
+        // The variable count binding gets its descriptors when each set is allocated
+        if (flags.testFlag(ResourceBindingFlagBits::VariableBindGroupEntriesCountBit)) {
+            const bool isHighestBinding = std::all_of(options.bindings.begin(), options.bindings.end(), [&](const ResourceBindingLayout &other) {
+                return other.binding <= bindingLayout.binding;
+            });
+            if (!isHighestBinding || variableBinding) {
+                SPDLOG_LOGGER_WARN(Logger::logger(), "Only the highest binding of a BindGroupLayout can have a variable count");
+                return {};
+            }
+            variableBinding = VulkanDescriptorAllocator::VariableBinding{ vkBindingLayout.descriptorType, vkBindingLayout.descriptorCount };
+            vkBindingLayouts.emplace_back(std::move(vkBindingLayout));
+            continue;
+        }
+
+        auto setSizeIt = std::find_if(setSizes.begin(), setSizes.end(), [&](const VkDescriptorPoolSize &size) {
+            return size.type == vkBindingLayout.descriptorType;
+        });
+        if (setSizeIt == setSizes.end())
+            setSizes.push_back({ vkBindingLayout.descriptorType, vkBindingLayout.descriptorCount });
+        else
+            setSizeIt->descriptorCount += vkBindingLayout.descriptorCount;
 
         vkBindingLayouts.emplace_back(std::move(vkBindingLayout));
     }
@@ -1829,13 +2115,85 @@ Handle<BindGroupLayout_t> VulkanResourceManager::createBindGroupLayout(const Han
     createInfo.bindingCount = static_cast<uint32_t>(vkBindingLayouts.size());
     createInfo.pBindings = vkBindingLayouts.data();
 
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+    if (hasBindingFlags) {
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(vkBindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = vkBindingFlags.data();
+        createInfo.pNext = &bindingFlagsInfo;
+    }
+    if (updateAfterBind)
+        createInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+
     VkDescriptorSetLayout vkDescriptorSetLayout{ VK_NULL_HANDLE };
     if (vkCreateDescriptorSetLayout(vulkanDevice->device, &createInfo, nullptr, &vkDescriptorSetLayout) != VK_SUCCESS) {
-        // TODO: Log problem
-        // SPDLOG_LOGGER_WARN(Logger::logger(), "Failed to create DescriptorSetLayout");
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Failed to create DescriptorSetLayout");
+        return {};
+    }
+
+    // The layout keeps its immutable samplers alive, whatever happens to the Samplers they came from
+    {
+        auto &cache = *vulkanDevice->samplerCache;
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (const Handle<Sampler_t> &sampler : immutableSamplers)
+            cache.retain(sampler);
+    }
+
+    VulkanBindGroupLayout vulkanBindGroupLayout(vkDescriptorSetLayout, deviceHandle);
+    vulkanBindGroupLayout.immutableSamplers = std::move(immutableSamplers);
+
+    // Precompute an update template so that bind groups written as a whole need no VkWriteDescriptorSet.
+    // Sampler bindings with immutable samplers and types BindGroupEntry cannot hold are never written.
+    // The number of descriptors of a variable count binding is only known per set, such layouts get none.
+    std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+    for (uint32_t j = 0; j < bindingLayoutCount && !variableBinding; ++j) {
+        const VkDescriptorSetLayoutBinding &vkBindingLayout = vkBindingLayouts[j];
+        const bool writable = (vkBindingLayout.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER && vkBindingLayout.pImmutableSamplers == nullptr) ||
+                vkBindingLayout.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+                vkBindingLayout.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+                vkBindingLayout.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+                vkBindingLayout.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+                vkBindingLayout.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+                vkBindingLayout.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        if (!writable || vkBindingLayout.descriptorCount == 0)
+            continue;
+
+        const uint32_t firstSlot = vulkanBindGroupLayout.templateSlotCount;
+        VkDescriptorUpdateTemplateEntry templateEntry = {};
+        templateEntry.dstBinding = vkBindingLayout.binding;
+        templateEntry.dstArrayElement = 0;
+        templateEntry.descriptorCount = vkBindingLayout.descriptorCount;
+        templateEntry.descriptorType = vkBindingLayout.descriptorType;
+        templateEntry.offset = firstSlot * sizeof(VulkanDescriptorSlot);
+        templateEntry.stride = sizeof(VulkanDescriptorSlot);
+        templateEntries.push_back(templateEntry);
+
+        vulkanBindGroupLayout.templateBindings.push_back({ vkBindingLayout.binding, vkBindingLayout.descriptorType,
+                                                           firstSlot, vkBindingLayout.descriptorCount });
+        vulkanBindGroupLayout.templateSlotCount += vkBindingLayout.descriptorCount;
     }
 
-    const auto vulkanBindGroupLayoutHandle = m_bindGroupLayouts.emplace(VulkanBindGroupLayout(vkDescriptorSetLayout, deviceHandle));
+    if (!templateEntries.empty()) {
+        VkDescriptorUpdateTemplateCreateInfo templateInfo = {};
+        templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+        templateInfo.pDescriptorUpdateEntries = templateEntries.data();
+        templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        templateInfo.descriptorSetLayout = vkDescriptorSetLayout;
+
+        // Bind groups then fall back to batched writes
+        if (vkCreateDescriptorUpdateTemplate(vulkanDevice->device, &templateInfo, nullptr, &vulkanBindGroupLayout.updateTemplate) != VK_SUCCESS) {
+            SPDLOG_LOGGER_WARN(Logger::logger(), "Failed to create DescriptorUpdateTemplate");
+            vulkanBindGroupLayout.updateTemplate = VK_NULL_HANDLE;
+        }
+    }
+
+    const auto vulkanBindGroupLayoutHandle = m_bindGroupLayouts.emplace(std::move(vulkanBindGroupLayout));
+
+    // Bind groups of this layout get descriptor pools of their own, sized for it
+    vulkanDevice->descriptorAllocator->registerLayout(vulkanBindGroupLayoutHandle, vkDescriptorSetLayout, std::move(setSizes),
+                                                      updateAfterBind, variableBinding);
+    cache.insert(key, vulkanBindGroupLayoutHandle);
     return vulkanBindGroupLayoutHandle;
 }
 
@@ -1844,7 +2202,18 @@ void VulkanResourceManager::deleteBindGroupLayout(const Handle<BindGroupLayout_t
     VulkanBindGroupLayout *vulkanBindGroupLayout = m_bindGroupLayouts.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(vulkanBindGroupLayout->deviceHandle);
 
+    auto &cache = *vulkanDevice->bindGroupLayoutCache;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (!cache.release(handle))
+        return;
+
     vkDestroyDescriptorSetLayout(vulkanDevice->device, vulkanBindGroupLayout->descriptorSetLayout, nullptr);
+    if (vulkanBindGroupLayout->updateTemplate != VK_NULL_HANDLE)
+        vkDestroyDescriptorUpdateTemplate(vulkanDevice->device, vulkanBindGroupLayout->updateTemplate, nullptr);
+    vulkanDevice->descriptorAllocator->unregisterLayout(handle);
+
+    for (const Handle<Sampler_t> &sampler : vulkanBindGroupLayout->immutableSamplers)
+        deleteSampler(sampler);
 
     m_bindGroupLayouts.remove(handle);
 }
@@ -1858,6 +2227,13 @@ Handle<Sampler_t> VulkanResourceManager::createSampler(const Handle<Device_t> &d
 {
     VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
 
+    // Samplers are capped by maxSamplerAllocationCount, identical ones share a single VkSampler
+    auto &cache = *vulkanDevice->samplerCache;
+    const VulkanSamplerKey key(options);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (const Handle<Sampler_t> cachedHandle = cache.acquire(key); cachedHandle.isValid())
+        return cachedHandle;
+
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.magFilter = filterModeToVkFilterMode(options.magFilter);
@@ -1888,6 +2264,7 @@ Handle<Sampler_t> VulkanResourceManager::createSampler(const Handle<Device_t> &d
         return {};
 
     auto samplerHandle = m_samplers.emplace(VulkanSampler(sampler, deviceHandle));
+    cache.insert(key, samplerHandle);
     return samplerHandle;
 }
 
@@ -1896,7 +2273,12 @@ void VulkanResourceManager::deleteSampler(const Handle<Sampler_t> &handle)
     VulkanSampler *sampler = m_samplers.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(sampler->deviceHandle);
 
-    vkDestroySampler(vulkanDevice->device, sampler->sampler, nullptr);
+    auto &cache = *vulkanDevice->samplerCache;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (!cache.release(handle))
+        return;
+
+    vulkanDevice->deletionQueue->enqueue(VK_OBJECT_TYPE_SAMPLER, sampler->sampler);
 
     m_samplers.remove(handle);
 }
@@ -1928,6 +2310,8 @@ void VulkanResourceManager::deleteFence(const Handle<Fence_t> &handle)
     VulkanFence *fence = m_fences.get(handle);
     VulkanDevice *vulkanDevice = m_devices.get(fence->deviceHandle);
 
+    // Stop tracking the submission which signalled the fence, if any
+    vulkanDevice->deletionQueue->collect();
     vkDestroyFence(vulkanDevice->device, fence->fence, nullptr);
 
     m_fences.remove(handle);
@@ -1938,4 +2322,490 @@ VulkanFence *VulkanResourceManager::getFence(const Handle<Fence_t> &handle) cons
     return m_fences.get(handle);
 }
 
+Handle<MemoryPool_t> VulkanResourceManager::createMemoryPool(const Handle<Device_t> &deviceHandle, const MemoryPoolOptions &options)
+{
+    VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = memoryUsageToVmaMemoryUsage(options.memoryUsage);
+
+    // Find a memory type compatible with the resources the pool is meant for
+    uint32_t memoryTypeIndex = 0;
+    VkResult result = VK_SUCCESS;
+    if (options.textureUsage.toInt() != 0) {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = formatToVkFormat(options.textureFormat);
+        imageInfo.extent = { 1, 1, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = options.textureUsage.toInt();
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        result = vmaFindMemoryTypeIndexForImageInfo(vulkanDevice->allocator, &imageInfo, &allocInfo, &memoryTypeIndex);
+    } else if (options.bufferUsage.toInt() != 0) {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = 1024;
+        bufferInfo.usage = options.bufferUsage.toInt();
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        result = vmaFindMemoryTypeIndexForBufferInfo(vulkanDevice->allocator, &bufferInfo, &allocInfo, &memoryTypeIndex);
+    } else {
+        result = vmaFindMemoryTypeIndex(vulkanDevice->allocator, UINT32_MAX, &allocInfo, &memoryTypeIndex);
+    }
+    if (result != VK_SUCCESS) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "No memory type suitable for the requested memory pool: {}", getResultAsString(result));
+        return {};
+    }
+
+    VmaPoolCreateInfo poolInfo = {};
+    poolInfo.memoryTypeIndex = memoryTypeIndex;
+    poolInfo.blockSize = options.blockSize;
+    poolInfo.minBlockCount = options.minBlockCount;
+    poolInfo.maxBlockCount = options.maxBlockCount;
+    if (options.algorithm == MemoryPoolAlgorithm::Linear)
+        poolInfo.flags |= VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT;
+
+    VmaPool vmaPool{ VK_NULL_HANDLE };
+    if (vmaCreatePool(vulkanDevice->allocator, &poolInfo, &vmaPool) != VK_SUCCESS)
+        return {};
+
+    return m_memoryPools.emplace(VulkanMemoryPool(vmaPool, memoryTypeIndex, this, deviceHandle));
+}
+
+void VulkanResourceManager::deleteMemoryPool(const Handle<MemoryPool_t> &handle)
+{
+    VulkanMemoryPool *vulkanMemoryPool = m_memoryPools.get(handle);
+    VulkanDevice *vulkanDevice = m_devices.get(vulkanMemoryPool->deviceHandle);
+
+    // Resources allocated from the pool may still be waiting in the deletion queue,
+    // the pool is queued after them so that it is destroyed once they are released.
+    vulkanDevice->deletionQueue->enqueue(VulkanDeletionQueue::MemoryPoolObjectType, vulkanMemoryPool->pool);
+
+    m_memoryPools.remove(handle);
+}
+
+VulkanMemoryPool *VulkanResourceManager::getMemoryPool(const Handle<MemoryPool_t> &handle) const
+{
+    return m_memoryPools.get(handle);
+}
+
+ResourceStatistics VulkanResourceManager::statistics() const
+{
+    return ResourceStatistics{
+        .instances = m_instances.statistics(),
+        .adapters = m_adapters.statistics(),
+        .devices = m_devices.statistics(),
+        .queues = m_queues.statistics(),
+        .surfaces = m_surfaces.statistics(),
+        .swapchains = m_swapchains.statistics(),
+        .textures = m_textures.statistics(),
+        .textureViews = m_textureViews.statistics(),
+        .buffers = m_buffers.statistics(),
+        .shaderModules = m_shaderModules.statistics(),
+        .pipelineLayouts = m_pipelineLayouts.statistics(),
+        .bindGroupLayouts = m_bindGroupLayouts.statistics(),
+        .bindGroups = m_bindGroups.statistics(),
+        .graphicsPipelines = m_graphicsPipelines.statistics(),
+        .computePipelines = m_computePipelines.statistics(),
+        .gpuSemaphores = m_gpuSemaphores.statistics(),
+        .commandRecorders = m_commandRecorders.statistics(),
+        .renderPassCommandRecorders = m_renderPassCommandRecorders.statistics(),
+        .computePassCommandRecorders = m_computePassCommandRecorders.statistics(),
+        .commandBuffers = m_commandBuffers.statistics(),
+        .renderPasses = m_renderPasses.statistics(),
+        .framebuffers = m_framebuffers.statistics(),
+        .samplers = m_samplers.statistics(),
+        .fences = m_fences.statistics(),
+        .memoryPools = m_memoryPools.statistics()
+    };
+}
+
+DeviceResourceStatistics VulkanResourceManager::deviceStatistics(const Handle<Device_t> &deviceHandle) const
+{
+    VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
+    if (!vulkanDevice)
+        return {};
+
+    DeviceResourceStatistics stats;
+
+    // Buffers and textures still waiting in the deletion queue are no longer accounted for
+    const VulkanMemoryUsageCounters &memoryCounters = *vulkanDevice->memoryUsageCounters;
+    for (uint32_t i = 0; i < MemoryUsageCount; ++i) {
+        stats.memoryUsage[i] = MemoryUsageStatistics{
+            .allocationCount = memoryCounters.allocationCounts[i].load(std::memory_order_relaxed),
+            .allocatedBytes = memoryCounters.allocatedBytes[i].load(std::memory_order_relaxed)
+        };
+    }
+
+    stats.descriptorPools = vulkanDevice->descriptorAllocator->statistics();
+
+    stats.cachedRenderPasses = static_cast<uint32_t>(vulkanDevice->renderPasses.size());
+    stats.cachedFramebuffers = static_cast<uint32_t>(vulkanDevice->framebuffers.size());
+    stats.deletionQueue = vulkanDevice->deletionQueue->statistics();
+
+    auto cacheStatistics = [](auto &cache) {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        return ObjectCacheStatistics{
+            .objectCount = static_cast<uint32_t>(cache.entries.size()),
+            .hitCount = cache.hitCount
+        };
+    };
+    stats.samplerCache = cacheStatistics(*vulkanDevice->samplerCache);
+    stats.textureViewCache = cacheStatistics(*vulkanDevice->textureViewCache);
+    stats.bindGroupLayoutCache = cacheStatistics(*vulkanDevice->bindGroupLayoutCache);
+    stats.pipelineLayoutCache = cacheStatistics(*vulkanDevice->pipelineLayoutCache);
+
+    const VulkanDescriptorUpdateCounters &descriptorCounters = *vulkanDevice->descriptorUpdateCounters;
+    stats.descriptorUpdates = DescriptorUpdateStatistics{
+        .batchedUpdateCount = descriptorCounters.batchedUpdates.load(std::memory_order_relaxed),
+        .templateUpdateCount = descriptorCounters.templateUpdates.load(std::memory_order_relaxed),
+        .descriptorCount = descriptorCounters.descriptors.load(std::memory_order_relaxed)
+    };
+
+    const VulkanBufferUploadCounters &uploadCounters = *vulkanDevice->bufferUploadCounters;
+    stats.bufferUploads = BufferUploadStatistics{
+        .hostVisibleDeviceLocalMemory = vulkanDevice->hostVisibleDeviceLocalMemory,
+        .directWriteCount = uploadCounters.directWrites.load(std::memory_order_relaxed),
+        .directWriteBytes = uploadCounters.directWriteBytes.load(std::memory_order_relaxed),
+        .stagedUploadCount = uploadCounters.stagedUploads.load(std::memory_order_relaxed),
+        .stagedUploadBytes = uploadCounters.stagedUploadBytes.load(std::memory_order_relaxed)
+    };
+
+    return stats;
+}
+
+bool VulkanResourceManager::beginDefragmentation(const Handle<Device_t> &deviceHandle, const DefragmentationOptions &options)
+{
+    VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
+    if (!vulkanDevice || vulkanDevice->defragmentationContext != VK_NULL_HANDLE)
+        return false;
+
+    VmaDefragmentationInfo defragInfo = {};
+    switch (options.strategy) {
+    case DefragmentationStrategy::Fast:
+        defragInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FAST_BIT;
+        break;
+    case DefragmentationStrategy::Balanced:
+        defragInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+        break;
+    case DefragmentationStrategy::Full:
+        defragInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FULL_BIT;
+        break;
+    }
+    if (options.memoryPool.isValid()) {
+        VulkanMemoryPool *vulkanMemoryPool = m_memoryPools.get(options.memoryPool);
+        if (!vulkanMemoryPool)
+            return false;
+        defragInfo.pool = vulkanMemoryPool->pool;
+    }
+    defragInfo.maxBytesPerPass = options.maxBytesPerPass;
+    defragInfo.maxAllocationsPerPass = options.maxAllocationsPerPass;
+
+    VmaDefragmentationContext context = VK_NULL_HANDLE;
+    const VkResult result = vmaBeginDefragmentation(vulkanDevice->allocator, &defragInfo, &context);
+    if (result != VK_SUCCESS) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Unable to begin defragmentation: {}", getResultAsString(result));
+        return false;
+    }
+
+    vulkanDevice->defragmentationContext = context;
+    vulkanDevice->defragmentationTimeBudget = options.timeBudget;
+    vulkanDevice->defragmentationStatistics = DefragmentationStatistics{ .active = true };
+    return true;
+}
+
+DefragmentationStatistics VulkanResourceManager::defragmentationStep(const Handle<Device_t> &deviceHandle, const Handle<Queue_t> &queueHandle)
+{
+    VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
+    if (!vulkanDevice)
+        return {};
+    if (vulkanDevice->defragmentationContext == VK_NULL_HANDLE)
+        return vulkanDevice->defragmentationStatistics;
+
+    VulkanQueue *vulkanQueue = m_queues.get(queueHandle);
+    const auto queueIt = std::find_if(
+            vulkanDevice->queueDescriptions.begin(),
+            vulkanDevice->queueDescriptions.end(),
+            [queueHandle](const QueueDescription &queueDescription) { return queueDescription.queue == queueHandle; });
+    if (!vulkanQueue || queueIt == vulkanDevice->queueDescriptions.end()) {
+        SPDLOG_LOGGER_WARN(Logger::logger(), "Defragmentation requires a queue of the device being defragmented");
+        return vulkanDevice->defragmentationStatistics;
+    }
+
+    // The previous pass ends once its copies, and all the work submitted before them, have retired
+    VulkanDeletionQueue &deletionQueue = *vulkanDevice->deletionQueue;
+    if (vulkanDevice->defragmentationPassPending) {
+        if (!deletionQueue.hasRetired(vulkanDevice->defragmentationSerial))
+            return vulkanDevice->defragmentationStatistics;
+        const DefragmentationStatistics stats = endDefragmentationPass(deviceHandle);
+        if (!stats.active)
+            return stats;
+    }
+
+    VmaDefragmentationPassMoveInfo &passInfo = vulkanDevice->defragmentationPass;
+    passInfo = {};
+    VkResult result = vmaBeginDefragmentationPass(vulkanDevice->allocator, vulkanDevice->defragmentationContext, &passInfo);
+    if (result != VK_INCOMPLETE) {
+        if (result != VK_SUCCESS)
+            SPDLOG_LOGGER_WARN(Logger::logger(), "Defragmentation pass failed: {}", getResultAsString(result));
+        return endDefragmentation(deviceHandle);
+    }
+
+    // Submitted work may still use the memory being moved. Host visible buffers are copied on
+    // the CPU, so only while nothing is in flight, and bind groups can only be rewritten then.
+    const bool idle = deletionQueue.hasRetired(deletionQueue.lastSubmittedSerial());
+    std::vector<Handle<Buffer_t>> pinnedBuffers;
+    if (!idle) {
+        m_bindGroups.forEach([&](const Handle<BindGroup_t> &, VulkanBindGroup &bindGroup) {
+            if (bindGroup.deviceHandle == deviceHandle)
+                bindGroup.collectBoundBuffers(pinnedBuffers);
+        });
+    }
+
+    // Command buffers recorded but not yet submitted, or submitted again later, keep using the
+    // VkBuffers they recorded, so those buffers stay where they are even while idle
+    m_commandBuffers.forEach([&](const Handle<CommandBuffer_t> &, VulkanCommandBuffer &commandBuffer) {
+        if (commandBuffer.deviceHandle == deviceHandle)
+            pinnedBuffers.insert(pinnedBuffers.end(), commandBuffer.usedBuffers.begin(), commandBuffer.usedBuffers.end());
+    });
+
+    struct BufferMove {
+        uint32_t moveIndex;
+        Handle<Buffer_t> handle;
+        VulkanBuffer *buffer;
+        VkBuffer newBuffer;
+        bool gpuCopy;
+    };
+    std::vector<BufferMove> moves;
+    moves.reserve(passInfo.moveCount);
+
+    DefragmentationStatistics &stats = vulkanDevice->defragmentationStatistics;
+    const auto deadline = std::chrono::steady_clock::now() + vulkanDevice->defragmentationTimeBudget;
+
+    for (uint32_t i = 0; i < passInfo.moveCount; ++i) {
+        VmaDefragmentationMove &move = passInfo.pMoves[i];
+        move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+        ++stats.allocationsSkipped;
+
+        // Whatever could not be done in time is proposed again by a later pass
+        if (std::chrono::steady_clock::now() >= deadline)
+            continue;
+
+        // Only buffers can be relocated. We don't know the layout textures are in,
+        // so they can't be copied and stay where they are.
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(vulkanDevice->allocator, move.srcAllocation, &allocationInfo);
+        const auto bufferIndex = reinterpret_cast<uintptr_t>(allocationInfo.pUserData);
+        if (bufferIndex == 0)
+            continue;
+        const Handle<Buffer_t> bufferHandle = m_buffers.handleForIndex(static_cast<uint32_t>(bufferIndex - 1));
+        VulkanBuffer *vulkanBuffer = m_buffers.get(bufferHandle);
+
+        // The application may be holding on to a pointer into mapped memory
+        if (!vulkanBuffer || vulkanBuffer->mapped != nullptr)
+            continue;
+        if (std::find(pinnedBuffers.begin(), pinnedBuffers.end(), bufferHandle) != pinnedBuffers.end())
+            continue;
+
+        VkMemoryPropertyFlags memoryProperties = 0;
+        vmaGetAllocationMemoryProperties(vulkanDevice->allocator, move.srcAllocation, &memoryProperties);
+        const bool gpuCopy = (memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0;
+        const VkBufferUsageFlags copyUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        if (gpuCopy && (vulkanBuffer->usage & copyUsage) != copyUsage)
+            continue;
+
+        // Host visible buffers could be mapped while a pass waits for its copies, to the memory
+        // they are leaving. A pass moves either kind of buffer, never both.
+        if (!gpuCopy && (!idle || std::any_of(moves.begin(), moves.end(), [](const BufferMove &m) { return m.gpuCopy; })))
+            continue;
+        if (gpuCopy && std::any_of(moves.begin(), moves.end(), [](const BufferMove &m) { return !m.gpuCopy; }))
+            continue;
+
+        VkBufferCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = vulkanBuffer->size;
+        createInfo.usage = vulkanBuffer->usage;
+        createInfo.sharingMode = vulkanBuffer->sharingMode;
+        createInfo.queueFamilyIndexCount = static_cast<uint32_t>(vulkanBuffer->queueFamilyIndices.size());
+        createInfo.pQueueFamilyIndices = vulkanBuffer->queueFamilyIndices.data();
+
+        VkBuffer newBuffer = VK_NULL_HANDLE;
+        if (vkCreateBuffer(vulkanDevice->device, &createInfo, nullptr, &newBuffer) != VK_SUCCESS)
+            continue;
+        if (vmaBindBufferMemory(vulkanDevice->allocator, move.dstTmpAllocation, newBuffer) != VK_SUCCESS) {
+            vkDestroyBuffer(vulkanDevice->device, newBuffer, nullptr);
+            continue;
+        }
+
+        if (!gpuCopy) {
+            void *src = nullptr;
+            void *dst = nullptr;
+            vmaMapMemory(vulkanDevice->allocator, move.srcAllocation, &src);
+            vmaMapMemory(vulkanDevice->allocator, move.dstTmpAllocation, &dst);
+            vmaInvalidateAllocation(vulkanDevice->allocator, move.srcAllocation, 0, VK_WHOLE_SIZE);
+            std::memcpy(dst, src, vulkanBuffer->size);
+            vmaFlushAllocation(vulkanDevice->allocator, move.dstTmpAllocation, 0, VK_WHOLE_SIZE);
+            vmaUnmapMemory(vulkanDevice->allocator, move.dstTmpAllocation);
+            vmaUnmapMemory(vulkanDevice->allocator, move.srcAllocation);
+        }
+
+        move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_COPY;
+        --stats.allocationsSkipped;
+        moves.push_back(BufferMove{ i, bufferHandle, vulkanBuffer, newBuffer, gpuCopy });
+    }
+
+    // Copy the device local buffers with a single submission, tracked like any other so
+    // that the old buffers are released once it retires
+    const bool needsGpuCopy = std::any_of(moves.begin(), moves.end(), [](const BufferMove &m) { return m.gpuCopy; });
+    if (needsGpuCopy) {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = queueIt->queueTypeIndex;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        result = vkCreateCommandPool(vulkanDevice->device, &poolInfo, nullptr, &commandPool);
+        if (result == VK_SUCCESS) {
+            VkCommandBufferAllocateInfo allocateInfo = {};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = commandPool;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocateInfo.commandBufferCount = 1;
+            result = vkAllocateCommandBuffers(vulkanDevice->device, &allocateInfo, &commandBuffer);
+        }
+        VkFence fence = VK_NULL_HANDLE;
+        if (result == VK_SUCCESS) {
+            VkCommandBufferBeginInfo beginInfo = {};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+            // Work submitted earlier to the queue may still be writing the buffers, and
+            // work submitted later uses the new ones
+            VkMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            for (const BufferMove &m : moves) {
+                if (!m.gpuCopy)
+                    continue;
+                VkBufferCopy region = {};
+                region.size = m.buffer->size;
+                vkCmdCopyBuffer(commandBuffer, m.buffer->buffer, m.newBuffer, 1, &region);
+            }
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            vkEndCommandBuffer(commandBuffer);
+
+            VkSubmitInfo submitInfo = {};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+            fence = deletionQueue.acquireSubmissionFence();
+            result = fence != VK_NULL_HANDLE ? vkQueueSubmit(vulkanQueue->queue, 1, &submitInfo, fence) : VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        if (result == VK_SUCCESS) {
+            deletionQueue.trackSubmission(fence);
+            deletionQueue.enqueue(VK_OBJECT_TYPE_COMMAND_POOL, commandPool);
+        } else {
+            // Without the copy the contents would be lost, keep these buffers where they are
+            SPDLOG_LOGGER_WARN(Logger::logger(), "Unable to copy buffers for defragmentation: {}", getResultAsString(result));
+            deletionQueue.releaseSubmissionFence(fence);
+            if (commandPool != VK_NULL_HANDLE)
+                vkDestroyCommandPool(vulkanDevice->device, commandPool, nullptr);
+            std::erase_if(moves, [&](const BufferMove &m) {
+                if (!m.gpuCopy)
+                    return false;
+                passInfo.pMoves[m.moveIndex].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                vkDestroyBuffer(vulkanDevice->device, m.newBuffer, nullptr);
+                ++stats.allocationsSkipped;
+                return true;
+            });
+        }
+    }
+
+    // Swap the VkBuffers behind the handles. The allocation handles stay the same,
+    // VMA points them at the new memory when the pass ends.
+    std::vector<Handle<Buffer_t>> movedBuffers;
+    movedBuffers.reserve(moves.size());
+    vulkanDevice->defragmentationMoves.clear();
+    for (const BufferMove &m : moves) {
+        deletionQueue.enqueue(VK_OBJECT_TYPE_BUFFER, m.buffer->buffer);
+        m.buffer->buffer = m.newBuffer;
+        movedBuffers.push_back(m.handle);
+        vulkanDevice->defragmentationMoves.emplace_back(m.handle, m.moveIndex);
+        stats.bytesMoved += m.buffer->size;
+    }
+    stats.allocationsMoved += moves.size();
+
+    // Point the descriptors at the new VkBuffers, only buffers bound to none are moved while busy
+    if (!movedBuffers.empty() && idle) {
+        m_bindGroups.forEach([&](const Handle<BindGroup_t> &, VulkanBindGroup &bindGroup) {
+            if (bindGroup.deviceHandle == deviceHandle)
+                bindGroup.rewriteBufferEntries(movedBuffers);
+        });
+    }
+
+    // The old memory is released when the pass ends, which has to wait for the copies
+    vulkanDevice->defragmentationSerial = deletionQueue.lastSubmittedSerial();
+    vulkanDevice->defragmentationPassPending = true;
+    if (needsGpuCopy && !moves.empty())
+        return stats;
+    return endDefragmentationPass(deviceHandle);
+}
+
+DefragmentationStatistics VulkanResourceManager::endDefragmentationPass(const Handle<Device_t> &deviceHandle)
+{
+    VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
+    DefragmentationStatistics &stats = vulkanDevice->defragmentationStatistics;
+
+    vulkanDevice->defragmentationPassPending = false;
+    vulkanDevice->defragmentationMoves.clear();
+    ++stats.passCount;
+    const VkResult result = vmaEndDefragmentationPass(vulkanDevice->allocator, vulkanDevice->defragmentationContext,
+                                                      &vulkanDevice->defragmentationPass);
+    if (result == VK_SUCCESS)
+        return endDefragmentation(deviceHandle);
+    return stats;
+}
+
+DefragmentationStatistics VulkanResourceManager::endDefragmentation(const Handle<Device_t> &deviceHandle)
+{
+    VulkanDevice *vulkanDevice = m_devices.get(deviceHandle);
+    if (!vulkanDevice)
+        return {};
+
+    DefragmentationStatistics &stats = vulkanDevice->defragmentationStatistics;
+    if (vulkanDevice->defragmentationContext == VK_NULL_HANDLE)
+        return stats;
+
+    // The memory of a pending pass can only be released once its copies are done
+    if (vulkanDevice->defragmentationPassPending) {
+        vulkanDevice->deletionQueue->waitUntilRetired(vulkanDevice->defragmentationSerial);
+        vulkanDevice->defragmentationPassPending = false;
+        vulkanDevice->defragmentationMoves.clear();
+        ++stats.passCount;
+        vmaEndDefragmentationPass(vulkanDevice->allocator, vulkanDevice->defragmentationContext, &vulkanDevice->defragmentationPass);
+    }
+
+    VmaDefragmentationStats vmaStats = {};
+    vmaEndDefragmentation(vulkanDevice->allocator, vulkanDevice->defragmentationContext, &vmaStats);
+    vulkanDevice->defragmentationContext = VK_NULL_HANDLE;
+
+    stats.active = false;
+    stats.bytesFreed = vmaStats.bytesFreed;
+    stats.memoryBlocksFreed = vmaStats.deviceMemoryBlocksFreed;
+    return stats;
+}
+
 } // namespace KDGpu
@@ -13,6 +13,8 @@
 #include <KDGpu/resource_manager.h>
 
 #include <KDGpu/pool.h>
+#include <KDGpu/concurrent_pool.h>
+#include <KDGpu/transient_pool.h>
 
 #include <KDGpu/vulkan/vulkan_adapter.h>
 #include <KDGpu/vulkan/vulkan_bind_group.h>
@@ -28,6 +30,7 @@
 #include <KDGpu/vulkan/vulkan_gpu_semaphore.h>
 #include <KDGpu/vulkan/vulkan_graphics_pipeline.h>
 #include <KDGpu/vulkan/vulkan_instance.h>
+#include <KDGpu/vulkan/vulkan_memory_pool.h>
 #include <KDGpu/vulkan/vulkan_pipeline_layout.h>
 #include <KDGpu/vulkan/vulkan_queue.h>
 #include <KDGpu/vulkan/vulkan_render_pass.h>
@@ -88,6 +91,7 @@ public:
 
     // For user-created textures
     Handle<Texture_t> createTexture(const Handle<Device_t> &deviceHandle, const TextureOptions &options) final;
+    std::vector<Handle<Texture_t>> createAliasedTextures(const Handle<Device_t> &deviceHandle, const std::vector<TextureOptions> &options) final;
     void deleteTexture(const Handle<Texture_t> &handle) final;
     VulkanTexture *getTexture(const Handle<Texture_t> &handle) const final;
 
@@ -153,6 +157,8 @@ public:
     Handle<BindGroup_t> createBindGroup(const Handle<Device_t> &deviceHandle, const BindGroupOptions &options) final;
     void deleteBindGroup(const Handle<BindGroup_t> &handle) final;
     VulkanBindGroup *getBindGroup(const Handle<BindGroup_t> &handle) const final;
+    // Invalidates the bind groups of a transient frame, their sets are reclaimed by the descriptor allocator
+    void removeTransientBindGroups(const std::vector<Handle<BindGroup_t>> &handles);
 
     Handle<BindGroupLayout_t> createBindGroupLayout(const Handle<Device_t> &deviceHandle, const BindGroupLayoutOptions &options) final;
     void deleteBindGroupLayout(const Handle<BindGroupLayout_t> &handle) final;
@@ -166,16 +172,32 @@ public:
     void deleteFence(const Handle<Fence_t> &handle) final;
     VulkanFence *getFence(const Handle<Fence_t> &handle) const final;
 
+    Handle<MemoryPool_t> createMemoryPool(const Handle<Device_t> &deviceHandle, const MemoryPoolOptions &options) final;
+    void deleteMemoryPool(const Handle<MemoryPool_t> &handle) final;
+    VulkanMemoryPool *getMemoryPool(const Handle<MemoryPool_t> &handle) const final;
+
+    ResourceStatistics statistics() const final;
+    DeviceResourceStatistics deviceStatistics(const Handle<Device_t> &deviceHandle) const final;
+
+    bool beginDefragmentation(const Handle<Device_t> &deviceHandle, const DefragmentationOptions &options) final;
+    DefragmentationStatistics defragmentationStep(const Handle<Device_t> &deviceHandle, const Handle<Queue_t> &queueHandle) final;
+    DefragmentationStatistics endDefragmentation(const Handle<Device_t> &deviceHandle) final;
+
 private:
+    // Ends the pass of the ongoing defragmentation, and the defragmentation if nothing is left to move
+    DefragmentationStatistics endDefragmentationPass(const Handle<Device_t> &deviceHandle);
+
     Pool<VulkanInstance, Instance_t> m_instances{ 1 };
     Pool<VulkanAdapter, Adapter_t> m_adapters{ 1 };
     Pool<VulkanDevice, Device_t> m_devices{ 1 };
     Pool<VulkanQueue, Queue_t> m_queues{ 4 };
     Pool<VulkanSurface, Surface_t> m_surfaces{ 1 };
     Pool<VulkanSwapchain, Swapchain_t> m_swapchains{ 1 };
-    Pool<VulkanTexture, Texture_t> m_textures{ 128 };
-    Pool<VulkanTextureView, TextureView_t> m_textureViews{ 128 };
-    Pool<VulkanBuffer, Buffer_t> m_buffers{ 128 };
+    // Resources which are commonly created by asset loading threads while the render thread
+    // looks them up use a ConcurrentPool. Everything else is owned by a single thread.
+    ConcurrentPool<VulkanTexture, Texture_t> m_textures{ 128 };
+    ConcurrentPool<VulkanTextureView, TextureView_t> m_textureViews{ 128 };
+    ConcurrentPool<VulkanBuffer, Buffer_t> m_buffers{ 128 };
     Pool<VulkanShaderModule, ShaderModule_t> m_shaderModules{ 64 };
     Pool<VulkanPipelineLayout, PipelineLayout_t> m_pipelineLayouts{ 64 };
     Pool<VulkanBindGroupLayout, BindGroupLayout_t> m_bindGroupLayouts{ 128 };
@@ -183,14 +205,17 @@ private:
     Pool<VulkanGraphicsPipeline, GraphicsPipeline_t> m_graphicsPipelines{ 64 };
     Pool<VulkanComputePipeline, ComputePipeline_t> m_computePipelines{ 64 };
     Pool<VulkanGpuSemaphore, GpuSemaphore_t> m_gpuSemaphores{ 32 };
-    Pool<VulkanCommandRecorder, CommandRecorder_t> m_commandRecorders{ 32 };
-    Pool<VulkanRenderPassCommandRecorder, RenderPassCommandRecorder_t> m_renderPassCommandRecorders{ 32 };
-    Pool<VulkanComputePassCommandRecorder, ComputePassCommandRecorder_t> m_computePassCommandRecorders{ 32 };
+    // Recorders only live for the duration of a frame's recording. They are bump allocated
+    // and the arenas are rewound once all the recorders of a frame have been released.
+    TransientPool<VulkanCommandRecorder, CommandRecorder_t> m_commandRecorders{ 32 };
+    TransientPool<VulkanRenderPassCommandRecorder, RenderPassCommandRecorder_t> m_renderPassCommandRecorders{ 32 };
+    TransientPool<VulkanComputePassCommandRecorder, ComputePassCommandRecorder_t> m_computePassCommandRecorders{ 32 };
     Pool<VulkanCommandBuffer, CommandBuffer_t> m_commandBuffers{ 128 };
     Pool<VulkanRenderPass, RenderPass_t> m_renderPasses{ 16 };
     Pool<VulkanFramebuffer, Framebuffer_t> m_framebuffers{ 16 };
-    Pool<VulkanSampler, Sampler_t> m_samplers{ 16 };
+    ConcurrentPool<VulkanSampler, Sampler_t> m_samplers{ 16 };
     Pool<VulkanFence, Fence_t> m_fences{ 16 };
+    Pool<VulkanMemoryPool, MemoryPool_t> m_memoryPools{ 4 };
 };
 
 } // namespace KDGpu
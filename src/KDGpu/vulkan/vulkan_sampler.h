@@ -12,12 +12,48 @@
 
 #include <KDGpu/api/api_sampler.h>
 #include <KDGpu/handle.h>
+#include <KDGpu/sampler_options.h>
+#include <KDGpu/utils/hash_utils.h>
 #include <KDGpu/kdgpu_export.h>
 #include <vulkan/vulkan.h>
 
 namespace KDGpu {
 
 class VulkanResourceManager;
+
+struct VulkanSamplerKey {
+    explicit VulkanSamplerKey(const SamplerOptions &_options)
+        : options(_options)
+    {
+        KDGpu::hash_combine(hash, options.magFilter);
+        KDGpu::hash_combine(hash, options.minFilter);
+        KDGpu::hash_combine(hash, options.mipmapFilter);
+        KDGpu::hash_combine(hash, options.u);
+        KDGpu::hash_combine(hash, options.v);
+        KDGpu::hash_combine(hash, options.w);
+        KDGpu::hash_combine(hash, options.lodMinClamp);
+        KDGpu::hash_combine(hash, options.lodMaxClamp);
+        KDGpu::hash_combine(hash, options.anisotropyEnabled);
+        KDGpu::hash_combine(hash, options.maxAnisotropy);
+        KDGpu::hash_combine(hash, options.compareEnabled);
+        KDGpu::hash_combine(hash, options.compare);
+        KDGpu::hash_combine(hash, options.normalizedCoordinates);
+    }
+
+    // Unlike the render pass keys, the full description is compared as samplers are shared
+    bool operator==(const VulkanSamplerKey &other) const noexcept
+    {
+        return hash == other.hash && options == other.options;
+    }
+
+    bool operator!=(const VulkanSamplerKey &other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+    SamplerOptions options;
+    uint64_t hash{ 0 };
+};
 struct Device_t;
 
 /**
@@ -34,3 +70,15 @@ struct KDGPU_EXPORT VulkanSampler : public ApiSampler {
 };
 
 } // namespace KDGpu
+
+namespace std {
+
+template<>
+struct hash<KDGpu::VulkanSamplerKey> {
+    size_t operator()(const KDGpu::VulkanSamplerKey &key) const
+    {
+        return key.hash;
+    }
+};
+
+} // namespace std
@@ -22,6 +22,8 @@ VulkanTexture::VulkanTexture(VkImage _image,
                              uint32_t _mipLevels,
                              uint32_t _arrayLayers,
                              TextureUsageFlags _usage,
+                             MemoryUsage _memoryUsage,
+                             DeviceSize _allocationSize,
                              VulkanResourceManager *_vulkanResourceManager,
                              const Handle<Device_t> &_deviceHandle)
     : ApiTexture()
@@ -32,6 +34,8 @@ VulkanTexture::VulkanTexture(VkImage _image,
     , mipLevels(_mipLevels)
     , arrayLayers(_arrayLayers)
     , usage(_usage)
+    , memoryUsage(_memoryUsage)
+    , allocationSize(_allocationSize)
     , vulkanResourceManager(_vulkanResourceManager)
     , deviceHandle(_deviceHandle)
 {
@@ -38,6 +38,8 @@ struct KDGPU_EXPORT VulkanTexture : public ApiTexture {
                            uint32_t _mipLevels,
                            uint32_t _arrayLayers,
                            TextureUsageFlags _usage,
+                           MemoryUsage _memoryUsage,
+                           DeviceSize _allocationSize,
                            VulkanResourceManager *_vulkanResourceManager,
                            const Handle<Device_t> &_deviceHandle);
 
@@ -64,7 +66,10 @@ struct KDGPU_EXPORT VulkanTexture : public ApiTexture {
     uint32_t mipLevels;
     uint32_t arrayLayers;
     TextureUsageFlags usage;
+    MemoryUsage memoryUsage{ MemoryUsage::Unknown };
+    DeviceSize allocationSize{ 0 };
     bool ownedBySwapchain{ false };
+    bool aliased{ false }; // allocation is shared with other textures, see VulkanAliasedAllocations
     VulkanResourceManager *vulkanResourceManager{ nullptr };
     Handle<Device_t> deviceHandle;
 };
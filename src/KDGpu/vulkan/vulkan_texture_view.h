@@ -12,6 +12,8 @@
 
 #include <KDGpu/api/api_texture_view.h>
 #include <KDGpu/handle.h>
+#include <KDGpu/texture_view_options.h>
+#include <KDGpu/utils/hash_utils.h>
 #include <KDGpu/kdgpu_export.h>
 
 #include <vulkan/vulkan.h>
@@ -21,6 +23,36 @@ namespace KDGpu {
 struct Texture_t;
 struct Device_t;
 
+struct VulkanTextureViewKey {
+    explicit VulkanTextureViewKey(const Handle<Texture_t> &_textureHandle, const TextureViewOptions &_options)
+        : textureHandle(_textureHandle)
+        , options(_options)
+    {
+        KDGpu::hash_combine(hash, textureHandle);
+        KDGpu::hash_combine(hash, options.viewType);
+        KDGpu::hash_combine(hash, options.format);
+        KDGpu::hash_combine(hash, options.range.aspectMask.toInt());
+        KDGpu::hash_combine(hash, options.range.baseMipLevel);
+        KDGpu::hash_combine(hash, options.range.levelCount);
+        KDGpu::hash_combine(hash, options.range.baseArrayLayer);
+        KDGpu::hash_combine(hash, options.range.layerCount);
+    }
+
+    bool operator==(const VulkanTextureViewKey &other) const noexcept
+    {
+        return hash == other.hash && textureHandle == other.textureHandle && options == other.options;
+    }
+
+    bool operator!=(const VulkanTextureViewKey &other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+    Handle<Texture_t> textureHandle;
+    TextureViewOptions options;
+    uint64_t hash{ 0 };
+};
+
 /**
  * @brief VulkanTextureView
  * \ingroup vulkan
@@ -37,3 +69,15 @@ struct KDGPU_EXPORT VulkanTextureView : public ApiTextureView {
 };
 
 } // namespace KDGpu
+
+namespace std {
+
+template<>
+struct hash<KDGpu::VulkanTextureViewKey> {
+    size_t operator()(const KDGpu::VulkanTextureViewKey &key) const
+    {
+        return key.hash;
+    }
+};
+
+} // namespace std
@@ -60,9 +60,6 @@ void AdvancedExampleEngineLayer::update()
     // Call the base class to delegate any ImGui overlay drawing
     ExampleEngineLayer::update();
 
-    // Release any staging buffers we are done with
-    releaseStagingBuffers();
-
     // Call updateScene() function to update scene state.
     updateScene();
 
@@ -65,15 +65,16 @@ void ExampleEngineLayer::recreateSwapChain()
         m_swapchainViews.push_back(std::move(view));
     }
 
-    // Create a depth texture to use for depth-correct rendering
+    // Create a depth texture to use for depth-correct rendering. It is transient, passes attaching
+    // it set its depth and stencil store operations to DontCare rather than the default Store.
     TextureOptions depthTextureOptions = {
         .type = TextureType::TextureType2D,
         .format = m_depthFormat,
         .extent = { m_window->width(), m_window->height(), 1 },
         .mipLevels = 1,
         .samples = m_samples,
-        .usage = TextureUsageFlagBits::DepthStencilAttachmentBit,
-        .memoryUsage = MemoryUsage::GpuOnly
+        .usage = TextureUsageFlagBits::DepthStencilAttachmentBit | TextureUsageFlagBits::TransientAttachmentBit,
+        .memoryUsage = MemoryUsage::GpuLazilyAllocated
     };
     m_depthTexture = m_device.createTexture(depthTextureOptions);
     m_depthTextureView = m_depthTexture.createView();
@@ -81,25 +82,15 @@ void ExampleEngineLayer::recreateSwapChain()
     m_capabilitiesString = surfaceCapabilitiesToString(m_device.adapter()->swapchainProperties(m_surface).capabilities);
 }
 
+// The uploads are batched in the staging ring of the queue and submitted with the next frame
 void ExampleEngineLayer::uploadBufferData(const BufferUploadOptions &options)
 {
-    m_stagingBuffers.emplace_back(m_queue.uploadBufferData(options));
+    m_queue.stageBufferUpload(options);
 }
 
 void ExampleEngineLayer::uploadTextureData(const TextureUploadOptions &options)
 {
-    m_stagingBuffers.emplace_back(m_queue.uploadTextureData(options));
-}
-
-void ExampleEngineLayer::releaseStagingBuffers()
-{
-    // Loop over any staging buffers and see if the corresponding fence has been signalled.
-    // If so, we can dispose of them
-    const auto removedCount = std::erase_if(m_stagingBuffers, [](const UploadStagingBuffer &stagingBuffer) {
-        return stagingBuffer.fence.status() == FenceStatus::Signalled;
-    });
-    if (removedCount)
-        SPDLOG_LOGGER_INFO(m_logger, "Released {} staging buffers", removedCount);
+    m_queue.stageTextureUpload(options);
 }
 
 void ExampleEngineLayer::drawImGuiOverlay(ImGuiContext *ctx)
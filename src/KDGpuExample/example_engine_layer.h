@@ -85,7 +85,6 @@ protected:
 
     void uploadBufferData(const BufferUploadOptions &options);
     void uploadTextureData(const TextureUploadOptions &options);
-    void releaseStagingBuffers();
 
     std::shared_ptr<spdlog::logger> m_logger;
     std::unique_ptr<GraphicsApi> m_api;
@@ -110,8 +109,6 @@ protected:
     std::array<GpuSemaphore, MAX_FRAMES_IN_FLIGHT> m_presentCompleteSemaphores;
     std::array<GpuSemaphore, MAX_FRAMES_IN_FLIGHT> m_renderCompleteSemaphores;
 
-    std::vector<UploadStagingBuffer> m_stagingBuffers;
-
     const Format m_swapchainFormat{ Format::B8G8R8A8_UNORM };
     Format m_depthFormat;
 
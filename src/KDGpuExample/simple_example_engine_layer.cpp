@@ -39,9 +39,6 @@ void SimpleExampleEngineLayer::update()
     // Call the base class to delegate any ImGui overlay drawing
     ExampleEngineLayer::update();
 
-    // Release any staging buffers we are done with
-    releaseStagingBuffers();
-
     // Call updateScene() function to update scene state.
     updateScene();
 
@@ -17,6 +17,7 @@
 #include <KDGpu/buffer.h>
 #include <KDGpu/device.h>
 #include <KDGpu/instance.h>
+#include <KDGpu/resource_manager.h>
 #include <KDGpu/texture_options.h>
 #include <KDGpu/sampler_options.h>
 #include <KDGpu/texture_view.h>
@@ -474,4 +475,190 @@ TEST_SUITE("BindGroup")
             CHECK(a != b);
         }
     }
+
+    TEST_CASE("Descriptor Allocation")
+    {
+        ResourceManager *resourceManager = api->resourceManager();
+
+        BufferOptions uboOptions = {
+            .size = 16 * sizeof(float),
+            .usage = BufferUsageFlagBits::UniformBufferBit,
+            .memoryUsage = MemoryUsage::CpuToGpu
+        };
+        auto ubo = device.createBuffer(uboOptions);
+
+        const BindGroupLayout bindGroupLayout = device.createBindGroupLayout(BindGroupLayoutOptions{
+                .bindings = { { .binding = 0,
+                                .count = 1,
+                                .resourceType = ResourceBindingType::UniformBuffer,
+                                .shaderStages = ShaderStageFlags(ShaderStageFlagBits::VertexBit) } } });
+
+        BindGroupOptions bindGroupOptions = {
+            .layout = bindGroupLayout,
+            .resources = {
+                    { .binding = 0,
+                      .resource = UniformBufferBinding{ .buffer = ubo } },
+            }
+        };
+
+        SUBCASE("Released sets are reused by bind groups of the same layout")
+        {
+            // GIVEN
+            device.waitUntilIdle();
+            {
+                BindGroup a = device.createBindGroup(bindGroupOptions);
+            }
+            const auto before = resourceManager->deviceStatistics(device.handle()).descriptorPools;
+            CHECK(before.freeSets > 0);
+
+            // WHEN
+            BindGroup b = device.createBindGroup(bindGroupOptions);
+
+            // THEN
+            CHECK(b.isValid());
+            const auto after = resourceManager->deviceStatistics(device.handle()).descriptorPools;
+            CHECK(after.freeSets == before.freeSets - 1);
+            CHECK(after.poolCount == before.poolCount);
+            CHECK(after.allocatedSets == before.allocatedSets + 1);
+        }
+
+        SUBCASE("Transient bind groups are invalidated at the end of their frame")
+        {
+            // GIVEN
+            bindGroupOptions.transient = true;
+            BindGroup transient = device.createBindGroup(bindGroupOptions);
+            const Handle<BindGroup_t> transientHandle = transient.handle();
+            REQUIRE(transient.isValid());
+            CHECK(resourceManager->deviceStatistics(device.handle()).descriptorPools.transientPoolCount > 0);
+
+            // WHEN
+            device.resetTransientBindGroups();
+
+            // THEN
+            CHECK(resourceManager->getBindGroup(transientHandle) == nullptr);
+        }
+
+        SUBCASE("Transient bind groups with large bindings are allocated from the pools of their layout")
+        {
+            // GIVEN
+            const BindGroupLayout largeLayout = device.createBindGroupLayout(BindGroupLayoutOptions{
+                    .bindings = { { .binding = 0,
+                                    .count = 100,
+                                    .resourceType = ResourceBindingType::CombinedImageSampler,
+                                    .shaderStages = ShaderStageFlags(ShaderStageFlagBits::FragmentBit) } } });
+            const auto before = resourceManager->deviceStatistics(device.handle()).descriptorPools;
+
+            // WHEN
+            BindGroup bindGroup = device.createBindGroup(BindGroupOptions{
+                    .layout = largeLayout,
+                    .transient = true });
+
+            // THEN
+            CHECK(bindGroup.isValid());
+            const auto after = resourceManager->deviceStatistics(device.handle()).descriptorPools;
+            CHECK(after.transientPoolCount == before.transientPoolCount);
+            CHECK(after.poolCount == before.poolCount + 1);
+
+            // Nor is it invalidated at the end of the frame
+            device.resetTransientBindGroups();
+            CHECK(resourceManager->getBindGroup(bindGroup.handle()) != nullptr);
+        }
+
+        SUBCASE("Transient pools are recycled rather than reallocated")
+        {
+            // GIVEN
+            bindGroupOptions.transient = true;
+            auto renderFrame = [&] {
+                std::vector<BindGroup> bindGroups;
+                for (uint32_t i = 0; i < 300; ++i)
+                    bindGroups.push_back(device.createBindGroup(bindGroupOptions));
+                device.resetTransientBindGroups();
+            };
+            renderFrame();
+            device.waitUntilIdle();
+            const uint32_t poolCount = resourceManager->deviceStatistics(device.handle()).descriptorPools.transientPoolCount;
+
+            // WHEN
+            for (uint32_t frame = 0; frame < 4; ++frame) {
+                renderFrame();
+                device.waitUntilIdle();
+            }
+
+            // THEN
+            CHECK(resourceManager->deviceStatistics(device.handle()).descriptorPools.transientPoolCount == poolCount);
+        }
+    }
+
+    TEST_CASE("Descriptor Updates")
+    {
+        ResourceManager *resourceManager = api->resourceManager();
+
+        BufferOptions uboOptions = {
+            .size = 16 * sizeof(float),
+            .usage = BufferUsageFlagBits::UniformBufferBit,
+            .memoryUsage = MemoryUsage::CpuToGpu
+        };
+        auto uboA = device.createBuffer(uboOptions);
+        auto uboB = device.createBuffer(uboOptions);
+
+        const BindGroupLayout bindGroupLayout = device.createBindGroupLayout(BindGroupLayoutOptions{
+                .bindings = {
+                        { .binding = 0,
+                          .count = 1,
+                          .resourceType = ResourceBindingType::UniformBuffer,
+                          .shaderStages = ShaderStageFlags(ShaderStageFlagBits::VertexBit) },
+                        { .binding = 1,
+                          .count = 1,
+                          .resourceType = ResourceBindingType::UniformBuffer,
+                          .shaderStages = ShaderStageFlags(ShaderStageFlagBits::FragmentBit) },
+                } });
+
+        SUBCASE("Bind groups created with all their bindings are written with the layout template")
+        {
+            // GIVEN
+            const auto before = resourceManager->deviceStatistics(device.handle()).descriptorUpdates;
+
+            // WHEN
+            BindGroup bindGroup = device.createBindGroup(BindGroupOptions{
+                    .layout = bindGroupLayout,
+                    .resources = {
+                            { .binding = 0, .resource = UniformBufferBinding{ .buffer = uboA } },
+                            { .binding = 1, .resource = UniformBufferBinding{ .buffer = uboB } },
+                    } });
+
+            // THEN
+            CHECK(bindGroup.isValid());
+            const auto after = resourceManager->deviceStatistics(device.handle()).descriptorUpdates;
+            CHECK(after.templateUpdateCount == before.templateUpdateCount + 1);
+            CHECK(after.batchedUpdateCount == before.batchedUpdateCount);
+            CHECK(after.descriptorCount == before.descriptorCount + 2);
+        }
+
+        SUBCASE("Partial updates are written in a single batch")
+        {
+            // GIVEN
+            BindGroup bindGroup = device.createBindGroup(BindGroupOptions{ .layout = bindGroupLayout });
+            const auto before = resourceManager->deviceStatistics(device.handle()).descriptorUpdates;
+
+            // WHEN
+            bindGroup.update(BindGroupEntry{ .binding = 1, .resource = UniformBufferBinding{ .buffer = uboB } });
+
+            // THEN
+            auto after = resourceManager->deviceStatistics(device.handle()).descriptorUpdates;
+            CHECK(after.batchedUpdateCount == before.batchedUpdateCount + 1);
+            CHECK(after.templateUpdateCount == before.templateUpdateCount);
+
+            // WHEN
+            bindGroup.update(std::vector<BindGroupEntry>{
+                    { .binding = 0, .resource = UniformBufferBinding{ .buffer = uboB } },
+                    { .binding = 1, .resource = UniformBufferBinding{ .buffer = uboA } },
+            });
+
+            // THEN -> every binding is covered again
+            after = resourceManager->deviceStatistics(device.handle()).descriptorUpdates;
+            CHECK(after.batchedUpdateCount == before.batchedUpdateCount + 1);
+            CHECK(after.templateUpdateCount == before.templateUpdateCount + 1);
+            CHECK(after.descriptorCount == before.descriptorCount + 3);
+        }
+    }
 }
@@ -17,6 +17,11 @@
 #include <KDGpu/buffer.h>
 #include <KDGpu/device.h>
 #include <KDGpu/instance.h>
+#include <KDGpu/pipeline_layout.h>
+#include <KDGpu/pipeline_layout_options.h>
+#include <KDGpu/resource_manager.h>
+#include <KDGpu/sampler.h>
+#include <KDGpu/sampler_options.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -59,6 +64,36 @@ TEST_SUITE("BindGroupLayout")
             // THEN
             CHECK(bindGroupLayout.isValid());
         }
+
+        SUBCASE("A BindGroupLayout with immutable samplers keeps them alive")
+        {
+            // GIVEN
+            Sampler sampler = device.createSampler(SamplerOptions{ .magFilter = FilterMode::Nearest, .minFilter = FilterMode::Nearest });
+            const Handle<Sampler_t> samplerHandle = sampler.handle();
+            const BindGroupLayoutOptions bindGroupLayoutOptions = {
+                .bindings = { {
+                        .binding = 0,
+                        .count = 4,
+                        .resourceType = ResourceBindingType::Sampler,
+                        .shaderStages = ShaderStageFlags(ShaderStageFlagBits::FragmentBit),
+                        .immutableSamplers = { sampler },
+                } }
+            };
+
+            // WHEN
+            BindGroupLayout bindGroupLayout = device.createBindGroupLayout(bindGroupLayoutOptions);
+            sampler = {};
+
+            // THEN
+            CHECK(bindGroupLayout.isValid());
+            CHECK(api->resourceManager()->getSampler(samplerHandle) != nullptr);
+
+            // WHEN
+            bindGroupLayout = {};
+
+            // THEN
+            CHECK(api->resourceManager()->getSampler(samplerHandle) == nullptr);
+        }
     }
 
     TEST_CASE("Destruction")
@@ -135,10 +170,85 @@ TEST_SUITE("BindGroupLayout")
 
             // WHEN
             BindGroupLayout a = device.createBindGroupLayout(bindGroupLayoutOptions);
-            BindGroupLayout b = device.createBindGroupLayout(bindGroupLayoutOptions);
+            BindGroupLayout b = device.createBindGroupLayout(BindGroupLayoutOptions{
+                    .bindings = { {
+                            .binding = 0,
+                            .count = 1,
+                            .resourceType = ResourceBindingType::StorageBuffer,
+                            .shaderStages = ShaderStageFlags(ShaderStageFlagBits::VertexBit),
+                    } } });
 
             // THEN
             CHECK(a != b);
         }
     }
+
+    TEST_CASE("Deduplication")
+    {
+        ResourceManager *resourceManager = api->resourceManager();
+        const BindGroupLayoutOptions bindGroupLayoutOptions = {
+            .bindings = { {
+                                  .binding = 0,
+                                  .count = 2,
+                                  .resourceType = ResourceBindingType::CombinedImageSampler,
+                                  .shaderStages = ShaderStageFlags(ShaderStageFlagBits::FragmentBit),
+                          },
+                          {
+                                  .binding = 1,
+                                  .count = 1,
+                                  .resourceType = ResourceBindingType::UniformBuffer,
+                                  .shaderStages = ShaderStageFlags(ShaderStageFlagBits::FragmentBit),
+                          } }
+        };
+
+        SUBCASE("Identical options share a single bind group layout")
+        {
+            // GIVEN
+            const auto before = resourceManager->deviceStatistics(device.handle()).bindGroupLayoutCache;
+
+            // WHEN
+            BindGroupLayout a = device.createBindGroupLayout(bindGroupLayoutOptions);
+            BindGroupLayout b = device.createBindGroupLayout(bindGroupLayoutOptions);
+
+            // THEN
+            CHECK(a == b);
+            const auto after = resourceManager->deviceStatistics(device.handle()).bindGroupLayoutCache;
+            CHECK(after.objectCount == before.objectCount + 1);
+            CHECK(after.hitCount == before.hitCount + 1);
+        }
+
+        SUBCASE("A shared bind group layout is only destroyed with its last reference")
+        {
+            // GIVEN
+            BindGroupLayout a = device.createBindGroupLayout(bindGroupLayoutOptions);
+            BindGroupLayout b = device.createBindGroupLayout(bindGroupLayoutOptions);
+            const Handle<BindGroupLayout_t> bindGroupLayoutHandle = a.handle();
+
+            // WHEN
+            a = {};
+
+            // THEN
+            CHECK(resourceManager->getBindGroupLayout(bindGroupLayoutHandle) != nullptr);
+
+            // WHEN
+            b = {};
+
+            // THEN
+            CHECK(resourceManager->getBindGroupLayout(bindGroupLayoutHandle) == nullptr);
+        }
+
+        SUBCASE("Pipeline layouts built from identical bind group layouts are shared")
+        {
+            // GIVEN
+            const BindGroupLayout a = device.createBindGroupLayout(bindGroupLayoutOptions);
+            const BindGroupLayout b = device.createBindGroupLayout(bindGroupLayoutOptions);
+
+            // WHEN
+            const PipelineLayout pipelineLayoutA = device.createPipelineLayout(PipelineLayoutOptions{ .bindGroupLayouts = { a } });
+            const PipelineLayout pipelineLayoutB = device.createPipelineLayout(PipelineLayoutOptions{ .bindGroupLayouts = { b } });
+
+            // THEN
+            CHECK(pipelineLayoutA == pipelineLayoutB);
+        }
+    }
 }
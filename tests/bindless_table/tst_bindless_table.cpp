@@ -0,0 +1,130 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/bindless_table.h>
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/device.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <vector>
+
+using namespace KDGpu;
+
+TEST_SUITE("BindlessTable")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "bindless_table",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice(DeviceOptions{
+            .requestedFeatures = discreteGPUAdapter->features() });
+
+    TEST_CASE("Construction")
+    {
+        SUBCASE("A default constructed BindlessTable is invalid")
+        {
+            BindlessTable table;
+            CHECK(!table.isValid());
+            CHECK(table.add(StorageBufferBinding{}) == BindlessTable::InvalidIndex);
+        }
+
+        SUBCASE("Resource types which can't be updated after bind are rejected")
+        {
+            BindlessTable table = device.createBindlessTable({ .resourceType = ResourceBindingType::UniformBuffer });
+            CHECK(!table.isValid());
+        }
+    }
+
+    TEST_CASE("Indices")
+    {
+        const AdapterFeatures &features = discreteGPUAdapter->features();
+        REQUIRE(features.descriptorBindingStorageBufferUpdateAfterBind);
+        REQUIRE(features.descriptorBindingPartiallyBound);
+        REQUIRE(features.descriptorBindingVariableDescriptorCount);
+
+        std::vector<Buffer> buffers;
+        for (uint32_t i = 0; i < 8; ++i) {
+            buffers.push_back(device.createBuffer(BufferOptions{
+                    .size = 256,
+                    .usage = BufferUsageFlagBits::StorageBufferBit,
+                    .memoryUsage = MemoryUsage::GpuOnly }));
+        }
+
+        BindlessTable table = device.createBindlessTable({
+                .resourceType = ResourceBindingType::StorageBuffer,
+                .maxCount = 6,
+                .initialCapacity = 2,
+        });
+        REQUIRE(table.isValid());
+
+        SUBCASE("Resources get consecutive indices and the table grows up to its maximum")
+        {
+            // WHEN
+            std::vector<uint32_t> indices;
+            for (uint32_t i = 0; i < 6; ++i)
+                indices.push_back(table.add(StorageBufferBinding{ .buffer = buffers[i] }));
+
+            // THEN
+            for (uint32_t i = 0; i < 6; ++i)
+                CHECK(indices[i] == i);
+            CHECK(table.capacity() == 6);
+            CHECK(table.statistics().growCount == 2);
+            CHECK(table.statistics().residentCount == 6);
+            CHECK(table.bindGroup().isValid());
+            CHECK(table.add(StorageBufferBinding{ .buffer = buffers[6] }) == BindlessTable::InvalidIndex);
+        }
+
+        SUBCASE("Resources of another type are rejected")
+        {
+            CHECK(table.add(UniformBufferBinding{ .buffer = buffers[0] }) == BindlessTable::InvalidIndex);
+        }
+
+        SUBCASE("Growing keeps the layout and the existing indices")
+        {
+            // GIVEN
+            const Handle<BindGroupLayout_t> layout = table.bindGroupLayout();
+            const uint32_t first = table.add(StorageBufferBinding{ .buffer = buffers[0] });
+            table.add(StorageBufferBinding{ .buffer = buffers[1] });
+
+            // WHEN
+            const uint32_t third = table.add(StorageBufferBinding{ .buffer = buffers[2] });
+
+            // THEN
+            CHECK(table.capacity() == 4);
+            CHECK(table.bindGroupLayout().handle() == layout);
+            CHECK(first == 0);
+            CHECK(third == 2);
+            CHECK(table.update(first, StorageBufferBinding{ .buffer = buffers[3] }));
+        }
+
+        SUBCASE("Removed indices are reused once the GPU is done with them")
+        {
+            // GIVEN
+            const uint32_t a = table.add(StorageBufferBinding{ .buffer = buffers[0] });
+            table.add(StorageBufferBinding{ .buffer = buffers[1] });
+
+            // WHEN
+            table.remove(a);
+            device.waitUntilIdle();
+            device.collectGarbage();
+
+            // THEN
+            CHECK(table.statistics().residentCount == 1);
+            CHECK(table.add(StorageBufferBinding{ .buffer = buffers[2] }) == a);
+            CHECK(table.statistics().retiringCount == 0);
+            CHECK(!table.update(5, StorageBufferBinding{ .buffer = buffers[2] }));
+        }
+    }
+}
@@ -14,6 +14,7 @@
 #include <KDGpu/instance.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
+#include <cstring>
 #include <set>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -185,6 +186,115 @@ TEST_SUITE("Buffer")
         }
     }
 
+    TEST_CASE("Persistent Mapping")
+    {
+        const std::vector<float> vertexData = {
+            1.0f, -1.0f, 0.0f, 1.0f
+        };
+
+        SUBCASE("A persistently mapped host visible Buffer exposes its mapping")
+        {
+            // GIVEN
+            const BufferOptions bufferOptions = {
+                .size = 4 * sizeof(float),
+                .usage = BufferUsageFlagBits::UniformBufferBit,
+                .memoryUsage = MemoryUsage::CpuToGpu,
+                .persistentlyMapped = true
+            };
+
+            // WHEN
+            Buffer b = device.createBuffer(bufferOptions, vertexData.data());
+
+            // THEN
+            CHECK(b.isValid());
+            CHECK(b.isPersistentlyMapped());
+            REQUIRE(b.mappedData() != nullptr);
+
+            const float *rawData = reinterpret_cast<const float *>(b.mappedData());
+            CHECK(rawData[0] == vertexData[0]);
+            CHECK(rawData[3] == vertexData[3]);
+
+            // WHEN
+            void *m = b.map();
+            b.unmap();
+
+            // THEN -> map() returns the persistent mapping and unmap() keeps it alive
+            CHECK(m == rawData);
+            CHECK(b.mappedData() == rawData);
+        }
+
+        SUBCASE("Writes through the mapping become visible after a flush")
+        {
+            // GIVEN
+            const BufferOptions bufferOptions = {
+                .size = 4 * sizeof(float),
+                .usage = BufferUsageFlagBits::UniformBufferBit,
+                .memoryUsage = MemoryUsage::CpuToGpu,
+                .persistentlyMapped = true
+            };
+            Buffer b = device.createBuffer(bufferOptions);
+            REQUIRE(b.mappedData() != nullptr);
+
+            // WHEN
+            std::memcpy(b.mappedData(), vertexData.data(), bufferOptions.size);
+            b.flush(0, bufferOptions.size);
+            b.invalidate();
+
+            // THEN
+            const float *rawData = reinterpret_cast<const float *>(b.mappedData());
+            CHECK(rawData[1] == vertexData[1]);
+            CHECK(rawData[2] == vertexData[2]);
+        }
+
+        SUBCASE("Moving a persistently mapped Buffer transfers its mapping")
+        {
+            // GIVEN
+            const BufferOptions bufferOptions = {
+                .size = 4 * sizeof(float),
+                .usage = BufferUsageFlagBits::UniformBufferBit,
+                .memoryUsage = MemoryUsage::CpuToGpu,
+                .persistentlyMapped = true
+            };
+            Buffer a = device.createBuffer(bufferOptions);
+            void *mapping = a.mappedData();
+
+            // WHEN
+            Buffer b = std::move(a);
+
+            // THEN
+            CHECK(b.mappedData() == mapping);
+            CHECK(b.isPersistentlyMapped());
+            CHECK(a.mappedData() == nullptr);
+        }
+
+        SUBCASE("A Buffer that is not persistently mapped has no mapping until map() is called")
+        {
+            // GIVEN
+            const BufferOptions bufferOptions = {
+                .size = 4 * sizeof(float),
+                .usage = BufferUsageFlagBits::UniformBufferBit,
+                .memoryUsage = MemoryUsage::CpuToGpu
+            };
+            Buffer b = device.createBuffer(bufferOptions);
+
+            // THEN
+            CHECK(!b.isPersistentlyMapped());
+            CHECK(b.mappedData() == nullptr);
+
+            // WHEN
+            void *m = b.map();
+
+            // THEN
+            CHECK(b.mappedData() == m);
+
+            // WHEN
+            b.unmap();
+
+            // THEN
+            CHECK(b.mappedData() == nullptr);
+        }
+    }
+
     TEST_CASE("Comparison")
     {
         SUBCASE("Compare default constructed Buffers")
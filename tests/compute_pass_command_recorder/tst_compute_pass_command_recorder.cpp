@@ -8,6 +8,11 @@
   Contact KDAB at <info@kdab.com> for commercial licensing options.
 */
 
+#include <KDGpu/bind_group.h>
+#include <KDGpu/bind_group_layout.h>
+#include <KDGpu/bind_group_options.h>
+#include <KDGpu/buffer.h>
+#include <KDGpu/buffer_options.h>
 #include <KDGpu/compute_pipeline.h>
 #include <KDGpu/compute_pipeline_options.h>
 #include <KDGpu/compute_pass_command_recorder.h>
@@ -15,6 +20,7 @@
 #include <KDGpu/device.h>
 #include <KDGpu/queue.h>
 #include <KDGpu/instance.h>
+#include <KDGpu/vulkan/vulkan_compute_pass_command_recorder.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
 #include <type_traits>
@@ -151,4 +157,97 @@ TEST_CASE("ComputePassCommandRecorder")
         // THEN
         CHECK(api->resourceManager()->getComputePassCommandRecorder(recorderHandle) == nullptr);
     }
+
+    SUBCASE("Bind groups are only bound again when their set was disturbed or their offsets changed")
+    {
+        // GIVEN
+        const ShaderStageFlags computeStage = ShaderStageFlags(ShaderStageFlagBits::ComputeBit);
+        const BindGroupLayout dynamicLayout = device.createBindGroupLayout(BindGroupLayoutOptions{
+                .bindings = { { .binding = 0, .resourceType = ResourceBindingType::DynamicUniformBuffer, .shaderStages = computeStage } } });
+        const BindGroupLayout storageLayout = device.createBindGroupLayout(BindGroupLayoutOptions{
+                .bindings = { { .binding = 0, .resourceType = ResourceBindingType::StorageBuffer, .shaderStages = computeStage } } });
+        const Buffer buffer = device.createBuffer(BufferOptions{
+                .size = 512,
+                .usage = BufferUsageFlagBits::UniformBufferBit | BufferUsageFlagBits::StorageBufferBit,
+                .memoryUsage = MemoryUsage::CpuToGpu });
+        const BindGroup dynamicBindGroup = device.createBindGroup(BindGroupOptions{
+                .layout = dynamicLayout,
+                .resources = { { .binding = 0, .resource = DynamicUniformBufferBinding{ .buffer = buffer, .size = 256 } } } });
+        const BindGroup storageBindGroup = device.createBindGroup(BindGroupOptions{
+                .layout = storageLayout,
+                .resources = { { .binding = 0, .resource = StorageBufferBinding{ .buffer = buffer } } } });
+
+        // Compatible with layout for sets 0 and 1, the others are not for any set
+        const PipelineLayout layout = device.createPipelineLayout(PipelineLayoutOptions{ .bindGroupLayouts = { dynamicLayout, storageLayout } });
+        const PipelineLayout compatibleLayout = device.createPipelineLayout(PipelineLayoutOptions{ .bindGroupLayouts = { dynamicLayout, storageLayout, storageLayout } });
+        const PipelineLayout pushConstantLayout = device.createPipelineLayout(PipelineLayoutOptions{
+                .bindGroupLayouts = { dynamicLayout, storageLayout },
+                .pushConstantRanges = { { .offset = 0, .size = 16, .shaderStages = computeStage } } });
+        const PipelineLayout differentLayout = device.createPipelineLayout(PipelineLayoutOptions{ .bindGroupLayouts = { storageLayout, storageLayout } });
+        const auto createPipeline = [&](const PipelineLayout &pipelineLayout) {
+            return device.createComputePipeline(ComputePipelineOptions{
+                    .layout = pipelineLayout,
+                    .shaderStage = ComputeShaderStage{ .shaderModule = computeShader.handle() } });
+        };
+        const ComputePipeline pipeline = createPipeline(layout);
+        const ComputePipeline compatiblePipeline = createPipeline(compatibleLayout);
+        const ComputePipeline pushConstantPipeline = createPipeline(pushConstantLayout);
+        const ComputePipeline differentPipeline = createPipeline(differentLayout);
+
+        CommandRecorder commandRecorder = device.createCommandRecorder(CommandRecorderOptions{ .queue = computeQueue });
+        ComputePassCommandRecorder computePass = commandRecorder.beginComputePass();
+        auto *vulkanComputePass = static_cast<VulkanComputePassCommandRecorder *>(api->resourceManager()->getComputePassCommandRecorder(computePass.handle()));
+        REQUIRE(vulkanComputePass != nullptr);
+        const std::vector<VulkanBoundBindGroups::BoundSet> &sets = vulkanComputePass->boundBindGroups.sets;
+
+        computePass.setPipeline(pipeline);
+        computePass.setBindGroup(0, dynamicBindGroup, {}, { 0 });
+        computePass.setBindGroup(1, storageBindGroup);
+
+        // THEN
+        REQUIRE(sets.size() == 2);
+        CHECK(sets[0].bindGroup == dynamicBindGroup.handle());
+        CHECK(sets[1].pipelineLayout == layout.handle());
+
+        // WHEN -> Switching to a pipeline with a compatible layout
+        computePass.setPipeline(compatiblePipeline);
+        computePass.setBindGroup(1, storageBindGroup);
+
+        // THEN -> Nothing is bound, the set keeps the layout it was bound with
+        CHECK(sets[1].pipelineLayout == layout.handle());
+        CHECK(sets[0].bindGroup == dynamicBindGroup.handle());
+
+        // WHEN -> Switching to a pipeline whose push constant ranges differ
+        computePass.setPipeline(pushConstantPipeline);
+        computePass.setBindGroup(1, storageBindGroup);
+
+        // THEN -> The set is bound again, disturbing set 0 which was bound without push constants
+        CHECK(sets[1].pipelineLayout == pushConstantLayout.handle());
+        CHECK(!sets[0].bindGroup.isValid());
+
+        // WHEN -> Binding with the same dynamic offsets, then with different ones
+        computePass.setBindGroup(0, dynamicBindGroup, {}, { 0 });
+        computePass.setBindGroup(0, dynamicBindGroup, {}, { 0 });
+
+        // THEN
+        CHECK(sets[0].bindGroup == dynamicBindGroup.handle());
+        CHECK(sets[0].dynamicBufferOffsets == std::vector<uint32_t>{ 0 });
+
+        // WHEN
+        computePass.setBindGroup(0, dynamicBindGroup, {}, { 256 });
+
+        // THEN -> Set 1 is not disturbed by binding set 0 through the same layout
+        CHECK(sets[0].dynamicBufferOffsets == std::vector<uint32_t>{ 256 });
+        CHECK(sets[1].bindGroup == storageBindGroup.handle());
+
+        // WHEN -> Switching to a pipeline with a different layout for the set
+        computePass.setPipeline(differentPipeline);
+        computePass.setBindGroup(1, storageBindGroup);
+
+        // THEN -> The set is bound again, and set 0 is disturbed
+        CHECK(sets[1].pipelineLayout == differentLayout.handle());
+        CHECK(!sets[0].bindGroup.isValid());
+
+        computePass.end();
+    }
 }
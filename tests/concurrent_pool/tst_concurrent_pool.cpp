@@ -0,0 +1,317 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/concurrent_pool.h>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+struct int_tag;
+using IntPool = KDGpu::ConcurrentPool<int, int_tag>;
+
+static_assert(std::is_nothrow_destructible<IntPool>{});
+static_assert(std::is_default_constructible<IntPool>{});
+static_assert(!std::is_copy_constructible<IntPool>{});
+static_assert(!std::is_copy_assignable<IntPool>{});
+static_assert(std::is_nothrow_move_constructible<IntPool>{});
+static_assert(std::is_nothrow_move_assignable<IntPool>{});
+
+TEST_CASE("Construction")
+{
+    SUBCASE("A default constructed pool is empty")
+    {
+        IntPool pool;
+        REQUIRE(pool.capacity() == 0);
+        REQUIRE(pool.size() == 0);
+    }
+
+    SUBCASE("A constructed pool with a size is empty but has capacity in whole chunks")
+    {
+        IntPool pool(10);
+        REQUIRE(pool.capacity() == IntPool::ChunkSize);
+        REQUIRE(pool.size() == 0);
+    }
+
+    SUBCASE("A move constructed pool maintains the elements and resets the original")
+    {
+        IntPool pool;
+        auto handle = pool.insert(1);
+        auto handle2 = pool.insert(2);
+        auto handle3 = pool.insert(3);
+
+        auto secondPool = std::move(pool);
+        REQUIRE(pool.capacity() == 0);
+        REQUIRE(pool.size() == 0);
+        REQUIRE(pool.get(handle) == nullptr);
+        REQUIRE(pool.get(handle2) == nullptr);
+        REQUIRE(pool.get(handle3) == nullptr);
+
+        REQUIRE(secondPool.size() == 3);
+        REQUIRE(*secondPool.get(handle) == 1);
+        REQUIRE(*secondPool.get(handle2) == 2);
+        REQUIRE(*secondPool.get(handle3) == 3);
+    }
+}
+
+TEST_CASE("Insertion and removal")
+{
+    SUBCASE("Values can be inserted and retrieved")
+    {
+        IntPool pool(4);
+        auto handle = pool.insert(5);
+        REQUIRE(handle.index() == 0);
+        REQUIRE(handle.isValid());
+
+        auto handle2 = pool.insert(7);
+        REQUIRE(handle2.index() == 1);
+        REQUIRE(handle2.isValid());
+
+        REQUIRE(pool.size() == 2);
+        REQUIRE(*pool.get(handle) == 5);
+        REQUIRE(*pool.get(handle2) == 7);
+    }
+
+    SUBCASE("An invalid handle never resolves")
+    {
+        IntPool pool(4);
+        pool.insert(5);
+        REQUIRE(pool.get(KDGpu::Handle<int_tag>()) == nullptr);
+    }
+
+    SUBCASE("Deletion removes the value")
+    {
+        IntPool pool(4);
+        auto handle = pool.insert(5);
+        const auto capacity = pool.capacity();
+
+        pool.remove(handle);
+        REQUIRE(pool.get(handle) == nullptr);
+        REQUIRE(pool.capacity() == capacity);
+        REQUIRE(pool.size() == 0);
+
+        // Removing twice is harmless
+        pool.remove(handle);
+        REQUIRE(pool.size() == 0);
+    }
+
+    SUBCASE("Inserting after a removal reuses the empty index with a newer generation")
+    {
+        IntPool pool(4);
+        pool.insert(5);
+        auto handle2 = pool.insert(7);
+        pool.insert(9);
+
+        pool.remove(handle2);
+        auto replacementHandle2 = pool.insert(123);
+
+        REQUIRE(handle2.index() == replacementHandle2.index());
+        REQUIRE(handle2.generation() < replacementHandle2.generation());
+        REQUIRE(pool.get(handle2) == nullptr);
+        REQUIRE(*pool.get(replacementHandle2) == 123);
+    }
+
+    SUBCASE("Clear invalidates all handles, but leaves capacity unchanged")
+    {
+        IntPool pool(4);
+        auto handle = pool.insert(5);
+        auto handle2 = pool.insert(7);
+        const auto capacity = pool.capacity();
+
+        pool.clear();
+        REQUIRE(pool.capacity() == capacity);
+        REQUIRE(pool.size() == 0);
+        REQUIRE(pool.get(handle) == nullptr);
+        REQUIRE(pool.get(handle2) == nullptr);
+    }
+
+    SUBCASE("Growing past a chunk keeps existing entries at the same address")
+    {
+        IntPool pool(1);
+        auto first = pool.insert(42);
+        int *firstPtr = pool.get(first);
+
+        for (uint32_t i = 0; i < 4 * IntPool::ChunkSize; ++i)
+            pool.insert(int(i));
+
+        REQUIRE(pool.capacity() >= 4 * IntPool::ChunkSize);
+        REQUIRE(pool.get(first) == firstPtr);
+        REQUIRE(*firstPtr == 42);
+    }
+}
+
+TEST_CASE("handleForIndex")
+{
+    IntPool pool(4);
+    for (int i = 0; i < 10; ++i)
+        pool.insert(i);
+
+    for (uint32_t i = 0; i < 10; ++i)
+        REQUIRE(pool.handleForIndex(i).isValid());
+    REQUIRE_FALSE(pool.handleForIndex(10).isValid());
+    REQUIRE_FALSE(pool.handleForIndex(IntPool::MaxSize).isValid());
+}
+
+TEST_CASE("Statistics")
+{
+    IntPool pool(4);
+    auto handle = pool.insert(1);
+    pool.insert(2);
+    pool.insert(3);
+    pool.remove(handle);
+    pool.insert(4);
+
+    const auto stats = pool.statistics();
+    REQUIRE(stats.liveCount == 3);
+    REQUIRE(stats.highWaterMark == 3);
+    REQUIRE(stats.capacity == IntPool::ChunkSize);
+    REQUIRE(stats.insertCount == 4);
+    REQUIRE(stats.reuseCount == 1);
+}
+
+class Counted
+{
+public:
+    explicit Counted(int value) noexcept
+        : m_value(value)
+    {
+        ++ms_alive;
+    }
+    ~Counted() { --ms_alive; }
+
+    int value() const noexcept { return m_value; }
+
+    static int ms_alive;
+
+private:
+    int m_value;
+};
+
+int Counted::ms_alive = 0;
+
+struct Counted_tag;
+
+TEST_CASE("Non-trivial types")
+{
+    SUBCASE("Stale entries are destroyed on reuse and when the pool is destroyed")
+    {
+        {
+            KDGpu::ConcurrentPool<Counted, Counted_tag> pool(4);
+            auto handle = pool.emplace(1);
+            pool.emplace(2);
+            REQUIRE(Counted::ms_alive == 2);
+
+            pool.remove(handle);
+            REQUIRE(Counted::ms_alive == 2);
+
+            auto replacement = pool.emplace(3);
+            REQUIRE(pool.get(replacement)->value() == 3);
+            REQUIRE(Counted::ms_alive == 2);
+        }
+        REQUIRE(Counted::ms_alive == 0);
+    }
+}
+
+TEST_CASE("Concurrency")
+{
+    SUBCASE("Concurrent emplace and remove never hand out the same live slot twice")
+    {
+        IntPool pool(64);
+        constexpr int ThreadCount = 8;
+        constexpr int Iterations = 5000;
+        std::atomic<int> failures{ 0 };
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < ThreadCount; ++t) {
+            threads.emplace_back([&, t] {
+                std::vector<KDGpu::Handle<int_tag>> handles;
+                for (int i = 0; i < Iterations; ++i) {
+                    const int value = t * Iterations + i;
+                    handles.push_back(pool.insert(value));
+                    if (i % 3 == 0) {
+                        pool.remove(handles.front());
+                        handles.erase(handles.begin());
+                    }
+                }
+                for (int i = 0; i < int(handles.size()); ++i) {
+                    int *v = pool.get(handles[i]);
+                    if (!v || *v / Iterations != t)
+                        ++failures;
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        REQUIRE(failures.load() == 0);
+    }
+
+    SUBCASE("A default constructed pool can be filled by several threads at once")
+    {
+        IntPool pool;
+        constexpr int ThreadCount = 8;
+        constexpr int Iterations = 1000;
+        std::atomic<int> failures{ 0 };
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < ThreadCount; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < Iterations; ++i) {
+                    const int value = t * Iterations + i;
+                    int *v = pool.get(pool.insert(value));
+                    if (!v || *v != value)
+                        ++failures;
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        REQUIRE(failures.load() == 0);
+        REQUIRE(pool.size() == ThreadCount * Iterations);
+    }
+
+    SUBCASE("Readers can look up entries while writers grow the pool")
+    {
+        IntPool pool(16);
+        std::vector<KDGpu::Handle<int_tag>> stable;
+        for (int i = 0; i < 16; ++i)
+            stable.push_back(pool.insert(i));
+
+        std::atomic<bool> done{ false };
+        std::atomic<int> failures{ 0 };
+
+        std::thread reader([&] {
+            while (!done.load()) {
+                for (int i = 0; i < 16; ++i) {
+                    int *v = pool.get(stable[i]);
+                    if (!v || *v != i)
+                        ++failures;
+                }
+            }
+        });
+
+        std::thread writer([&] {
+            for (int i = 0; i < 20000; ++i)
+                pool.insert(i);
+            done.store(true);
+        });
+
+        writer.join();
+        reader.join();
+
+        REQUIRE(failures.load() == 0);
+        REQUIRE(pool.size() == 20016);
+    }
+}
@@ -0,0 +1,518 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/buffer.h>
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/command_buffer.h>
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/device.h>
+#include <KDGpu/gpu_semaphore.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/memory_pool_options.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/readback_ring.h>
+#include <KDGpu/resource_manager.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace KDGpu;
+
+TEST_SUITE("Device")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "device",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice();
+
+    const BufferOptions bufferOptions = {
+        .size = 4 * sizeof(float),
+        .usage = BufferUsageFlagBits::TransferDstBit,
+        .memoryUsage = MemoryUsage::GpuOnly
+    };
+
+    TEST_CASE("Deferred Deletion")
+    {
+        REQUIRE(device.isValid());
+        REQUIRE(!device.queues().empty());
+        Queue &queue = device.queues()[0];
+
+        SUBCASE("Releasing a resource with no submission in flight destroys it immediately")
+        {
+            // GIVEN
+            device.waitUntilIdle();
+            const auto before = device.deletionQueueStatistics();
+
+            // WHEN
+            {
+                Buffer b = device.createBuffer(bufferOptions);
+                CHECK(b.isValid());
+            }
+
+            // THEN
+            const auto after = device.deletionQueueStatistics();
+            CHECK(after.pendingDeletions == 0);
+            CHECK(after.completedDeletions == before.completedDeletions + 1);
+            CHECK(after.deferredDeletions == before.deferredDeletions);
+        }
+
+        SUBCASE("Releasing a resource after a submission defers it until the submission retired")
+        {
+            // GIVEN
+            Fence fence = device.createFence({ .createSignalled = false });
+            Buffer b = device.createBuffer(bufferOptions);
+            const Handle<Buffer_t> bufferHandle = b.handle();
+
+            CommandRecorder recorder = device.createCommandRecorder();
+            CommandBuffer commandBuffer = recorder.finish();
+            queue.submit({ .commandBuffers = { commandBuffer }, .signalFence = fence });
+
+            const auto submitted = device.deletionQueueStatistics();
+            CHECK(submitted.lastSubmittedSerial > 0);
+
+            // WHEN
+            b = {};
+
+            // THEN -> The handle is invalidated straight away, even if the destruction is deferred
+            CHECK(api->resourceManager()->getBuffer(bufferHandle) == nullptr);
+
+            // WHEN
+            fence.wait();
+            queue.waitUntilIdle();
+            device.collectGarbage();
+
+            // THEN
+            const auto collected = device.deletionQueueStatistics();
+            CHECK(collected.pendingDeletions == 0);
+            CHECK(collected.submissionsInFlight == 0);
+            CHECK(collected.lastCompletedSerial == collected.lastSubmittedSerial);
+        }
+
+        SUBCASE("Every submission is tracked once, including those without command buffers")
+        {
+            // GIVEN
+            device.waitUntilIdle();
+            GpuSemaphore semaphore = device.createGpuSemaphore();
+            Fence fence = device.createFence({ .createSignalled = false });
+            const uint64_t serial = device.deletionQueueStatistics().lastSubmittedSerial;
+
+            // WHEN
+            queue.submit({ .signalSemaphores = { semaphore } });
+            queue.submit({ .waitSemaphores = { semaphore }, .signalFence = fence });
+
+            // THEN
+            CHECK(device.deletionQueueStatistics().lastSubmittedSerial == serial + 2);
+
+            // WHEN -> The fence of the caller tracks its submission and can be reused
+            fence.wait();
+            fence.reset();
+            queue.submit({ .signalFence = fence });
+            fence.wait();
+            device.collectGarbage();
+
+            // THEN
+            const auto stats = device.deletionQueueStatistics();
+            CHECK(stats.lastSubmittedSerial == serial + 3);
+            CHECK(stats.submissionsInFlight == 0);
+            CHECK(stats.lastCompletedSerial == stats.lastSubmittedSerial);
+        }
+
+        SUBCASE("Waiting for the device releases all pending deletions")
+        {
+            // GIVEN
+            CommandRecorder recorder = device.createCommandRecorder();
+            CommandBuffer commandBuffer = recorder.finish();
+
+            {
+                Buffer b = device.createBuffer(bufferOptions);
+                queue.submit({ .commandBuffers = { commandBuffer } });
+            }
+
+            // WHEN
+            device.waitUntilIdle();
+
+            // THEN
+            const auto stats = device.deletionQueueStatistics();
+            CHECK(stats.pendingDeletions == 0);
+            CHECK(stats.submissionsInFlight == 0);
+            CHECK(stats.lastCompletedSerial == stats.lastSubmittedSerial);
+        }
+    }
+
+    TEST_CASE("Statistics")
+    {
+        REQUIRE(device.isValid());
+        ResourceManager *resourceManager = api->resourceManager();
+
+        SUBCASE("Buffer creation is reflected in the pool and memory statistics")
+        {
+            // GIVEN
+            device.waitUntilIdle();
+            const auto poolBefore = resourceManager->statistics().buffers;
+            const auto memoryBefore = resourceManager->deviceStatistics(device.handle()).memoryFor(MemoryUsage::GpuOnly);
+
+            // WHEN
+            Buffer b = device.createBuffer(bufferOptions);
+
+            // THEN
+            const auto poolAfter = resourceManager->statistics().buffers;
+            CHECK(poolAfter.liveCount == poolBefore.liveCount + 1);
+            CHECK(poolAfter.insertCount == poolBefore.insertCount + 1);
+            CHECK(poolAfter.highWaterMark >= poolAfter.liveCount);
+
+            const auto memoryAfter = resourceManager->deviceStatistics(device.handle()).memoryFor(MemoryUsage::GpuOnly);
+            CHECK(memoryAfter.allocationCount == memoryBefore.allocationCount + 1);
+            CHECK(memoryAfter.allocatedBytes >= memoryBefore.allocatedBytes + bufferOptions.size);
+
+            // WHEN
+            b = {};
+
+            // THEN
+            const auto memoryReleased = resourceManager->deviceStatistics(device.handle()).memoryFor(MemoryUsage::GpuOnly);
+            CHECK(memoryReleased.allocationCount == memoryBefore.allocationCount);
+            CHECK(memoryReleased.allocatedBytes == memoryBefore.allocatedBytes);
+            CHECK(resourceManager->statistics().buffers.liveCount == poolBefore.liveCount);
+        }
+
+        SUBCASE("Recreating a buffer reuses the released slot")
+        {
+            // GIVEN
+            {
+                Buffer b = device.createBuffer(bufferOptions);
+            }
+            const auto before = resourceManager->statistics().buffers;
+
+            // WHEN
+            Buffer b = device.createBuffer(bufferOptions);
+
+            // THEN
+            const auto after = resourceManager->statistics().buffers;
+            CHECK(after.reuseCount == before.reuseCount + 1);
+            CHECK(after.reuseRate() > 0.0f);
+        }
+
+        SUBCASE("Recorders of later frames reuse the storage of earlier frames")
+        {
+            // GIVEN
+            auto recordFrame = [&] {
+                CommandRecorder recorder = device.createCommandRecorder();
+                {
+                    ComputePassCommandRecorder computePass = recorder.beginComputePass();
+                    computePass.end();
+                }
+                return recorder.finish();
+            };
+            CommandBuffer firstFrame = recordFrame();
+            const auto before = resourceManager->statistics();
+
+            // WHEN
+            CommandBuffer secondFrame = recordFrame();
+
+            // THEN
+            const auto after = resourceManager->statistics();
+            CHECK(after.commandRecorders.liveCount == 0);
+            CHECK(after.commandRecorders.reuseCount == before.commandRecorders.reuseCount + 1);
+            CHECK(after.computePassCommandRecorders.liveCount == 0);
+            CHECK(after.computePassCommandRecorders.reuseCount == before.computePassCommandRecorders.reuseCount + 1);
+        }
+
+        SUBCASE("An invalid device handle returns empty statistics")
+        {
+            const auto stats = resourceManager->deviceStatistics({});
+            CHECK(stats.descriptorPools.poolCount == 0);
+            CHECK(stats.memoryFor(MemoryUsage::GpuOnly).allocationCount == 0);
+        }
+    }
+
+    TEST_CASE("Memory Budget")
+    {
+        REQUIRE(device.isValid());
+
+        SUBCASE("Every memory heap reports a budget")
+        {
+            // WHEN
+            const MemoryBudget budget = device.memoryBudget();
+
+            // THEN
+            REQUIRE(!budget.heaps.empty());
+            for (uint32_t i = 0; i < budget.heaps.size(); ++i) {
+                const MemoryHeapBudget &heap = budget.heaps[i];
+                CHECK(heap.heapIndex == i);
+                CHECK(heap.heapSize > 0);
+                CHECK(heap.budget > 0);
+                CHECK(heap.allocationBytes <= heap.blockBytes);
+            }
+        }
+
+        SUBCASE("Allocating memory is reflected in the usage of a heap")
+        {
+            // GIVEN
+            auto allocatedBytes = [&] {
+                DeviceSize total = 0;
+                for (const MemoryHeapBudget &heap : device.memoryBudget().heaps)
+                    total += heap.allocationBytes;
+                return total;
+            };
+            const DeviceSize before = allocatedBytes();
+
+            // WHEN
+            Buffer b = device.createBuffer(bufferOptions);
+
+            // THEN
+            CHECK(allocatedBytes() >= before + bufferOptions.size);
+        }
+
+        SUBCASE("The callback is invoked once when a heap crosses the threshold")
+        {
+            // GIVEN
+            std::vector<uint32_t> notifiedHeaps;
+            device.setMemoryBudgetCallback(0.0f, [&](const MemoryHeapBudget &heap) {
+                notifiedHeaps.push_back(heap.heapIndex);
+            });
+
+            // WHEN -> Every heap is at or over a threshold of 0
+            Buffer a = device.createBuffer(bufferOptions);
+
+            // THEN
+            CHECK(notifiedHeaps.size() == device.memoryBudget().heaps.size());
+
+            // WHEN -> Heaps already over the threshold are not reported again
+            notifiedHeaps.clear();
+            Buffer b = device.createBuffer(bufferOptions);
+
+            // THEN
+            CHECK(notifiedHeaps.empty());
+
+            // WHEN
+            device.setMemoryBudgetCallback(0.0f, {});
+            Buffer c = device.createBuffer(bufferOptions);
+
+            // THEN
+            CHECK(notifiedHeaps.empty());
+        }
+    }
+
+    TEST_CASE("Defragmentation")
+    {
+        REQUIRE(device.isValid());
+        REQUIRE(!device.queues().empty());
+        Queue &queue = device.queues()[0];
+
+        SUBCASE("Only one defragmentation can be in progress at a time")
+        {
+            // WHEN
+            const bool begun = device.beginDefragmentation();
+
+            // THEN
+            CHECK(begun);
+            CHECK(!device.beginDefragmentation());
+
+            // WHEN
+            const DefragmentationStatistics stats = device.endDefragmentation();
+
+            // THEN
+            CHECK(!stats.active);
+            CHECK(!device.endDefragmentation().active);
+        }
+
+        SUBCASE("Relocated buffers keep their handles and contents")
+        {
+            // GIVEN -> A pool fragmented by releasing every other buffer
+            MemoryPool pool = device.createMemoryPool(MemoryPoolOptions{
+                    .memoryUsage = MemoryUsage::CpuToGpu,
+                    .bufferUsage = BufferUsageFlagBits::UniformBufferBit,
+                    .blockSize = 64 * 1024 });
+            REQUIRE(pool.isValid());
+
+            constexpr uint32_t bufferCount = 16;
+            std::vector<Buffer> buffers;
+            for (uint32_t i = 0; i < bufferCount; ++i) {
+                std::vector<uint32_t> data(1024, i);
+                buffers.push_back(device.createBuffer(BufferOptions{
+                                                              .size = data.size() * sizeof(uint32_t),
+                                                              .usage = BufferUsageFlagBits::UniformBufferBit,
+                                                              .memoryUsage = MemoryUsage::CpuToGpu,
+                                                              .memoryPool = pool },
+                                                      data.data()));
+                REQUIRE(buffers.back().isValid());
+            }
+            std::vector<Handle<Buffer_t>> handles;
+            for (uint32_t i = 0; i < bufferCount; ++i) {
+                if (i % 2 == 0)
+                    buffers[i] = {};
+                handles.push_back(buffers[i].handle());
+            }
+            device.waitUntilIdle();
+
+            // WHEN
+            REQUIRE(device.beginDefragmentation({ .memoryPool = pool, .timeBudget = std::chrono::milliseconds(100) }));
+            DefragmentationStatistics stats;
+            for (uint32_t step = 0; step < 16; ++step) {
+                stats = device.defragmentationStep(queue);
+                if (!stats.active)
+                    break;
+            }
+            stats = device.endDefragmentation();
+
+            // THEN
+            CHECK(!stats.active);
+            for (uint32_t i = 1; i < bufferCount; i += 2) {
+                CHECK(buffers[i].handle() == handles[i]);
+                REQUIRE(api->resourceManager()->getBuffer(handles[i]) != nullptr);
+                const auto *data = static_cast<const uint32_t *>(buffers[i].map());
+                REQUIRE(data != nullptr);
+                CHECK(data[0] == i);
+                CHECK(data[1023] == i);
+                buffers[i].unmap();
+            }
+        }
+
+        SUBCASE("Device local buffers are copied without waiting for the device")
+        {
+            // GIVEN -> A device local pool fragmented by releasing every other buffer
+            constexpr BufferUsageFlags usage = BufferUsageFlagBits::StorageBufferBit | BufferUsageFlagBits::TransferSrcBit | BufferUsageFlagBits::TransferDstBit;
+            MemoryPool pool = device.createMemoryPool(MemoryPoolOptions{
+                    .memoryUsage = MemoryUsage::GpuOnly,
+                    .bufferUsage = usage,
+                    .blockSize = 64 * 1024 });
+            REQUIRE(pool.isValid());
+
+            constexpr uint32_t bufferCount = 16;
+            std::vector<Buffer> buffers;
+            for (uint32_t i = 0; i < bufferCount; ++i) {
+                std::vector<uint32_t> data(1024, i);
+                buffers.push_back(device.createBuffer(BufferOptions{
+                        .size = data.size() * sizeof(uint32_t),
+                        .usage = usage,
+                        .memoryUsage = MemoryUsage::GpuOnly,
+                        .memoryPool = pool }));
+                REQUIRE(buffers.back().isValid());
+                queue.waitForUploadBufferData(WaitForBufferUploadOptions{
+                        .destinationBuffer = buffers.back(),
+                        .data = data.data(),
+                        .byteSize = data.size() * sizeof(uint32_t) });
+            }
+            for (uint32_t i = 0; i < bufferCount; i += 2)
+                buffers[i] = {};
+            device.waitUntilIdle();
+
+            // WHEN
+            REQUIRE(device.beginDefragmentation({ .memoryPool = pool, .timeBudget = std::chrono::milliseconds(100) }));
+            DefragmentationStatistics stats = device.defragmentationStep(queue);
+
+            // THEN -> The pass only ends once its copies have retired, in a later step
+            if (stats.allocationsMoved > 0) {
+                CHECK(stats.active);
+                CHECK(stats.passCount == 0);
+            }
+
+            // WHEN
+            for (uint32_t step = 0; step < 1000 && stats.active; ++step) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                stats = device.defragmentationStep(queue);
+            }
+            stats = device.endDefragmentation();
+
+            // THEN
+            CHECK(!stats.active);
+            ReadbackRing ring = device.createReadbackRing(queue);
+            std::vector<Readback> readbacks;
+            for (uint32_t i = 1; i < bufferCount; i += 2) {
+                readbacks.push_back(ring.readBufferData(BufferReadbackOptions{
+                        .sourceBuffer = buffers[i],
+                        .srcStages = PipelineStageFlagBit::TransferBit,
+                        .srcMask = AccessFlagBit::TransferWriteBit,
+                        .byteSize = 1024 * sizeof(uint32_t) }));
+            }
+            ring.submit();
+            for (uint32_t i = 1; i < bufferCount; i += 2) {
+                const auto *data = static_cast<const uint32_t *>(readbacks[i / 2].data());
+                REQUIRE(data != nullptr);
+                CHECK(data[0] == i);
+                CHECK(data[1023] == i);
+            }
+        }
+
+        SUBCASE("Buffers used by a command buffer waiting to be submitted stay where they are")
+        {
+            // GIVEN -> A fragmented pool whose remaining buffers are copied by a recorded command buffer
+            constexpr BufferUsageFlags usage = BufferUsageFlagBits::UniformBufferBit | BufferUsageFlagBits::TransferSrcBit;
+            MemoryPool pool = device.createMemoryPool(MemoryPoolOptions{
+                    .memoryUsage = MemoryUsage::CpuToGpu,
+                    .bufferUsage = usage,
+                    .blockSize = 64 * 1024 });
+            REQUIRE(pool.isValid());
+
+            constexpr uint32_t bufferCount = 16;
+            constexpr DeviceSize bufferSize = 1024 * sizeof(uint32_t);
+            std::vector<Buffer> buffers;
+            for (uint32_t i = 0; i < bufferCount; ++i) {
+                std::vector<uint32_t> data(1024, i);
+                buffers.push_back(device.createBuffer(BufferOptions{
+                                                              .size = bufferSize,
+                                                              .usage = usage,
+                                                              .memoryUsage = MemoryUsage::CpuToGpu,
+                                                              .memoryPool = pool },
+                                                      data.data()));
+                REQUIRE(buffers.back().isValid());
+            }
+            for (uint32_t i = 0; i < bufferCount; i += 2)
+                buffers[i] = {};
+
+            Buffer destination = device.createBuffer(BufferOptions{
+                    .size = bufferCount / 2 * bufferSize,
+                    .usage = BufferUsageFlagBits::TransferDstBit,
+                    .memoryUsage = MemoryUsage::GpuToCpu });
+            CommandRecorder recorder = device.createCommandRecorder();
+            for (uint32_t i = 1; i < bufferCount; i += 2) {
+                recorder.copyBuffer(BufferCopy{
+                        .src = buffers[i],
+                        .dst = destination,
+                        .dstOffset = i / 2 * bufferSize,
+                        .byteSize = bufferSize });
+            }
+            CommandBuffer commandBuffer = recorder.finish();
+            device.waitUntilIdle();
+
+            // WHEN
+            REQUIRE(device.beginDefragmentation({ .memoryPool = pool, .timeBudget = std::chrono::milliseconds(100) }));
+            DefragmentationStatistics stats;
+            for (uint32_t step = 0; step < 16; ++step) {
+                stats = device.defragmentationStep(queue);
+                if (!stats.active)
+                    break;
+            }
+            stats = device.endDefragmentation();
+
+            // THEN
+            CHECK(stats.allocationsMoved == 0);
+
+            // WHEN
+            queue.submit(SubmitOptions{ .commandBuffers = { commandBuffer } });
+            queue.waitUntilIdle();
+
+            // THEN -> The recorded copies read the buffers' contents
+            const auto *data = static_cast<const uint32_t *>(destination.map());
+            REQUIRE(data != nullptr);
+            for (uint32_t i = 1; i < bufferCount; i += 2) {
+                CHECK(data[i / 2 * 1024] == i);
+                CHECK(data[i / 2 * 1024 + 1023] == i);
+            }
+            destination.unmap();
+        }
+    }
+}
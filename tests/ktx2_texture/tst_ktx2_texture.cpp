@@ -0,0 +1,223 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/device.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/ktx2_texture.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/readback_ring.h>
+#include <KDGpu/texture.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+using namespace KDGpu;
+
+TEST_SUITE("Ktx2Texture")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "ktx2_texture",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice();
+
+    constexpr uint32_t size = 8;
+    constexpr uint32_t layers = 2;
+    constexpr uint32_t levels = 4;
+
+    // Value of the texel of a given level and layer, all texels of an image are the same
+    uint32_t texelValue(uint32_t level, uint32_t layer)
+    {
+        return 0xff000000 | (level << 8) | layer;
+    }
+
+    // Contents of a KTX2 file, levels are stored from the smallest to the largest.
+    // Blocks are blockSide x blockSide texels, uncompressed formats have 1x1 blocks.
+    std::vector<uint8_t> ktx2FileData(Format format, uint32_t blockSide = 1, uint32_t bytesPerBlock = sizeof(uint32_t))
+    {
+        constexpr uint32_t dfdOffset = 80 + levels * 3 * sizeof(uint64_t);
+        constexpr uint32_t dfdSize = 28;
+        const uint32_t header[20] = {
+            0, 0, 0, // Identifier, written below
+            static_cast<uint32_t>(format), 1, size, size, 0, layers, 1, levels, 0,
+            dfdOffset, dfdSize, 0, 0, 0, 0, 0, 0
+        };
+        std::vector<uint8_t> file(dfdOffset + dfdSize);
+        std::memcpy(file.data(), header, sizeof(header));
+        const uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+        std::memcpy(file.data(), identifier, sizeof(identifier));
+
+        // Basic data format descriptor, only the block dimensions and size are read
+        const uint32_t descriptor[3] = { dfdSize, 0, (dfdSize - 4) << 16 };
+        std::memcpy(file.data() + dfdOffset, descriptor, sizeof(descriptor));
+        const uint8_t blockDimensions[4] = { uint8_t(blockSide - 1), uint8_t(blockSide - 1), 0, 0 };
+        std::memcpy(file.data() + dfdOffset + 16, blockDimensions, sizeof(blockDimensions));
+        file[dfdOffset + 20] = uint8_t(bytesPerBlock);
+
+        for (uint32_t level = levels; level-- > 0;) {
+            const uint32_t blocks = (size >> level) / blockSide + ((size >> level) % blockSide != 0);
+            const uint64_t byteLength = blocks * blocks * layers * bytesPerBlock;
+            const uint64_t index[3] = { file.size(), byteLength, byteLength };
+            std::memcpy(file.data() + sizeof(header) + level * sizeof(index), index, sizeof(index));
+            for (uint32_t layer = 0; layer < layers; ++layer) {
+                const std::vector<uint32_t> texels(blocks * blocks * bytesPerBlock / sizeof(uint32_t), texelValue(level, layer));
+                const auto *bytes = reinterpret_cast<const uint8_t *>(texels.data());
+                file.insert(file.end(), bytes, bytes + texels.size() * sizeof(uint32_t));
+            }
+        }
+        return file;
+    }
+
+    std::string writeFile(const std::string &name, const std::vector<uint8_t> &file)
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(file.data()), file.size());
+        return path;
+    }
+
+    std::string writeKtx2File(const std::string &name, Format format)
+    {
+        return writeFile(name, ktx2FileData(format));
+    }
+
+    // Overwrites the byte offset and length of a level in the level index of file
+    void setLevelRange(std::vector<uint8_t> &file, uint32_t level, uint64_t byteOffset, uint64_t byteLength)
+    {
+        const uint64_t range[2] = { byteOffset, byteLength };
+        std::memcpy(file.data() + 80 + level * 3 * sizeof(uint64_t), range, sizeof(range));
+    }
+
+    TEST_CASE("Loading")
+    {
+        SUBCASE("A missing or invalid file gives an invalid Ktx2Texture")
+        {
+            // GIVEN
+            const std::string path = (std::filesystem::temp_directory_path() / "kdgpu_invalid.ktx2").string();
+            std::ofstream(path, std::ios::binary) << "Not a KTX2 file";
+
+            // THEN
+            CHECK(!Ktx2Texture("kdgpu_does_not_exist.ktx2").isValid());
+            CHECK(!Ktx2Texture(path).isValid());
+        }
+
+        SUBCASE("Files with levels out of bounds or of the wrong size are invalid")
+        {
+            // GIVEN
+            const std::vector<uint8_t> valid = ktx2FileData(Format::R8G8B8A8_UNORM);
+            const uint64_t level0Size = size * size * layers * sizeof(uint32_t);
+
+            std::vector<uint8_t> truncated = valid;
+            truncated.resize(truncated.size() - 1);
+
+            std::vector<uint8_t> overflowing = valid;
+            setLevelRange(overflowing, 0, std::numeric_limits<uint64_t>::max() - 8, level0Size);
+
+            std::vector<uint8_t> tooShort = valid;
+            setLevelRange(tooShort, 0, valid.size() - level0Size, level0Size / 2);
+
+            // THEN
+            CHECK(Ktx2Texture(writeFile("kdgpu_valid.ktx2", valid)).isValid());
+            CHECK(!Ktx2Texture(writeFile("kdgpu_truncated.ktx2", truncated)).isValid());
+            CHECK(!Ktx2Texture(writeFile("kdgpu_overflowing.ktx2", overflowing)).isValid());
+            CHECK(!Ktx2Texture(writeFile("kdgpu_too_short.ktx2", tooShort)).isValid());
+        }
+
+        SUBCASE("The header describes the texture")
+        {
+            // WHEN
+            Ktx2Texture ktx(writeKtx2File("kdgpu_rgba8.ktx2", Format::R8G8B8A8_UNORM));
+
+            // THEN
+            REQUIRE(ktx.isValid());
+            CHECK(ktx.format() == Format::R8G8B8A8_UNORM);
+            CHECK(ktx.type() == TextureType::TextureType2D);
+            CHECK(ktx.extent() == Extent3D{ size, size, 1 });
+            CHECK(ktx.mipLevels() == levels);
+            CHECK(ktx.arrayLayers() == layers);
+            CHECK(!ktx.isCubeMap());
+            CHECK(ktx.levelData(0).size() == size * size * layers * sizeof(uint32_t));
+            CHECK(ktx.levelData(levels).empty());
+
+            const TextureOptions options = ktx.textureOptions();
+            CHECK(options.mipLevels == levels);
+            CHECK(options.arrayLayers == layers);
+            CHECK(options.usage.testFlag(TextureUsageFlagBits::TransferDstBit));
+        }
+
+        SUBCASE("The first variant with a supported format is selected")
+        {
+            // GIVEN -> No texture compression feature was enabled on the device
+            const std::string bcPath = writeFile("kdgpu_bc7.ktx2", ktx2FileData(Format::BC7_UNORM_BLOCK, 4, 16));
+            const std::string rgbaPath = writeKtx2File("kdgpu_rgba8.ktx2", Format::R8G8B8A8_UNORM);
+
+            // WHEN
+            Ktx2Texture ktx = Ktx2Texture::loadBestSupported(device, { bcPath, rgbaPath });
+
+            // THEN
+            CHECK(Ktx2Texture(bcPath).isValid());
+            CHECK(!Ktx2Texture::isFormatSupported(device, Format::BC7_UNORM_BLOCK));
+            REQUIRE(ktx.isValid());
+            CHECK(ktx.format() == Format::R8G8B8A8_UNORM);
+        }
+    }
+
+    TEST_CASE("Uploading")
+    {
+        REQUIRE(device.isValid());
+        Queue &queue = device.queues()[0];
+
+        SUBCASE("All levels and layers are uploaded with a single copy")
+        {
+            // GIVEN
+            Ktx2Texture ktx(writeKtx2File("kdgpu_rgba8.ktx2", Format::R8G8B8A8_UNORM));
+            REQUIRE(ktx.isValid());
+            Texture texture = device.createTexture(ktx.textureOptions(TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferSrcBit));
+
+            // WHEN
+            const TextureUploadOptions uploadOptions = ktx.uploadOptions({ .destinationTexture = texture });
+            UploadStagingBuffer upload = queue.uploadTextureData(uploadOptions);
+            upload.fence.wait();
+
+            // THEN
+            CHECK(uploadOptions.regions.size() == levels);
+            const TextureSubresourceRange range = textureUploadRange(uploadOptions.regions);
+            CHECK(range.levelCount == levels);
+            CHECK(range.layerCount == layers);
+
+            // WHEN -> Reading back the second layer of the third level
+            ReadbackRing ring = device.createReadbackRing(queue);
+            const uint32_t extent = size >> 2;
+            Readback readback = ring.readTextureData(TextureReadbackOptions{
+                    .sourceTexture = texture,
+                    .srcStages = PipelineStageFlagBit::FragmentShaderBit,
+                    .srcMask = AccessFlagBit::ShaderReadBit,
+                    .layout = TextureLayout::ShaderReadOnlyOptimal,
+                    .byteSize = extent * extent * sizeof(uint32_t),
+                    .regions = { { .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit, .mipLevel = 2, .baseArrayLayer = 1 },
+                                   .textureExtent = { extent, extent, 1 } } } });
+            ring.submit();
+
+            // THEN
+            const auto *result = static_cast<const uint32_t *>(readback.data());
+            REQUIRE(result != nullptr);
+            for (uint32_t i = 0; i < extent * extent; ++i)
+                CHECK(result[i] == texelValue(2, 1));
+        }
+    }
+}
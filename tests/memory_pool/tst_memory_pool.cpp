@@ -0,0 +1,156 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/device.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/memory_pool.h>
+#include <KDGpu/memory_pool_options.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+using namespace KDGpu;
+
+TEST_SUITE("MemoryPool")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "memory_pool",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice();
+
+    const MemoryPoolOptions bufferPoolOptions = {
+        .memoryUsage = MemoryUsage::CpuToGpu,
+        .bufferUsage = BufferUsageFlagBits::UniformBufferBit | BufferUsageFlagBits::TransferSrcBit,
+        .algorithm = MemoryPoolAlgorithm::Linear,
+        .blockSize = 64 * 1024,
+        .maxBlockCount = 1
+    };
+
+    TEST_CASE("Construction")
+    {
+        SUBCASE("A default constructed MemoryPool is invalid")
+        {
+            // GIVEN
+            MemoryPool pool;
+
+            // THEN
+            REQUIRE(!pool.isValid());
+            CHECK(pool.statistics().blockCount == 0);
+        }
+
+        SUBCASE("A constructed MemoryPool from a Vulkan API")
+        {
+            // WHEN
+            MemoryPool pool = device.createMemoryPool(bufferPoolOptions);
+
+            // THEN
+            CHECK(pool.isValid());
+            CHECK(api->resourceManager()->getMemoryPool(pool) != nullptr);
+            CHECK(pool.statistics().allocationCount == 0);
+        }
+
+        SUBCASE("A MemoryPool for textures")
+        {
+            // WHEN
+            MemoryPool pool = device.createMemoryPool(MemoryPoolOptions{
+                    .memoryUsage = MemoryUsage::GpuOnly,
+                    .textureUsage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+                    .textureFormat = Format::R8G8B8A8_UNORM,
+                    .minBlockCount = 1 });
+
+            // THEN
+            CHECK(pool.isValid());
+            CHECK(pool.statistics().blockCount == 1);
+        }
+    }
+
+    TEST_CASE("Destruction")
+    {
+        SUBCASE("Going Out Of Scope")
+        {
+            Handle<MemoryPool_t> poolHandle;
+            {
+                // WHEN
+                MemoryPool pool = device.createMemoryPool(bufferPoolOptions);
+                poolHandle = pool.handle();
+
+                // THEN
+                CHECK(api->resourceManager()->getMemoryPool(poolHandle) != nullptr);
+            }
+
+            // THEN
+            CHECK(api->resourceManager()->getMemoryPool(poolHandle) == nullptr);
+        }
+    }
+
+    TEST_CASE("Allocation")
+    {
+        SUBCASE("Buffers are allocated from the pool they target")
+        {
+            // GIVEN
+            MemoryPool pool = device.createMemoryPool(bufferPoolOptions);
+
+            // WHEN
+            Buffer a = device.createBuffer(BufferOptions{
+                    .size = 256,
+                    .usage = BufferUsageFlagBits::UniformBufferBit,
+                    .memoryUsage = MemoryUsage::CpuToGpu,
+                    .memoryPool = pool });
+            Buffer b = device.createBuffer(BufferOptions{
+                    .size = 256,
+                    .usage = BufferUsageFlagBits::UniformBufferBit,
+                    .memoryUsage = MemoryUsage::CpuToGpu,
+                    .memoryPool = pool });
+
+            // THEN
+            CHECK(a.isValid());
+            CHECK(b.isValid());
+            const MemoryPoolStatistics stats = pool.statistics();
+            CHECK(stats.allocationCount == 2);
+            CHECK(stats.blockCount == 1);
+            CHECK(stats.allocationBytes >= 512);
+
+            // WHEN
+            device.waitUntilIdle();
+            a = {};
+
+            // THEN
+            CHECK(pool.statistics().allocationCount == 1);
+        }
+
+        SUBCASE("Textures are allocated from the pool they target")
+        {
+            // GIVEN
+            MemoryPool pool = device.createMemoryPool(MemoryPoolOptions{
+                    .memoryUsage = MemoryUsage::GpuOnly,
+                    .textureUsage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+                    .textureFormat = Format::R8G8B8A8_UNORM });
+
+            // WHEN
+            Texture t = device.createTexture(TextureOptions{
+                    .type = TextureType::TextureType2D,
+                    .format = Format::R8G8B8A8_UNORM,
+                    .extent = { 64, 64, 1 },
+                    .mipLevels = 1,
+                    .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+                    .memoryUsage = MemoryUsage::GpuOnly,
+                    .memoryPool = pool });
+
+            // THEN
+            CHECK(t.isValid());
+            CHECK(pool.statistics().allocationCount == 1);
+        }
+    }
+}
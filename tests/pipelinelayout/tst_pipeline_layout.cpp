@@ -12,6 +12,7 @@
 #include <KDGpu/pipeline_layout_options.h>
 #include <KDGpu/device.h>
 #include <KDGpu/instance.h>
+#include <KDGpu/resource_manager.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -119,11 +120,56 @@ TEST_SUITE("PipelineLayout")
 
             // WHEN
             PipelineLayout a = device.createPipelineLayout(pipelineLayoutOptions);
-            PipelineLayout b = device.createPipelineLayout(pipelineLayoutOptions);
+            PipelineLayout b = device.createPipelineLayout(PipelineLayoutOptions{
+                    .pushConstantRanges = { { .offset = 0, .size = 16, .shaderStages = ShaderStageFlags(ShaderStageFlagBits::VertexBit) } } });
 
             // THEN
             CHECK(a != b);
             CHECK(a == a);
         }
     }
+
+    TEST_CASE("Deduplication")
+    {
+        ResourceManager *resourceManager = api->resourceManager();
+        const PipelineLayoutOptions pipelineLayoutOptions = {
+            .pushConstantRanges = { { .offset = 0, .size = 64, .shaderStages = ShaderStageFlags(ShaderStageFlagBits::FragmentBit) } }
+        };
+
+        SUBCASE("Identical options share a single pipeline layout")
+        {
+            // GIVEN
+            const auto before = resourceManager->deviceStatistics(device.handle()).pipelineLayoutCache;
+
+            // WHEN
+            PipelineLayout a = device.createPipelineLayout(pipelineLayoutOptions);
+            PipelineLayout b = device.createPipelineLayout(pipelineLayoutOptions);
+
+            // THEN
+            CHECK(a == b);
+            const auto after = resourceManager->deviceStatistics(device.handle()).pipelineLayoutCache;
+            CHECK(after.objectCount == before.objectCount + 1);
+            CHECK(after.hitCount == before.hitCount + 1);
+        }
+
+        SUBCASE("A shared pipeline layout is only destroyed with its last reference")
+        {
+            // GIVEN
+            PipelineLayout a = device.createPipelineLayout(pipelineLayoutOptions);
+            PipelineLayout b = device.createPipelineLayout(pipelineLayoutOptions);
+            const Handle<PipelineLayout_t> pipelineLayoutHandle = a.handle();
+
+            // WHEN
+            a = {};
+
+            // THEN
+            CHECK(resourceManager->getPipelineLayout(pipelineLayoutHandle) != nullptr);
+
+            // WHEN
+            b = {};
+
+            // THEN
+            CHECK(resourceManager->getPipelineLayout(pipelineLayoutHandle) == nullptr);
+        }
+    }
 }
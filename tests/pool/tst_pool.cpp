@@ -11,6 +11,7 @@
 #include <KDGpu/pool.h>
 
 #include <set>
+#include <vector>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest.h>
@@ -207,6 +208,137 @@ TEST_CASE("handleForIndex")
     }
 }
 
+TEST_CASE("Iteration")
+{
+    SUBCASE("forEach only visits alive entries")
+    {
+        IntPool array;
+        auto handle = array.insert(1);
+        auto handle2 = array.insert(2);
+        auto handle3 = array.insert(3);
+        array.remove(handle2);
+
+        std::set<int> visited;
+        std::set<uint32_t> visitedIndices;
+        array.forEach([&](const KDGpu::Handle<int_tag> &h, int &value) {
+            REQUIRE(array.get(h) == &value);
+            visited.insert(value);
+            visitedIndices.insert(h.index());
+        });
+
+        REQUIRE(visited == std::set<int>{ 1, 3 });
+        REQUIRE(visitedIndices == std::set<uint32_t>{ handle.index(), handle3.index() });
+    }
+
+    SUBCASE("Entries can be removed while iterating")
+    {
+        IntPool array;
+        for (int i = 0; i < 10; ++i)
+            array.insert(i);
+
+        int visitCount = 0;
+        array.forEach([&](const KDGpu::Handle<int_tag> &h, int &value) {
+            ++visitCount;
+            if (value % 2 == 0)
+                array.remove(h);
+        });
+
+        REQUIRE(visitCount == 10);
+        REQUIRE(array.size() == 5);
+        array.forEach([&](const KDGpu::Handle<int_tag> &, int &value) {
+            REQUIRE(value % 2 == 1);
+        });
+    }
+}
+
+TEST_CASE("Reserve and shrink")
+{
+    SUBCASE("Reserving grows the capacity without changing the content")
+    {
+        IntPool array;
+        auto handle = array.insert(42);
+
+        array.reserve(100);
+        REQUIRE(array.capacity() == 100);
+        REQUIRE(array.size() == 1);
+        REQUIRE(*array.get(handle) == 42);
+
+        // Reserving less than the capacity does nothing
+        array.reserve(10);
+        REQUIRE(array.capacity() == 100);
+    }
+
+    SUBCASE("Shrinking releases the unused capacity but keeps handles valid")
+    {
+        IntPool array(100);
+        auto handle = array.insert(1);
+        auto handle2 = array.insert(2);
+        auto handle3 = array.insert(3);
+        array.remove(handle2);
+
+        array.shrink();
+        REQUIRE(array.capacity() == 3);
+        REQUIRE(array.size() == 2);
+        REQUIRE(*array.get(handle) == 1);
+        REQUIRE(array.get(handle2) == nullptr);
+        REQUIRE(*array.get(handle3) == 3);
+
+        // The removed slot is still reused before growing
+        auto replacementHandle2 = array.insert(4);
+        REQUIRE(replacementHandle2.index() == handle2.index());
+        REQUIRE(array.get(handle2) == nullptr);
+        REQUIRE(array.capacity() == 3);
+    }
+}
+
+TEST_CASE("Statistics")
+{
+    SUBCASE("A new pool has no statistics")
+    {
+        IntPool array(8);
+        const auto stats = array.statistics();
+        REQUIRE(stats.liveCount == 0);
+        REQUIRE(stats.highWaterMark == 0);
+        REQUIRE(stats.capacity == 8);
+        REQUIRE(stats.insertCount == 0);
+        REQUIRE(stats.reuseCount == 0);
+        REQUIRE(stats.reuseRate() == 0.0f);
+    }
+
+    SUBCASE("Insertions, removals and slot reuse are counted")
+    {
+        IntPool array;
+        auto handle = array.insert(1);
+        auto handle2 = array.insert(2);
+        array.insert(3);
+        array.remove(handle);
+        array.remove(handle2);
+        array.insert(4);
+
+        const auto stats = array.statistics();
+        REQUIRE(stats.liveCount == 2);
+        REQUIRE(stats.highWaterMark == 3);
+        REQUIRE(stats.insertCount == 4);
+        REQUIRE(stats.reuseCount == 1);
+        REQUIRE(stats.reuseRate() == doctest::Approx(0.25f));
+    }
+
+    SUBCASE("Resetting the statistics restarts the high water mark from the live count")
+    {
+        IntPool array;
+        auto handle = array.insert(1);
+        array.insert(2);
+        array.remove(handle);
+
+        array.resetStatistics();
+        const auto stats = array.statistics();
+        REQUIRE(stats.liveCount == 1);
+        REQUIRE(stats.highWaterMark == 1);
+        REQUIRE(stats.insertCount == 0);
+        REQUIRE(stats.reuseCount == 0);
+    }
+}
+
 class MyType
 {
 public:
@@ -256,4 +388,34 @@ TEST_CASE("Non-trivial types")
         REQUIRE(MyType::ms_destructorCalled == true);
         MyType::ms_destructorCalled = false;
     }
+
+    SUBCASE("Reusing a slot destroys the removed entry and constructs the new one in place")
+    {
+        MyTypePool array;
+
+        auto handle = array.emplace(1, 2);
+        array.remove(handle);
+        REQUIRE(MyType::ms_destructorCalled == false);
+
+        auto replacementHandle = array.emplace(3, 4);
+        REQUIRE(MyType::ms_destructorCalled == true);
+        REQUIRE(replacementHandle.index() == handle.index());
+        REQUIRE(array.get(replacementHandle)->a() == 3);
+        REQUIRE(array.get(replacementHandle)->b() == 4);
+        MyType::ms_destructorCalled = false;
+    }
+
+    SUBCASE("Growing the pool keeps the entries")
+    {
+        MyTypePool array;
+        std::vector<KDGpu::Handle<MyType_tag>> handles;
+        for (uint32_t i = 0; i < 100; ++i)
+            handles.push_back(array.emplace(i, 2 * i));
+
+        for (uint32_t i = 0; i < 100; ++i) {
+            REQUIRE(array.get(handles[i])->a() == i);
+            REQUIRE(array.get(handles[i])->b() == 2 * i);
+        }
+        MyType::ms_destructorCalled = false;
+    }
 }
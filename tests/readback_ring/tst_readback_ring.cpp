@@ -0,0 +1,260 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/buffer.h>
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/device.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/readback_ring.h>
+#include <KDGpu/texture.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+using namespace KDGpu;
+
+TEST_SUITE("ReadbackRing")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "readback_ring",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice();
+
+    std::vector<uint32_t> sequence(size_t count, uint32_t first)
+    {
+        std::vector<uint32_t> data(count);
+        std::iota(data.begin(), data.end(), first);
+        return data;
+    }
+
+    Buffer createSource(const std::vector<uint32_t> &data)
+    {
+        Buffer buffer = device.createBuffer(BufferOptions{
+                .size = data.size() * sizeof(uint32_t),
+                .usage = BufferUsageFlagBits::TransferSrcBit | BufferUsageFlagBits::TransferDstBit,
+                .memoryUsage = MemoryUsage::GpuOnly });
+        device.queues()[0].waitForUploadBufferData(WaitForBufferUploadOptions{
+                .destinationBuffer = buffer,
+                .data = data.data(),
+                .byteSize = data.size() * sizeof(uint32_t) });
+        return buffer;
+    }
+
+    BufferReadbackOptions readbackOptions(const Buffer &buffer, DeviceSize byteSize)
+    {
+        return BufferReadbackOptions{
+            .sourceBuffer = buffer,
+            .srcStages = PipelineStageFlagBit::TransferBit,
+            .srcMask = AccessFlagBit::TransferWriteBit,
+            .byteSize = byteSize
+        };
+    }
+
+    TEST_CASE("Buffer Readbacks")
+    {
+        REQUIRE(device.isValid());
+        Queue &queue = device.queues()[0];
+
+        SUBCASE("A readback is fulfilled once its copy has been submitted and completed")
+        {
+            // GIVEN
+            ReadbackRing ring = device.createReadbackRing(queue);
+            REQUIRE(ring.isValid());
+            const std::vector<uint32_t> data = sequence(1024, 5);
+            Buffer source = createSource(data);
+
+            // WHEN
+            Readback readback = ring.readBufferData(readbackOptions(source, data.size() * sizeof(uint32_t)));
+
+            // THEN -> Nothing to wait for until submitted
+            REQUIRE(readback.isValid());
+            CHECK(ring.hasPendingReadbacks());
+            CHECK(!readback.isReady());
+
+            // WHEN
+            ring.submit();
+            REQUIRE(readback.wait());
+
+            // THEN
+            CHECK(readback.isReady());
+            CHECK(readback.byteSize() == data.size() * sizeof(uint32_t));
+            const auto *result = static_cast<const uint32_t *>(readback.data());
+            REQUIRE(result != nullptr);
+            CHECK(std::memcmp(result, data.data(), readback.byteSize()) == 0);
+        }
+
+        SUBCASE("Several readbacks are copied with a single submission")
+        {
+            // GIVEN
+            ReadbackRing ring = device.createReadbackRing(queue);
+            const std::vector<uint32_t> data = sequence(256, 0);
+            Buffer source = createSource(data);
+
+            // WHEN
+            std::vector<Readback> readbacks;
+            for (uint32_t i = 0; i < 4; ++i) {
+                BufferReadbackOptions options = readbackOptions(source, 64 * sizeof(uint32_t));
+                options.srcOffset = i * 64 * sizeof(uint32_t);
+                readbacks.push_back(ring.readBufferData(options));
+            }
+            ring.submit();
+
+            // THEN
+            CHECK(ring.statistics().submissionCount == 1);
+            CHECK(ring.statistics().readbackCount == 4);
+            for (uint32_t i = 0; i < 4; ++i) {
+                const auto *result = static_cast<const uint32_t *>(readbacks[i].data());
+                REQUIRE(result != nullptr);
+                CHECK(result[0] == i * 64);
+                CHECK(result[63] == i * 64 + 63);
+            }
+        }
+
+        SUBCASE("Released readbacks recycle their buffer")
+        {
+            // GIVEN
+            ReadbackRing ring = device.createReadbackRing(queue);
+            const std::vector<uint32_t> data = sequence(64, 1);
+            Buffer source = createSource(data);
+            {
+                Readback readback = ring.readBufferData(readbackOptions(source, data.size() * sizeof(uint32_t)));
+                ring.submit();
+                readback.wait();
+            }
+            CHECK(ring.statistics().buffersInUse == 0);
+
+            // WHEN
+            Readback readback = ring.readBufferData(readbackOptions(source, data.size() * sizeof(uint32_t)));
+            ring.submit();
+
+            // THEN
+            const auto stats = ring.statistics();
+            CHECK(stats.bufferCount == 1);
+            CHECK(stats.reuseCount == 1);
+            CHECK(stats.buffersInUse == 1);
+            const auto *result = static_cast<const uint32_t *>(readback.data());
+            REQUIRE(result != nullptr);
+            CHECK(result[63] == 64);
+        }
+
+        SUBCASE("Waiting for a readback which was never submitted fails")
+        {
+            // GIVEN
+            ReadbackRing ring = device.createReadbackRing(queue);
+            Buffer source = createSource(sequence(16, 0));
+            Readback readback = ring.readBufferData(readbackOptions(source, 16 * sizeof(uint32_t)));
+
+            // THEN
+            CHECK(!readback.wait());
+            CHECK(readback.data() == nullptr);
+        }
+    }
+
+    TEST_CASE("Texture Readbacks")
+    {
+        REQUIRE(device.isValid());
+        Queue &queue = device.queues()[0];
+
+        SUBCASE("Optimally tiled textures can be read back")
+        {
+            // GIVEN
+            constexpr uint32_t size = 16;
+            const std::vector<uint32_t> texels = sequence(size * size, 100);
+            Texture texture = device.createTexture(TextureOptions{
+                    .type = TextureType::TextureType2D,
+                    .format = Format::R8G8B8A8_UNORM,
+                    .extent = { size, size, 1 },
+                    .mipLevels = 1,
+                    .usage = TextureUsageFlagBits::TransferSrcBit | TextureUsageFlagBits::TransferDstBit,
+                    .memoryUsage = MemoryUsage::GpuOnly });
+            const BufferTextureCopyRegion region = {
+                .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
+                .textureExtent = { size, size, 1 }
+            };
+            queue.waitForUploadTextureData(WaitForTextureUploadOptions{
+                    .destinationTexture = texture,
+                    .data = texels.data(),
+                    .byteSize = texels.size() * sizeof(uint32_t),
+                    .oldLayout = TextureLayout::Undefined,
+                    .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+                    .regions = { region } });
+            ReadbackRing ring = device.createReadbackRing(queue);
+
+            // WHEN
+            Readback readback = ring.readTextureData(TextureReadbackOptions{
+                    .sourceTexture = texture,
+                    .srcStages = PipelineStageFlagBit::TransferBit,
+                    .srcMask = AccessFlagBit::TransferWriteBit,
+                    .layout = TextureLayout::ShaderReadOnlyOptimal,
+                    .byteSize = texels.size() * sizeof(uint32_t),
+                    .regions = { region } });
+            ring.submit();
+
+            // THEN
+            const auto *result = static_cast<const uint32_t *>(readback.data());
+            REQUIRE(result != nullptr);
+            CHECK(std::memcmp(result, texels.data(), readback.byteSize()) == 0);
+        }
+
+        SUBCASE("Several regions of the same level are read back together")
+        {
+            // GIVEN
+            constexpr uint32_t size = 16;
+            const std::vector<uint32_t> texels = sequence(size * size, 300);
+            Texture texture = device.createTexture(TextureOptions{
+                    .type = TextureType::TextureType2D,
+                    .format = Format::R8G8B8A8_UNORM,
+                    .extent = { size, size, 1 },
+                    .mipLevels = 1,
+                    .usage = TextureUsageFlagBits::TransferSrcBit | TextureUsageFlagBits::TransferDstBit,
+                    .memoryUsage = MemoryUsage::GpuOnly });
+            queue.waitForUploadTextureData(WaitForTextureUploadOptions{
+                    .destinationTexture = texture,
+                    .data = texels.data(),
+                    .byteSize = texels.size() * sizeof(uint32_t),
+                    .oldLayout = TextureLayout::Undefined,
+                    .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+                    .regions = { { .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
+                                   .textureExtent = { size, size, 1 } } } });
+            ReadbackRing ring = device.createReadbackRing(queue);
+
+            // WHEN -> The top and bottom halves, which share their only subresource
+            constexpr uint32_t halfSize = size * size / 2 * sizeof(uint32_t);
+            Readback readback = ring.readTextureData(TextureReadbackOptions{
+                    .sourceTexture = texture,
+                    .srcStages = PipelineStageFlagBit::TransferBit,
+                    .srcMask = AccessFlagBit::TransferWriteBit,
+                    .layout = TextureLayout::ShaderReadOnlyOptimal,
+                    .byteSize = texels.size() * sizeof(uint32_t),
+                    .regions = {
+                            { .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
+                              .textureExtent = { size, size / 2, 1 } },
+                            { .bufferOffset = halfSize,
+                              .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
+                              .textureOffset = { 0, size / 2, 0 },
+                              .textureExtent = { size, size / 2, 1 } } } });
+            ring.submit();
+
+            // THEN
+            const auto *result = static_cast<const uint32_t *>(readback.data());
+            REQUIRE(result != nullptr);
+            CHECK(std::memcmp(result, texels.data(), readback.byteSize()) == 0);
+        }
+    }
+}
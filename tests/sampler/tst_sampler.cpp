@@ -12,6 +12,7 @@
 #include <KDGpu/sampler_options.h>
 #include <KDGpu/device.h>
 #include <KDGpu/instance.h>
+#include <KDGpu/resource_manager.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -113,10 +114,52 @@ TEST_SUITE("Sampler")
 
             // WHEN
             Sampler a = device.createSampler(samplerOptions);
-            Sampler b = device.createSampler(samplerOptions);
+            Sampler b = device.createSampler(SamplerOptions{ .magFilter = FilterMode::Nearest });
 
             // THEN
             CHECK(a != b);
         }
     }
+
+    TEST_CASE("Deduplication")
+    {
+        ResourceManager *resourceManager = api->resourceManager();
+        const SamplerOptions samplerOptions{ .u = AddressMode::ClampToEdge, .v = AddressMode::ClampToEdge };
+
+        SUBCASE("Identical options share a single sampler")
+        {
+            // GIVEN
+            const auto before = resourceManager->deviceStatistics(device.handle()).samplerCache;
+
+            // WHEN
+            Sampler a = device.createSampler(samplerOptions);
+            Sampler b = device.createSampler(samplerOptions);
+
+            // THEN
+            CHECK(a == b);
+            const auto after = resourceManager->deviceStatistics(device.handle()).samplerCache;
+            CHECK(after.objectCount == before.objectCount + 1);
+            CHECK(after.hitCount == before.hitCount + 1);
+        }
+
+        SUBCASE("A shared sampler is only destroyed with its last reference")
+        {
+            // GIVEN
+            Sampler a = device.createSampler(samplerOptions);
+            Sampler b = device.createSampler(samplerOptions);
+            const Handle<Sampler_t> samplerHandle = a.handle();
+
+            // WHEN
+            a = {};
+
+            // THEN
+            CHECK(resourceManager->getSampler(samplerHandle) != nullptr);
+
+            // WHEN
+            b = {};
+
+            // THEN
+            CHECK(resourceManager->getSampler(samplerHandle) == nullptr);
+        }
+    }
 }
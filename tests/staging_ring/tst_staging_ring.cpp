@@ -0,0 +1,471 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/async_uploader.h>
+#include <KDGpu/buffer.h>
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/device.h>
+#include <KDGpu/fence.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/resource_manager.h>
+#include <KDGpu/staging_ring.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <numeric>
+#include <vector>
+
+using namespace KDGpu;
+
+TEST_SUITE("StagingRing")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "staging_ring",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice(DeviceOptions{ .stagingRingSize = 64 * 1024 });
+
+    // Host visible so that the uploaded contents can be checked
+    Buffer createDestination(DeviceSize size)
+    {
+        return device.createBuffer(BufferOptions{
+                .size = size,
+                .usage = BufferUsageFlagBits::TransferDstBit,
+                .memoryUsage = MemoryUsage::GpuToCpu });
+    }
+
+    std::vector<uint32_t> sequence(size_t count, uint32_t first)
+    {
+        std::vector<uint32_t> data(count);
+        std::iota(data.begin(), data.end(), first);
+        return data;
+    }
+
+    bool contains(Buffer &buffer, const std::vector<uint32_t> &expected)
+    {
+        const auto *data = static_cast<const uint32_t *>(buffer.map());
+        const bool equal = data && std::equal(expected.begin(), expected.end(), data);
+        buffer.unmap();
+        return equal;
+    }
+
+    TEST_CASE("Staged Uploads")
+    {
+        REQUIRE(device.isValid());
+        REQUIRE(!device.queues().empty());
+        Queue &queue = device.queues()[0];
+
+        SUBCASE("Uploads staged before a submission are submitted together")
+        {
+            // GIVEN
+            const auto before = queue.stagingRingStatistics();
+            std::vector<Buffer> destinations;
+            std::vector<std::vector<uint32_t>> contents;
+            for (uint32_t i = 0; i < 8; ++i) {
+                contents.push_back(sequence(64, i * 64));
+                destinations.push_back(createDestination(64 * sizeof(uint32_t)));
+            }
+
+            // WHEN
+            for (uint32_t i = 0; i < 8; ++i) {
+                queue.stageBufferUpload(BufferUploadOptions{
+                        .destinationBuffer = destinations[i],
+                        .dstStages = PipelineStageFlagBit::TransferBit,
+                        .dstMask = AccessFlagBit::TransferReadBit,
+                        .data = contents[i].data(),
+                        .byteSize = contents[i].size() * sizeof(uint32_t) });
+            }
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+
+            // THEN
+            const auto after = queue.stagingRingStatistics();
+            CHECK(after.uploadCount == before.uploadCount + 8);
+            CHECK(after.submissionCount == before.submissionCount + 1);
+            CHECK(after.capacity == 64 * 1024);
+            for (uint32_t i = 0; i < 8; ++i)
+                CHECK(contains(destinations[i], contents[i]));
+        }
+
+        SUBCASE("Space is reclaimed once the submission completed")
+        {
+            // GIVEN
+            const std::vector<uint32_t> data = sequence(256, 0);
+            Buffer destination = createDestination(data.size() * sizeof(uint32_t));
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = destination,
+                    .dstStages = PipelineStageFlagBit::TransferBit,
+                    .dstMask = AccessFlagBit::TransferReadBit,
+                    .data = data.data(),
+                    .byteSize = data.size() * sizeof(uint32_t) });
+            CHECK(queue.stagingRingStatistics().usedBytes > 0);
+
+            // WHEN
+            queue.submit({});
+            queue.waitUntilIdle();
+            queue.submitStagedUploads();
+
+            // THEN
+            const auto stats = queue.stagingRingStatistics();
+            CHECK(stats.usedBytes == 0);
+            CHECK(stats.submissionsInFlight == 0);
+            CHECK(contains(destination, data));
+        }
+
+        SUBCASE("A drained ring starts over from its beginning")
+        {
+            // GIVEN -> A ring left with its head partway through once its uploads completed
+            const std::vector<uint32_t> first = sequence(6 * 1024, 0);
+            Buffer firstDestination = createDestination(first.size() * sizeof(uint32_t));
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = firstDestination,
+                    .dstStages = PipelineStageFlagBit::TransferBit,
+                    .dstMask = AccessFlagBit::TransferReadBit,
+                    .data = first.data(),
+                    .byteSize = first.size() * sizeof(uint32_t) });
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+            queue.submitStagedUploads();
+            REQUIRE(queue.stagingRingStatistics().usedBytes == 0);
+            const auto before = queue.stagingRingStatistics();
+
+            // WHEN -> An upload of more than half of the ring which doesn't fit after the head
+            const std::vector<uint32_t> second = sequence(12 * 1024, 5);
+            Buffer secondDestination = createDestination(second.size() * sizeof(uint32_t));
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = secondDestination,
+                    .dstStages = PipelineStageFlagBit::TransferBit,
+                    .dstMask = AccessFlagBit::TransferReadBit,
+                    .data = second.data(),
+                    .byteSize = second.size() * sizeof(uint32_t) });
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+
+            // THEN
+            const auto after = queue.stagingRingStatistics();
+            CHECK(after.stallCount == before.stallCount);
+            CHECK(after.dedicatedBufferCount == before.dedicatedBufferCount);
+            CHECK(contains(secondDestination, second));
+        }
+
+        SUBCASE("Uploads wrap around the ring and wait when it is full")
+        {
+            // GIVEN -> More data than the ring holds, in uploads of a quarter of the ring
+            const auto before = queue.stagingRingStatistics();
+            std::vector<Buffer> destinations;
+            std::vector<std::vector<uint32_t>> contents;
+            for (uint32_t i = 0; i < 10; ++i) {
+                contents.push_back(sequence(4096, i * 4096));
+                destinations.push_back(createDestination(4096 * sizeof(uint32_t)));
+            }
+
+            // WHEN
+            for (uint32_t i = 0; i < 10; ++i) {
+                queue.stageBufferUpload(BufferUploadOptions{
+                        .destinationBuffer = destinations[i],
+                        .dstStages = PipelineStageFlagBit::TransferBit,
+                        .dstMask = AccessFlagBit::TransferReadBit,
+                        .data = contents[i].data(),
+                        .byteSize = contents[i].size() * sizeof(uint32_t) });
+            }
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+
+            // THEN
+            const auto after = queue.stagingRingStatistics();
+            CHECK(after.stallCount > before.stallCount);
+            CHECK(after.dedicatedBufferCount == before.dedicatedBufferCount);
+            for (uint32_t i = 0; i < 10; ++i)
+                CHECK(contains(destinations[i], contents[i]));
+        }
+
+        SUBCASE("Uploads larger than the ring use a dedicated staging buffer")
+        {
+            // GIVEN
+            const auto before = queue.stagingRingStatistics();
+            const std::vector<uint32_t> data = sequence(32 * 1024, 7);
+            Buffer destination = createDestination(data.size() * sizeof(uint32_t));
+
+            // WHEN
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = destination,
+                    .dstStages = PipelineStageFlagBit::TransferBit,
+                    .dstMask = AccessFlagBit::TransferReadBit,
+                    .data = data.data(),
+                    .byteSize = data.size() * sizeof(uint32_t) });
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+
+            // THEN
+            CHECK(queue.stagingRingStatistics().dedicatedBufferCount == before.dedicatedBufferCount + 1);
+            CHECK(contains(destination, data));
+        }
+    }
+
+    TEST_CASE("Direct Writes")
+    {
+        REQUIRE(device.isValid());
+        Queue &queue = device.queues()[0];
+        ResourceManager *resourceManager = api->resourceManager();
+
+        SUBCASE("Uploads to GpuOnly buffers skip the staging copy when device local memory is host visible")
+        {
+            // GIVEN
+            const std::vector<uint32_t> data = sequence(256, 11);
+            Buffer destination = device.createBuffer(BufferOptions{
+                    .size = data.size() * sizeof(uint32_t),
+                    .usage = BufferUsageFlagBits::TransferDstBit | BufferUsageFlagBits::VertexBufferBit,
+                    .memoryUsage = MemoryUsage::GpuOnly });
+            device.waitUntilIdle();
+            const auto before = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+            const auto ringBefore = queue.stagingRingStatistics();
+
+            // WHEN
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = destination,
+                    .dstStages = PipelineStageFlagBit::VertexAttributeInputBit,
+                    .dstMask = AccessFlagBit::VertexAttributeReadBit,
+                    .data = data.data(),
+                    .byteSize = data.size() * sizeof(uint32_t) });
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+
+            // THEN -> Exactly one of the two paths was taken
+            const auto after = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+            CHECK(after.directWriteCount + after.stagedUploadCount == before.directWriteCount + before.stagedUploadCount + 1);
+            if (!after.hostVisibleDeviceLocalMemory)
+                CHECK(after.stagedUploadCount == before.stagedUploadCount + 1);
+
+            if (after.directWriteCount > before.directWriteCount) {
+                CHECK(after.directWriteBytes == before.directWriteBytes + data.size() * sizeof(uint32_t));
+                CHECK(queue.stagingRingStatistics().uploadCount == ringBefore.uploadCount);
+                CHECK(contains(destination, data));
+            } else {
+                CHECK(queue.stagingRingStatistics().uploadCount == ringBefore.uploadCount + 1);
+            }
+        }
+
+        SUBCASE("A direct write doesn't get overwritten by a copy staged before it")
+        {
+            // GIVEN -> An upload staged while the GPU is busy with the buffer, still waiting to be submitted once it is idle
+            const std::vector<uint32_t> stale = sequence(256, 100);
+            const std::vector<uint32_t> latest = sequence(256, 200);
+            Buffer busySource = device.createBuffer(BufferOptions{
+                    .size = latest.size() * sizeof(uint32_t),
+                    .usage = BufferUsageFlagBits::TransferSrcBit,
+                    .memoryUsage = MemoryUsage::GpuOnly });
+            Buffer destination = device.createBuffer(BufferOptions{
+                    .size = latest.size() * sizeof(uint32_t),
+                    .usage = BufferUsageFlagBits::TransferDstBit | BufferUsageFlagBits::VertexBufferBit,
+                    .memoryUsage = MemoryUsage::GpuOnly });
+            device.waitUntilIdle();
+
+            CommandRecorder recorder = device.createCommandRecorder();
+            recorder.copyBuffer(BufferCopy{
+                    .src = busySource,
+                    .dst = destination,
+                    .byteSize = latest.size() * sizeof(uint32_t) });
+            CommandBuffer busyCommands = recorder.finish();
+            queue.submit(SubmitOptions{ .commandBuffers = { busyCommands } });
+            const auto beforeStale = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = destination,
+                    .dstStages = PipelineStageFlagBit::VertexAttributeInputBit,
+                    .dstMask = AccessFlagBit::VertexAttributeReadBit,
+                    .data = stale.data(),
+                    .byteSize = stale.size() * sizeof(uint32_t) });
+            queue.waitUntilIdle();
+            const auto before = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+            // The GPU may have been done already, the stale data was then written directly
+            const bool staleStaged = before.stagedUploadCount > beforeStale.stagedUploadCount;
+
+            SUBCASE("Staging another upload to the same range")
+            {
+                // WHEN
+                queue.stageBufferUpload(BufferUploadOptions{
+                        .destinationBuffer = destination,
+                        .dstStages = PipelineStageFlagBit::VertexAttributeInputBit,
+                        .dstMask = AccessFlagBit::VertexAttributeReadBit,
+                        .data = latest.data(),
+                        .byteSize = latest.size() * sizeof(uint32_t) });
+                queue.submitStagedUploads();
+            }
+
+            SUBCASE("Uploading to the same range and waiting for it")
+            {
+                // WHEN
+                queue.waitForUploadBufferData(WaitForBufferUploadOptions{
+                        .destinationBuffer = destination,
+                        .data = latest.data(),
+                        .byteSize = latest.size() * sizeof(uint32_t) });
+            }
+            queue.waitUntilIdle();
+
+            // THEN -> The copy staged first was submitted, so the later upload was staged as well
+            const auto after = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+            if (staleStaged) {
+                CHECK(after.directWriteCount == before.directWriteCount);
+                CHECK(after.stagedUploadCount == before.stagedUploadCount + 1);
+            }
+            if (after.hostVisibleDeviceLocalMemory)
+                CHECK(contains(destination, latest));
+        }
+
+        SUBCASE("Only the buffers used by submissions in flight are kept from being written directly")
+        {
+            // GIVEN -> A copy into one buffer submitted without waiting for it
+            const std::vector<uint32_t> data = sequence(256, 300);
+            const DeviceSize byteSize = data.size() * sizeof(uint32_t);
+            Buffer busySource = device.createBuffer(BufferOptions{
+                    .size = byteSize,
+                    .usage = BufferUsageFlagBits::TransferSrcBit,
+                    .memoryUsage = MemoryUsage::GpuOnly });
+            Buffer busyDestination = device.createBuffer(BufferOptions{
+                    .size = byteSize,
+                    .usage = BufferUsageFlagBits::TransferDstBit | BufferUsageFlagBits::VertexBufferBit,
+                    .memoryUsage = MemoryUsage::GpuOnly });
+            Buffer idleDestination = device.createBuffer(BufferOptions{
+                    .size = byteSize,
+                    .usage = BufferUsageFlagBits::TransferDstBit | BufferUsageFlagBits::VertexBufferBit,
+                    .memoryUsage = MemoryUsage::GpuOnly });
+            device.waitUntilIdle();
+
+            CommandRecorder recorder = device.createCommandRecorder();
+            recorder.copyBuffer(BufferCopy{
+                    .src = busySource,
+                    .dst = busyDestination,
+                    .byteSize = byteSize });
+            CommandBuffer busyCommands = recorder.finish();
+            Fence busyFence = device.createFence(FenceOptions{ .createSignalled = false });
+            queue.submit(SubmitOptions{ .commandBuffers = { busyCommands }, .signalFence = busyFence });
+            const auto before = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+
+            // WHEN
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = busyDestination,
+                    .dstStages = PipelineStageFlagBit::VertexAttributeInputBit,
+                    .dstMask = AccessFlagBit::VertexAttributeReadBit,
+                    .data = data.data(),
+                    .byteSize = byteSize });
+            const bool stillBusy = busyFence.status() != FenceStatus::Signalled;
+            const auto afterBusy = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = idleDestination,
+                    .dstStages = PipelineStageFlagBit::VertexAttributeInputBit,
+                    .dstMask = AccessFlagBit::VertexAttributeReadBit,
+                    .data = data.data(),
+                    .byteSize = byteSize });
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+
+            // THEN -> The buffer nothing is using is written directly even though the GPU was not idle
+            const auto after = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+            if (stillBusy)
+                CHECK(afterBusy.stagedUploadCount == before.stagedUploadCount + 1);
+            if (after.hostVisibleDeviceLocalMemory) {
+                CHECK(after.directWriteCount == afterBusy.directWriteCount + 1);
+                CHECK(after.directWriteBytes == afterBusy.directWriteBytes + byteSize);
+            }
+        }
+
+        SUBCASE("Uploads to host visible buffers of other memory usages are always staged")
+        {
+            // GIVEN
+            const std::vector<uint32_t> data = sequence(16, 0);
+            Buffer destination = createDestination(data.size() * sizeof(uint32_t));
+            device.waitUntilIdle();
+            const auto before = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+
+            // WHEN
+            queue.stageBufferUpload(BufferUploadOptions{
+                    .destinationBuffer = destination,
+                    .dstStages = PipelineStageFlagBit::TransferBit,
+                    .dstMask = AccessFlagBit::TransferReadBit,
+                    .data = data.data(),
+                    .byteSize = data.size() * sizeof(uint32_t) });
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+
+            // THEN
+            const auto after = resourceManager->deviceStatistics(device.handle()).bufferUploads;
+            CHECK(after.directWriteCount == before.directWriteCount);
+            CHECK(after.stagedUploadCount == before.stagedUploadCount + 1);
+            CHECK(contains(destination, data));
+        }
+    }
+
+    TEST_CASE("Async Uploads")
+    {
+        // GIVEN -> A device with one queue of every type so that a transfer only queue is used if there is one
+        std::vector<QueueRequest> queueRequests;
+        const auto queueTypes = discreteGPUAdapter->queueTypes();
+        for (uint32_t i = 0; i < queueTypes.size(); ++i)
+            queueRequests.push_back(QueueRequest{ .queueTypeIndex = i, .count = 1, .priorities = { 1.0f } });
+        Device uploadDevice = discreteGPUAdapter->createDevice(DeviceOptions{ .queues = queueRequests });
+        REQUIRE(uploadDevice.isValid());
+        Queue &graphicsQueue = uploadDevice.queues()[0];
+
+        bool hasTransferOnlyQueue = false;
+        for (const AdapterQueueType &queueType : queueTypes) {
+            hasTransferOnlyQueue |= queueType.flags.testFlag(QueueFlagBits::TransferBit) &&
+                    !queueType.flags.testFlag(QueueFlagBits::GraphicsBit) &&
+                    !queueType.flags.testFlag(QueueFlagBits::ComputeBit);
+        }
+
+        SUBCASE("Uploaded data is visible to the destination queue after a flush")
+        {
+            // GIVEN
+            AsyncUploader uploader = uploadDevice.createAsyncUploader(graphicsQueue, AsyncUploaderOptions{ .stagingSize = 64 * 1024 });
+            REQUIRE(uploader.isValid());
+            CHECK(uploader.usesTransferQueue() == hasTransferOnlyQueue);
+
+            const std::vector<uint32_t> data = sequence(1024, 3);
+            Buffer destination = uploadDevice.createBuffer(BufferOptions{
+                    .size = data.size() * sizeof(uint32_t),
+                    .usage = BufferUsageFlagBits::TransferDstBit,
+                    .memoryUsage = MemoryUsage::GpuToCpu });
+
+            // WHEN
+            uploader.uploadBufferData(BufferUploadOptions{
+                    .destinationBuffer = destination,
+                    .dstStages = PipelineStageFlagBit::TransferBit,
+                    .dstMask = AccessFlagBit::TransferReadBit,
+                    .data = data.data(),
+                    .byteSize = data.size() * sizeof(uint32_t) });
+            uploader.flush();
+            uploader.waitUntilIdle();
+
+            // THEN
+            const auto stats = uploader.statistics();
+            CHECK(stats.usesTransferQueue == hasTransferOnlyQueue);
+            CHECK(stats.flushCount >= 1);
+            CHECK(stats.acquiresInFlight == 0);
+            CHECK(stats.staging.uploadCount == 1);
+            CHECK(contains(destination, data));
+        }
+
+        SUBCASE("Flushing without uploads does not submit anything")
+        {
+            // GIVEN
+            AsyncUploader uploader = uploadDevice.createAsyncUploader(graphicsQueue);
+
+            // WHEN
+            uploader.flush();
+
+            // THEN
+            CHECK(uploader.statistics().staging.submissionCount == 0);
+        }
+    }
+}
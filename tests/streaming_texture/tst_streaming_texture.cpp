@@ -0,0 +1,197 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/device.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/streaming_texture.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <vector>
+
+using namespace KDGpu;
+
+TEST_SUITE("StreamingTexture")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "streaming_texture",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice();
+
+    constexpr uint32_t size = 64;
+    constexpr uint32_t levels = 7;
+
+    const TextureOptions textureOptions = {
+        .type = TextureType::TextureType2D,
+        .format = Format::R8G8B8A8_UNORM,
+        .extent = { size, size, 1 },
+        .mipLevels = levels,
+        .usage = TextureUsageFlagBits::SampledBit,
+        .memoryUsage = MemoryUsage::GpuOnly
+    };
+
+    // RGBA8 texels of all the levels, finest first
+    std::vector<std::vector<uint8_t>> levelTexels()
+    {
+        std::vector<std::vector<uint8_t>> texels;
+        for (uint32_t level = 0; level < levels; ++level) {
+            const uint32_t extent = size >> level;
+            texels.emplace_back(extent * extent * 4, static_cast<uint8_t>(level));
+        }
+        return texels;
+    }
+
+    std::vector<std::span<const uint8_t>> spans(const std::vector<std::vector<uint8_t>> &texels)
+    {
+        return { texels.begin(), texels.end() };
+    }
+
+    TEST_CASE("Construction")
+    {
+        SUBCASE("A default constructed StreamingTexture is invalid")
+        {
+            StreamingTexture t;
+            CHECK(!t.isValid());
+            CHECK(!t.update(1024));
+        }
+
+        SUBCASE("The data of every level is required")
+        {
+            // GIVEN
+            const auto texels = levelTexels();
+            std::vector<std::span<const uint8_t>> levelData = spans(texels);
+            levelData.pop_back();
+
+            // WHEN
+            StreamingTexture t = device.createStreamingTexture(device.queues()[0], { .textureOptions = textureOptions, .levelData = levelData });
+
+            // THEN
+            CHECK(!t.isValid());
+        }
+
+        SUBCASE("Nothing is resident before the first update")
+        {
+            // GIVEN
+            const auto texels = levelTexels();
+
+            // WHEN
+            StreamingTexture t = device.createStreamingTexture(device.queues()[0], { .textureOptions = textureOptions, .levelData = spans(texels) });
+
+            // THEN
+            REQUIRE(t.isValid());
+            CHECK(!t.isResident());
+            CHECK(!t.view().isValid());
+            CHECK(t.statistics().residentMipLevel == levels);
+            CHECK(t.statistics().remainingBytes == 21844); // 64x64 RGBA8 and its 6 smaller levels
+        }
+    }
+
+    TEST_CASE("Streaming")
+    {
+        REQUIRE(device.isValid());
+        Queue &queue = device.queues()[0];
+        const auto texels = levelTexels();
+        StreamingTexture t = device.createStreamingTexture(queue, { .textureOptions = textureOptions, .levelData = spans(texels) });
+        REQUIRE(t.isValid());
+
+        SUBCASE("The mip tail is uploaded first within the budget")
+        {
+            // WHEN -> Levels 6 to 2 take 4 + 16 + 64 + 256 + 1024 bytes
+            t.update(1400);
+
+            // THEN
+            CHECK(t.statistics().levelsInFlight == 5);
+            CHECK(t.statistics().uploadedBytes == 1364);
+
+            // WHEN
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+            const bool changed = t.update(1400);
+
+            // THEN -> Level 1 does not fit the budget and goes on its own
+            CHECK(changed);
+            CHECK(t.residentMipLevel() == 2);
+            CHECK(t.view().isValid());
+            CHECK(t.statistics().levelsInFlight == 1);
+        }
+
+        SUBCASE("Staged levels are only resident once submitted and completed")
+        {
+            // WHEN
+            t.update(1400);
+            queue.waitUntilIdle();
+
+            // THEN
+            CHECK(!t.update(0));
+            CHECK(!t.isResident());
+
+            // WHEN
+            queue.submitStagedUploads();
+            queue.waitUntilIdle();
+
+            // THEN
+            CHECK(t.update(0));
+            CHECK(t.residentMipLevel() == 2);
+            CHECK(queue.stagingRingStatistics().dedicatedBufferCount == 0);
+        }
+
+        SUBCASE("All the levels eventually become resident")
+        {
+            // WHEN
+            for (uint32_t frame = 0; frame < 16 && !t.isFullyResident(); ++frame) {
+                t.update(1024);
+                queue.submitStagedUploads();
+                queue.waitUntilIdle();
+            }
+            t.update(1024);
+
+            // THEN
+            CHECK(t.isFullyResident());
+            CHECK(t.statistics().remainingBytes == 0);
+            CHECK(t.statistics().levelsInFlight == 0);
+        }
+    }
+
+    TEST_CASE("Streaming through a small staging ring")
+    {
+        // GIVEN -> Level 2 needs the whole ring, levels 1 and 0 get dedicated buffers
+        Device smallRingDevice = discreteGPUAdapter->createDevice(DeviceOptions{ .stagingRingSize = 1024 });
+        REQUIRE(smallRingDevice.isValid());
+        Queue &queue = smallRingDevice.queues()[0];
+        const auto texels = levelTexels();
+        StreamingTexture t = smallRingDevice.createStreamingTexture(queue, { .textureOptions = textureOptions, .levelData = spans(texels) });
+        REQUIRE(t.isValid());
+
+        SUBCASE("Levels which do not fit yet are deferred rather than waited for")
+        {
+            // WHEN
+            t.update(1024 * 1024);
+
+            // THEN
+            CHECK(t.statistics().levelsInFlight == 4);
+
+            // WHEN
+            for (uint32_t frame = 0; frame < 1000 && !t.isFullyResident(); ++frame) {
+                queue.submitStagedUploads();
+                t.update(1024 * 1024);
+            }
+
+            // THEN
+            CHECK(t.isFullyResident());
+            CHECK(queue.stagingRingStatistics().stallCount == 0);
+            CHECK(queue.stagingRingStatistics().dedicatedBufferCount == 2);
+        }
+    }
+}
@@ -12,9 +12,16 @@
 #include <KDGpu/texture_options.h>
 #include <KDGpu/device.h>
 #include <KDGpu/instance.h>
+#include <KDGpu/memory_pool.h>
+#include <KDGpu/memory_pool_options.h>
+#include <KDGpu/mipmap_generator.h>
+#include <KDGpu/readback_ring.h>
+#include <KDGpu/resource_manager.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
+#include <cstring>
 #include <set>
+#include <vector>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest.h>
@@ -168,4 +175,260 @@ TEST_SUITE("Texture")
         // THEN
         CHECK(success);
     }
+
+    TEST_CASE("MipMap Generator")
+    {
+        REQUIRE(device.isValid());
+        Queue &queue = device.queues().front();
+        MipmapGenerator generator = device.createMipmapGenerator();
+        REQUIRE(generator.isValid());
+
+        const TextureOptions textureOptions = {
+            .type = TextureType::TextureType2D,
+            .format = Format::R8G8B8A8_UNORM,
+            .extent = { 64, 64, 1 },
+            .mipLevels = 7,
+            .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferSrcBit | TextureUsageFlagBits::TransferDstBit,
+            .memoryUsage = MemoryUsage::GpuOnly
+        };
+
+        SUBCASE("Textures without a mip chain are not supported")
+        {
+            // GIVEN
+            TextureOptions options = textureOptions;
+            options.mipLevels = 1;
+            Texture t = device.createTexture(options);
+
+            // THEN
+            CHECK(generator.method(options) == MipmapGenerationMethod::Unsupported);
+            CHECK(!generator.generate(queue, t, options).isValid());
+        }
+
+        SUBCASE("Linearly filterable formats are blitted")
+        {
+            CHECK(generator.method(textureOptions) == MipmapGenerationMethod::Blit);
+            CHECK(generator.blitFilter(textureOptions) == FilterMode::Linear);
+        }
+
+        SUBCASE("Depth formats are blitted with nearest filtering")
+        {
+            // GIVEN
+            TextureOptions depthOptions = textureOptions;
+            depthOptions.format = Format::D32_SFLOAT;
+            depthOptions.usage = TextureUsageFlagBits::DepthStencilAttachmentBit | TextureUsageFlagBits::TransferSrcBit | TextureUsageFlagBits::TransferDstBit;
+            Texture t = device.createTexture(depthOptions);
+
+            // THEN
+            CHECK(generator.blitFilter(depthOptions) == FilterMode::Nearest);
+            const MipmapGenerationMethod generationMethod = generator.method(depthOptions);
+            CHECK(generationMethod != MipmapGenerationMethod::Compute);
+            if (generationMethod == MipmapGenerationMethod::Blit) {
+                // WHEN
+                Fence fence = generator.generate(queue, t, depthOptions,
+                                                 MipmapGenerationOptions{
+                                                         .newLayout = TextureLayout::DepthStencilReadOnlyOptimal,
+                                                         .dstStages = PipelineStageFlagBit::EarlyFragmentTestBit,
+                                                         .dstMask = AccessFlagBit::DepthStencilAttachmentReadBit });
+
+                // THEN
+                REQUIRE(fence.isValid());
+                fence.wait();
+                CHECK(fence.status() == FenceStatus::Signalled);
+            }
+        }
+
+        SUBCASE("Textures which can't be blitted are downsampled with a compute shader")
+        {
+            // GIVEN -> No TransferSrcBit usage, so that blits are not an option
+            REQUIRE(discreteGPUAdapter->features().shaderStorageImageWriteWithoutFormat);
+            Device computeDevice = discreteGPUAdapter->createDevice(DeviceOptions{
+                    .requestedFeatures = discreteGPUAdapter->features() });
+            Queue &computeQueue = computeDevice.queues()[0];
+            MipmapGenerator computeGenerator = computeDevice.createMipmapGenerator();
+            TextureOptions storageOptions = textureOptions;
+            storageOptions.usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::StorageBit | TextureUsageFlagBits::TransferDstBit;
+            Texture t = computeDevice.createTexture(storageOptions);
+
+            // THEN
+            REQUIRE(computeGenerator.method(storageOptions) == MipmapGenerationMethod::Compute);
+
+            // WHEN
+            Fence fence = computeGenerator.generate(computeQueue, t, storageOptions);
+
+            // THEN
+            REQUIRE(fence.isValid());
+            fence.wait();
+            CHECK(fence.status() == FenceStatus::Signalled);
+            computeGenerator.releaseTransientResources();
+        }
+
+        SUBCASE("All the layers of array and cube textures are generated")
+        {
+            // GIVEN
+            TextureOptions arrayOptions = textureOptions;
+            arrayOptions.arrayLayers = 4;
+            TextureOptions cubeOptions = textureOptions;
+            cubeOptions.type = TextureType::TextureTypeCube;
+            cubeOptions.arrayLayers = 6;
+            Texture arrayTexture = device.createTexture(arrayOptions);
+            Texture cubeTexture = device.createTexture(cubeOptions);
+
+            // WHEN
+            CommandRecorder recorder = device.createCommandRecorder();
+            const bool arrayRecorded = generator.generate(recorder, arrayTexture, arrayOptions);
+            const bool cubeRecorded = generator.generate(recorder, cubeTexture, cubeOptions);
+            CommandBuffer commandBuffer = recorder.finish();
+            Fence fence = device.createFence({ .createSignalled = false });
+            queue.submit({ .commandBuffers = { commandBuffer }, .signalFence = fence });
+            fence.wait();
+
+            // THEN
+            CHECK(arrayRecorded);
+            CHECK(cubeRecorded);
+            CHECK(fence.status() == FenceStatus::Signalled);
+        }
+
+        SUBCASE("Each level is downsampled from the previous one")
+        {
+            // GIVEN -> A constant colored first level
+            constexpr uint32_t texel = 0xff804020;
+            const std::vector<uint32_t> texels(64 * 64, texel);
+            Texture t = device.createTexture(textureOptions);
+            queue.waitForUploadTextureData(WaitForTextureUploadOptions{
+                    .destinationTexture = t,
+                    .data = texels.data(),
+                    .byteSize = texels.size() * sizeof(uint32_t),
+                    .oldLayout = TextureLayout::Undefined,
+                    .newLayout = TextureLayout::TransferDstOptimal,
+                    .regions = { { .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
+                                   .textureExtent = { 64, 64, 1 } } } });
+
+            // WHEN
+            Fence fence = generator.generate(queue, t, textureOptions,
+                                             MipmapGenerationOptions{
+                                                     .oldLayout = TextureLayout::TransferDstOptimal,
+                                                     .newLayout = TextureLayout::TransferSrcOptimal,
+                                                     .dstStages = PipelineStageFlagBit::TransferBit,
+                                                     .dstMask = AccessFlagBit::TransferReadBit });
+
+            // THEN
+            REQUIRE(fence.isValid());
+            fence.wait();
+
+            // WHEN -> Reading back the 1x1 last level
+            ReadbackRing ring = device.createReadbackRing(queue);
+            Readback readback = ring.readTextureData(TextureReadbackOptions{
+                    .sourceTexture = t,
+                    .srcStages = PipelineStageFlagBit::TransferBit,
+                    .srcMask = AccessFlagBit::TransferReadBit,
+                    .layout = TextureLayout::TransferSrcOptimal,
+                    .byteSize = sizeof(uint32_t),
+                    .regions = { { .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit, .mipLevel = 6 },
+                                   .textureExtent = { 1, 1, 1 } } } });
+            ring.submit();
+
+            // THEN
+            const auto *result = static_cast<const uint32_t *>(readback.data());
+            REQUIRE(result != nullptr);
+            CHECK(*result == texel);
+        }
+    }
+
+    TEST_CASE("Transient Attachments")
+    {
+        ResourceManager *resourceManager = api->resourceManager();
+
+        const TextureOptions transientOptions = {
+            .type = TextureType::TextureType2D,
+            .format = Format::R8G8B8A8_UNORM,
+            .extent = { 256, 256, 1 },
+            .mipLevels = 1,
+            .samples = SampleCountFlagBits::Samples4Bit,
+            .usage = TextureUsageFlagBits::ColorAttachmentBit | TextureUsageFlagBits::TransientAttachmentBit,
+            .memoryUsage = MemoryUsage::GpuLazilyAllocated
+        };
+
+        auto allocationCount = [&] {
+            const auto stats = resourceManager->deviceStatistics(device.handle());
+            return stats.memoryFor(MemoryUsage::GpuLazilyAllocated).allocationCount + stats.memoryFor(MemoryUsage::GpuOnly).allocationCount;
+        };
+
+        SUBCASE("Lazily allocated textures fall back to device memory when needed")
+        {
+            // GIVEN
+            device.waitUntilIdle();
+            const uint32_t before = allocationCount();
+
+            // WHEN
+            Texture t = device.createTexture(transientOptions);
+
+            // THEN
+            CHECK(t.isValid());
+            CHECK(allocationCount() == before + 1);
+        }
+
+        SUBCASE("Aliased textures share a single allocation")
+        {
+            // GIVEN
+            device.waitUntilIdle();
+            const uint32_t before = allocationCount();
+            TextureOptions depthOptions = transientOptions;
+            depthOptions.format = Format::D32_SFLOAT;
+            depthOptions.usage = TextureUsageFlagBits::DepthStencilAttachmentBit | TextureUsageFlagBits::TransientAttachmentBit;
+
+            // WHEN
+            std::vector<Texture> textures = device.createAliasedTextures({ transientOptions, depthOptions });
+
+            // THEN
+            REQUIRE(textures.size() == 2);
+            CHECK(textures[0].isValid());
+            CHECK(textures[1].isValid());
+            CHECK(textures[0] != textures[1]);
+            CHECK(allocationCount() == before + 1);
+
+            // WHEN -> The allocation outlives all but the last texture
+            textures[0] = {};
+            device.waitUntilIdle();
+
+            // THEN
+            CHECK(allocationCount() == before + 1);
+
+            // WHEN
+            textures[1] = {};
+            device.waitUntilIdle();
+
+            // THEN
+            CHECK(allocationCount() == before);
+        }
+
+        SUBCASE("Aliased textures are allocated from the memory pool of the first options")
+        {
+            // GIVEN
+            MemoryPool pool = device.createMemoryPool(MemoryPoolOptions{
+                    .memoryUsage = MemoryUsage::GpuOnly,
+                    .textureUsage = TextureUsageFlagBits::ColorAttachmentBit,
+                    .textureFormat = Format::R8G8B8A8_UNORM });
+            REQUIRE(pool.isValid());
+            TextureOptions colorOptions = transientOptions;
+            colorOptions.usage = TextureUsageFlagBits::ColorAttachmentBit;
+            colorOptions.memoryUsage = MemoryUsage::GpuOnly;
+            colorOptions.memoryPool = pool;
+            TextureOptions largerOptions = colorOptions;
+            largerOptions.extent = { 512, 512, 1 };
+
+            // WHEN
+            std::vector<Texture> textures = device.createAliasedTextures({ colorOptions, largerOptions });
+
+            // THEN
+            REQUIRE(textures.size() == 2);
+            CHECK(textures[0].isValid());
+            CHECK(textures[1].isValid());
+            CHECK(pool.statistics().allocationCount == 1);
+        }
+
+        SUBCASE("Aliasing no textures returns nothing")
+        {
+            CHECK(device.createAliasedTextures({}).empty());
+        }
+    }
 }
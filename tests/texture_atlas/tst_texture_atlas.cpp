@@ -0,0 +1,185 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/device.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/texture_atlas.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <vector>
+
+using namespace KDGpu;
+
+TEST_SUITE("TextureAtlas")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "texture_atlas",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice();
+
+    bool overlap(const TextureAtlasRegion &a, const TextureAtlasRegion &b)
+    {
+        return a.layer == b.layer &&
+                a.offset.x < b.offset.x + static_cast<int32_t>(b.extent.width) &&
+                b.offset.x < a.offset.x + static_cast<int32_t>(a.extent.width) &&
+                a.offset.y < b.offset.y + static_cast<int32_t>(b.extent.height) &&
+                b.offset.y < a.offset.y + static_cast<int32_t>(a.extent.height);
+    }
+
+    TEST_CASE("Construction")
+    {
+        SUBCASE("A default constructed TextureAtlas is invalid")
+        {
+            TextureAtlas atlas;
+            CHECK(!atlas.isValid());
+            CHECK(!atlas.upload());
+        }
+
+        SUBCASE("Compressed formats cannot be packed")
+        {
+            TextureAtlas atlas = device.createTextureAtlas(device.queues()[0], { .format = Format::BC1_RGB_UNORM_BLOCK });
+            CHECK(!atlas.isValid());
+        }
+
+        SUBCASE("Several layers create a texture array")
+        {
+            TextureAtlas atlas = device.createTextureAtlas(device.queues()[0], { .extent = { 256, 256 }, .layerCount = 3 });
+            CHECK(atlas.isValid());
+            CHECK(atlas.view().isValid());
+            CHECK(atlas.layerCount() == 3);
+        }
+    }
+
+    TEST_CASE("Packing")
+    {
+        REQUIRE(!device.queues().empty());
+        const std::vector<uint8_t> texels(32 * 32 * 4, 0xff);
+
+        SUBCASE("Images do not overlap and map to their UV rectangle")
+        {
+            // GIVEN
+            TextureAtlas atlas = device.createTextureAtlas(device.queues()[0], { .extent = { 128, 128 }, .padding = 2 });
+            std::vector<TextureAtlasRegion> regions;
+
+            // WHEN
+            for (uint32_t i = 0; i < 8; ++i)
+                regions.push_back(atlas.add(texels.data(), 16 + i, 32 - i));
+
+            // THEN
+            for (size_t i = 0; i < regions.size(); ++i) {
+                const TextureAtlasRegion &region = regions[i];
+                REQUIRE(region.isValid());
+                CHECK(region.offset.x + region.extent.width <= 128u);
+                CHECK(region.offset.y + region.extent.height <= 128u);
+                CHECK(region.uvOffset[0] == doctest::Approx(region.offset.x / 128.0f));
+                CHECK(region.uvScale[1] == doctest::Approx(region.extent.height / 128.0f));
+                for (size_t j = 0; j < i; ++j)
+                    CHECK(!overlap(region, regions[j]));
+            }
+            CHECK(atlas.statistics().imageCount == 8);
+            CHECK(atlas.statistics().occupancy > 0.0f);
+        }
+
+        SUBCASE("Full layers spill into the next one")
+        {
+            // GIVEN
+            TextureAtlas atlas = device.createTextureAtlas(device.queues()[0], { .extent = { 64, 64 }, .layerCount = 2, .padding = 0 });
+
+            // WHEN
+            std::vector<TextureAtlasRegion> regions;
+            for (uint32_t i = 0; i < 5; ++i)
+                regions.push_back(atlas.add(texels.data(), 32, 32));
+
+            // THEN -> 4 images fill a layer, the last one does not fit anymore
+            for (uint32_t i = 0; i < 4; ++i)
+                CHECK(regions[i].layer == 0);
+            CHECK(regions[4].layer == 1);
+            CHECK(atlas.statistics().layersInUse == 2);
+
+            // WHEN
+            for (uint32_t i = 0; i < 3; ++i)
+                CHECK(atlas.add(texels.data(), 32, 32).isValid());
+
+            // THEN
+            CHECK(!atlas.add(texels.data(), 32, 32).isValid());
+            CHECK(atlas.statistics().occupancy == doctest::Approx(1.0f));
+
+            // WHEN
+            atlas.clear();
+
+            // THEN
+            CHECK(atlas.statistics().imageCount == 0);
+            CHECK(atlas.add(texels.data(), 32, 32).layer == 0);
+        }
+
+        SUBCASE("Images larger than the atlas are rejected")
+        {
+            TextureAtlas atlas = device.createTextureAtlas(device.queues()[0], { .extent = { 16, 16 } });
+            CHECK(!atlas.add(texels.data(), 32, 8).isValid());
+        }
+    }
+
+    TEST_CASE("Upload")
+    {
+        REQUIRE(!device.queues().empty());
+        const std::vector<uint8_t> texels(16 * 16 * 4, 0x80);
+
+        SUBCASE("All the pending images are uploaded with a single submission")
+        {
+            // GIVEN
+            TextureAtlas atlas = device.createTextureAtlas(device.queues()[0], { .extent = { 128, 128 } });
+            for (uint32_t i = 0; i < 10; ++i)
+                atlas.add(texels.data(), 16, 16);
+            CHECK(atlas.hasPendingUploads());
+            CHECK(atlas.statistics().pendingImageCount == 10);
+            CHECK(atlas.statistics().pendingBytes >= texels.size() * 10);
+
+            // WHEN
+            const bool uploaded = atlas.upload();
+
+            // THEN
+            CHECK(uploaded);
+            CHECK(!atlas.hasPendingUploads());
+            CHECK(atlas.statistics().uploadCount == 1);
+            CHECK(!atlas.upload());
+
+            device.queues()[0].waitUntilIdle();
+        }
+
+        SUBCASE("Assigning over an atlas with uploads in flight takes over the other atlas")
+        {
+            // GIVEN
+            TextureAtlas atlas = device.createTextureAtlas(device.queues()[0], { .extent = { 128, 128 } });
+            atlas.add(texels.data(), 16, 16);
+            REQUIRE(atlas.upload());
+            TextureAtlas other = device.createTextureAtlas(device.queues()[0], { .extent = { 64, 64 } });
+            other.add(texels.data(), 16, 16);
+            other.add(texels.data(), 16, 16);
+
+            // WHEN
+            atlas = std::move(other);
+
+            // THEN
+            CHECK(atlas.isValid());
+            CHECK(atlas.extent().width == 64);
+            CHECK(atlas.statistics().pendingImageCount == 2);
+            CHECK(atlas.statistics().uploadCount == 0);
+            CHECK(atlas.upload());
+            CHECK(atlas.statistics().uploadCount == 1);
+
+            device.queues()[0].waitUntilIdle();
+        }
+    }
+}
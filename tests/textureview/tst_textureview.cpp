@@ -12,6 +12,7 @@
 #include <KDGpu/texture_options.h>
 #include <KDGpu/device.h>
 #include <KDGpu/instance.h>
+#include <KDGpu/resource_manager.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
 #include <set>
@@ -147,8 +148,58 @@ TEST_SUITE("TextureView")
             // WHEN
             Texture t = device.createTexture(textureOptions);
             TextureView a = t.createView();
+            TextureView b = t.createView({ .viewType = ViewType::ViewType2DArray });
+
+            // THEN
+            CHECK(a != b);
+        }
+    }
+
+    TEST_CASE("Deduplication")
+    {
+        ResourceManager *resourceManager = api->resourceManager();
+        const TextureOptions textureOptions = {
+            .type = TextureType::TextureType2D,
+            .format = Format::R8G8B8A8_UNORM,
+            .extent = { 64, 64, 1 },
+            .mipLevels = 1,
+            .usage = TextureUsageFlagBits::SampledBit,
+            .memoryUsage = MemoryUsage::GpuOnly
+        };
+
+        SUBCASE("Identical views of a texture share a single view")
+        {
+            // GIVEN
+            Texture t = device.createTexture(textureOptions);
+            const auto before = resourceManager->deviceStatistics(device.handle()).textureViewCache;
+
+            // WHEN
+            TextureView a = t.createView();
             TextureView b = t.createView();
 
+            // THEN
+            CHECK(a == b);
+            const auto after = resourceManager->deviceStatistics(device.handle()).textureViewCache;
+            CHECK(after.objectCount == before.objectCount + 1);
+            CHECK(after.hitCount == before.hitCount + 1);
+
+            // WHEN
+            a = {};
+
+            // THEN
+            CHECK(resourceManager->getTextureView(b.handle()) != nullptr);
+        }
+
+        SUBCASE("Identical views of different textures are not shared")
+        {
+            // GIVEN
+            Texture t1 = device.createTexture(textureOptions);
+            Texture t2 = device.createTexture(textureOptions);
+
+            // WHEN
+            TextureView a = t1.createView();
+            TextureView b = t2.createView();
+
             // THEN
             CHECK(a != b);
         }
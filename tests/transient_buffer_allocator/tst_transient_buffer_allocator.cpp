@@ -0,0 +1,169 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/device.h>
+#include <KDGpu/instance.h>
+#include <KDGpu/transient_buffer_allocator.h>
+#include <KDGpu/vulkan/vulkan_graphics_api.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+using namespace KDGpu;
+
+TEST_SUITE("TransientBufferAllocator")
+{
+    std::unique_ptr<GraphicsApi> api = std::make_unique<VulkanGraphicsApi>();
+    Instance instance = api->createInstance(InstanceOptions{
+            .applicationName = "transient_buffer_allocator",
+            .applicationVersion = SERENITY_MAKE_API_VERSION(0, 1, 0, 0) });
+    Adapter *discreteGPUAdapter = instance.selectAdapter(AdapterDeviceType::Default);
+    Device device = discreteGPUAdapter->createDevice();
+
+    const TransientBufferAllocatorOptions allocatorOptions = {
+        .sizePerFrame = 4096,
+        .framesInFlight = 2
+    };
+
+    TEST_CASE("Construction")
+    {
+        SUBCASE("A default constructed TransientBufferAllocator is invalid")
+        {
+            // GIVEN
+            TransientBufferAllocator allocator;
+
+            // THEN
+            CHECK(!allocator.isValid());
+            CHECK(!allocator.allocate(16).isValid());
+        }
+
+        SUBCASE("A constructed TransientBufferAllocator owns one region per frame in flight")
+        {
+            // WHEN
+            TransientBufferAllocator allocator = device.createTransientBufferAllocator(allocatorOptions);
+
+            // THEN
+            CHECK(allocator.isValid());
+            CHECK(allocator.buffer().isPersistentlyMapped());
+            CHECK(allocator.framesInFlight() == 2);
+            CHECK(allocator.regionSize() >= allocatorOptions.sizePerFrame);
+            CHECK(allocator.regionSize() % allocator.alignment() == 0);
+            CHECK(allocator.alignment() >= discreteGPUAdapter->properties().limits.minUniformBufferOffsetAlignment);
+        }
+
+        SUBCASE("Move construction transfers the buffer")
+        {
+            // GIVEN
+            TransientBufferAllocator a = device.createTransientBufferAllocator(allocatorOptions);
+            const Handle<Buffer_t> bufferHandle = a.buffer().handle();
+
+            // WHEN
+            TransientBufferAllocator b = std::move(a);
+
+            // THEN
+            CHECK(!a.isValid());
+            CHECK(b.isValid());
+            CHECK(b.buffer().handle() == bufferHandle);
+        }
+    }
+
+    TEST_CASE("Allocation")
+    {
+        TransientBufferAllocator allocator = device.createTransientBufferAllocator(allocatorOptions);
+        REQUIRE(allocator.isValid());
+
+        SUBCASE("Allocations are aligned and do not overlap")
+        {
+            // WHEN
+            const TransientAllocation a = allocator.allocate(4);
+            const TransientAllocation b = allocator.allocate(64);
+
+            // THEN
+            REQUIRE(a.isValid());
+            REQUIRE(b.isValid());
+            CHECK(a.buffer == allocator.buffer().handle());
+            CHECK(a.offset % allocator.alignment() == 0);
+            CHECK(b.offset % allocator.alignment() == 0);
+            CHECK(b.offset >= a.offset + a.size);
+            CHECK(static_cast<uint8_t *>(b.data) - static_cast<uint8_t *>(a.data) == static_cast<ptrdiff_t>(b.offset - a.offset));
+        }
+
+        SUBCASE("Uploaded data is written through the mapping")
+        {
+            // WHEN
+            const float value[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+            const TransientAllocation allocation = allocator.upload(value);
+            allocator.flush();
+
+            // THEN
+            REQUIRE(allocation.isValid());
+            CHECK(allocation.size == sizeof(value));
+            const float *rawData = static_cast<const float *>(allocation.data);
+            CHECK(rawData[0] == 1.0f);
+            CHECK(rawData[3] == 4.0f);
+            CHECK(allocation.dynamicOffset() == allocation.offset);
+        }
+
+        SUBCASE("Allocating past the end of the frame region fails")
+        {
+            // WHEN
+            const TransientAllocation fits = allocator.allocate(allocator.regionSize());
+            const TransientAllocation overflow = allocator.allocate(1);
+
+            // THEN
+            CHECK(fits.isValid());
+            CHECK(!overflow.isValid());
+            CHECK(allocator.statistics().failedAllocationCount == 1);
+            CHECK(allocator.statistics().usedBytes == allocator.regionSize());
+        }
+
+        SUBCASE("Each frame in flight allocates from its own region")
+        {
+            // WHEN
+            const TransientAllocation first = allocator.allocate(16);
+            allocator.beginFrame();
+            const TransientAllocation second = allocator.allocate(16);
+
+            // THEN
+            CHECK(allocator.currentFrameIndex() == 1);
+            CHECK(second.offset >= first.offset + allocator.regionSize());
+            CHECK(allocator.statistics().usedBytes == 16);
+
+            // WHEN
+            allocator.beginFrame();
+            const TransientAllocation third = allocator.allocate(16);
+
+            // THEN -> The region of the first frame is recycled
+            CHECK(allocator.currentFrameIndex() == 0);
+            CHECK(third.offset == first.offset);
+            CHECK(allocator.statistics().allocationCount == 3);
+            CHECK(allocator.statistics().peakUsedBytes == 16);
+        }
+
+        SUBCASE("Recycling a region waits for the fence of its frame")
+        {
+            // GIVEN
+            Fence fence = device.createFence({ .createSignalled = false });
+            Queue &queue = device.queues()[0];
+            CommandRecorder recorder = device.createCommandRecorder();
+            CommandBuffer commandBuffer = recorder.finish();
+
+            allocator.allocate(16);
+            queue.submit({ .commandBuffers = { commandBuffer }, .signalFence = fence });
+
+            // WHEN
+            allocator.beginFrame(fence);
+
+            // THEN
+            CHECK(fence.status() == FenceStatus::Signalled);
+            CHECK(allocator.statistics().usedBytes == 0);
+        }
+    }
+}
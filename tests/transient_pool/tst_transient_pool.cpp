@@ -0,0 +1,235 @@
+/*
+  This file is part of KDGpu.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <KDGpu/transient_pool.h>
+
+#include <vector>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+struct int_tag;
+using IntPool = KDGpu::TransientPool<int, int_tag>;
+
+static_assert(std::is_nothrow_destructible<IntPool>{});
+static_assert(std::is_nothrow_default_constructible<IntPool>{});
+static_assert(!std::is_copy_constructible<IntPool>{});
+static_assert(!std::is_copy_assignable<IntPool>{});
+static_assert(std::is_nothrow_move_constructible<IntPool>{});
+static_assert(std::is_nothrow_move_assignable<IntPool>{});
+
+TEST_CASE("Construction")
+{
+    SUBCASE("A default constructed pool is empty")
+    {
+        IntPool pool;
+        REQUIRE(pool.capacity() == 0);
+        REQUIRE(pool.size() == 0);
+    }
+
+    SUBCASE("A constructed pool with a size is empty but has capacity in whole chunks")
+    {
+        IntPool pool(10);
+        REQUIRE(pool.capacity() == IntPool::ChunkSize);
+        REQUIRE(pool.size() == 0);
+    }
+
+    SUBCASE("A move constructed pool maintains the elements and resets the original")
+    {
+        IntPool pool;
+        auto handle = pool.insert(1);
+        auto handle2 = pool.insert(2);
+
+        auto secondPool = std::move(pool);
+        REQUIRE(pool.capacity() == 0);
+        REQUIRE(pool.size() == 0);
+        REQUIRE(pool.get(handle) == nullptr);
+        REQUIRE(pool.get(handle2) == nullptr);
+
+        REQUIRE(secondPool.size() == 2);
+        REQUIRE(*secondPool.get(handle) == 1);
+        REQUIRE(*secondPool.get(handle2) == 2);
+    }
+}
+
+TEST_CASE("Insertion and removal")
+{
+    SUBCASE("Values can be inserted and retrieved")
+    {
+        IntPool pool;
+        auto handle = pool.insert(42);
+        auto handle2 = pool.emplace(43);
+
+        REQUIRE(handle.isValid());
+        REQUIRE(handle2.isValid());
+        REQUIRE(pool.size() == 2);
+        REQUIRE(*pool.get(handle) == 42);
+        REQUIRE(*pool.get(handle2) == 43);
+    }
+
+    SUBCASE("An invalid handle never resolves")
+    {
+        IntPool pool;
+        pool.insert(1);
+        REQUIRE(pool.get({}) == nullptr);
+    }
+
+    SUBCASE("Removed entries are not reused while other entries are alive")
+    {
+        IntPool pool;
+        auto handle = pool.insert(1);
+        auto handle2 = pool.insert(2);
+        pool.remove(handle);
+        REQUIRE(pool.get(handle) == nullptr);
+        REQUIRE(pool.size() == 1);
+
+        auto handle3 = pool.insert(3);
+        REQUIRE(handle3.index() != handle.index());
+        REQUIRE(*pool.get(handle2) == 2);
+        REQUIRE(*pool.get(handle3) == 3);
+    }
+
+    SUBCASE("Removing the last alive entry rewinds the arena and invalidates old handles")
+    {
+        IntPool pool;
+        auto handle = pool.insert(1);
+        auto handle2 = pool.insert(2);
+        pool.remove(handle2);
+        pool.remove(handle);
+        REQUIRE(pool.size() == 0);
+
+        auto handle3 = pool.insert(3);
+        REQUIRE(handle3.index() == handle.index());
+        REQUIRE(handle3.generation() != handle.generation());
+        REQUIRE(pool.get(handle) == nullptr);
+        REQUIRE(pool.get(handle2) == nullptr);
+        REQUIRE(*pool.get(handle3) == 3);
+
+        // Removing a stale handle again must not disturb the current entries
+        pool.remove(handle);
+        REQUIRE(pool.size() == 1);
+        REQUIRE(*pool.get(handle3) == 3);
+    }
+
+    SUBCASE("Clear invalidates all handles, but leaves capacity unchanged")
+    {
+        IntPool pool;
+        std::vector<KDGpu::Handle<int_tag>> handles;
+        for (int i = 0; i < 40; ++i)
+            handles.push_back(pool.insert(i));
+        const uint32_t capacity = pool.capacity();
+
+        pool.clear();
+        REQUIRE(pool.size() == 0);
+        REQUIRE(pool.capacity() == capacity);
+        for (const auto &handle : handles)
+            REQUIRE(pool.get(handle) == nullptr);
+    }
+
+    SUBCASE("Entries outliving their frame do not make the arena grow")
+    {
+        IntPool pool;
+        auto longLived = pool.insert(-1);
+
+        // Each frame's last entry is only removed during the next frame, so the arena never empties
+        auto previous = pool.insert(0);
+        std::vector<KDGpu::Handle<int_tag>> staleHandles;
+        for (int frame = 1; frame < 100; ++frame) {
+            std::vector<KDGpu::Handle<int_tag>> handles;
+            for (int i = 0; i < 10; ++i)
+                handles.push_back(pool.insert(frame));
+            pool.remove(previous);
+            staleHandles.push_back(previous);
+            previous = handles.back();
+            handles.pop_back();
+            for (const auto &handle : handles)
+                pool.remove(handle);
+            staleHandles.insert(staleHandles.end(), handles.begin(), handles.end());
+        }
+
+        REQUIRE(pool.size() == 2);
+        REQUIRE(pool.capacity() == IntPool::ChunkSize);
+        REQUIRE(*pool.get(longLived) == -1);
+        REQUIRE(*pool.get(previous) == 99);
+        for (const auto &handle : staleHandles)
+            REQUIRE(pool.get(handle) == nullptr);
+    }
+
+    SUBCASE("Growing keeps existing entries at the same address")
+    {
+        IntPool pool;
+        auto handle = pool.insert(42);
+        const int *firstPtr = pool.get(handle);
+        for (uint32_t i = 0; i < 4 * IntPool::ChunkSize; ++i)
+            pool.insert(int(i));
+        REQUIRE(pool.get(handle) == firstPtr);
+        REQUIRE(*firstPtr == 42);
+    }
+}
+
+TEST_CASE("Statistics")
+{
+    SUBCASE("Frames after the first one reuse the storage of the arena")
+    {
+        IntPool pool;
+        for (int frame = 0; frame < 3; ++frame) {
+            auto handle = pool.insert(frame);
+            auto handle2 = pool.insert(frame);
+            pool.remove(handle);
+            pool.remove(handle2);
+        }
+
+        const auto stats = pool.statistics();
+        REQUIRE(stats.liveCount == 0);
+        REQUIRE(stats.highWaterMark == 2);
+        REQUIRE(stats.capacity == IntPool::ChunkSize);
+        REQUIRE(stats.insertCount == 6);
+        REQUIRE(stats.reuseCount == 4);
+    }
+}
+
+class Counted
+{
+public:
+    explicit Counted(int value) noexcept
+        : m_value(value)
+    {
+        ++ms_alive;
+    }
+    ~Counted() { --ms_alive; }
+
+    int value() const noexcept { return m_value; }
+
+    static int ms_alive;
+
+private:
+    int m_value;
+};
+
+int Counted::ms_alive = 0;
+
+struct Counted_tag;
+
+TEST_CASE("Non-trivial types")
+{
+    SUBCASE("Entries are destroyed on removal and when the pool is destroyed")
+    {
+        {
+            KDGpu::TransientPool<Counted, Counted_tag> pool;
+            auto handle = pool.emplace(1);
+            pool.emplace(2);
+            REQUIRE(Counted::ms_alive == 2);
+
+            pool.remove(handle);
+            REQUIRE(Counted::ms_alive == 1);
+        }
+        REQUIRE(Counted::ms_alive == 0);
+    }
+}